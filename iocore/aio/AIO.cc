@@ -27,9 +27,17 @@
 
 #include "P_AIO.h"
 
-#if AIO_MODE == AIO_MODE_NATIVE
+#if AIO_MODE == AIO_MODE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#endif
+
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
 #define AIO_PERIOD                                -HRTIME_MSECONDS(4)
-#else
+#endif
+
+#if AIO_MODE != AIO_MODE_NATIVE
 
 #define MAX_DISKS_POSSIBLE 100
 
@@ -143,6 +151,20 @@ ink_aio_set_callback(Continuation *callback)
   aio_err_callbck = callback;
 }
 
+#if AIO_MODE != AIO_MODE_IO_URING
+void
+ink_aio_register_buffer(void * /* buf ATS_UNUSED */, size_t /* len ATS_UNUSED */)
+{
+}
+
+void
+ink_aio_unregister_buffer(void * /* buf ATS_UNUSED */)
+{
+}
+#else
+static ink_mutex aio_buffers_mutex;
+#endif
+
 void
 ink_aio_init(ModuleVersion v)
 {
@@ -162,6 +184,9 @@ ink_aio_init(ModuleVersion v)
 #if AIO_MODE != AIO_MODE_NATIVE
   memset(&aio_reqs, 0, MAX_DISKS_POSSIBLE * sizeof(AIO_Reqs *));
   ink_mutex_init(&insert_mutex, NULL);
+#endif
+#if AIO_MODE == AIO_MODE_IO_URING
+  ink_mutex_init(&aio_buffers_mutex, NULL);
 #endif
   REC_ReadConfigInteger(cache_config_threads_per_disk, "proxy.config.cache.threads_per_disk");
 }
@@ -179,6 +204,9 @@ ink_aio_start()
 #if  AIO_MODE != AIO_MODE_NATIVE
 
 static void *aio_thread_main(void *arg);
+#if AIO_MODE == AIO_MODE_IO_URING
+static bool aio_uring_queue(AIOCallbackInternal *op);
+#endif
 
 struct AIOThreadInfo:public Continuation
 {
@@ -395,6 +423,19 @@ aio_queue_req(AIOCallbackInternal *op, int fromAPI = 0)
   }
 }
 
+/* tell the error callback about a failed operation on fildes */
+static void
+aio_disk_failed(int fildes)
+{
+  if (aio_err_callbck) {
+    AIOCallback *callback_op = new AIOCallbackInternal();
+    callback_op->aiocb.aio_fildes = fildes;
+    callback_op->mutex = aio_err_callbck->mutex;
+    callback_op->action = aio_err_callbck;
+    eventProcessor.schedule_imm(callback_op);
+  }
+}
+
 static inline int
 cache_op(AIOCallbackInternal *op)
 {
@@ -442,6 +483,9 @@ ink_aio_read(AIOCallback *op, int fromAPI)
   op->action.continuation->handleEvent(AIO_EVENT_DONE, op);
 #elif (AIO_MODE == AIO_MODE_THREAD)
   aio_queue_req((AIOCallbackInternal *) op, fromAPI);
+#elif (AIO_MODE == AIO_MODE_IO_URING)
+  if (fromAPI || !aio_uring_queue((AIOCallbackInternal *) op))
+    aio_queue_req((AIOCallbackInternal *) op, fromAPI);
 #endif
 
   return 1;
@@ -465,6 +509,9 @@ ink_aio_write(AIOCallback *op, int fromAPI)
   op->action.continuation->handleEvent(AIO_EVENT_DONE, op);
 #elif (AIO_MODE == AIO_MODE_THREAD)
   aio_queue_req((AIOCallbackInternal *) op, fromAPI);
+#elif (AIO_MODE == AIO_MODE_IO_URING)
+  if (fromAPI || !aio_uring_queue((AIOCallbackInternal *) op))
+    aio_queue_req((AIOCallbackInternal *) op, fromAPI);
 #endif
 
   return 1;
@@ -511,15 +558,8 @@ aio_thread_main(void *arg)
         aio_bytes_read += op->aiocb.aio_nbytes;
       }
       ink_mutex_release(&current_req->aio_mutex);
-      if (cache_op((AIOCallbackInternal *) op) <= 0) {
-        if (aio_err_callbck) {
-          AIOCallback *callback_op = new AIOCallbackInternal();
-          callback_op->aiocb.aio_fildes = op->aiocb.aio_fildes;
-          callback_op->mutex = aio_err_callbck->mutex;
-          callback_op->action = aio_err_callbck;
-          eventProcessor.schedule_imm(callback_op);
-        }
-      }
+      if (cache_op((AIOCallbackInternal *) op) <= 0)
+        aio_disk_failed(op->aiocb.aio_fildes);
       ink_atomic_increment((int *) &current_req->requests_queued, -1);
 #ifdef AIO_STATS
       ink_atomic_increment((int *) &current_req->pending, -1);
@@ -669,3 +709,381 @@ ink_aio_writev(AIOCallback *op, int /* fromAPI ATS_UNUSED */) {
   return 1;
 }
 #endif // AIO_MODE != AIO_MODE_NATIVE
+
+#if AIO_MODE == AIO_MODE_IO_URING
+
+/*
+ * io_uring
+ *
+ * Each net thread owns a ring.  Operations issued on the thread are
+ * queued on its DiskHandler, which once per event loop puts them into the
+ * submission queue with a single io_uring_enter() and delivers the
+ * completions reaped from the completion queue.  Operations issued from
+ * other threads, or through the API, go to the aio threads as before.
+ */
+
+#define AIO_URING_ENTRIES     1024
+#define AIO_MAX_BUFFERS       256
+
+static int aio_mode = AIO_MODE_IO_URING;
+
+// registered buffers, see ink_aio_register_buffer()
+static struct iovec aio_buffers[AIO_MAX_BUFFERS];
+static int aio_n_buffers = 0;
+static volatile int aio_buffers_generation = 0;
+
+struct AIOUring
+{
+  int fd;
+  unsigned entries;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned sq_mask;
+  unsigned *sq_array;
+  unsigned sq_local_tail;       // tail including the entries not yet published
+  int to_submit;
+  io_uring_sqe *sqes;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  io_uring_cqe *cqes;
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+  int n_buffers;                // buffers registered with this ring
+  struct iovec buffers[AIO_MAX_BUFFERS];
+
+  bool init(unsigned n);
+  io_uring_sqe *get_sqe();
+  int submit();
+  int find_buffer(char *buf, size_t len);
+
+  AIOUring()
+    : fd(-1), entries(0), sq_local_tail(0), to_submit(0), sqes(NULL), sq_ring(NULL), sq_ring_size(0),
+      cq_ring(NULL), cq_ring_size(0), sqes_size(0), n_buffers(0)
+  { }
+  ~AIOUring();
+};
+
+static void *
+aio_uring_mmap(int fd, size_t size, off_t offset)
+{
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+bool
+AIOUring::init(unsigned n)
+{
+  io_uring_params p;
+
+  memset(&p, 0, sizeof(p));
+  fd = syscall(__NR_io_uring_setup, n, &p);
+  if (fd < 0)
+    return false;
+  entries = p.sq_entries;
+  sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    sq_ring_size = cq_ring_size = max(sq_ring_size, cq_ring_size);
+  if (!(sq_ring = aio_uring_mmap(fd, sq_ring_size, IORING_OFF_SQ_RING)))
+    return false;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    cq_ring = sq_ring;
+  else if (!(cq_ring = aio_uring_mmap(fd, cq_ring_size, IORING_OFF_CQ_RING)))
+    return false;
+  sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+  if (!(sqes = (io_uring_sqe *) aio_uring_mmap(fd, sqes_size, IORING_OFF_SQES)))
+    return false;
+
+  char *sq = (char *) sq_ring;
+  sq_head = (unsigned *) (sq + p.sq_off.head);
+  sq_tail = (unsigned *) (sq + p.sq_off.tail);
+  sq_mask = *(unsigned *) (sq + p.sq_off.ring_mask);
+  sq_array = (unsigned *) (sq + p.sq_off.array);
+  sq_local_tail = *sq_tail;
+
+  char *cq = (char *) cq_ring;
+  cq_head = (unsigned *) (cq + p.cq_off.head);
+  cq_tail = (unsigned *) (cq + p.cq_off.tail);
+  cq_mask = *(unsigned *) (cq + p.cq_off.ring_mask);
+  cqes = (io_uring_cqe *) (cq + p.cq_off.cqes);
+  return true;
+}
+
+AIOUring::~AIOUring()
+{
+  if (sqes)
+    munmap(sqes, sqes_size);
+  if (cq_ring && cq_ring != sq_ring)
+    munmap(cq_ring, cq_ring_size);
+  if (sq_ring)
+    munmap(sq_ring, sq_ring_size);
+  if (fd >= 0)
+    close(fd);
+}
+
+io_uring_sqe *
+AIOUring::get_sqe()
+{
+  if (sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= entries)
+    return NULL;
+  unsigned idx = sq_local_tail & sq_mask;
+  sq_array[idx] = idx;
+  sq_local_tail++;
+  to_submit++;
+  memset(&sqes[idx], 0, sizeof(io_uring_sqe));
+  return &sqes[idx];
+}
+
+int
+AIOUring::submit()
+{
+  int ret;
+
+  __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+  do {
+    ret = syscall(__NR_io_uring_enter, fd, to_submit, 0, 0, NULL, 0);
+  } while (ret < 0 && errno == EINTR);
+  if (ret > 0)
+    to_submit -= ret;
+  return ret;
+}
+
+int
+AIOUring::find_buffer(char *buf, size_t len)
+{
+  for (int i = 0; i < n_buffers; i++) {
+    char *b = (char *) buffers[i].iov_base;
+    if (buf >= b && buf + len <= b + buffers[i].iov_len)
+      return i;
+  }
+  return -1;
+}
+
+int
+ink_aio_mode()
+{
+  return aio_mode;
+}
+
+void
+ink_aio_mode_set(int mode)
+{
+  ink_assert(mode == AIO_MODE_IO_URING || mode == AIO_MODE_THREAD);
+  aio_mode = mode;
+}
+
+void
+ink_aio_register_buffer(void *buf, size_t len)
+{
+  ink_mutex_acquire(&aio_buffers_mutex);
+  if (aio_n_buffers < AIO_MAX_BUFFERS) {
+    aio_buffers[aio_n_buffers].iov_base = buf;
+    aio_buffers[aio_n_buffers].iov_len = len;
+    aio_n_buffers++;
+    ink_atomic_increment(&aio_buffers_generation, 1);
+  }
+  ink_mutex_release(&aio_buffers_mutex);
+}
+
+void
+ink_aio_unregister_buffer(void *buf)
+{
+  ink_mutex_acquire(&aio_buffers_mutex);
+  for (int i = 0; i < aio_n_buffers; i++) {
+    if (aio_buffers[i].iov_base == buf) {
+      aio_buffers[i] = aio_buffers[--aio_n_buffers];
+      ink_atomic_increment(&aio_buffers_generation, 1);
+      break;
+    }
+  }
+  ink_mutex_release(&aio_buffers_mutex);
+}
+
+DiskHandler::DiskHandler()
+  : trigger_event(NULL), ring(new AIOUring), in_flight(0), buffers_generation(0)
+{
+  SET_HANDLER(&DiskHandler::startAIOEvent);
+  if (!ring->init(AIO_URING_ENTRIES)) {
+    Warning("unable to set up io_uring, using the aio threads: %s", strerror(errno));
+    delete ring;
+    ring = NULL;
+  }
+}
+
+DiskHandler::~DiskHandler()
+{
+  delete ring;
+}
+
+int
+DiskHandler::startAIOEvent(int /* event ATS_UNUSED */, Event *e)
+{
+  if (!ring)
+    return EVENT_DONE;
+#if HAVE_EVENTFD
+  // completions wake the thread up through its eventfd
+  int evfd = this_ethread()->evfd;
+  if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_EVENTFD, &evfd, 1) < 0)
+    Warning("unable to register the thread eventfd with io_uring: %s", strerror(errno));
+#endif
+  SET_HANDLER(&DiskHandler::mainAIOEvent);
+  e->schedule_every(AIO_PERIOD);
+  trigger_event = e;
+  return EVENT_CONT;
+}
+
+// Registered buffers can only be changed while nothing is in flight.
+void
+DiskHandler::update_buffers()
+{
+  if (buffers_generation == aio_buffers_generation)
+    return;
+  if (ring->n_buffers) {
+    syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    ring->n_buffers = 0;
+  }
+  ink_mutex_acquire(&aio_buffers_mutex);
+  int n = aio_n_buffers;
+  memcpy(ring->buffers, aio_buffers, n * sizeof(struct iovec));
+  buffers_generation = aio_buffers_generation;
+  ink_mutex_release(&aio_buffers_mutex);
+  if (n > 0) {
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, ring->buffers, n) == 0)
+      ring->n_buffers = n;
+    else
+      Debug("aio", "unable to register %d buffers with io_uring: %s", n, strerror(errno));
+  }
+}
+
+static void
+aio_uring_prep(DiskHandler *dh, io_uring_sqe *sqe, AIOCallbackInternal *op)
+{
+  ink_aiocb_t *a = &op->aiocb;
+  char *buf = (char *) a->aio_buf + op->aio_result;
+  size_t len = a->aio_nbytes - op->aio_result;
+  bool read = a->aio_lio_opcode == LIO_READ;
+  int i = -1;
+
+  // the ring's buffers are only current if none were (un)registered since
+  if (dh->buffers_generation == aio_buffers_generation)
+    i = dh->ring->find_buffer(buf, len);
+  if (i >= 0) {
+    sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+    sqe->buf_index = i;
+  } else
+    sqe->opcode = read ? IORING_OP_READ : IORING_OP_WRITE;
+  sqe->fd = a->aio_fildes;
+  sqe->addr = (uintptr_t) buf;
+  sqe->len = len;
+  sqe->off = a->aio_offset + op->aio_result;
+  sqe->user_data = (uintptr_t) op;
+}
+
+static void
+aio_uring_complete(AIOCallbackInternal *op, EThread *t)
+{
+  op->link.prev = NULL;
+  op->link.next = NULL;
+  op->mutex = op->action.mutex;
+  if (op->thread != AIO_CALLBACK_THREAD_ANY && op->thread != AIO_CALLBACK_THREAD_AIO && op->thread != t) {
+    op->thread->schedule_imm_signal(op);
+    return;
+  }
+  if (!op->mutex) {
+    op->handleEvent(AIO_EVENT_DONE, NULL);
+    return;
+  }
+  MUTEX_TRY_LOCK(lock, op->mutex, t);
+  if (lock)
+    op->handleEvent(AIO_EVENT_DONE, NULL);
+  else
+    t->schedule_imm(op);
+}
+
+int
+DiskHandler::mainAIOEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+{
+  EThread *t = this_ethread();
+  AIOCallbackInternal *op;
+
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++) {
+    io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+    op = (AIOCallbackInternal *) (uintptr_t) cqe->user_data;
+    in_flight--;
+    if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+      ready_list.push(op);
+      continue;
+    }
+    if (cqe->res <= 0) {
+      Warning("cache disk operation failed %s %d\n", (op->aiocb.aio_lio_opcode == LIO_READ) ? "READ" : "WRITE", cqe->res);
+      op->aio_result = cqe->res ? cqe->res : -EIO;
+      aio_disk_failed(op->aiocb.aio_fildes);
+    } else {
+      op->aio_result += cqe->res;
+      if (op->aio_result < (int64_t) op->aiocb.aio_nbytes) {
+        // short transfer, queue the rest
+        ready_list.push(op);
+        continue;
+      }
+    }
+    AIOCallbackInternal *first = (AIOCallbackInternal *) op->first;
+    if (--first->pending == 0)
+      complete_list.enqueue(first);
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+  if (!in_flight)
+    update_buffers();
+
+  // the completion queue is twice the size of the submission queue, so
+  // bounding in_flight by the latter keeps it from overflowing
+  while (in_flight < (int) ring->entries && (op = (AIOCallbackInternal *) ready_list.dequeue())) {
+    io_uring_sqe *sqe = ring->get_sqe();
+    if (!sqe) {
+      ready_list.push(op);
+      break;
+    }
+    aio_uring_prep(this, sqe, op);
+    in_flight++;
+  }
+  if (ring->to_submit && ring->submit() < 0 && errno != EAGAIN && errno != EBUSY)
+    Warning("io_uring_enter failed: %s", strerror(errno));
+
+  while ((op = (AIOCallbackInternal *) complete_list.dequeue()))
+    aio_uring_complete(op, t);
+  return EVENT_CONT;
+}
+
+/* queue op and the operations chained to it on this thread's ring */
+static bool
+aio_uring_queue(AIOCallbackInternal *op)
+{
+  EThread *t = this_ethread();
+  DiskHandler *dh = t ? t->diskHandler : NULL;
+
+  if (aio_mode != AIO_MODE_IO_URING || !dh || !dh->ring)
+    return false;
+  op->pending = 0;
+  for (AIOCallbackInternal *io = op; io; io = (AIOCallbackInternal *) io->then) {
+    io->aiocb.aio_lio_opcode = op->aiocb.aio_lio_opcode;
+    io->first = op;
+    io->aio_result = 0;
+    op->pending++;
+    if (io->aiocb.aio_lio_opcode == LIO_WRITE) {
+      aio_num_write++;
+      aio_bytes_written += io->aiocb.aio_nbytes;
+    } else {
+      aio_num_read++;
+      aio_bytes_read += io->aiocb.aio_nbytes;
+    }
+    dh->ready_list.enqueue(io);
+  }
+  return true;
+}
+#endif // AIO_MODE == AIO_MODE_IO_URING
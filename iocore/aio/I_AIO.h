@@ -47,9 +47,12 @@
 #define AIO_MODE_SYNC            1
 #define AIO_MODE_THREAD          2
 #define AIO_MODE_NATIVE          3
+#define AIO_MODE_IO_URING        4
 
 #if TS_USE_LINUX_NATIVE_AIO
 #define AIO_MODE                 AIO_MODE_NATIVE
+#elif TS_USE_LINUX_IO_URING
+#define AIO_MODE                 AIO_MODE_IO_URING
 #else
 #define AIO_MODE                 AIO_MODE_THREAD
 #endif
@@ -149,8 +152,46 @@ struct DiskHandler: public Continuation
     }
   }
 };
+
+#elif AIO_MODE == AIO_MODE_IO_URING
+
+struct AIOUring;
+
+/*
+  Per event thread io_uring.  Reads and writes issued on the thread are
+  queued and submitted together once per event loop, and the completions
+  are reaped on the same thread.  The ring signals the thread's eventfd so
+  that a sleeping thread is woken up by completions.
+*/
+struct DiskHandler: public Continuation
+{
+  Event *trigger_event;
+  AIOUring *ring;
+  int in_flight;
+  int buffers_generation;
+  Que(AIOCallback, link) ready_list;
+  Que(AIOCallback, link) complete_list;
+  int startAIOEvent(int event, Event *e);
+  int mainAIOEvent(int event, Event *e);
+  void update_buffers();
+  DiskHandler();
+  ~DiskHandler();
+};
+
+// Switches between AIO_MODE_IO_URING and the AIO_MODE_THREAD fallback.
+int ink_aio_mode();
+void ink_aio_mode_set(int mode);
 #endif
 
+/*
+  Buffers that are read into or written from repeatedly, such as the
+  cache aggregation buffers, may be registered with the kernel so that
+  their pages are not mapped again on each operation.  This is a no-op
+  unless the AIO mode supports it.
+*/
+void ink_aio_register_buffer(void *buf, size_t len);
+void ink_aio_unregister_buffer(void *buf);
+
 void ink_aio_init(ModuleVersion version);
 int ink_aio_start();
 void ink_aio_set_callback(Continuation * error_callback);
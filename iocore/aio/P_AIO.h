@@ -102,6 +102,7 @@ struct AIOCallbackInternal: public AIOCallback
   AIOCallback *first;
   AIO_Reqs *aio_req;
   ink_hrtime sleep_time;
+  int pending;                  // io_uring: operations of the chain still in flight
   int io_complete(int event, void *data);
   AIOCallbackInternal()
   {
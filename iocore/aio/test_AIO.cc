@@ -171,6 +171,30 @@ int seq_read_size = 0;
 int seq_write_size = 0;
 int rand_read_size = 0;
 
+// the AIO modes compared, one run_time each
+#if AIO_MODE == AIO_MODE_IO_URING
+int aio_modes[] = { AIO_MODE_THREAD, AIO_MODE_IO_URING };
+#else
+int aio_modes[] = { AIO_MODE };
+#endif
+int n_aio_modes = sizeof(aio_modes) / sizeof(aio_modes[0]);
+int cur_aio_mode = 0;
+
+static const char *
+aio_mode_name(int mode)
+{
+  switch (mode) {
+  case AIO_MODE_THREAD:
+    return "thread";
+  case AIO_MODE_NATIVE:
+    return "native";
+  case AIO_MODE_IO_URING:
+    return "io_uring";
+  default:
+    return "other";
+  }
+}
+
 struct AIO_Device:public Continuation
 {
   char *path;
@@ -183,12 +207,18 @@ struct AIO_Device:public Continuation
   int rand_reads;
   int hotset_idx;
   int mode;
+  ink_hrtime io_start;
+  ink_hrtime io_latency;
+  int io_count;
   AIOCallback *io;
     AIO_Device(ProxyMutex * m):Continuation(m)
   {
     hotset_idx = 0;
     io = new_AIOCallback();
     time_start = 0;
+    io_start = 0;
+    io_latency = 0;
+    io_count = 0;
     SET_HANDLER(&AIO_Device::do_hotset);
   }
   int select_mode(double p)
@@ -234,11 +264,30 @@ struct AIO_Device:public Continuation
 
 };
 
+static void
+start_run(void)
+{
+#if AIO_MODE == AIO_MODE_IO_URING
+  ink_aio_mode_set(aio_modes[cur_aio_mode]);
+#endif
+  n_accessors = orig_n_accessors;
+  for (int i = 0; i < orig_n_accessors; i++) {
+    dev[i]->time_start = 0;
+    dev[i]->io_start = 0;
+    dev[i]->io_latency = 0;
+    dev[i]->io_count = 0;
+    dev[i]->seq_reads = 0;
+    dev[i]->seq_writes = 0;
+    dev[i]->rand_reads = 0;
+    eventProcessor.schedule_imm(dev[i]);
+  }
+}
+
 void
 dump_summary(void)
 {
   /* dump timing info */
-  printf("Writing summary info\n");
+  printf("Writing summary info for AIO mode %s\n", aio_mode_name(aio_modes[cur_aio_mode]));
 
   printf("----------\n");
   printf("parameters\n");
@@ -264,12 +313,17 @@ dump_summary(void)
   double total_seq_writes = 0;
   double total_rand_reads = 0;
   double total_secs = 0.0;
+  double total_latency = 0.0;
+  double total_ios = 0.0;
   for (int i = 0; i < orig_n_accessors; i++) {
     double secs = (dev[i]->time_end - dev[i]->time_start) / 1000000000.0;
     double ops_sec = (dev[i]->seq_reads + dev[i]->seq_writes + dev[i]->rand_reads) / secs;
-    printf("%s: #sr:%d #sw:%d #rr:%d %0.1f secs %0.1f ops/sec\n",
-           dev[i]->path, dev[i]->seq_reads, dev[i]->seq_writes, dev[i]->rand_reads, secs, ops_sec);
+    double latency = dev[i]->io_count ? (double) dev[i]->io_latency / dev[i]->io_count / HRTIME_USECOND : 0.0;
+    printf("%s: #sr:%d #sw:%d #rr:%d %0.1f secs %0.1f ops/sec %0.1f usec/op\n",
+           dev[i]->path, dev[i]->seq_reads, dev[i]->seq_writes, dev[i]->rand_reads, secs, ops_sec, latency);
     total_secs += secs;
+    total_latency += dev[i]->io_latency;
+    total_ios += dev[i]->io_count;
     total_seq_reads += dev[i]->seq_reads;
     total_seq_writes += dev[i]->seq_writes;
     total_rand_reads += dev[i]->rand_reads;
@@ -291,8 +345,15 @@ dump_summary(void)
   printf("%f ops %0.2f mbytes/sec %0.1f ops/sec %0.1f ops/sec/disk rand_read\n",
          total_rand_reads, rr, total_rand_reads / total_secs, total_rand_reads / total_secs / n_disk_path);
   printf("%0.2f total mbytes/sec\n", sr + sw + rr);
+  printf("%s: %0.1f total ops/sec %0.1f usec/op\n", aio_mode_name(aio_modes[cur_aio_mode]),
+         (total_seq_reads + total_seq_writes + total_rand_reads) / total_secs,
+         total_ios ? total_latency / total_ios / HRTIME_USECOND : 0.0);
   printf("----------------------------------------------------------\n");
 
+  if (++cur_aio_mode < n_aio_modes) {
+    start_run();
+    return;
+  }
   if (delete_disks)
     for (int i = 0; i < n_disk_path; i++)
       unlink(disk_path[i]);
@@ -332,7 +393,10 @@ AIO_Device::do_fd(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
 {
   if (!time_start) {
     time_start = ink_get_hrtime();
-    fprintf(stderr, "Starting the aio_testing \n");
+    fprintf(stderr, "Starting the aio_testing with AIO mode %s\n", aio_mode_name(aio_modes[cur_aio_mode]));
+  } else if (io_start) {
+    io_latency += ink_get_hrtime() - io_start;
+    io_count++;
   }
   if ((ink_get_hrtime() - time_start) > (run_time * HRTIME_SECOND)) {
     time_end = ink_get_hrtime();
@@ -358,6 +422,7 @@ AIO_Device::do_fd(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
   io->aiocb.aio_buf = buf;
   io->action = this;
   io->thread = mutex->thread_holding;
+  io_start = ink_get_hrtime();
 
   switch (select_mode(drand48())) {
   case READ_MODE:
@@ -486,7 +551,7 @@ main(int /* argc ATS_UNUSED */, char *argv[])
   RecProcessInit(RECM_STAND_ALONE);
   ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
   eventProcessor.start(ink_number_of_processors());
-#if AIO_MODE == AIO_MODE_NATIVE
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
   int etype = ET_NET;
   int n_netthreads = eventProcessor.n_threads_for_type[etype];
   EThread **netthreads = eventProcessor.eventthread[etype];
@@ -76,6 +76,9 @@ int cache_config_enable_checksum = 0;
 int cache_config_alt_rewrite_max_size = 4096;
 int cache_config_read_while_writer = 0;
 int cache_config_mutex_retry_delay = 2;
+int cache_config_read_while_writer_max_wait = 10000;
+int cache_config_online_per_volume = 1;
+int cache_config_dir_tag_index = 1;
 #ifdef HTTP_CACHE
 static int enable_cache_empty_http_doc = 0;
 #endif
@@ -92,6 +95,9 @@ Cache *theCache = 0;
 CacheDisk **gdisks = NULL;
 int gndisks = 0;
 static volatile int initialize_disk = 0;
+static ink_hrtime cache_start_time = 0;
+// serializes volumes coming online, and their entry into gvol
+static ink_mutex vol_online_mutex = INK_MUTEX_INIT;
 Cache *caches[NUM_CACHE_FRAG_TYPES] = { 0 };
 CacheSync *cacheDirSync = 0;
 Store theCacheStore;
@@ -121,17 +127,36 @@ CacheKey zero_key(0, 0);
 ClassAllocator<MigrateToInterimCache> migrateToInterimCacheAllocator("migrateToInterimCache");
 #endif
 
-struct VolInitInfo
+struct VolInitInfo: public Continuation
 {
-  off_t recover_pos;
+  Vol *vol;
   AIOCallbackInternal vol_aio[4];
   char *vol_h_f;
 
-  VolInitInfo()
+  /* The recovery scan reads ahead: while one read is scanned, the one
+     after it is in flight into the other buffer.  Each buffer has room
+     for the tail of the previous read ahead of its own, to join a Doc
+     which straddles the two.
+   */
+  char *recover_buf[2];
+  int recover_cur;              // buffer being scanned
+  off_t scan_end;               // of the read being scanned
+  AIOCallbackInternal ahead;
+  bool ahead_busy;              // in flight
+  bool ahead_valid;             // issued for the read being scanned
+  bool ahead_wanted;            // the scan waits for it
+  bool orphaned;                // recovery is over, free when it lands
+
+  int handle_ahead(int event, void *data);
+
+  VolInitInfo(Vol *v)
+    : Continuation(v->mutex), vol(v), recover_cur(0), scan_end(0), ahead_busy(false), ahead_valid(false),
+      ahead_wanted(false), orphaned(false)
   {
-    recover_pos = 0;
     vol_h_f = (char *)ats_memalign(ats_pagesize(), 4 * STORE_BLOCK_SIZE);
     memset(vol_h_f, 0, 4 * STORE_BLOCK_SIZE);
+    recover_buf[0] = recover_buf[1] = NULL;
+    SET_HANDLER(&VolInitInfo::handle_ahead);
   }
 
   ~VolInitInfo()
@@ -140,10 +165,40 @@ struct VolInitInfo
       vol_aio[i].action = NULL;
       vol_aio[i].mutex.clear();
     }
+    ahead.action = NULL;
+    ahead.mutex.clear();
     free(vol_h_f);
+    ats_memalign_free(recover_buf[0]);
+    ats_memalign_free(recover_buf[1]);
+    mutex.clear();
   }
 };
 
+// Frees the init info of a volume, or leaves that to its read ahead.
+static inline void
+free_VolInitInfo(VolInitInfo *ii)
+{
+  if (ii->ahead_busy)
+    ii->orphaned = true;
+  else
+    delete ii;
+}
+
+int
+VolInitInfo::handle_ahead(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+{
+  ahead_busy = false;
+  if (orphaned) {
+    delete this;
+    return EVENT_DONE;
+  }
+  if (ahead_wanted) {
+    ahead_wanted = false;
+    return vol->recover_take_ahead();
+  }
+  return EVENT_CONT;
+}
+
 #if AIO_MODE == AIO_MODE_NATIVE
 struct VolInit : public Continuation
 {
@@ -336,6 +391,26 @@ CacheVC::do_io_pread(Continuation *c, int64_t nbytes, MIOBuffer *abuf, int64_t o
   return &vio;
 }
 
+VIO *
+CacheVC::do_io_pread_ranges(Continuation *c, MIOBuffer *abuf, int n, int64_t const *ranges)
+{
+  ink_assert(vio.op == VIO::READ);
+  ink_assert(n > 0 && !read_ranges);
+  int64_t nbytes = 0;
+  for (int i = 0; i < n; i++) {
+    ink_assert(ranges[2 * i] <= ranges[2 * i + 1] && (!i || ranges[2 * i] > ranges[2 * i - 1]));
+    nbytes += ranges[2 * i + 1] - ranges[2 * i] + 1;
+  }
+  read_ranges = (int64_t *)ats_malloc(2 * n * sizeof(int64_t));
+  memcpy(read_ranges, ranges, 2 * n * sizeof(int64_t));
+  n_read_ranges = n;
+  read_range = 0;
+  range_todo = ranges[1] - ranges[0] + 1;
+  // the ranges after the first are reached by seeking again when the
+  // previous one is done, see openReadMain
+  return do_io_pread(c, nbytes, abuf, ranges[0]);
+}
+
 VIO *
 CacheVC::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *abuf, bool owner)
 {
@@ -592,7 +667,7 @@ CacheProcessor::start_internal(int flags)
   ink_assert((int)TS_EVENT_CACHE_SCAN_OPERATION_FAILED == (int)CACHE_EVENT_SCAN_OPERATION_FAILED);
   ink_assert((int)TS_EVENT_CACHE_SCAN_DONE == (int)CACHE_EVENT_SCAN_DONE);
 
-#if AIO_MODE == AIO_MODE_NATIVE
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
   int etype = ET_NET;
   int n_netthreads = eventProcessor.n_threads_for_type[etype];
   EThread **netthreads = eventProcessor.eventthread[etype];
@@ -606,6 +681,7 @@ CacheProcessor::start_internal(int flags)
   clear = !!(flags & PROCESSOR_RECONFIGURE) || auto_clear_flag;
   fix = !!(flags & PROCESSOR_FIX);
   start_done = 0;
+  cache_start_time = ink_get_hrtime();
   int diskok = 1;
   Span *sd;
 #if TS_USE_INTERIM_CACHE == 1
@@ -873,6 +949,104 @@ CacheProcessor::diskInitialized()
   }
 }
 
+// Raises a startup stat to @a v, globally and for the volume.
+static void
+cache_startup_stat_max(Vol *vol, int stat, int64_t v)
+{
+  int64_t cur = 0;
+
+  RecGetGlobalRawStatSum(cache_rsb, stat, &cur);
+  if (v > cur)
+    RecSetGlobalRawStatSum(cache_rsb, stat, v);
+  RecGetGlobalRawStatSum(vol->cache_vol->vol_rsb, stat, &cur);
+  if (v > cur)
+    RecSetGlobalRawStatSum(vol->cache_vol->vol_rsb, stat, v);
+}
+
+/* Sets up the RAM cache of a volume and counts its space, once its
+   directory is read and recovered and the cache is up.  Lookups go to
+   the volume from then on.  Called under vol_online_mutex, which makes
+   sure that happens once.
+ */
+static void
+vol_online(Vol *vol)
+{
+  ProxyMutex *mutex = this_ethread()->mutex;
+  int64_t ram_cache_bytes = 0;
+
+  if (vol->online)
+    return;
+
+  switch (cache_config_ram_cache_algorithm) {
+    default:
+    case RAM_CACHE_ALGORITHM_CLFUS:
+      vol->ram_cache = new_RamCacheCLFUS();
+      break;
+    case RAM_CACHE_ALGORITHM_LRU:
+      vol->ram_cache = new_RamCacheLRU();
+      break;
+  }
+
+  if (cache_config_ram_cache_size == AUTO_SIZE_RAM_CACHE) {
+    vol->ram_cache->init(vol_dirlen(vol) * DEFAULT_RAM_CACHE_MULTIPLIER, vol);
+    ram_cache_bytes = vol_dirlen(vol);
+  } else {
+    /* allocate ram size in proportion to the disk space the
+       volume accupies */
+    int64_t total_size = 0;             // count in HTTP & MIXT
+    if (theCache)
+      total_size += theCache->cache_size;
+    if (theStreamCache)
+      total_size += theStreamCache->cache_size;
+    int64_t http_ram_cache_size =
+      (theCache) ? (int64_t) (((double) theCache->cache_size / total_size) * cache_config_ram_cache_size) : 0;
+    int64_t stream_ram_cache_size = cache_config_ram_cache_size - http_ram_cache_size;
+    double factor;
+    if (vol->cache == theCache) {
+      factor = (double) (int64_t) (vol->len >> STORE_BLOCK_SHIFT) / (int64_t) theCache->cache_size;
+      ram_cache_bytes = (int64_t) (http_ram_cache_size * factor);
+    } else {
+      factor = (double) (int64_t) (vol->len >> STORE_BLOCK_SHIFT) / (int64_t) theStreamCache->cache_size;
+      ram_cache_bytes = (int64_t) (stream_ram_cache_size * factor);
+    }
+    Debug("cache_init", "vol_online - factor = %f", factor);
+    vol->ram_cache->init(ram_cache_bytes, vol);
+  }
+#if TS_USE_INTERIM_CACHE == 1
+  vol->history.init(1<<20, 2097143);
+#endif
+  Debug("cache_init", "vol_online - %s ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
+        vol->hash_id, ram_cache_bytes, ram_cache_bytes / (1024 * 1024));
+
+  uint64_t vol_total_cache_bytes = vol->len - vol_dirlen(vol);
+  uint64_t vol_total_direntries = vol->buckets * vol->segments * DIR_DEPTH;
+  uint64_t vol_used_direntries = dir_entries_used(vol);
+
+  CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, ram_cache_bytes);
+  CACHE_VOL_SUM_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
+  CACHE_VOL_SUM_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
+  CACHE_VOL_SUM_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
+  GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_ram_cache_bytes_total_stat, ram_cache_bytes);
+  GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
+  GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
+  GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
+
+  int64_t up = ink_hrtime_to_msec(ink_get_hrtime() - cache_start_time);
+  int64_t first = 0;
+  RecGetGlobalRawStatSum(cache_rsb, cache_startup_first_online_time_stat, &first);
+  if (!first)
+    RecSetGlobalRawStatSum(cache_rsb, cache_startup_first_online_time_stat, up);
+  RecGetGlobalRawStatSum(vol->cache_vol->vol_rsb, cache_startup_first_online_time_stat, &first);
+  if (!first)
+    RecSetGlobalRawStatSum(vol->cache_vol->vol_rsb, cache_startup_first_online_time_stat, up);
+  cache_startup_stat_max(vol, cache_startup_online_time_stat, up);
+  RecIncrGlobalRawStatSum(cache_rsb, cache_startup_volumes_online_stat, 1);
+  RecIncrGlobalRawStatSum(vol->cache_vol->vol_rsb, cache_startup_volumes_online_stat, 1);
+
+  vol->online = true;
+  Debug("cache_init", "volume %s online after %" PRId64 " ms", vol->hash_id, up);
+}
+
 void
 CacheProcessor::cacheInitialized()
 {
@@ -883,29 +1057,6 @@ CacheProcessor::cacheInitialized()
     return;
   int caches_ready = 0;
   int cache_init_ok = 0;
-  /* allocate ram size in proportion to the disk space the
-     volume accupies */
-  int64_t total_size = 0;               // count in HTTP & MIXT
-  uint64_t total_cache_bytes = 0;       // bytes that can used in total_size
-  uint64_t total_direntries = 0;        // all the direntries in the cache
-  uint64_t used_direntries = 0;         //   and used
-  uint64_t vol_total_cache_bytes = 0;
-  uint64_t vol_total_direntries = 0;
-  uint64_t vol_used_direntries = 0;
-  Vol *vol;
-
-  ProxyMutex *mutex = this_ethread()->mutex;
-
-  if (theCache) {
-    total_size += theCache->cache_size;
-    Debug("cache_init", "CacheProcessor::cacheInitialized - theCache, total_size = %" PRId64 " = %" PRId64 " MB",
-          total_size, total_size / ((1024 * 1024) / STORE_BLOCK_SIZE));
-  }
-  if (theStreamCache) {
-    total_size += theStreamCache->cache_size;
-    Debug("cache_init", "CacheProcessor::cacheInitialized - theStreamCache, total_size = %" PRId64 " = %" PRId64 " MB",
-          total_size, total_size / ((1024 * 1024) / STORE_BLOCK_SIZE));
-  }
 
   if (theCache) {
     if (theCache->ready == CACHE_INIT_FAILED) {
@@ -929,113 +1080,21 @@ CacheProcessor::cacheInitialized()
     }
   }
 
+  // volumes coming up meanwhile wait for the cache to be up, or not
+  ink_mutex_acquire(&vol_online_mutex);
   if (caches_ready) {
     Debug("cache_init", "CacheProcessor::cacheInitialized - caches_ready=0x%0X, gnvol=%d", (unsigned int) caches_ready,
           gnvol);
 
-    int64_t ram_cache_bytes = 0;
-
     if (gnvol) {
-      // new ram_caches, with algorithm from the config
-      for (i = 0; i < gnvol; i++) {
-        switch (cache_config_ram_cache_algorithm) {
-          default:
-          case RAM_CACHE_ALGORITHM_CLFUS:
-            gvol[i]->ram_cache = new_RamCacheCLFUS();
-            break;
-          case RAM_CACHE_ALGORITHM_LRU:
-            gvol[i]->ram_cache = new_RamCacheLRU();
-            break;
-        }
-      }
-      // let us calculate the Size
-      if (cache_config_ram_cache_size == AUTO_SIZE_RAM_CACHE) {
-        Debug("cache_init", "CacheProcessor::cacheInitialized - cache_config_ram_cache_size == AUTO_SIZE_RAM_CACHE");
-        for (i = 0; i < gnvol; i++) {
-          vol = gvol[i];
-          gvol[i]->ram_cache->init(vol_dirlen(vol) * DEFAULT_RAM_CACHE_MULTIPLIER, vol);
-#if TS_USE_INTERIM_CACHE == 1
-          gvol[i]->history.init(1<<20, 2097143);
-#endif
-          ram_cache_bytes += vol_dirlen(gvol[i]);
-          Debug("cache_init", "CacheProcessor::cacheInitialized - ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                ram_cache_bytes, ram_cache_bytes / (1024 * 1024));
-          CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) vol_dirlen(gvol[i]));
-
-          vol_total_cache_bytes = gvol[i]->len - vol_dirlen(gvol[i]);
-          total_cache_bytes += vol_total_cache_bytes;
-          Debug("cache_init", "CacheProcessor::cacheInitialized - total_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                total_cache_bytes, total_cache_bytes / (1024 * 1024));
-
-          CACHE_VOL_SUM_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
-
-
-          vol_total_direntries = gvol[i]->buckets * gvol[i]->segments * DIR_DEPTH;
-          total_direntries += vol_total_direntries;
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
-
-
-          vol_used_direntries = dir_entries_used(gvol[i]);
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
-          used_direntries += vol_used_direntries;
-        }
-
-      } else {
-        // we got configured memory size
-        // TODO, should we check the available system memories, or you will
-        //   OOM or swapout, that is not a good situation for the server
-        Debug("cache_init", "CacheProcessor::cacheInitialized - %" PRId64 " != AUTO_SIZE_RAM_CACHE",
-              cache_config_ram_cache_size);
-        int64_t http_ram_cache_size =
-          (theCache) ? (int64_t) (((double) theCache->cache_size / total_size) * cache_config_ram_cache_size) : 0;
-        Debug("cache_init", "CacheProcessor::cacheInitialized - http_ram_cache_size = %" PRId64 " = %" PRId64 "Mb",
-              http_ram_cache_size, http_ram_cache_size / (1024 * 1024));
-        int64_t stream_ram_cache_size = cache_config_ram_cache_size - http_ram_cache_size;
-        Debug("cache_init", "CacheProcessor::cacheInitialized - stream_ram_cache_size = %" PRId64 " = %" PRId64 "Mb",
-              stream_ram_cache_size, stream_ram_cache_size / (1024 * 1024));
-
+      if (cache_config_ram_cache_size != AUTO_SIZE_RAM_CACHE) {
         // Dump some ram_cache size information in debug mode.
         Debug("ram_cache", "config: size = %" PRId64 ", cutoff = %" PRId64 "",
               cache_config_ram_cache_size, cache_config_ram_cache_cutoff);
-
-        for (i = 0; i < gnvol; i++) {
-          vol = gvol[i];
-          double factor;
-          if (gvol[i]->cache == theCache) {
-            factor = (double) (int64_t) (gvol[i]->len >> STORE_BLOCK_SHIFT) / (int64_t) theCache->cache_size;
-            Debug("cache_init", "CacheProcessor::cacheInitialized - factor = %f", factor);
-            gvol[i]->ram_cache->init((int64_t) (http_ram_cache_size * factor), vol);
-            ram_cache_bytes += (int64_t) (http_ram_cache_size * factor);
-            CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) (http_ram_cache_size * factor));
-          } else {
-            factor = (double) (int64_t) (gvol[i]->len >> STORE_BLOCK_SHIFT) / (int64_t) theStreamCache->cache_size;
-            Debug("cache_init", "CacheProcessor::cacheInitialized - factor = %f", factor);
-            gvol[i]->ram_cache->init((int64_t) (stream_ram_cache_size * factor), vol);
-            ram_cache_bytes += (int64_t) (stream_ram_cache_size * factor);
-            CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) (stream_ram_cache_size * factor));
-          }
-          Debug("cache_init", "CacheProcessor::cacheInitialized[%d] - ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                i, ram_cache_bytes, ram_cache_bytes / (1024 * 1024));
-#if TS_USE_INTERIM_CACHE == 1
-          gvol[i]->history.init(1<<20, 2097143);
-#endif
-          vol_total_cache_bytes = gvol[i]->len - vol_dirlen(gvol[i]);
-          total_cache_bytes += vol_total_cache_bytes;
-          CACHE_VOL_SUM_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
-          Debug("cache_init", "CacheProcessor::cacheInitialized - total_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                total_cache_bytes, total_cache_bytes / (1024 * 1024));
-
-          vol_total_direntries = gvol[i]->buckets * gvol[i]->segments * DIR_DEPTH;
-          total_direntries += vol_total_direntries;
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
-
-
-          vol_used_direntries = dir_entries_used(gvol[i]);
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
-          used_direntries += vol_used_direntries;
-
-        }
       }
+      // the volumes up so far, the rest as they come
+      for (i = 0; i < gnvol; i++)
+        vol_online(gvol[i]);
       switch (cache_config_ram_cache_compress) {
         default:
           Fatal("unknown RAM cache compression type: %d", cache_config_ram_cache_compress);
@@ -1054,10 +1113,6 @@ CacheProcessor::cacheInitialized()
           break;
       }
 
-      GLOBAL_CACHE_SET_DYN_STAT(cache_ram_cache_bytes_total_stat, ram_cache_bytes);
-      GLOBAL_CACHE_SET_DYN_STAT(cache_bytes_total_stat, total_cache_bytes);
-      GLOBAL_CACHE_SET_DYN_STAT(cache_direntries_total_stat, total_direntries);
-      GLOBAL_CACHE_SET_DYN_STAT(cache_direntries_used_stat, used_direntries);
       dir_sync_init();
       cache_init_ok = 1;
     } else
@@ -1065,8 +1120,13 @@ CacheProcessor::cacheInitialized()
   }
   if (cache_init_ok) {
     // Initialize virtual cache
-    CacheProcessor::initialized = CACHE_INITIALIZED;
     CacheProcessor::cache_ready = caches_ready;
+    CacheProcessor::initialized = CACHE_INITIALIZED;
+  } else
+    CacheProcessor::initialized = CACHE_INIT_FAILED;
+  ink_mutex_release(&vol_online_mutex);
+
+  if (cache_init_ok) {
     Note("cache enabled");
 #ifdef CLUSTER_CACHE
     if (!(start_internal_flags & PROCESSOR_RECONFIGURE)) {
@@ -1075,7 +1135,6 @@ CacheProcessor::cacheInitialized()
     }
 #endif
   } else {
-    CacheProcessor::initialized = CACHE_INIT_FAILED;
     Note("cache disabled");
   }
   // Fire callback to signal initialization finished.
@@ -1179,6 +1238,7 @@ vol_clear_init(Vol *d)
 {
   size_t dir_len = vol_dirlen(d);
   memset(d->raw_dir, 0, dir_len);
+  memset(d->dir_dirty, DIR_DIRTY_BOTH, dir_len / STORE_BLOCK_SIZE);
   vol_init_dir(d);
   d->header->magic = VOL_MAGIC;
   d->header->version.ink_major = CACHE_DB_MAJOR_VERSION;
@@ -1191,6 +1251,7 @@ vol_clear_init(Vol *d)
   d->header->dirty = 0;
   d->sector_size = d->header->sector_size = d->disk->hw_sector_size;
   *d->footer = *d->header;
+  dir_tags_build(d);
 
 #if TS_USE_INTERIM_CACHE == 1
   for (int i = 0; i < d->num_interim_vols; i++) {
@@ -1234,6 +1295,7 @@ Vol::clear_dir()
 int
 Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
 {
+  init_start = ink_get_hrtime();
   dir_skip = ROUND_TO_STORE_BLOCK((dir_skip < START_POS ? START_POS : dir_skip));
   path = ats_strdup(s);
   const size_t hash_id_size = strlen(s) + 32;
@@ -1245,6 +1307,7 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
   hash_id_md5.encodeBuffer(hash_id, strlen(hash_id));
   len = blocks * STORE_BLOCK_SIZE;
   ink_assert(len <= MAX_VOL_SIZE);
+  ink_atomic_increment(&cache->total_started_vol, 1);
   skip = dir_skip;
   prev_recover_pos = 0;
 
@@ -1262,9 +1325,13 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
   Debug("cache_init", "allocating %zu directory bytes for a %lld byte volume (%lf%%)",
     vol_dirlen(this), (long long)this->len, (double)vol_dirlen(this) / (double)this->len * 100.0);
   raw_dir = (char *)ats_memalign(ats_pagesize(), vol_dirlen(this));
+  // neither copy on disk is known to match until written
+  dir_dirty = (uint8_t *)ats_malloc(vol_dirlen(this) / STORE_BLOCK_SIZE);
+  memset(dir_dirty, DIR_DIRTY_BOTH, vol_dirlen(this) / STORE_BLOCK_SIZE);
   dir = (Dir *) (raw_dir + vol_headerlen(this));
   header = (VolHeaderFooter *) raw_dir;
   footer = (VolHeaderFooter *) (raw_dir + vol_dirlen(this) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter)));
+  ink_aio_register_buffer(agg_buffer, AGG_SIZE);
 
 #if TS_USE_INTERIM_CACHE == 1
   num_interim_vols = good_interim_disks;
@@ -1284,7 +1351,7 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
     return clear_dir();
   }
 
-  init_info = new VolInitInfo();
+  init_info = new VolInitInfo(this);
   int footerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
   off_t footer_offset = vol_dirlen(this) - footerlen;
   // try A
@@ -1388,6 +1455,7 @@ Vol::handle_dir_read(int event, void *data)
 int
 Vol::recover_data()
 {
+  recover_start = ink_get_hrtime();
   SET_HANDLER(&Vol::handle_recover_from_data);
   return handle_recover_from_data(EVENT_IMMEDIATE, 0);
 }
@@ -1449,7 +1517,8 @@ Vol::handle_recover_from_data(int event, void * /* data ATS_UNUSED */ )
       recover_wrapped = 1;
       recover_pos = start;
     }
-    io.aiocb.aio_buf = (char *)ats_memalign(ats_pagesize(), RECOVERY_SIZE);
+    for (int i = 0; i < 2; i++)
+      init_info->recover_buf[i] = (char *)ats_memalign(ats_pagesize(), AGG_SIZE + RECOVERY_SIZE);
     io.aiocb.aio_nbytes = RECOVERY_SIZE;
     if ((off_t)(recover_pos + io.aiocb.aio_nbytes) > (off_t)(skip + len))
       io.aiocb.aio_nbytes = (skip + len) - recover_pos;
@@ -1458,6 +1527,7 @@ Vol::handle_recover_from_data(int event, void * /* data ATS_UNUSED */ )
       Warning("disk read error on recover '%s', clearing", hash_id);
       goto Lclear;
     }
+    recover_read_ahead();
     if (io.aiocb.aio_offset == header->last_write_pos) {
 
       /* check that we haven't wrapped around without syncing
@@ -1599,9 +1669,7 @@ Vol::handle_recover_from_data(int event, void * /* data ATS_UNUSED */ )
   if (recover_pos == prev_recover_pos) // this should never happen, but if it does break the loop
     goto Lclear;
   prev_recover_pos = recover_pos;
-  io.aiocb.aio_offset = recover_pos;
-  ink_assert(ink_aio_read(&io));
-  return EVENT_CONT;
+  return recover_read();
 
 Ldone:{
     /* if we come back to the starting position, then we don't have to recover anything */
@@ -1672,19 +1740,83 @@ Ldone:{
   }
 
 Lclear:
-  free((char *) io.aiocb.aio_buf);
-  delete init_info;
+  free_VolInitInfo(init_info);
   init_info = 0;
   clear_dir();
   return EVENT_CONT;
 }
 
+/* Reads the recovery window from recover_pos, io.aiocb.aio_nbytes of it,
+   into the buffer not being read ahead into.  When the read ahead of the
+   read just scanned follows on, the unscanned tail of that read is put in
+   front of it instead, and the scan goes on once it lands.
+ */
+int
+Vol::recover_read()
+{
+  VolInitInfo *ii = init_info;
+  off_t tail = ii->scan_end - recover_pos;
+
+  if (ii->ahead_valid && recover_pos >= (off_t)io.aiocb.aio_offset && tail >= 0 && tail <= AGG_SIZE) {
+    int next = 1 - ii->recover_cur;
+    char *b = ii->recover_buf[next] + AGG_SIZE - tail;
+    memcpy(b, (char *) io.aiocb.aio_buf + (recover_pos - io.aiocb.aio_offset), tail);
+    ii->recover_cur = next;
+    ii->ahead_valid = false;
+    io.aiocb.aio_buf = b;
+    io.aiocb.aio_offset = recover_pos;
+    io.aiocb.aio_nbytes = tail;
+    if (ii->ahead_busy) {
+      ii->ahead_wanted = true;
+      return EVENT_CONT;
+    }
+    return recover_take_ahead();
+  }
+  io.aiocb.aio_buf = ii->recover_buf[ii->recover_cur] + AGG_SIZE;
+  io.aiocb.aio_offset = recover_pos;
+  ink_assert(ink_aio_read(&io) >= 0);
+  return EVENT_CONT;
+}
+
+// Scans the read ahead, joined to the tail put in front of it.
+int
+Vol::recover_take_ahead()
+{
+  AIOCallback *a = &init_info->ahead;
+
+  io.aiocb.aio_nbytes += a->aiocb.aio_nbytes;
+  io.aio_result = a->ok() ? (int64_t)io.aiocb.aio_nbytes : -1;
+  return handle_recover_from_data(AIO_EVENT_DONE, &io);
+}
+
+// Reads the recovery window after the read about to be scanned.
+void
+Vol::recover_read_ahead()
+{
+  VolInitInfo *ii = init_info;
+  AIOCallback *a = &ii->ahead;
+
+  ii->scan_end = io.aiocb.aio_offset + io.aiocb.aio_nbytes;
+  ii->ahead_valid = false;
+  if (ii->ahead_busy || ii->scan_end >= skip + len)
+    return;
+  a->aiocb.aio_fildes = fd;
+  a->aiocb.aio_buf = ii->recover_buf[1 - ii->recover_cur] + AGG_SIZE;
+  a->aiocb.aio_offset = ii->scan_end;
+  a->aiocb.aio_nbytes = RECOVERY_SIZE;
+  if ((off_t)(a->aiocb.aio_offset + a->aiocb.aio_nbytes) > (off_t)(skip + len))
+    a->aiocb.aio_nbytes = (skip + len) - a->aiocb.aio_offset;
+  a->action = ii;
+  a->thread = AIO_CALLBACK_THREAD_ANY;
+  a->then = 0;
+  ii->ahead_busy = ii->ahead_valid = true;
+  ink_assert(ink_aio_read(a) >= 0);
+}
+
 int
 Vol::handle_recover_write_dir(int /* event ATS_UNUSED */ , void * /* data ATS_UNUSED */ )
 {
-  if (io.aiocb.aio_buf)
-    free((char *) io.aiocb.aio_buf);
-  delete init_info;
+  free_VolInitInfo(init_info);
   init_info = 0;
   set_io_not_in_progress();
   scan_pos = header->write_pos;
@@ -1754,14 +1886,41 @@ Vol::dir_init_done(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */ )
     eventProcessor.schedule_in(this, HRTIME_MSECONDS(5), ET_CALL);
     return EVENT_CONT;
   } else {
-    int vol_no = ink_atomic_increment(&gnvol, 1);
-    ink_assert(!gvol[vol_no]);
-    gvol[vol_no] = this;
+    ink_hrtime now = ink_get_hrtime();
     SET_HANDLER(&Vol::aggWrite);
+
+#if TS_USE_INTERIM_CACHE != 1
+    // the directory is final now, summarize its buckets before lookups come
+    if (cache_config_dir_tag_index && fd != -1 && !dir_tags) {
+      dir_tags = (uint64_t *) ats_memalign(DIR_TAGS_ALIGN, segments * buckets * sizeof(uint64_t));
+      dir_tags_build(this);
+    }
+#endif
+
+    {
+      ink_scoped_mutex lock(vol_online_mutex);
+      // the directory read (or clear), then the recovery scan
+      cache_startup_stat_max(this, cache_startup_dir_read_time_stat,
+                             ink_hrtime_to_msec((recover_start ? recover_start : now) - init_start));
+      if (recover_start)
+        cache_startup_stat_max(this, cache_startup_recover_time_stat, ink_hrtime_to_msec(now - recover_start));
+
+      int vol_no = gnvol;
+      ink_assert(!gvol[vol_no]);
+      gvol[vol_no] = this;
+      // only once the slot is filled, for those walking gvol
+      ink_atomic_increment(&gnvol, 1);
+    }
+
+    // this may bring the cache up, which takes vol_online_mutex itself
     if (fd == -1)
       cache->vol_initialized(0);
     else
       cache->vol_initialized(1);
+    // once the cache is up, volumes join it as they come
+    ink_scoped_mutex lock(vol_online_mutex);
+    if (CacheProcessor::initialized == CACHE_INITIALIZED)
+      vol_online(this);
     return EVENT_DONE;
   }
 }
@@ -2104,7 +2263,14 @@ void
 Cache::vol_initialized(bool result) {
   if (result)
     ink_atomic_increment(&total_good_nvol, 1);
-  if (total_nvol == ink_atomic_increment(&total_initialized_vol, 1) + 1)
+  int n = ink_atomic_increment(&total_initialized_vol, 1) + 1;
+  if (ready != CACHE_INITIALIZING)
+    return;
+  /* Opening the cache with the first good volume lets lookups go to it
+     while the others are still read and recovered.  The volume hash
+     table needs the hash ids of all of them though.
+   */
+  if (total_nvol == n || (result && cache_config_online_per_volume && total_started_vol == total_nvol))
     open_done();
 }
 
@@ -2575,6 +2741,7 @@ LinterimRead:
     io.thread = mutex->thread_holding->tt == DEDICATED ? AIO_CALLBACK_THREAD_ANY : mutex->thread_holding;
 
     SET_HANDLER(&CacheVC::handleReadDone);
+    CACHE_SUM_DYN_STAT(cache_read_bytes_stat, io.aiocb.aio_nbytes);
     ink_assert(ink_aio_read(&io) >= 0);
     CACHE_DEBUG_INCREMENT_DYN_STAT(cache_pread_count_stat);
     return EVENT_CONT;
@@ -2602,6 +2769,8 @@ LinterimRead:
   io.action = this;
   io.thread = mutex->thread_holding->tt == DEDICATED ? AIO_CALLBACK_THREAD_ANY : mutex->thread_holding;
   SET_HANDLER(&CacheVC::handleReadDone);
+  // only what is actually read from disk
+  CACHE_SUM_DYN_STAT(cache_read_bytes_stat, io.aiocb.aio_nbytes);
   ink_assert(ink_aio_read(&io) >= 0);
   CACHE_DEBUG_INCREMENT_DYN_STAT(cache_pread_count_stat);
   return EVENT_CONT;
@@ -2638,6 +2807,10 @@ Cache::lookup(Continuation *cont, CacheKey *key, CacheFragType type, char *hostn
   }
 
   Vol *vol = key_to_vol(key, hostname, host_len);
+  if (!vol->online) {
+    cont->handleEvent(CACHE_EVENT_LOOKUP_FAILED, 0);
+    return ACTION_RESULT_DONE;
+  }
   ProxyMutex *mutex = cont->mutex;
   CacheVC *c = new_CacheVC(cont);
   SET_CONTINUATION_HANDLER(c, &CacheVC::openReadStartHead);
@@ -2761,13 +2934,19 @@ Cache::remove(Continuation *cont, CacheKey *key, CacheFragType type, bool /* use
 
   ink_assert(this);
 
+  Vol *vol = key_to_vol(key, hostname, host_len);
+  if (!vol->online) {
+    if (cont)
+      cont->handleEvent(CACHE_EVENT_REMOVE_FAILED, 0);
+    return ACTION_RESULT_DONE;
+  }
+
   Ptr<ProxyMutex> mutex;
   if (!cont)
     cont = new_CacheRemoveCont();
 
   CACHE_TRY_LOCK(lock, cont->mutex, this_ethread());
   ink_assert(lock);
-  Vol *vol = key_to_vol(key, hostname, host_len);
   // coverity[var_decl]
   Dir result;
   dir_clear(&result);           // initialized here, set result empty so we can recognize missed lock
@@ -3315,10 +3494,17 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("frags_per_doc.3+", cache_three_plus_plus_fragment_document_count_stat);
   REG_INT("read_busy.success", cache_read_busy_success_stat);
   REG_INT("read_busy.failure", cache_read_busy_failure_stat);
+  REG_INT("read_busy.wait", cache_read_busy_wait_stat);
   REG_INT("write_bytes_stat", cache_write_bytes_stat);
+  REG_INT("read_bytes_stat", cache_read_bytes_stat);
   REG_INT("vector_marshals", cache_hdr_vector_marshal_stat);
   REG_INT("hdr_marshals", cache_hdr_marshal_stat);
   REG_INT("hdr_marshal_bytes", cache_hdr_marshal_bytes_stat);
+  REG_INT("startup.directory_read_time", cache_startup_dir_read_time_stat);
+  REG_INT("startup.recovery_time", cache_startup_recover_time_stat);
+  REG_INT("startup.first_online_time", cache_startup_first_online_time_stat);
+  REG_INT("startup.online_time", cache_startup_online_time_stat);
+  REG_INT("startup.volumes_online", cache_startup_volumes_online_stat);
   REG_INT("gc_bytes_evacuated", cache_gc_bytes_evacuated_stat);
   REG_INT("gc_frags_evacuated", cache_gc_frags_evacuated_stat);
 }
@@ -3404,6 +3590,15 @@ ink_cache_init(ModuleVersion v)
   REC_RegisterConfigUpdateFunc("proxy.config.cache.enable_read_while_writer", update_cache_config, NULL);
   Debug("cache_init", "proxy.config.cache.enable_read_while_writer = %d", cache_config_read_while_writer);
 
+  REC_EstablishStaticConfigInt32(cache_config_read_while_writer_max_wait, "proxy.config.cache.read_while_writer.max_wait");
+  Debug("cache_init", "proxy.config.cache.read_while_writer.max_wait = %d", cache_config_read_while_writer_max_wait);
+
+  REC_EstablishStaticConfigInt32(cache_config_online_per_volume, "proxy.config.cache.online_per_volume");
+  Debug("cache_init", "proxy.config.cache.online_per_volume = %d", cache_config_online_per_volume);
+
+  REC_EstablishStaticConfigInt32(cache_config_dir_tag_index, "proxy.config.cache.dir.tag_index");
+  Debug("cache_init", "proxy.config.cache.dir.tag_index = %d", cache_config_dir_tag_index);
+
   register_cache_stats(cache_rsb, "proxy.process.cache");
 
   const char *err = NULL;
@@ -3429,25 +3624,28 @@ ink_cache_init(ModuleVersion v)
 //----------------------------------------------------------------------------
 Action *
 CacheProcessor::open_read(Continuation *cont, URL *url, bool cluster_cache_local, CacheHTTPHdr *request,
-                          CacheLookupHttpConfig *params, time_t pin_in_cache, CacheFragType type)
+                          CacheLookupHttpConfig *params, time_t pin_in_cache, CacheFragType type, int64_t segment,
+                          int64_t segment_size)
 {
 #ifdef CLUSTER_CACHE
-  if (cache_clustering_enabled > 0 && !cluster_cache_local) {
+  // segments are always kept in the local cache
+  if (cache_clustering_enabled > 0 && !cluster_cache_local && segment < 0) {
     return open_read_internal(CACHE_OPEN_READ_LONG, cont, (MIOBuffer *) 0,
                               url, request, params, (CacheKey *) 0, pin_in_cache, type, (char *) 0, 0);
   }
 #endif
-  return caches[type]->open_read(cont, url, request, params, type);
+  return caches[type]->open_read(cont, url, request, params, type, segment, segment_size);
 }
 
 
 //----------------------------------------------------------------------------
 Action *
 CacheProcessor::open_write(Continuation *cont, int expected_size, URL *url, bool cluster_cache_local,
-                           CacheHTTPHdr *request, CacheHTTPInfo *old_info, time_t pin_in_cache, CacheFragType type)
+                           CacheHTTPHdr *request, CacheHTTPInfo *old_info, time_t pin_in_cache, CacheFragType type,
+                           int64_t segment, int64_t segment_size)
 {
 #ifdef CLUSTER_CACHE
-  if (cache_clustering_enabled > 0 && !cluster_cache_local) {
+  if (cache_clustering_enabled > 0 && !cluster_cache_local && segment < 0) {
     INK_MD5 url_md5;
     Cache::generate_key(&url_md5, url, request);
     ClusterMachine *m = cluster_machine_at_depth(cache_hash(url_md5));
@@ -3463,7 +3661,7 @@ CacheProcessor::open_write(Continuation *cont, int expected_size, URL *url, bool
     }
   }
 #endif
-  return caches[type]->open_write(cont, url, request, old_info, pin_in_cache, type);
+  return caches[type]->open_write(cont, url, request, old_info, pin_in_cache, type, segment, segment_size);
 }
 
 //----------------------------------------------------------------------------
@@ -29,6 +29,10 @@
 #define DIR_LOOP_THRESHOLD	      1000
 #endif
 #include "ink_stack_trace.h"
+#if defined(linux)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 
 #define CACHE_INC_DIR_USED(_m) do { \
 ProxyMutex *mutex = _m; \
@@ -45,6 +49,73 @@ ProxyMutex *mutex = _m; \
 CACHE_INCREMENT_DYN_STAT(cache_directory_collision_count_stat); \
 } while (0);
 
+// Marks the blocks of the directory holding [p, p + len) as changed for
+// both copies on disk, so that the next sync of each writes them.
+static inline void
+dir_dirty_range(Vol *d, void *p, size_t len)
+{
+  size_t o = (char *) p - d->raw_dir;
+  size_t last = (o + len - 1) / STORE_BLOCK_SIZE;
+  for (size_t i = o / STORE_BLOCK_SIZE; i <= last; i++)
+    d->dir_dirty[i] = DIR_DIRTY_BOTH;
+}
+
+static inline void
+dir_dirty(Dir *e, Vol *d)
+{
+  if (e)
+    dir_dirty_range(d, e, SIZEOF_DIR);
+}
+
+// The tag summary of the chain of bucket b, or DIR_TAGS_UNKNOWN if
+// it is longer than there are lanes.
+static uint64_t
+dir_tags_summary(Dir *b, Dir *seg)
+{
+  uint64_t t = 0;
+  Dir *e = b;
+
+  if (!dir_offset(b))
+    return 0;
+  for (int l = 0; l < DIR_TAGS_LANES; l++) {
+    t |= ((uint64_t) (DIR_TAGS_LANE_USED | dir_tag(e))) << (16 * l);
+    e = next_dir(e, seg);
+    if (!e)
+      return t;
+  }
+  return DIR_TAGS_UNKNOWN;
+}
+
+// Brings the tag summary of a bucket up to date after its chain changed.
+static inline void
+dir_tags_bucket(int b, int s, Vol *d)
+{
+  if (d->dir_tags) {
+    Dir *seg = dir_segment(s, d);
+    d->dir_tags[s * d->buckets + b] = dir_tags_summary(dir_bucket(b, seg), seg);
+  }
+}
+
+static void
+dir_tags_segment(int s, Vol *d)
+{
+  if (d->dir_tags) {
+    Dir *seg = dir_segment(s, d);
+    uint64_t *t = d->dir_tags + s * d->buckets;
+    for (int b = 0; b < d->buckets; b++)
+      t[b] = dir_tags_summary(dir_bucket(b, seg), seg);
+  }
+}
+
+// Recomputes all the tag summaries of a volume which keeps them, after
+// its directory was read or cleared.
+void
+dir_tags_build(Vol *d)
+{
+  for (int s = 0; s < d->segments; s++)
+    dir_tags_segment(s, d);
+}
+
 
 // Globals
 
@@ -126,6 +197,22 @@ OpenDir::signal_readers(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
   return 0;
 }
 
+/*
+   Wakes the readers waiting on a writer of the entry, once it has made
+   progress. They are called back from an event rather than from under
+   the writer.
+   */
+void
+OpenDir::wake_readers(OpenDirEntry *d)
+{
+  ink_assert(mutex->thread_holding == this_ethread());
+  if (!d->readers.head)
+    return;
+  delayed_readers.append(d->readers);
+  d->readers.head = NULL;
+  this_ethread()->schedule_imm_local(this);
+}
+
 int
 OpenDir::close_write(CacheVC *cont)
 {
@@ -140,6 +227,9 @@ OpenDir::close_write(CacheVC *cont)
     signal_readers(0, 0);
     cont->od->vector.clear();
     THREAD_FREE(cont->od, openDirEntryAllocator, cont->mutex->thread_holding);
+  } else {
+    // the readers may have been waiting on this writer
+    wake_readers(cont->od);
   }
   cont->od = NULL;
   return 0;
@@ -156,6 +246,12 @@ OpenDir::open_read(INK_MD5 *key)
   return NULL;
 }
 
+/*
+   Parks a reader until a writer of the entry signals it, or until msec
+   have passed. Either way the reader is called back with
+   f.open_read_timeout still set only if it timed out, in which case it
+   must take itself off the list (see leave()).
+   */
 int
 OpenDirEntry::wait(CacheVC *cont, int msec)
 {
@@ -167,6 +263,20 @@ OpenDirEntry::wait(CacheVC *cont, int msec)
   return EVENT_CONT;
 }
 
+void
+OpenDir::leave(CacheVC *cont)
+{
+  ink_assert(cont->vol->mutex->thread_holding == this_ethread());
+  ink_assert(cont->f.open_read_timeout);
+  // still on the entry, or already handed to signal_readers()
+  OpenDirEntry *d = open_read(&cont->first_key);
+  if (d && d->readers.in(cont))
+    d->readers.remove(cont);
+  else
+    delayed_readers.remove(cont);
+  cont->f.open_read_timeout = 0;
+}
+
 //
 // Cache Directory
 //
@@ -207,12 +317,14 @@ dir_init_segment(int s, Vol *d)
   Dir *seg = dir_segment(s, d);
   int l, b;
   memset(seg, 0, SIZEOF_DIR * DIR_DEPTH * d->buckets);
+  dir_dirty_range(d, seg, SIZEOF_DIR * DIR_DEPTH * d->buckets);
   for (l = 1; l < DIR_DEPTH; l++) {
     for (b = 0; b < d->buckets; b++) {
       Dir *bucket = dir_bucket(b, seg);
       dir_free_entry(dir_bucket_row(bucket, l), s, d);
     }
   }
+  dir_tags_segment(s, d);
 }
 
 
@@ -292,6 +404,8 @@ unlink_from_freelist(Dir *e, int s, Vol *d)
   Dir *n = dir_from_offset(dir_next(e), seg);
   if (n)
     dir_set_prev(n, dir_prev(e));
+  dir_dirty(p, d);
+  dir_dirty(n, d);
 }
 
 inline Dir *
@@ -300,15 +414,19 @@ dir_delete_entry(Dir *e, Dir *p, int s, Vol *d)
   Dir *seg = dir_segment(s, d);
   int no = dir_next(e);
   d->header->dirty = 1;
+  dir_dirty(e, d);
   if (p) {
     unsigned int fo = d->header->freelist[s];
     unsigned int eo = dir_to_offset(e, seg);
     dir_clear(e);
     dir_set_next(p, no);
     dir_set_next(e, fo);
-    if (fo)
+    if (fo) {
       dir_set_prev(dir_from_offset(fo, seg), eo);
+      dir_dirty(dir_from_offset(fo, seg), d);
+    }
     d->header->freelist[s] = eo;
+    dir_dirty(p, d);
   } else {
     Dir *n = next_dir(e, seg);
     if (n) {
@@ -360,6 +478,7 @@ dir_clean_segment(int s, Vol *d)
   for (int64_t i = 0; i < d->buckets; i++) {
     dir_clean_bucket(dir_bucket(i, seg), s, d);
     ink_assert(!dir_next(dir_bucket(i, seg)) || dir_offset(dir_bucket(i, seg)));
+    dir_tags_bucket(i, s, d);
   }
 }
 
@@ -456,6 +575,7 @@ dir_clean_range_interimvol(off_t start, off_t end, InterimCacheVol *svol)
             dir_offset(e) >= (int64_t)start && dir_offset(e) < (int64_t)end) {
       CACHE_DEC_DIR_USED(vol->mutex);
       dir_set_offset(e, 0);     // delete
+      dir_dirty(e, vol);
     }
   }
 
@@ -471,6 +591,7 @@ dir_clear_range(off_t start, off_t end, Vol *vol)
     if (!dir_token(e) && dir_offset(e) >= (int64_t)start && dir_offset(e) < (int64_t)end) {
       CACHE_DEC_DIR_USED(vol->mutex);
       dir_set_offset(e, 0);     // delete
+      dir_dirty(e, vol);
     }
   }
   dir_clean_vol(vol);
@@ -504,6 +625,7 @@ freelist_clean(int s, Vol *vol)
       if (dir_head(e) && !(n++ % 10)) {
         CACHE_DEC_DIR_USED(vol->mutex);
         dir_set_offset(e, 0);   // delete
+        dir_dirty(e, vol);
       }
     }
   }
@@ -526,8 +648,10 @@ freelist_pop(int s, Vol *d)
     return NULL;
   }
   Dir *h = dir_from_offset(d->header->freelist[s], seg);
-  if (h)
+  if (h) {
     dir_set_prev(h, 0);
+    dir_dirty(h, d);
+  }
   return e;
 }
 
@@ -601,6 +725,11 @@ dir_probe(CacheKey *key, Vol *d, Dir *result, Dir ** last_collision)
   if (dir_bucket_loop_fix(dir_bucket(b, seg), s, d))
     return 0;
 #endif
+  // nothing in the bucket has the tag, no need to walk it
+  if (d->dir_tags && !collision && !dir_tags_may_match(d->dir_tags[s * d->buckets + b], key)) {
+    DDebug("dir_probe_miss", "missed %X %X on vol %d bucket %d by tag", key->word(0), key->word(1), d->fd, b);
+    return 0;
+  }
 Lagain:
   e = dir_bucket(b, seg);
   if (dir_offset(e))
@@ -634,6 +763,7 @@ Lagain:
         } else {                // delete the invalid entry
           CACHE_DEC_DIR_USED(d->mutex);
           e = dir_delete_entry(e, p, s, d);
+          dir_tags_bucket(b, s, d);
           continue;
         }
       } else
@@ -711,6 +841,9 @@ Lfill:
          e, key->word(0), d->fd, bi, e, key->word(1), dir_tag(e), dir_offset(e));
   CHECK_DIR(d);
   d->header->dirty = 1;
+  dir_dirty(b, d);
+  dir_dirty(e, d);
+  dir_tags_bucket(bi, s, d);
   CACHE_INC_DIR_USED(d->mutex);
   return 1;
 }
@@ -789,6 +922,9 @@ Lfill:
          e, key->word(0), d->fd, bi, e, t, dir_tag(e), dir_offset(e));
   CHECK_DIR(d);
   d->header->dirty = 1;
+  dir_dirty(b, d);
+  dir_dirty(e, d);
+  dir_tags_bucket(bi, s, d);
   return res;
 }
 
@@ -823,6 +959,7 @@ dir_delete(CacheKey *key, Vol *d, Dir *del)
 #endif
         CACHE_DEC_DIR_USED(d->mutex);
         dir_delete_entry(e, p, s, d);
+        dir_tags_bucket(b, s, d);
         CHECK_DIR(d);
         return 1;
       }
@@ -967,6 +1104,51 @@ CacheSync::aio_write(int fd, char *b, int n, off_t o)
   ink_assert(ink_aio_write(&io) >= 0);
 }
 
+/* Takes the blocks of the directory body changed since the copy about
+   to be written last was, as runs of at most SYNC_MAX_WRITE bytes.
+   Called with the vol lock held, along with the snapshot into buf, so
+   that later changes mark the blocks again.
+ */
+void
+CacheSync::collect(Vol *d)
+{
+  uint8_t bit = 1 << (d->header->sync_serial & 1);
+  size_t first = vol_headerlen(d) / STORE_BLOCK_SIZE;
+  size_t last = (vol_dirlen(d) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter))) / STORE_BLOCK_SIZE;
+
+  nruns = 0;
+  for (size_t i = first; i < last; i++) {
+    if (!(d->dir_dirty[i] & bit))
+      continue;
+    d->dir_dirty[i] &= ~bit;
+    off_t o = i * STORE_BLOCK_SIZE;
+    if (nruns && runs[nruns - 1].offset + runs[nruns - 1].len == o && runs[nruns - 1].len < SYNC_MAX_WRITE) {
+      runs[nruns - 1].len += STORE_BLOCK_SIZE;
+      continue;
+    }
+    if (nruns == maxruns) {
+      maxruns = maxruns ? maxruns * 2 : 64;
+      runs = (CacheSyncRun *)ats_realloc(runs, maxruns * sizeof(CacheSyncRun));
+    }
+    runs[nruns].offset = o;
+    runs[nruns].len = STORE_BLOCK_SIZE;
+    nruns++;
+  }
+}
+
+void
+CacheSync::free_buffers()
+{
+  if (buf) {
+    ats_memalign_free(buf);
+    buf = 0;
+    buflen = 0;
+  }
+  ats_free(runs);
+  runs = 0;
+  nruns = maxruns = 0;
+}
+
 uint64_t
 dir_entries_used(Vol *d)
 {
@@ -1115,11 +1297,7 @@ CacheSync::mainEvent(int event, Event *e)
 Lrestart:
   if (vol >= gnvol) {
     vol = 0;
-    if (buf) {
-      ats_memalign_free(buf);
-      buf = 0;
-      buflen = 0;
-    }
+    free_buffers();
     Debug("cache_dir_sync", "sync done");
     if (event == EVENT_INTERVAL)
       trigger = e->ethread->schedule_in(this, HRTIME_SECONDS(cache_config_dir_sync_frequency));
@@ -1131,10 +1309,13 @@ Lrestart:
     // AIO Thread
     if (io.aio_result != (int64_t)io.aiocb.aio_nbytes) {
       Warning("vol write error during directory sync '%s'", gvol[vol]->hash_id);
-      event = EVENT_NONE;
-      goto Ldone;
+      // clean up under the vol lock
+      failed = true;
+      trigger = eventProcessor.schedule_imm(this);
+      return EVENT_CONT;
     }
-    trigger = eventProcessor.schedule_in(this, SYNC_DELAY);
+    // pace the writes to SYNC_MAX_WRITE per SYNC_DELAY
+    trigger = eventProcessor.schedule_in(this, SYNC_DELAY * (ink_hrtime)io.aiocb.aio_nbytes / SYNC_MAX_WRITE);
     return EVENT_CONT;
   }
   {
@@ -1144,6 +1325,19 @@ Lrestart:
       return EVENT_CONT;
     }
     Vol *d = gvol[vol];
+    size_t dirlen = vol_dirlen(d);
+    size_t blocks = dirlen / STORE_BLOCK_SIZE;
+
+    if (failed) {
+      // the copy is no longer known to match anything on disk
+      uint8_t bit = 1 << (d->header->sync_serial & 1);
+      for (size_t i = 0; i < blocks; i++)
+        d->dir_dirty[i] |= bit;
+      d->dir_sync_in_progress = 0;
+      failed = false;
+      event = EVENT_NONE;
+      goto Ldone;
+    }
 
     // recompute hit_evacuate_window
     d->hit_evacuate_window = (d->data_blocks * cache_config_hit_evacuate_percent) / 100;
@@ -1152,7 +1346,6 @@ Lrestart:
       goto Ldone;
 
     int headerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
-    size_t dirlen = vol_dirlen(d);
     if (!writepos) {
       // start
       Debug("cache_dir_sync", "sync started");
@@ -1198,26 +1391,34 @@ Lrestart:
 #endif
       CHECK_DIR(d);
       memcpy(buf, d->raw_dir, dirlen);
+      collect(d);
+      run = 0;
+      synclen = vol_headerlen(d) + headerlen;
+      for (int i = 0; i < nruns; i++)
+        synclen += runs[i].len;
+      Debug("cache_dir_sync", "Dir %s: writing %" PRId64 " of %" PRId64 " bytes", d->hash_id, (int64_t)synclen,
+            (int64_t)dirlen);
       d->dir_sync_in_progress = 1;
     }
     size_t B = d->header->sync_serial & 1;
     off_t start = d->skip + (B ? dirlen : 0);
 
+    /* The header goes first and the footer last, so a copy cut short
+       has mismatched serials and is not recovered from.  In between,
+       only the blocks changed since the copy was last written.
+     */
     if (!writepos) {
-      // write header
-      aio_write(d->fd, buf + writepos, headerlen, start + writepos);
-      writepos += headerlen;
-    } else if (writepos < (off_t)dirlen - headerlen) {
-      // write part of body
-      int l = SYNC_MAX_WRITE;
-      if (writepos + l > (off_t)dirlen - headerlen)
-        l = dirlen - headerlen - writepos;
-      aio_write(d->fd, buf + writepos, l, start + writepos);
-      writepos += l;
-    } else if (writepos < (off_t)dirlen) {
-      ink_assert(writepos == (off_t)dirlen - headerlen);
+      // write header, with the freelist heads
+      aio_write(d->fd, buf, vol_headerlen(d), start);
+      writepos = vol_headerlen(d);
+    } else if (run < nruns) {
+      // write a run of the body
+      aio_write(d->fd, buf + runs[run].offset, runs[run].len, start + runs[run].offset);
+      writepos += runs[run].len;
+      run++;
+    } else if (writepos < synclen) {
       // write footer
-      aio_write(d->fd, buf + writepos, headerlen, start + writepos);
+      aio_write(d->fd, buf + dirlen - headerlen, headerlen, start + dirlen - headerlen);
       writepos += headerlen;
     } else {
       d->dir_sync_in_progress = 0;
@@ -1590,3 +1791,146 @@ EXCLUSIVE_REGRESSION_TEST(Cache_dir) (RegressionTest *t, int /* atype ATS_UNUSED
   vol_dir_clear(d);
   *status = ret;
 }
+
+// Directory lookups at scale: a directory of its own, as large as that of
+// a volume of 1TB of 8KB objects, filled with dir_insert and then probed
+// for what was inserted and for what was not, without and with the bucket
+// tag summaries.  Only run with the extended tests, as it takes 1.5GB.
+
+#define DIR_BENCH_ENTRIES (128 * 1024 * 1024)
+
+enum
+{
+  DIR_BENCH_INSERT,
+  DIR_BENCH_PROBE
+};
+
+// The last level cache misses of this thread so far, if they can be counted.
+static int
+dir_bench_misses_open()
+{
+#if defined(linux)
+  struct perf_event_attr pe;
+  memset(&pe, 0, sizeof(pe));
+  pe.type = PERF_TYPE_HARDWARE;
+  pe.size = sizeof(pe);
+  pe.config = PERF_COUNT_HW_CACHE_MISSES;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static uint64_t
+dir_bench_misses(int fd)
+{
+  uint64_t n = 0;
+  if (fd >= 0 && read(fd, &n, sizeof(n)) != sizeof(n))
+    n = 0;
+  return n;
+}
+
+static int
+dir_bench_run(RegressionTest *t, const char *what, Vol *d, int op, unsigned int seed, int n, int misses_fd)
+{
+  CacheKey key;
+  Dir dir;
+  int found = 0;
+
+  dir_clear(&dir);
+  dir_set_head(&dir, true);
+  regress_rand_init(seed);
+  uint64_t misses = dir_bench_misses(misses_fd);
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < n; i++) {
+    regress_rand_CacheKey(&key);
+    if (op == DIR_BENCH_INSERT) {
+      dir_set_offset(&dir, i + 1);
+      found += dir_insert(&key, d, &dir);
+    } else {
+      Dir *last_collision = 0;
+      found += dir_probe(&key, d, &dir, &last_collision);
+    }
+  }
+  double secs = (double) (ink_get_hrtime_internal() - start) / HRTIME_SECOND;
+  misses = dir_bench_misses(misses_fd) - misses;
+
+  char tag[64];
+  snprintf(tag, sizeof(tag), "%s%s", what, d->dir_tags ? "_tags" : "");
+  if (misses_fd >= 0)
+    rprintf(t, "%s: %d of %d, %.0f / second, %.2f LLC misses each\n", tag, found, n, n / secs, (double) misses / n);
+  else
+    rprintf(t, "%s: %d of %d, %.0f / second\n", tag, found, n, n / secs);
+  rperf(t, tag, n / secs);
+  return found;
+}
+
+EXCLUSIVE_REGRESSION_TEST(Cache_dir_bench) (RegressionTest *t, int atype, int *status) {
+  if (atype < REGRESSION_TEST_EXTENDED) {
+    *status = REGRESSION_TEST_NOT_RUN;
+    return;
+  }
+  if ((CacheProcessor::IsCacheEnabled() != CACHE_INITIALIZED) || gnvol < 1) {
+    rprintf(t, "cache not ready/configured");
+    *status = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  // the bench's own CacheVol, so that its entries are not counted in the
+  // stats of a live volume
+  static CacheVol bench_cache_vol;
+  if (!bench_cache_vol.vol_rsb && !(bench_cache_vol.vol_rsb = RecAllocateRawStatBlock((int) cache_stat_count))) {
+    rprintf(t, "cannot allocate the stats");
+    *status = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  int ret = REGRESSION_TEST_PASSED;
+  Vol *d = new Vol;
+  d->path = (char *) "dir_bench";
+  d->disk = gvol[0]->disk;
+  d->cache_vol = &bench_cache_vol;
+  d->buckets = DIR_BENCH_ENTRIES / DIR_DEPTH;
+  d->segments = (d->buckets + (((1<<16)-1)/DIR_DEPTH)) / ((1<<16)/DIR_DEPTH);
+  d->buckets = (d->buckets + d->segments - 1) / d->segments;
+  d->len = (off_t) vol_direntries(d) * CACHE_BLOCK_SIZE;
+  d->raw_dir = (char *) ats_memalign(ats_pagesize(), vol_dirlen(d));
+  d->dir_dirty = (uint8_t *) ats_malloc(vol_dirlen(d) / STORE_BLOCK_SIZE);
+  d->dir = (Dir *) (d->raw_dir + vol_headerlen(d));
+  d->header = (VolHeaderFooter *) d->raw_dir;
+  d->footer = (VolHeaderFooter *) (d->raw_dir + vol_dirlen(d) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter)));
+  uint64_t *tags = (uint64_t *) ats_memalign(DIR_TAGS_ALIGN, d->segments * d->buckets * sizeof(uint64_t));
+  int misses_fd = dir_bench_misses_open();
+  int n = (int) (vol_direntries(d) * 0.75);
+  int found[2][2];
+
+  rprintf(t, "%d entries in %d segments\n", vol_direntries(d), d->segments);
+  if (misses_fd < 0)
+    rprintf(t, "LLC misses can not be counted\n");
+  {
+    MUTEX_TRY_LOCK(lock, d->mutex, this_ethread());
+    ink_release_assert(lock);
+    for (int i = 0; i < 2; i++) {
+      d->dir_tags = i ? tags : NULL;
+      vol_clear_init(d);
+      d->header->write_pos = d->start + d->len;
+      dir_bench_run(t, "insert", d, DIR_BENCH_INSERT, 17, n, misses_fd);
+      found[i][0] = dir_bench_run(t, "probe_hit", d, DIR_BENCH_PROBE, 17, n, misses_fd);
+      found[i][1] = dir_bench_run(t, "probe_miss", d, DIR_BENCH_PROBE, 18, n, misses_fd);
+    }
+  }
+  // the same directory either way, so the same results
+  if (found[0][0] != found[1][0] || found[0][1] != found[1][1])
+    ret = REGRESSION_TEST_FAILED;
+
+  if (misses_fd >= 0)
+    close(misses_fd);
+  d->dir_tags = NULL;
+  ats_memalign_free(tags);
+  ats_memalign_free(d->raw_dir);
+  ats_free(d->dir_dirty);
+  delete d;
+  *status = ret;
+}
@@ -34,8 +34,14 @@ Cache::link(Continuation * cont, CacheKey * from, CacheKey * to, CacheFragType t
 
   ink_assert(caches[type] == this);
 
+  Vol *vol = key_to_vol(from, hostname, host_len);
+  if (!vol->online) {
+    cont->handleEvent(CACHE_EVENT_LINK_FAILED, 0);
+    return ACTION_RESULT_DONE;
+  }
+
   CacheVC *c = new_CacheVC(cont);
-  c->vol = key_to_vol(from, hostname, host_len);
+  c->vol = vol;
   c->write_len = sizeof(*to);   // so that the earliest_key will be used
   c->f.use_first_key = 1;
   c->first_key = *from;
@@ -83,6 +89,10 @@ Cache::deref(Continuation * cont, CacheKey * key, CacheFragType type, char *host
   ink_assert(caches[type] == this);
 
   Vol *vol = key_to_vol(key, hostname, host_len);
+  if (!vol->online) {
+    cont->handleEvent(CACHE_EVENT_DEREF_FAILED, 0);
+    return ACTION_RESULT_DONE;
+  }
   Dir result;
   Dir *last_collision = NULL;
   CacheVC *c = NULL;
@@ -39,6 +39,10 @@ Cache::open_read(Continuation * cont, CacheKey * key, CacheFragType type, char *
   ink_assert(caches[type] == this);
 
   Vol *vol = key_to_vol(key, hostname, host_len);
+  if (!vol->online) {
+    cont->handleEvent(CACHE_EVENT_OPEN_READ_FAILED, (void *) -ECACHE_NOT_READY);
+    return ACTION_RESULT_DONE;
+  }
   Dir result, *last_collision = NULL;
   ProxyMutex *mutex = cont->mutex;
   OpenDirEntry *od = NULL;
@@ -100,6 +104,10 @@ Cache::open_read(Continuation * cont, CacheKey * key, CacheHTTPHdr * request,
   ink_assert(caches[type] == this);
 
   Vol *vol = key_to_vol(key, hostname, host_len);
+  if (!vol->online) {
+    cont->handleEvent(CACHE_EVENT_OPEN_READ_FAILED, (void *) -ECACHE_NOT_READY);
+    return ACTION_RESULT_DONE;
+  }
   Dir result, *last_collision = NULL;
   ProxyMutex *mutex = cont->mutex;
   OpenDirEntry *od = NULL;
@@ -270,6 +278,29 @@ CacheVC::openReadChooseWriter(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSE
   return EVENT_NONE;
 }
 
+/*
+  Parks the reader until the writers of the entry make progress: it is
+  called back in openReadFromWriter() when one of them writes its first
+  fragment or closes. Returns false if the reader has already waited
+  cache_config_read_while_writer_max_wait for them. Must be called under
+  the vol lock.
+*/
+bool
+CacheVC::openReadWaitForWriter(OpenDirEntry *d)
+{
+  ink_hrtime left = HRTIME_MSECONDS(cache_config_read_while_writer_max_wait) - (ink_get_hrtime() - start_time);
+
+  od = NULL;
+  write_vc = NULL;
+  if (left <= 0)
+    return false;
+  if (!writer_lock_retry++) {
+    CACHE_INCREMENT_DYN_STAT(cache_read_busy_wait_stat);
+  }
+  d->wait(this, (int) ink_hrtime_to_msec(left + HRTIME_MSECOND - 1));
+  return true;
+}
+
 int
 CacheVC::openReadFromWriter(int event, Event * e)
 {
@@ -291,13 +322,23 @@ CacheVC::openReadFromWriter(int event, Event * e)
 #ifndef READ_WHILE_WRITER
   return openReadFromWriterFailure(CACHE_EVENT_OPEN_READ_FAILED, (Event *) -err);
 #else
-  if (_action.cancelled) {
+  if (_action.cancelled && !f.open_read_timeout) {
     od = NULL; // only open for read so no need to close
     return free_CacheVC(this);
   }
   CACHE_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
   if (!lock)
     VC_SCHED_LOCK_RETRY();
+  if (f.open_read_timeout) {
+    // the wait for the writer ran out
+    vol->open_dir.leave(this);
+    MUTEX_RELEASE(lock);
+    od = NULL;
+    if (_action.cancelled)
+      return free_CacheVC(this);
+    DDebug("cache_read_agg", "%p: key: %X gave up waiting for the writer", this, first_key.word(1));
+    return openReadFromWriterFailure(CACHE_EVENT_OPEN_READ_FAILED, (Event *) -err);
+  }
   od = vol->open_read(&first_key); // recheck in case the lock failed
   if (!od) {
     MUTEX_RELEASE(lock);
@@ -306,6 +347,7 @@ CacheVC::openReadFromWriter(int event, Event * e)
     return openReadStartHead(event, e);
   } else
     ink_assert(od == vol->open_read(&first_key));
+  OpenDirEntry *wod = od;
   if (!write_vc) {
     int ret = openReadChooseWriter(event, e);
     if (ret < 0) {
@@ -318,7 +360,10 @@ CacheVC::openReadFromWriter(int event, Event * e)
       return openReadStartHead(event, e);
     } else if (ret == EVENT_CONT) {
       ink_assert(!write_vc);
-      VC_SCHED_WRITER_RETRY();
+      if (openReadWaitForWriter(wod))
+        return EVENT_CONT;
+      MUTEX_RELEASE(lock);
+      return openReadFromWriterFailure(CACHE_EVENT_OPEN_READ_FAILED, (Event *) -err);
     } else
       ink_assert(write_vc);
   } else {
@@ -354,7 +399,10 @@ CacheVC::openReadFromWriter(int event, Event * e)
     DDebug("cache_read_agg",
           "%p: key: %X writer: closed:%d, fragment:%d, retry: %d",
           this, first_key.word(1), write_vc->closed, write_vc->fragment, writer_lock_retry);
-    VC_SCHED_WRITER_RETRY();
+    if (openReadWaitForWriter(wod))
+      return EVENT_CONT;
+    MUTEX_RELEASE(lock);
+    return openReadFromWriterFailure(CACHE_EVENT_OPEN_READ_FAILED, (Event *) -err);
   }
 
   CACHE_TRY_LOCK(writer_lock, write_vc->mutex, mutex->thread_holding);
@@ -625,6 +673,7 @@ CacheVC::openReadMain(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
   int64_t ntodo = vio.ntodo();
   int64_t bytes = doc->len - doc_pos;
   IOBufferBlock *b = NULL;
+Lseek:
   if (seek_to) { // handle do_io_pread
     if (seek_to >= doc_len) {
       vio.ndone = doc_len;
@@ -689,7 +738,6 @@ CacheVC::openReadMain(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
     }
     doc_pos = doc->prefix_len() + seek_to;
     if (fragment) doc_pos -= static_cast<int64_t>(frags[fragment-1]);
-    vio.ndone = 0;
     seek_to = 0;
     ntodo = vio.ntodo();
     bytes = doc->len - doc_pos;
@@ -708,11 +756,19 @@ CacheVC::openReadMain(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
     goto Lread;
   if (bytes > vio.ntodo())
     bytes = vio.ntodo();
+  if (read_ranges && bytes > range_todo)
+    bytes = range_todo;
   b = new_IOBufferBlock(buf, bytes, doc_pos);
   b->_buf_end = b->_end;
   vio.buffer.writer()->append_block(b);
   vio.ndone += bytes;
   doc_pos += bytes;
+  if (read_ranges && !(range_todo -= bytes) && ++read_range < n_read_ranges) {
+    // the next range is found through the fragment table, so only the
+    // fragments it covers are read
+    seek_to = read_ranges[2 * read_range];
+    range_todo = read_ranges[2 * read_range + 1] - read_ranges[2 * read_range] + 1;
+  }
   if (vio.ntodo() <= 0)
     return calluser(VC_EVENT_READ_COMPLETE);
   else {
@@ -720,8 +776,11 @@ CacheVC::openReadMain(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
       return EVENT_DONE;
     // we have to keep reading until we give the user all the
     // bytes it wanted or we hit the watermark.
-    if (vio.ntodo() > 0 && !vio.buffer.writer()->high_water())
+    if (vio.ntodo() > 0 && !vio.buffer.writer()->high_water()) {
+      if (seek_to)
+        goto Lseek;
       goto Lread;
+    }
     return EVENT_CONT;
   }
 Lread: {
@@ -48,6 +48,10 @@ CacheTestSM::CacheTestSM(RegressionTest *t) :
 CacheTestSM::~CacheTestSM() {
   ink_assert(!cache_action);
   ink_assert(!cache_vc);
+#ifdef HTTP_CACHE
+  if (request.valid())
+    request.destroy();
+#endif
   if (buffer_reader)
     buffer->dealloc_reader(buffer_reader);
   if (buffer)
@@ -227,13 +231,14 @@ void CacheTestSM::fill_buffer() {
   }
 }
 
-int CacheTestSM::check_buffer() {
-  int64_t avail = buffer_reader->read_avail();
+// Checks the next @a len bytes of the reader against the content at offset
+// @a pos of the object, consuming them.
+int CacheTestSM::check_content(int64_t pos, int64_t len) {
+  int64_t avail = len;
   CacheKey k = key;
   k.b[1] += content_salt;
   char b[sizeof(key)];
   int64_t sk = (int64_t)sizeof(key);
-  int64_t pos = cvio->ndone -  buffer_reader->read_avail();
   while (avail > 0) {
     int64_t l = avail;
     if (l > sk)
@@ -253,6 +258,10 @@ int CacheTestSM::check_buffer() {
   return 1;
 }
 
+int CacheTestSM::check_buffer() {
+  return check_content(cvio->ndone - buffer_reader->read_avail(), buffer_reader->read_avail());
+}
+
 int CacheTestSM::check_result(int event) {
   return
     initial_event == expect_initial_event &&
@@ -275,6 +284,63 @@ CacheTestSM::CacheTestSM(const CacheTestSM &ao) : RegressionSM(ao) {
   SET_HANDLER(&CacheTestSM::event_handler);
 }
 
+#ifdef HTTP_CACHE
+extern CacheLookupHttpConfig global_cache_lookup_config;
+
+// Ranges of the 10MB object read back by http_range_test, as inclusive
+// [start, end] pairs: the first and last fragments, a fragment boundary and
+// two ranges in the same fragment.
+static int64_t const test_ranges[] = {
+  10, 109,
+  1048000, 1050000,
+  6000000, 6000099,
+  6000500, 6000599,
+  9999900, 9999999
+};
+
+// fragment bytes fetched by the full read of the object
+static int64_t http_read_bytes;
+
+static void
+make_test_hdr(HTTPHdr *hdr, HTTPType type, const char *str)
+{
+  HTTPParser parser;
+  const char *start = str;
+
+  http_parser_init(&parser);
+  hdr->create(type);
+  if (type == HTTP_TYPE_REQUEST)
+    hdr->parse_req(&parser, &start, str + strlen(str), true);
+  else
+    hdr->parse_resp(&parser, &start, str + strlen(str), true);
+  http_parser_clear(&parser);
+}
+
+static void
+make_test_request(HTTPHdr *request, const char *url)
+{
+  char b[1024];
+
+  if (request->valid())
+    request->destroy();
+  snprintf(b, sizeof(b), "GET %s HTTP/1.1\r\n\r\n", url);
+  make_test_hdr(request, HTTP_TYPE_REQUEST, b);
+}
+
+// Maps @a pos in the output of a read of test_ranges to its offset in the
+// object and sets @a left to the bytes remaining in its range.
+static int64_t
+test_range_offset(int64_t pos, int64_t *left)
+{
+  unsigned i = 0;
+
+  for (; pos > test_ranges[i + 1] - test_ranges[i]; i += 2)
+    pos -= test_ranges[i + 1] - test_ranges[i] + 1;
+  *left = test_ranges[i + 1] - test_ranges[i] + 1 - pos;
+  return test_ranges[i] + pos;
+}
+#endif
+
 EXCLUSIVE_REGRESSION_TEST(cache)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus) {
   if (cacheProcessor.IsCacheEnabled() != CACHE_INITIALIZED) {
     rprintf(t, "cache not initialized");
@@ -394,6 +460,104 @@ EXCLUSIVE_REGRESSION_TEST(cache)(RegressionTest *t, int /* atype ATS_UNUSED */,
   pread_test.nbytes = 100;
   pread_test.key = large_write_test.key;
 
+#ifdef HTTP_CACHE
+  CACHE_SM(t, http_write_test, {
+      make_test_request(&request, urlstr);
+      cacheProcessor.open_write(this, 0, request.url_get(), false, &request, NULL);
+    }
+    int open_write_callout() {
+      char b[256];
+      HTTPHdr response;
+      snprintf(b, sizeof(b), "HTTP/1.1 200 OK\r\nContent-Length: %" PRId64 "\r\n"
+               "Cache-Control: max-age=86400\r\n\r\n", nbytes);
+      make_test_hdr(&response, HTTP_TYPE_RESPONSE, b);
+      info.create();
+      info.request_set(&request);
+      info.response_set(&response);
+      info.request_sent_time_set(time(NULL));
+      info.response_received_time_set(time(NULL));
+      response.destroy();
+      cache_vc->set_http_info(&info);
+      cvio = cache_vc->do_io_write(this, nbytes, buffer_reader);
+      return 1;
+    });
+  http_write_test.expect_initial_event = CACHE_EVENT_OPEN_WRITE;
+  http_write_test.expect_event = VC_EVENT_WRITE_COMPLETE;
+  http_write_test.nbytes = 10000000;
+  rand_CacheKey(&http_write_test.key, thread->mutex);
+  {
+    char hex[33];
+    snprintf(http_write_test.urlstr, sizeof(http_write_test.urlstr), "http://regression.cache/%s",
+             http_write_test.key.toHexStr(hex));
+  }
+
+  // reads the whole object to count the fragment bytes it reads from disk
+  CACHE_SM(t, http_read_test, {
+      make_test_request(&request, urlstr);
+      cacheProcessor.open_read(this, request.url_get(), false, &request, &global_cache_lookup_config);
+    }
+    int open_read_callout() {
+      RecGetRawStatSum(cache_rsb, cache_read_bytes_stat, &http_read_bytes);
+      cvio = cache_vc->do_io_read(this, nbytes, buffer);
+      return 1;
+    }
+    int check_buffer() {
+      if (!CacheTestSM::check_buffer())
+        return 0;
+      if (cvio->ntodo() <= 0) {
+        int64_t read_bytes;
+        RecGetRawStatSum(cache_rsb, cache_read_bytes_stat, &read_bytes);
+        http_read_bytes = read_bytes - http_read_bytes;
+      }
+      return 1;
+    });
+  http_read_test.expect_initial_event = CACHE_EVENT_OPEN_READ;
+  http_read_test.expect_event = VC_EVENT_READ_COMPLETE;
+  http_read_test.nbytes = http_write_test.nbytes;
+  http_read_test.key = http_write_test.key;
+  ink_strlcpy(http_read_test.urlstr, http_write_test.urlstr, sizeof(http_read_test.urlstr));
+
+  // reads test_ranges by seeking through the fragment table
+  CACHE_SM(t, http_range_test, {
+      make_test_request(&request, urlstr);
+      cacheProcessor.open_read(this, request.url_get(), false, &request, &global_cache_lookup_config);
+    }
+    int64_t read_bytes_start;
+    int open_read_callout() {
+      RecGetRawStatSum(cache_rsb, cache_read_bytes_stat, &read_bytes_start);
+      cvio = cache_vc->do_io_pread_ranges(this, buffer, countof(test_ranges) / 2, test_ranges);
+      return 1;
+    }
+    int check_buffer() {
+      int64_t avail = buffer_reader->read_avail();
+      int64_t pos = cvio->ndone - avail;
+      int64_t left;
+      while (avail > 0) {
+        int64_t offset = test_range_offset(pos, &left);
+        int64_t l = min(avail, left);
+        if (!check_content(offset, l))
+          return 0;
+        pos += l;
+        avail -= l;
+      }
+      if (cvio->ntodo() <= 0) {
+        int64_t read_bytes;
+        RecGetRawStatSum(cache_rsb, cache_read_bytes_stat, &read_bytes);
+        read_bytes -= read_bytes_start;
+        rprintf(t, "read %" PRId64 " bytes of fragments for %" PRId64 " bytes of ranges, %" PRId64 " for the whole object\n",
+                read_bytes, cvio->ndone, http_read_bytes);
+        // only the fragments under the ranges should have been read
+        if (read_bytes * 2 > http_read_bytes)
+          return 0;
+      }
+      return 1;
+    });
+  http_range_test.expect_initial_event = CACHE_EVENT_OPEN_READ;
+  http_range_test.expect_event = VC_EVENT_READ_COMPLETE;
+  http_range_test.key = http_write_test.key;
+  ink_strlcpy(http_range_test.urlstr, http_write_test.urlstr, sizeof(http_range_test.urlstr));
+#endif
+
   r_sequential(
     t,
     write_test.clone(),
@@ -408,6 +572,11 @@ EXCLUSIVE_REGRESSION_TEST(cache)(RegressionTest *t, int /* atype ATS_UNUSED */,
     replace_read_test.clone(),
     large_write_test.clone(),
     pread_test.clone(),
+#ifdef HTTP_CACHE
+    http_write_test.clone(),
+    http_read_test.clone(),
+    http_range_test.clone(),
+#endif
     NULL_PTR
     )->run(pstatus);
   return;
@@ -487,3 +656,32 @@ REGRESSION_TEST(cache_disk_replacement_stability)(RegressionTest *t, int level,
   hr1.vols = 0;
   hr2.vols = 0;
 }
+
+#ifdef HTTP_CACHE
+// Each segment of an object has a key of its own, which changes with the
+// segment size so segments cut at another size are never served, and the
+// segment head has yet another.
+REGRESSION_TEST(cache_segment_key)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus) {
+  INK_MD5 url, key, same, next, resized, first, head;
+
+  url.encodeBuffer("http://regression.range.segment/object", 38);
+  key = url;
+  Cache::segment_key(&key, 1, 1000);
+  same = url;
+  Cache::segment_key(&same, 1, 1000);
+  next = url;
+  Cache::segment_key(&next, 2, 1000);
+  resized = url;
+  Cache::segment_key(&resized, 1, 2000);
+  first = url;
+  Cache::segment_key(&first, 0, 1000);
+  head = url;
+  Cache::segment_head_key(&head);
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  if (key == url || !(key == same) || key == next || key == resized || head == url || head == first) {
+    rprintf(t, "segment keys not distinct\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+}
+#endif
@@ -78,6 +78,9 @@ CacheVC::scanVol(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
     goto Ldone;
   }
 Lcont:
+  // not read and recovered yet, on to the next
+  if (!vol->online)
+    return scanVol(EVENT_NONE, 0);
   fragment = 0;
   SET_HANDLER(&CacheVC::scanObject);
   eventProcessor.schedule_in(this, HRTIME_MSECONDS(scan_msec_delay));
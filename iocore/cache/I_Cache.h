@@ -108,17 +108,23 @@ struct CacheProcessor:public Processor
 #ifdef HTTP_CACHE
   Action *lookup(Continuation *cont, URL *url, bool cluster_cache_local, bool local_only = false,
                  CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP);
+  /** A non-negative @a segment opens that segment, of @a segment_size
+      bytes, of a range segmented object instead of the object itself,
+      see Cache::segment_key.
+  */
   inkcoreapi Action *open_read(Continuation *cont, URL *url,
                                bool cluster_cache_local,
                                CacheHTTPHdr *request,
                                CacheLookupHttpConfig *params,
-                               time_t pin_in_cache = (time_t) 0, CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP);
+                               time_t pin_in_cache = (time_t) 0, CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP,
+                               int64_t segment = -1, int64_t segment_size = 0);
   Action *open_read_buffer(Continuation *cont, MIOBuffer *buf, URL *url,
                            CacheHTTPHdr *request,
                            CacheLookupHttpConfig *params, CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP);
   Action *open_write(Continuation *cont, int expected_size, URL *url, bool cluster_cache_local,
                      CacheHTTPHdr *request, CacheHTTPInfo *old_info,
-                     time_t pin_in_cache = (time_t) 0, CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP);
+                     time_t pin_in_cache = (time_t) 0, CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP,
+                     int64_t segment = -1, int64_t segment_size = 0);
   Action *open_write_buffer(Continuation *cont, MIOBuffer *buf, URL *url,
                             CacheHTTPHdr *request, CacheHTTPHdr *response,
                             CacheFragType frag_type = CACHE_FRAG_TYPE_HTTP);
@@ -197,6 +203,11 @@ struct CacheVConnection:public VConnection
 {
   VIO *do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf) = 0;
   virtual VIO *do_io_pread(Continuation *c, int64_t nbytes, MIOBuffer *buf, int64_t offset) = 0;
+  /** Read several byte ranges of the object back to back.
+      @a ranges holds @a n inclusive [start, end] offset pairs, sorted and
+      not overlapping.  Only the fragments covering the ranges are read.
+  */
+  virtual VIO *do_io_pread_ranges(Continuation *c, MIOBuffer *buf, int n, int64_t const *ranges) = 0;
   VIO *do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *buf, bool owner = false) = 0;
   void do_io_close(int lerrno = -1) = 0;
   void reenable(VIO *avio) = 0;
@@ -54,6 +54,11 @@ struct CacheVC;
 
 #define SYNC_MAX_WRITE                  (2 * 1024 * 1024)
 #define SYNC_DELAY                      HRTIME_MSECONDS(500)
+#define DIR_DIRTY_BOTH                  3 // changed since either copy was written
+#define DIR_TAGS_LANES                  4 // tags summarized per bucket, one to a 16 bit lane
+#define DIR_TAGS_LANE_USED              0x8000
+#define DIR_TAGS_UNKNOWN                (~(uint64_t)0) // longer chain, walk it
+#define DIR_TAGS_ALIGN                  64 // a cache line, 8 buckets
 #define DO_NOT_REMOVE_THIS              0
 
 // Debugging Options
@@ -257,7 +262,7 @@ LINK_FORWARD_DECLARATION(CacheVC, opendir_link) // forward declaration
 struct OpenDirEntry
 {
   DLL<CacheVC, Link_CacheVC_opendir_link> writers;       // list of all the current writers
-  DLL<CacheVC, Link_CacheVC_opendir_link> readers;         // list of all the current readers - not used
+  DLL<CacheVC, Link_CacheVC_opendir_link> readers;         // readers waiting for a writer to make progress
   CacheHTTPInfoVector vector;   // Vector for the http document. Each writer
                                 // maintains a pointer to this vector and
                                 // writes it down to disk.
@@ -291,22 +296,40 @@ struct OpenDir: public Continuation
   int close_write(CacheVC *c);
   OpenDirEntry *open_read(INK_MD5 *key);
   int signal_readers(int event, Event *e);
+  void wake_readers(OpenDirEntry *d);
+  void leave(CacheVC *c);
 
   OpenDir();
 };
 
+// A run of changed directory blocks to write
+struct CacheSyncRun
+{
+  off_t offset;                 // in the directory copy
+  int len;
+};
+
 struct CacheSync: public Continuation
 {
   int vol;
   char *buf;
   size_t buflen;
   off_t writepos;
+  off_t synclen;                // of the header, runs and footer in buf
+  CacheSyncRun *runs;
+  int nruns;
+  int maxruns;
+  int run;
+  bool failed;
   AIOCallbackInternal io;
   Event *trigger;
   int mainEvent(int event, Event *e);
   void aio_write(int fd, char *b, int n, off_t o);
+  void collect(Vol *d);
+  void free_buffers();
 
-  CacheSync():Continuation(new_ProxyMutex()), vol(0), buf(0), buflen(0), writepos(0), trigger(0)
+  CacheSync():Continuation(new_ProxyMutex()), vol(0), buf(0), buflen(0), writepos(0), synclen(0),
+    runs(0), nruns(0), maxruns(0), run(0), failed(false), trigger(0)
   {
     SET_HANDLER(&CacheSync::mainEvent);
   }
@@ -327,6 +350,7 @@ void dir_lookaside_cleanup(Vol *d);
 void dir_lookaside_remove(CacheKey *key, Vol *d);
 void dir_free_entry(Dir *e, int s, Vol *d);
 void dir_sync_init();
+void dir_tags_build(Vol *d);
 int check_dir(Vol *d);
 void dir_clean_vol(Vol *d);
 void dir_clear_range(off_t start, off_t end, Vol *d);
@@ -350,6 +374,19 @@ dir_compare_tag(Dir *e, CacheKey *key)
   return (dir_tag(e) == DIR_MASK_TAG(key->word(2)));
 }
 
+// Whether a bucket with the tag summary @a t may hold an entry with the
+// tag of @a key.  The summary holds the tags of the bucket chain one to
+// a lane, so all of them are compared at once.
+TS_INLINE bool
+dir_tags_may_match(uint64_t t, CacheKey *key)
+{
+  if (t == DIR_TAGS_UNKNOWN)
+    return true;
+  uint64_t x = t ^ (0x0001000100010001ULL * (DIR_TAGS_LANE_USED | DIR_MASK_TAG(key->word(2))));
+  // true if any lane of x is zero
+  return ((x - 0x0001000100010001ULL) & ~x & 0x8000800080008000ULL) != 0;
+}
+
 TS_INLINE Dir *
 dir_from_offset(int64_t i, Dir *seg)
 {
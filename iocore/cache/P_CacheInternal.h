@@ -154,12 +154,19 @@ enum
   cache_three_plus_plus_fragment_document_count_stat,
   cache_read_busy_success_stat,
   cache_read_busy_failure_stat,
+  cache_read_busy_wait_stat,
   cache_gc_bytes_evacuated_stat,
   cache_gc_frags_evacuated_stat,
   cache_write_bytes_stat,
+  cache_read_bytes_stat,
   cache_hdr_vector_marshal_stat,
   cache_hdr_marshal_stat,
   cache_hdr_marshal_bytes_stat,
+  cache_startup_dir_read_time_stat,
+  cache_startup_recover_time_stat,
+  cache_startup_first_online_time_stat,
+  cache_startup_online_time_stat,
+  cache_startup_volumes_online_stat,
   cache_stat_count
 };
 
@@ -229,6 +236,9 @@ extern int cache_config_hit_evacuate_size_limit;
 extern int cache_config_force_sector_size;
 extern int cache_config_target_fragment_size;
 extern int cache_config_mutex_retry_delay;
+extern int cache_config_read_while_writer_max_wait;
+extern int cache_config_online_per_volume;
+extern int cache_config_dir_tag_index;
 #if TS_USE_INTERIM_CACHE == 1
 extern int good_interim_disks;
 #endif
@@ -239,6 +249,7 @@ struct CacheVC: public CacheVConnection
 
   VIO *do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf);
   VIO *do_io_pread(Continuation *c, int64_t nbytes, MIOBuffer *buf, int64_t offset);
+  VIO *do_io_pread_ranges(Continuation *c, MIOBuffer *buf, int n, int64_t const *ranges);
   VIO *do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *buf, bool owner = false);
   void do_io_close(int lerrno = -1);
   void reenable(VIO *avio);
@@ -308,6 +319,7 @@ struct CacheVC: public CacheVConnection
   int openReadFromWriterMain(int event, Event *e);
   int openReadFromWriterFailure(int event, Event *);
   int openReadChooseWriter(int event, Event *e);
+  bool openReadWaitForWriter(OpenDirEntry *d);
 
   int openWriteCloseDir(int event, Event *e);
   int openWriteCloseHeadDone(int event, Event *e);
@@ -442,6 +454,10 @@ struct CacheVC: public CacheVConnection
   int recursive;
   int closed;
   uint64_t seek_to;               // pread offset
+  int64_t *read_ranges;           // do_io_pread_ranges [start, end] pairs
+  int n_read_ranges;
+  int read_range;                 // index of the range being read
+  int64_t range_todo;             // bytes left in the current range
   int64_t offset;                 // offset into 'blocks' of data to write
   int64_t writer_offset;          // offset of the writer for reading from a writer
   int64_t length;                 // length of data available to write
@@ -479,7 +495,7 @@ struct CacheVC: public CacheVConnection
       unsigned int update:1;
       unsigned int remove:1;
       unsigned int remove_aborted_writers:1;
-      unsigned int open_read_timeout:1; // UNUSED
+      unsigned int open_read_timeout:1; // waiting on OpenDirEntry::readers
       unsigned int data_done:1;
       unsigned int read_from_writer_called:1;
       unsigned int not_from_ram_cache:1;        // entire object was from ram cache
@@ -624,6 +640,8 @@ free_CacheVC(CacheVC *cont)
   cont->alternate_index = CACHE_ALT_INDEX_DEFAULT;
   if (cont->scan_vol_map)
     ats_free(cont->scan_vol_map);
+  if (cont->read_ranges)
+    ats_free(cont->read_ranges);
   memset((char *) &cont->vio, 0, cont->size_to_init);
 #ifdef CACHE_STAT_PAGES
   ink_assert(!cont->stat_link.next && !cont->stat_link.prev);
@@ -1015,6 +1033,7 @@ struct Cache
   int64_t cache_size;             //in store block size
   CacheHostTable *hosttable;
   volatile int total_initialized_vol;
+  volatile int total_started_vol;       // with the hash ids the volume hash table needs
   CacheType scheme;
 
   int open(bool reconfigure, bool fix);
@@ -1037,15 +1056,18 @@ struct Cache
                                CacheHTTPHdr *request,
                                CacheLookupHttpConfig *params, CacheFragType type, char *hostname, int host_len);
   Action *open_read(Continuation *cont, URL *url, CacheHTTPHdr *request,
-                    CacheLookupHttpConfig *params, CacheFragType type);
+                    CacheLookupHttpConfig *params, CacheFragType type, int64_t segment = -1,
+                    int64_t segment_size = 0);
   Action *open_write(Continuation *cont, CacheKey *key,
                      CacheHTTPInfo *old_info, time_t pin_in_cache = (time_t) 0,
                      CacheKey *key1 = NULL,
                      CacheFragType type = CACHE_FRAG_TYPE_HTTP, char *hostname = 0, int host_len = 0);
   Action *open_write(Continuation *cont, URL *url, CacheHTTPHdr *request,
                      CacheHTTPInfo *old_info, time_t pin_in_cache = (time_t) 0,
-                     CacheFragType type = CACHE_FRAG_TYPE_HTTP);
+                     CacheFragType type = CACHE_FRAG_TYPE_HTTP, int64_t segment = -1, int64_t segment_size = 0);
   static void generate_key(INK_MD5 *md5, URL *url, CacheHTTPHdr *request);
+  static void segment_key(INK_MD5 *md5, int64_t segment, int64_t segment_size);
+  static void segment_head_key(INK_MD5 *md5);
 #endif
 
   Action *link(Continuation *cont, CacheKey *from, CacheKey *to, CacheFragType type, char *hostname, int host_len);
@@ -1059,7 +1081,7 @@ struct Cache
 
   Cache()
     : cache_read_done(0), total_good_nvol(0), total_nvol(0), ready(CACHE_INITIALIZING), cache_size(0),  // in store block size
-      hosttable(NULL), total_initialized_vol(0), scheme(CACHE_NONE_TYPE)
+      hosttable(NULL), total_initialized_vol(0), total_started_vol(0), scheme(CACHE_NONE_TYPE)
     { }
 };
 
@@ -1070,11 +1092,13 @@ inkcoreapi extern Cache *caches[NUM_CACHE_FRAG_TYPES];
 #ifdef HTTP_CACHE
 TS_INLINE Action *
 Cache::open_read(Continuation *cont, CacheURL *url, CacheHTTPHdr *request,
-                 CacheLookupHttpConfig *params, CacheFragType type)
+                 CacheLookupHttpConfig *params, CacheFragType type, int64_t segment, int64_t segment_size)
 {
   INK_MD5 md5;
   int len;
   url->MD5_get(&md5);
+  if (segment >= 0)
+    segment_key(&md5, segment, segment_size);
   const char *hostname = url->host_get(&len);
   return open_read(cont, &md5, request, params, type, (char *) hostname, len);
 }
@@ -1124,13 +1148,41 @@ Cache::generate_key(INK_MD5 *md5, URL *url, CacheHTTPHdr */* request ATS_UNUSED
   url->MD5_get(md5);
 }
 
+// Segments of a range segmented object are separate objects, each keyed
+// off the key of the whole object, its segment number and the segment
+// size, which may be changed at run time.  The hostname stays that of the
+// URL so they land in the same volume.
+TS_INLINE void
+Cache::segment_key(INK_MD5 *md5, int64_t segment, int64_t segment_size)
+{
+  INK_DIGEST_CTX context;
+  ink_code_incr_md5_init(&context);
+  ink_code_incr_md5_update(&context, (char *) md5, sizeof(INK_MD5));
+  ink_code_incr_md5_update(&context, (char *) &segment, sizeof(segment));
+  ink_code_incr_md5_update(&context, (char *) &segment_size, sizeof(segment_size));
+  ink_code_incr_md5_final((char *) md5, &context);
+}
+
+// The segment head of a range segmented object is a small object of its
+// own, holding the validator of the version its segments are to be of.
+// Its key is mixed like a segment key, off a segment number and size no
+// segment ever has.
+TS_INLINE void
+Cache::segment_head_key(INK_MD5 *md5)
+{
+  segment_key(md5, -1, 0);
+}
+
 TS_INLINE Action *
 Cache::open_write(Continuation *cont, CacheURL *url, CacheHTTPHdr *request,
-                  CacheHTTPInfo *old_info, time_t pin_in_cache, CacheFragType type)
+                  CacheHTTPInfo *old_info, time_t pin_in_cache, CacheFragType type, int64_t segment,
+                  int64_t segment_size)
 {
   (void) request;
   INK_MD5 url_md5;
   url->MD5_get(&url_md5);
+  if (segment >= 0)
+    segment_key(&url_md5, segment, segment_size);
   int len;
   const char *hostname = url->host_get(&len);
 
@@ -78,6 +78,7 @@ struct CacheTestSM : public RegressionSM {
 #ifdef HTTP_CACHE
   CacheLookupHttpConfig params;
   CacheHTTPInfo info;
+  CacheHTTPHdr request;
   char urlstr[1024];
 #endif
   int64_t total_size;
@@ -92,7 +93,8 @@ struct CacheTestSM : public RegressionSM {
   int end_memcpy_on_clone; // place all variables to be copied between these markers
 
   void fill_buffer();
-  int check_buffer();
+  int check_content(int64_t pos, int64_t len);
+  virtual int check_buffer();
   int check_result(int event);
   int complete(int event);
   int event_handler(int event, void *edata);
@@ -419,7 +419,9 @@ struct Vol: public Continuation
   int fd;
 
   char *raw_dir;
+  uint8_t *dir_dirty;           // per block of raw_dir, the copies (bit 0 A, bit 1 B) it changed since
   Dir *dir;
+  uint64_t *dir_tags;           // per bucket, the tags of its chain (see dir_tags_may_match), if kept
   VolHeaderFooter *header;
   VolHeaderFooter *footer;
   int segments;
@@ -462,6 +464,9 @@ struct Vol: public Continuation
   bool dir_sync_waiting;
   bool dir_sync_in_progress;
   bool writing_end_marker;
+  bool online;                  // lookups may come, set once on the way up
+  ink_hrtime init_start;        // startup phases, for the startup stats
+  ink_hrtime recover_start;
 
   CacheKey first_fragment_key;
   int64_t first_fragment_offset;
@@ -530,6 +535,9 @@ struct Vol: public Continuation
   int handle_recover_from_data(int event, void *data);
   int handle_recover_write_dir(int event, void *data);
   int handle_header_read(int event, void *data);
+  int recover_read();
+  int recover_take_ahead();
+  void recover_read_ahead();
 
 #if TS_USE_INTERIM_CACHE == 1
   int recover_interim_vol();
@@ -576,11 +584,12 @@ struct Vol: public Continuation
   uint32_t round_to_approx_size(uint32_t l);
 
   Vol()
-    : Continuation(new_ProxyMutex()), path(NULL), fd(-1),
-      dir(0), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
+    : Continuation(new_ProxyMutex()), path(NULL), fd(-1), dir_dirty(NULL),
+      dir(0), dir_tags(NULL), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
       len(0), data_blocks(0), hit_evacuate_window(0), agg_todo_size(0), agg_buf_pos(0), trigger(0),
       evacuate_size(0), disk(NULL), last_sync_serial(0), last_write_serial(0), recover_wrapped(false),
-      dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0) {
+      dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0), online(false), init_start(0),
+      recover_start(0) {
     open_dir.mutex = mutex;
     agg_buffer = (char *)ats_memalign(ats_pagesize(), AGG_SIZE);
     memset(agg_buffer, 0, AGG_SIZE);
@@ -588,6 +597,7 @@ struct Vol: public Continuation
   }
 
   ~Vol() {
+    ink_aio_unregister_buffer(agg_buffer);
     ats_memalign_free(agg_buffer);
   }
 };
@@ -801,6 +811,7 @@ Doc::data()
   return ((char *) this) + sizeofDoc + _flen + hlen;
 }
 
+void vol_clear_init(Vol *d);
 int vol_dir_clear(Vol *d);
 int vol_init(Vol *d, char *s, off_t blocks, off_t skip, bool clear);
 
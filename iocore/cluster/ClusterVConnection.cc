@@ -97,6 +97,13 @@ ClusterVConnectionBase::do_io_pread(Continuation * /* acont ATS_UNUSED */, int64
   return 0;
 }
 
+VIO *
+ClusterVConnectionBase::do_io_pread_ranges(Continuation * /* acont ATS_UNUSED */, MIOBuffer * /* abuffer ATS_UNUSED */,
+                                           int /* n ATS_UNUSED */, int64_t const * /* ranges ATS_UNUSED */)
+{
+  return 0;
+}
+
 int
 ClusterVConnection::get_header(void ** /* ptr ATS_UNUSED */, int * /*len ATS_UNUSED */)
 {
@@ -351,6 +351,7 @@ struct ClusterVConnectionBase: public CacheVConnection
   }
   virtual void do_io_close(int lerrno = -1);
   virtual VIO* do_io_pread(Continuation*, int64_t, MIOBuffer*, int64_t);
+  virtual VIO* do_io_pread_ranges(Continuation*, MIOBuffer*, int, int64_t const*);
 
   // Set the timeouts associated with this connection.
   // active_timeout is for the total elasped time of the connection.
@@ -47,7 +47,8 @@ int dns_failover_period = DEFAULT_FAILOVER_PERIOD;
 int dns_failover_try_period = DEFAULT_FAILOVER_TRY_PERIOD;
 int dns_max_dns_in_flight = MAX_DNS_IN_FLIGHT;
 int dns_validate_qname = 0;
-unsigned int dns_handler_initialized = 0;
+int dns_tcp_fallback = 1;
+int dns_handlers = 1;
 int dns_ns_rr = 0;
 int dns_ns_rr_init_down = 1;
 char *dns_ns_list = NULL;
@@ -64,6 +65,13 @@ namespace {
   inline bool is_addr_query(int qtype) {
     return qtype == T_A || qtype == T_AAAA;
   }
+  // Which of @a n handlers a query for @a qname goes to.
+  inline int handler_index(const char *qname, int n) {
+    uint32_t h = 0;
+    for (const char *p = qname; *p; ++p)
+      h = h * 31 + ParseRules::ink_tolower(*p);
+    return h % n;
+  }
 }
 
 DNSProcessor dnsProcessor;
@@ -176,19 +184,28 @@ DNSProcessor::start(int, size_t stacksize) {
   REC_EstablishStaticConfigInt32(dns_max_dns_in_flight, "proxy.config.dns.max_dns_in_flight");
   REC_EstablishStaticConfigInt32(dns_validate_qname, "proxy.config.dns.validate_query_name");
   REC_EstablishStaticConfigInt32(dns_ns_rr, "proxy.config.dns.round_robin_nameservers");
+  REC_EstablishStaticConfigInt32(dns_tcp_fallback, "proxy.config.dns.tcp_fallback");
+  REC_ReadConfigInt32(dns_handlers, "proxy.config.dns.handlers");
   REC_ReadConfigStringAlloc(dns_ns_list, "proxy.config.dns.nameservers");
   REC_ReadConfigStringAlloc(dns_local_ipv4, "proxy.config.dns.local_ipv4");
   REC_ReadConfigStringAlloc(dns_local_ipv6, "proxy.config.dns.local_ipv6");
   REC_ReadConfigStringAlloc(dns_resolv_conf, "proxy.config.dns.resolv_conf");
   REC_EstablishStaticConfigInt32(dns_thread, "proxy.config.dns.dedicated_thread");
 
+  if (dns_handlers < 1)
+    dns_handlers = 1;
+  else if (dns_handlers > DNS_MAX_HANDLERS)
+    dns_handlers = DNS_MAX_HANDLERS;
+
   if (dns_thread > 0) {
-    // TODO: Hmmm, should we just get a single thread some other way?
-    ET_DNS = eventProcessor.spawn_event_threads(1, "ET_DNS", stacksize);
-    initialize_thread_for_net(eventProcessor.eventthread[ET_DNS][0]);
+    ET_DNS = eventProcessor.spawn_event_threads(dns_handlers, "ET_DNS", stacksize);
+    for (int i = 0; i < dns_handlers; i++)
+      initialize_thread_for_net(eventProcessor.eventthread[ET_DNS][i]);
   } else {
-    // Initialize the first event thread for DNS.
+    // Run the handlers on the first event threads.
     ET_DNS = ET_CALL;
+    if (dns_handlers > eventProcessor.n_threads_for_type[ET_CALL])
+      dns_handlers = eventProcessor.n_threads_for_type[ET_CALL];
   }
   thread = eventProcessor.eventthread[ET_DNS][0];
 
@@ -199,21 +216,26 @@ DNSProcessor::start(int, size_t stacksize) {
     SplitDNSConfig::reconfigure();
   }
 
-  // Setup the default DNSHandler, it's used both by normal DNS, and SplitDNS (for PTR lookups etc.)
+  // Setup the default DNSHandlers, they are used both by normal DNS, and SplitDNS (for PTR lookups etc.)
   dns_init();
-  open();
+  for (int i = 0; i < dns_handlers; i++)
+    open(NULL, _res.options, eventProcessor.eventthread[ET_DNS][i]);
 
   return 0;
 }
 
 void
-DNSProcessor::open(sockaddr const* target, int aoptions)
+DNSProcessor::open(sockaddr const* target, int aoptions, EThread *t)
 {
   DNSHandler *h = NEW(new DNSHandler);
 
+  if (!t)
+    t = thread;
   h->options = aoptions;
-  h->mutex = thread->mutex;
+  h->mutex = t->mutex;
+  h->thread = t;
   h->m_res = &l_res;
+  h->ns_stats = true;
   ats_ip_copy(&h->local_ipv4.sa, &local_ipv4.sa);
   ats_ip_copy(&h->local_ipv6.sa, &local_ipv6.sa);
 
@@ -222,11 +244,21 @@ DNSProcessor::open(sockaddr const* target, int aoptions)
   else
     ats_ip_invalidate(&h->ip); // marked to use default.
 
-  if (!dns_handler_initialized)
+  if (!handler)
     handler = h;
+  if (n_handlers < DNS_MAX_HANDLERS)
+    handlers[n_handlers++] = h;
 
   SET_CONTINUATION_HANDLER(h, &DNSHandler::startEvent);
-  thread->schedule_imm(h);
+  t->schedule_imm(h);
+}
+
+DNSHandler *
+DNSProcessor::handler_for(const char *qname)
+{
+  if (n_handlers <= 1)
+    return handler;
+  return handlers[handler_index(qname, n_handlers)];
 }
 
 //
@@ -301,6 +333,23 @@ DNSProcessor::dns_init()
   if (ink_res_init(&l_res, nameserver, nserv, NULL, NULL, dns_resolv_conf) < 0)
     Warning("Failed to build DNS res records for the servers (%s).  Using resolv.conf.", dns_ns_list);
 
+  int nscount = min(l_res.nscount, MAX_NAMED);
+  for (int i = 0; i < nscount; i++) {
+    char name[64];
+    ip_port_text_buffer buff;
+
+    Note("DNS nameserver %d is %s", i, ats_ip_nptop(&l_res.nsaddr_list[i].sa, buff, sizeof(buff)));
+    snprintf(name, sizeof(name), "proxy.process.dns.nameserver.%d.queries", i);
+    RecRegisterRawStat(dns_rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT,
+                       DNS_NS_STAT(i, dns_ns_queries_stat), RecRawStatSyncSum);
+    snprintf(name, sizeof(name), "proxy.process.dns.nameserver.%d.response_avg_time", i);
+    RecRegisterRawStat(dns_rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT,
+                       DNS_NS_STAT(i, dns_ns_response_time_stat), RecRawStatSyncHrTimeAvg);
+    snprintf(name, sizeof(name), "proxy.process.dns.nameserver.%d.failures", i);
+    RecRegisterRawStat(dns_rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT,
+                       DNS_NS_STAT(i, dns_ns_failures_stat), RecRawStatSyncSum);
+  }
+
   // Check for local forced bindings.
 
   if (dns_local_ipv6) {
@@ -339,8 +388,9 @@ ink_dn_expand(const u_char *msg, const u_char *eom, const u_char *comp_dn, u_cha
 }
 
 DNSProcessor::DNSProcessor()
-  : thread(NULL), handler(NULL)
+  : thread(NULL), handler(NULL), n_handlers(0)
 {
+  memset(handlers, 0, sizeof(handlers));
   ink_zero(l_res);
   ink_zero(local_ipv6);
   ink_zero(local_ipv4);
@@ -366,20 +416,6 @@ DNSEntry::init(const char *x, int len, int qtype_arg, Continuation* acont,
   action = acont;
   submit_thread = acont->mutex->thread_holding;
 
-#ifdef SPLIT_DNS
-  if (SplitDNSConfig::gsplit_dns_enabled) {
-    dnsH = opt.handler ? opt.handler : dnsProcessor.handler;
-  } else {
-    dnsH = dnsProcessor.handler;
-  }
-#else
-  dnsH = dnsProcessor.handler;
-#endif // SPLIT_DNS
-
-  dnsH->txn_lookup_timeout = opt.timeout;
-
-  mutex = dnsH->mutex;
-
   if (is_addr_query(qtype) || qtype == T_SRV) {
     if (len) {
       len = len > (MAXDNAME - 1) ? (MAXDNAME - 1) : len;
@@ -400,6 +436,11 @@ DNSEntry::init(const char *x, int len, int qtype_arg, Continuation* acont,
       ink_assert(!"T_PTR query to DNS must be IP address.");
   }
 
+  // Split DNS picks the handler, otherwise the name does.
+  dnsH = opt.handler ? opt.handler : dnsProcessor.handler_for(qname);
+  dnsH->txn_lookup_timeout = opt.timeout;
+  mutex = dnsH->mutex;
+
   SET_HANDLER((DNSEntryHandler) & DNSEntry::mainEvent);
 }
 
@@ -412,7 +453,7 @@ void
 DNSHandler::open_con(sockaddr const* target, bool failed, int icon)
 {
   ip_port_text_buffer ip_text;
-  PollDescriptor *pd = get_PollDescriptor(dnsProcessor.thread);
+  PollDescriptor *pd = get_PollDescriptor(mutex->thread_holding);
 
   if (!icon && target) {
     ats_ip_copy(&ip, target);
@@ -455,6 +496,69 @@ DNSHandler::open_con(sockaddr const* target, bool failed, int icon)
   }
 }
 
+/**
+  Open the TCP connection to nameserver @a ndx that queries with
+  truncated UDP replies are retried on, unless it is already open.
+
+*/
+bool
+DNSHandler::open_tcp(int ndx)
+{
+  DNSConnection *c = &tcp_con[ndx];
+  ip_port_text_buffer ip_text;
+
+  if (c->fd != NO_FD)
+    return true;
+  if (con[ndx].fd == NO_FD)
+    return false;
+
+  Debug("dns", "open_tcp: opening TCP connection %s", ats_ip_nptop(&con[ndx].ip.sa, ip_text, sizeof ip_text));
+  if (c->connect(
+      &con[ndx].ip.sa, DNSConnection::Options()
+        .setNonBlockingConnect(true)
+        .setNonBlockingIo(true)
+        .setUseTcp(true)
+        .setBindRandomPort(false)
+        .setLocalIpv6(&local_ipv6.sa)
+        .setLocalIpv4(&local_ipv4.sa)
+    ) < 0) {
+    Debug("dns", "opening TCP connection %s FAILED for %d", ip_text, ndx);
+    return false;
+  }
+  c->tcp = true;
+  c->num = ndx;
+  if (c->eio.start(get_PollDescriptor(mutex->thread_holding), c, EVENTIO_READ) < 0) {
+    Error("[iocore_dns] open_tcp: Failed to add %d server to epoll list\n", ndx);
+    c->close();
+    return false;
+  }
+  return true;
+}
+
+/** Close the TCP connection to nameserver @a ndx, the queries waiting on it are sent again. */
+void
+DNSHandler::close_tcp(int ndx)
+{
+  DNSConnection *c = &tcp_con[ndx];
+
+  if (c->fd == NO_FD)
+    return;
+  Debug("dns", "close_tcp: closing TCP connection for %d", ndx);
+  c->eio.stop();
+  c->close();
+  // Each resend takes one of the query's retries, those without any left
+  // stay in flight until they time out.
+  for (DNSEntry *e = entries.head; e; e = (DNSEntry *) e->link.next) {
+    if (e->tcp && e->written_flag && e->which_ns == ndx && e->retries) {
+      e->written_flag = false;
+      --(e->retries);
+      --in_flight;
+      DNS_DECREMENT_DYN_STAT(dns_in_flight_stat);
+      DNS_INCREMENT_DYN_STAT(dns_retries_stat);
+    }
+  }
+}
+
 void
 DNSHandler::validate_ip() {
   if (!ip.isValid()) {
@@ -480,42 +584,35 @@ DNSHandler::startEvent(int /* event ATS_UNUSED */, Event *e)
 
   this->validate_ip();
 
-  if (!dns_handler_initialized) {
-    //
-    // If we are THE handler, open connection and configure for
-    // periodic execution.
-    //
-    dns_handler_initialized = 1;
-    SET_HANDLER(&DNSHandler::mainEvent);
-    if (dns_ns_rr) {
-      int max_nscount = m_res->nscount;
-      if (max_nscount > MAX_NAMED)
-        max_nscount = MAX_NAMED;
-      n_con = 0;
-      for (int i = 0; i < max_nscount; i++) {
-        ip_port_text_buffer buff;
-        sockaddr *sa = &m_res->nsaddr_list[i].sa;
-        if (ats_is_ip(sa)) {
-          open_con(sa, false, n_con);
-          ++n_con;
-          Debug("dns_pas", "opened connection to %s, n_con = %d",
-            ats_ip_nptop(sa, buff, sizeof(buff)),
-            n_con
-          );
-        }
+  //
+  // Open connections and configure for periodic execution.
+  //
+  SET_HANDLER(&DNSHandler::mainEvent);
+  if (dns_ns_rr) {
+    int max_nscount = m_res->nscount;
+    if (max_nscount > MAX_NAMED)
+      max_nscount = MAX_NAMED;
+    n_con = 0;
+    for (int i = 0; i < max_nscount; i++) {
+      ip_port_text_buffer buff;
+      sockaddr *sa = &m_res->nsaddr_list[i].sa;
+      if (ats_is_ip(sa)) {
+        open_con(sa, false, n_con);
+        ++n_con;
+        Debug("dns_pas", "opened connection to %s, n_con = %d",
+          ats_ip_nptop(sa, buff, sizeof(buff)),
+          n_con
+        );
       }
-      dns_ns_rr_init_down = 0;
-    } else {
-      open_con(0); // use current target address.
-      n_con = 1;
     }
-    e->ethread->schedule_every(this, DNS_PERIOD);
-
-    return EVENT_CONT;
+    dns_ns_rr_init_down = 0;
   } else {
-    ink_assert(false);          // I.e. this should never really happen
-    return EVENT_DONE;
+    open_con(0); // use current target address.
+    n_con = 1;
   }
+  e->ethread->schedule_every(this, DNS_PERIOD);
+
+  return EVENT_CONT;
 }
 
 /**
@@ -709,6 +806,17 @@ DNSHandler::rr_failure(int ndx)
   }
 }
 
+static inline void
+dns_ns_stat(DNSHandler *h, int ns, int stat, int64_t incr = 1)
+{
+  if (h->ns_stats && ns >= 0 && ns < MAX_NAMED) {
+    if (stat == dns_ns_response_time_stat)
+      RecIncrRawStat(dns_rsb, h->mutex->thread_holding, DNS_NS_STAT(ns, stat), incr);
+    else
+      RecIncrRawStatSum(dns_rsb, h->mutex->thread_holding, DNS_NS_STAT(ns, stat), incr);
+  }
+}
+
 static inline unsigned int get_rcode(char* buff) {
   return reinterpret_cast<HEADER*>(buff)->rcode;
 }
@@ -731,6 +839,10 @@ DNSHandler::recv_dns(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
   ip_text_buffer ipbuff1, ipbuff2;
 
   while ((dnsc = (DNSConnection *) triggered.dequeue())) {
+    if (dnsc->tcp) {
+      recv_tcp(dnsc);
+      continue;
+    }
     while (1) {
       IpEndpoint from_ip;
       socklen_t from_length = sizeof(from_ip);
@@ -794,11 +906,51 @@ DNSHandler::recv_dns(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
   }
 }
 
+/** Read the replies to the queries retried over TCP. */
+void
+DNSHandler::recv_tcp(DNSConnection *dnsc)
+{
+  int len;
+
+  while ((len = dnsc->recv_msg()) >= 0) {
+    if (!hostent_cache)
+      hostent_cache = dnsBufAllocator.alloc();
+    HostEnt *buf = hostent_cache;
+
+    // Answers that do not fit in the buffer are dropped, the message is
+    // still parsed up to there.
+    int res = min(len, MAX_DNS_PACKET_LEN);
+    memcpy(buf->buf, dnsc->tcp_in + 2, res);
+    dnsc->consume_msg(len);
+    if (res < HFIXEDSZ)
+      continue;
+
+    hostent_cache = 0;
+    buf->packet_size = res;
+    Debug("dns", "received TCP packet size = %d", len);
+    Ptr<HostEnt> protect_hostent = make_ptr(buf);
+    if (dns_process(this, buf, res)) {
+      if (dnsc->num == name_server)
+        received_one(name_server);
+    }
+    if (dnsc->fd == NO_FD)
+      return;
+  }
+  if (len != -EAGAIN) {
+    Debug("dns", "TCP named error: %d", len);
+    close_tcp(dnsc->num);
+  }
+}
+
 /** Main event for the DNSHandler. Attempt to read from and write to named. */
 int
 DNSHandler::mainEvent(int event, Event *e)
 {
   recv_dns(event, e);
+  for (int i = 0; i < n_con; i++) {
+    if (tcp_con[i].tcp_out_len && tcp_con[i].flush() < 0)
+      close_tcp(i);
+  }
   if (dns_ns_rr) {
     ink_hrtime t = ink_get_hrtime();
     if (t - last_primary_retry > DNS_PRIMARY_RETRY_PERIOD) {
@@ -975,19 +1127,32 @@ write_dns_event(DNSHandler *h, DNSEntry *e)
     h->release_query_id(e->id[dns_retries - e->retries]);
   }
   e->id[dns_retries - e->retries] = i;
-  Debug("dns", "send query (qtype=%d) for %s to fd %d", e->qtype, e->qname, h->con[h->name_server].fd);
-
-  int s = socketManager.send(h->con[h->name_server].fd, blob._b, r, 0);
-  if (s != r) {
-    Debug("dns", "send() failed: qname = %s, %d != %d, nameserver= %d", e->qname, s, r, h->name_server);
-    // changed if condition from 'r < 0' to 's < 0' - 8/2001 pas
+  if (e->tcp) {
+    Debug("dns", "send query (qtype=%d) for %s over TCP to nameserver %d", e->qtype, e->qname, h->name_server);
+    int s = h->open_tcp(h->name_server) ? h->tcp_con[h->name_server].send_msg(blob._b, r) : -ENOTCONN;
     if (s < 0) {
-      if (dns_ns_rr)
-        h->rr_failure(h->name_server);
-      else
-        h->failover();
+      Debug("dns", "TCP send failed: qname = %s, %d, nameserver= %d", e->qname, s, h->name_server);
+      dns_ns_stat(h, h->name_server, dns_ns_failures_stat);
+      h->close_tcp(h->name_server);
+      dns_result(h, e, NULL, true);
+      return true;
+    }
+  } else {
+    Debug("dns", "send query (qtype=%d) for %s to fd %d", e->qtype, e->qname, h->con[h->name_server].fd);
+
+    int s = socketManager.send(h->con[h->name_server].fd, blob._b, r, 0);
+    if (s != r) {
+      Debug("dns", "send() failed: qname = %s, %d != %d, nameserver= %d", e->qname, s, r, h->name_server);
+      // changed if condition from 'r < 0' to 's < 0' - 8/2001 pas
+      if (s < 0) {
+        dns_ns_stat(h, h->name_server, dns_ns_failures_stat);
+        if (dns_ns_rr)
+          h->rr_failure(h->name_server);
+        else
+          h->failover();
+      }
+      return false;
     }
-    return false;
   }
 
   e->written_flag = true;
@@ -997,6 +1162,7 @@ write_dns_event(DNSHandler *h, DNSEntry *e)
   DNS_INCREMENT_DYN_STAT(dns_in_flight_stat);
 
   e->send_time = ink_get_hrtime();
+  dns_ns_stat(h, h->name_server, dns_ns_queries_stat);
 
   if (e->timeout)
     e->timeout->cancel();
@@ -1035,7 +1201,7 @@ DNSEntry::mainEvent(int event, Event *e)
     return EVENT_DONE;
   case EVENT_IMMEDIATE:{
       if (!dnsH)
-        dnsH = dnsProcessor.handler;
+        dnsH = dnsProcessor.handler_for(qname);
       if (!dnsH) {
         Debug("dns", "handler not found, retrying...");
         SET_HANDLER((DNSEntryHandler) & DNSEntry::delayEvent);
@@ -1054,6 +1220,7 @@ DNSEntry::mainEvent(int event, Event *e)
       DNSEntry *dup = get_entry(dnsH, qname, qtype);
       if (dup) {
         Debug("dns", "collapsing NS request");
+        DNS_INCREMENT_DYN_STAT(dns_coalesced_stat);
         dup->dups.enqueue(this);
       } else {
         Debug("dns", "adding first to collapsing queue");
@@ -1071,6 +1238,7 @@ DNSEntry::mainEvent(int event, Event *e)
     }
     if (written_flag) {
       Debug("dns", "marking %s as not-written", qname);
+      dns_ns_stat(dnsH, which_ns, dns_ns_failures_stat);
       written_flag = false;
       --(dnsH->in_flight);
       DNS_DECREMENT_DYN_STAT(dns_in_flight_stat);
@@ -1093,7 +1261,7 @@ DNSProcessor::getby(const char *x, int len, int type, Continuation *cont, Option
   e->init(x, len, type, cont, opt);
   MUTEX_TRY_LOCK(lock, e->mutex, this_ethread());
   if (!lock)
-    thread->schedule_imm(e);
+    (e->dnsH->thread ? e->dnsH->thread : thread)->schedule_imm(e);
   else
     e->handleEvent(EVENT_IMMEDIATE, 0);
   return &e->action;
@@ -1309,6 +1477,18 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
   DNS_DECREMENT_DYN_STAT(dns_in_flight_stat);
 
   DNS_SUM_DYN_STAT(dns_response_time_stat, ink_get_hrtime() - e->send_time);
+  dns_ns_stat(handler, e->which_ns, dns_ns_response_time_stat, ink_get_hrtime() - e->send_time);
+
+  //
+  // Truncated, ask again over TCP
+  //
+  if (h->tc && !e->tcp && dns_tcp_fallback) {
+    Debug("dns", "truncated response for [%s], retrying over TCP", e->qname);
+    DNS_INCREMENT_DYN_STAT(dns_tcp_retries_stat);
+    e->tcp = true;
+    write_dns(handler);
+    return true;
+  }
 
   if (h->rcode != NOERROR || !h->ancount) {
     Debug("dns", "received rcode = %d", h->rcode);
@@ -1422,10 +1602,13 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
       }
       ++attempt_num_entries;
     } else {
-      // fill up try_server_names for try_primary_named
-      try_servers = local_num_entries++;
-      ink_strlcpy(try_server_names[try_servers], e->qname, MAXDNAME);
-      memset(&try_server_names[try_servers][strlen(e->qname)], 0, 1);
+      // fill up try_server_names for try_primary_named, the handlers
+      // may be doing this on several threads at once
+      int n = ink_atomic_increment(&local_num_entries, 1);
+      if (n < DEFAULT_NUM_TRY_SERVER) {
+        try_servers = n;
+        ink_strlcpy(try_server_names[n], e->qname, MAXDNAME);
+      }
     }
 
     /* added for SRV support [ebalsa]
@@ -1600,6 +1783,8 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
     }
   }
 Lerror:;
+  if (!server_ok)
+    dns_ns_stat(handler, e->which_ns, dns_ns_failures_stat);
   DNS_INCREMENT_DYN_STAT(dns_lookup_fail_stat);
   dns_result(handler, e, NULL, retry);
   return server_ok;
@@ -1622,7 +1807,7 @@ ink_dns_init(ModuleVersion v)
   init_called = 1;
   // do one time stuff
   // create a stat block for HostDBStats
-  dns_rsb = RecAllocateRawStatBlock((int) DNS_Stat_Count);
+  dns_rsb = RecAllocateRawStatBlock((int) DNS_Stat_Count + MAX_NAMED * DNS_NS_Stat_Count);
 
   //
   // Register statistics callbacks
@@ -1662,6 +1847,15 @@ ink_dns_init(ModuleVersion v)
                      "proxy.process.dns.in_flight",
                      RECD_INT, RECP_NON_PERSISTENT, (int) dns_in_flight_stat, RecRawStatSyncSum);
 
+  RecRegisterRawStat(dns_rsb, RECT_PROCESS,
+                     "proxy.process.dns.queries_coalesced",
+                     RECD_INT, RECP_NULL, (int) dns_coalesced_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(dns_rsb, RECT_PROCESS,
+                     "proxy.process.dns.tcp_retries",
+                     RECD_INT, RECP_NULL, (int) dns_tcp_retries_stat, RecRawStatSyncSum);
+
+  // the per nameserver stats are registered by dns_init(), once the nameservers are known
 }
 
 
@@ -1725,4 +1919,285 @@ REGRESSION_TEST(DNS) (RegressionTest *t, int atype, int *pstatus) {
                              HRTIME_SECONDS(1));
 }
 
+//
+// Resolver throughput against a stub nameserver on the loopback interface.
+// The handlers are opened by a private DNSProcessor on the ET_DNS threads as
+// DNSProcessor::start() does, and each query is routed by handler_for().
+// Passes double the number of handlers from 1 up to the larger of
+// proxy.config.dns.handlers and DNS_BENCH_HANDLERS.  One in eight queries
+// duplicates the one before it and is collapsed, and names starting with
+// "tc" are truncated over UDP so that they are retried over TCP.  The
+// handlers and the stub are left running afterwards.
+//
+#define DNS_BENCH_QUERIES     50000
+#define DNS_BENCH_WINDOW      512
+#define DNS_BENCH_HANDLERS    4
+
+static int dns_stub_udp_fd = NO_FD;
+static int dns_stub_tcp_fd = NO_FD;
+static DNSProcessor dns_bench_processor;
+
+// Answers the query in @a msg in place with 127.0.0.1, or truncated.
+static int
+dns_stub_answer(unsigned char *msg, int len, int size, bool udp)
+{
+  HEADER *h = (HEADER *) msg;
+  unsigned char *cp = msg + HFIXEDSZ;
+  int n;
+
+  if (len < HFIXEDSZ || h->qr || ntohs(h->qdcount) != 1)
+    return -1;
+  if ((n = dn_skipname(cp, msg + len)) < 0 || cp + n + QFIXEDSZ > msg + len)
+    return -1;
+  bool truncated = udp && cp[0] >= 2 && !strncmp((char *) cp + 1, "tc", 2);
+  cp += n + QFIXEDSZ;
+  h->qr = 1;
+  h->ra = 1;
+  h->rcode = NOERROR;
+  h->nscount = h->arcount = 0;
+  if (truncated) {
+    h->tc = 1;
+    h->ancount = 0;
+    return cp - msg;
+  }
+  if (cp + 16 > msg + size)
+    return -1;
+  h->ancount = htons(1);
+  *cp++ = 0xC0;                 // name is the one in the question
+  *cp++ = HFIXEDSZ;
+  NS_PUT16(T_A, cp);
+  NS_PUT16(C_IN, cp);
+  NS_PUT32(60, cp);
+  NS_PUT16(4, cp);
+  *cp++ = 127;
+  *cp++ = 0;
+  *cp++ = 0;
+  *cp++ = 1;
+  return cp - msg;
+}
+
+static void *
+dns_stub_udp(void * /* arg ATS_UNUSED */)
+{
+  unsigned char msg[MAX_DNS_PACKET_LEN];
+
+  while (1) {
+    IpEndpoint from;
+    socklen_t from_len = sizeof(from);
+    int len = recvfrom(dns_stub_udp_fd, msg, sizeof(msg), 0, &from.sa, &from_len);
+    if (len < 0 && errno != EINTR)
+      break;
+    if ((len = dns_stub_answer(msg, len, sizeof(msg), true)) > 0)
+      sendto(dns_stub_udp_fd, msg, len, 0, &from.sa, from_len);
+  }
+  return NULL;
+}
+
+static void *
+dns_stub_tcp(void * /* arg ATS_UNUSED */)
+{
+  struct pollfd pfd[1 + DNS_MAX_HANDLERS];
+  unsigned char msg[2 + MAX_DNS_PACKET_LEN];
+  int nfd = 1;
+
+  pfd[0].fd = dns_stub_tcp_fd;
+  pfd[0].events = POLLIN;
+  while (poll(pfd, nfd, -1) >= 0) {
+    for (int i = nfd - 1; i > 0; i--) {
+      if (!pfd[i].revents)
+        continue;
+      int len = 0;
+      if (recv(pfd[i].fd, msg, 2, MSG_WAITALL) == 2) {
+        len = (msg[0] << 8) | msg[1];
+        if (len > MAX_DNS_PACKET_LEN || recv(pfd[i].fd, msg + 2, len, MSG_WAITALL) != len)
+          len = 0;
+      }
+      if (len && (len = dns_stub_answer(msg + 2, len, MAX_DNS_PACKET_LEN, false)) > 0) {
+        msg[0] = len >> 8;
+        msg[1] = len & 0xFF;
+        send(pfd[i].fd, msg, len + 2, 0);
+      } else {
+        ::close(pfd[i].fd);
+        pfd[i] = pfd[--nfd];
+      }
+    }
+    if (pfd[0].revents && nfd <= DNS_MAX_HANDLERS) {
+      int fd = accept(dns_stub_tcp_fd, NULL, NULL);
+      if (fd >= 0) {
+        pfd[nfd].fd = fd;
+        pfd[nfd].events = POLLIN;
+        pfd[nfd++].revents = 0;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Starts the stub on UDP and TCP on the same loopback port.
+static bool
+dns_stub_start(IpEndpoint *addr)
+{
+  socklen_t len = sizeof(*addr);
+
+  ink_zero(*addr);
+  addr->setToLoopback(AF_INET);
+  if ((dns_stub_udp_fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+      bind(dns_stub_udp_fd, &addr->sa, sizeof(addr->sin)) < 0 ||
+      getsockname(dns_stub_udp_fd, &addr->sa, &len) < 0)
+    return false;
+  if ((dns_stub_tcp_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+      bind(dns_stub_tcp_fd, &addr->sa, sizeof(addr->sin)) < 0 ||
+      listen(dns_stub_tcp_fd, DNS_MAX_HANDLERS) < 0)
+    return false;
+  for (int i = 0; i < DNS_BENCH_HANDLERS; i++)
+    ink_thread_create(dns_stub_udp, NULL, 1);
+  ink_thread_create(dns_stub_tcp, NULL, 1);
+  return true;
+}
+
+static int
+dns_bench_hrtime_compare(const void *a, const void *b)
+{
+  ink_hrtime x = *(ink_hrtime const *) a, y = *(ink_hrtime const *) b;
+  return x < y ? -1 : x > y;
+}
+
+struct DNSBenchQuery;
+typedef int (DNSBenchQuery::*DNSBenchQueryHandler) (int, void *);
+
+struct DNSBenchContinuation: public Continuation
+{
+  RegressionTest *test;
+  int *status;
+  int n_handlers;               // used in this pass
+  int max_handlers;
+  volatile int next;
+  volatile int completed;
+  volatile int failed;
+  int total_failed;
+  ink_hrtime start;
+  ink_hrtime latency[DNS_BENCH_QUERIES];
+  DNSBenchQuery *queries;
+
+  int mainEvent(int event, Event *e);
+
+  DNSBenchContinuation(RegressionTest *atest, int *astatus, IpEndpoint const *stub);
+  ~DNSBenchContinuation();
+};
+
+struct DNSBenchQuery: public Continuation
+{
+  DNSBenchContinuation *bench;
+  int index;
+  ink_hrtime submit_time;
+
+  void submit()
+  {
+    char name[64];
+
+    if ((index = ink_atomic_increment(&bench->next, 1)) >= DNS_BENCH_QUERIES)
+      return;
+    int id = index % 8 == 1 ? index - 1 : index;
+    snprintf(name, sizeof(name), "%s%d-%d.bench.test", id % 16 ? "q" : "tc", bench->n_handlers, id);
+    submit_time = ink_get_hrtime();
+    dnsProcessor.gethostbyname(this, name, DNSProcessor::Options()
+                               .setHandler(dns_bench_processor.handler_for(name))
+                               .setHostResStyle(HOST_RES_IPV4_ONLY));
+  }
+
+  int mainEvent(int event, HostEnt *he)
+  {
+    if (event != DNS_EVENT_LOOKUP) {
+      submit();
+      return EVENT_DONE;
+    }
+    int done = index;
+    bench->latency[done] = ink_get_hrtime() - submit_time;
+    if (!he)
+      ink_atomic_increment(&bench->failed, 1);
+    // the last to complete hands the pass back to the driver, so do not
+    // touch the bench after that
+    submit();
+    if (ink_atomic_increment(&bench->completed, 1) == DNS_BENCH_QUERIES - 1)
+      eventProcessor.schedule_imm(bench);
+    return EVENT_DONE;
+  }
+
+  DNSBenchQuery(): Continuation(new_ProxyMutex()), bench(NULL), index(0), submit_time(0)
+  {
+    SET_HANDLER((DNSBenchQueryHandler) & DNSBenchQuery::mainEvent);
+  }
+};
+
+DNSBenchContinuation::DNSBenchContinuation(RegressionTest *atest, int *astatus, IpEndpoint const *stub)
+  : Continuation(new_ProxyMutex()), test(atest), status(astatus), n_handlers(0),
+    max_handlers(dns_handlers > DNS_BENCH_HANDLERS ? dns_handlers : DNS_BENCH_HANDLERS),
+    next(0), completed(0), failed(0), total_failed(0), start(0)
+{
+  ink_res_init(&dns_bench_processor.l_res, stub, 1);
+  for (int i = 0; i < max_handlers; i++) {
+    dns_bench_processor.open(NULL, dns_bench_processor.l_res.options,
+                             eventProcessor.eventthread[ET_DNS][i % eventProcessor.n_threads_for_type[ET_DNS]]);
+    // keep the per nameserver stats for the configured nameservers
+    dns_bench_processor.handlers[i]->ns_stats = false;
+  }
+  queries = new DNSBenchQuery[DNS_BENCH_WINDOW];
+  for (int i = 0; i < DNS_BENCH_WINDOW; i++)
+    queries[i].bench = this;
+  SET_HANDLER(&DNSBenchContinuation::mainEvent);
+}
+
+DNSBenchContinuation::~DNSBenchContinuation()
+{
+  delete[] queries;
+}
+
+int
+DNSBenchContinuation::mainEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+{
+  if (n_handlers) {
+    double secs = (double) (ink_get_hrtime() - start) / HRTIME_SECOND;
+
+    qsort(latency, DNS_BENCH_QUERIES, sizeof(ink_hrtime), dns_bench_hrtime_compare);
+    rprintf(test, "%d handler(s): %.0f queries/sec, p99 latency %.3f ms, %d failed\n",
+            n_handlers, DNS_BENCH_QUERIES / secs,
+            (double) latency[DNS_BENCH_QUERIES * 99 / 100] / HRTIME_MSECOND, (int) failed);
+    total_failed += failed;
+  }
+  if (n_handlers == max_handlers) {
+    *status = total_failed ? REGRESSION_TEST_FAILED : REGRESSION_TEST_PASSED;
+    delete this;
+    return EVENT_DONE;
+  }
+  n_handlers = n_handlers ? n_handlers * 2 : 1;
+  if (n_handlers > max_handlers)
+    n_handlers = max_handlers;
+  // handler_for() spreads the names over the first n_handlers handlers
+  dns_bench_processor.n_handlers = n_handlers;
+
+  next = completed = failed = 0;
+  start = ink_get_hrtime();
+  for (int i = 0; i < DNS_BENCH_WINDOW; i++)
+    eventProcessor.eventthread[ET_CALL][i % eventProcessor.n_threads_for_type[ET_CALL]]->schedule_imm(&queries[i]);
+  return EVENT_DONE;
+}
+
+REGRESSION_TEST(DNS_resolver_throughput) (RegressionTest *t, int level, int *pstatus) {
+  IpEndpoint stub;
+
+  // Only run at the highest levels.
+  if (REGRESSION_TEST_EXTENDED > level) {
+    *pstatus = REGRESSION_TEST_PASSED;
+    return;
+  }
+  if (!dns_stub_start(&stub)) {
+    rprintf(t, "cannot start the stub nameserver: %s\n", strerror(errno));
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  // give the handlers time to open their connections
+  eventProcessor.schedule_in(NEW(new DNSBenchContinuation(t, pstatus, &stub)), HRTIME_SECONDS(1));
+}
+
 #endif
@@ -38,6 +38,8 @@
 // #define SEND_BUF_SIZE            (1024*64)
 #define FIRST_RANDOM_PORT        (16000)
 #define LAST_RANDOM_PORT         (60000)
+// TCP messages carry a two byte length
+#define DNS_TCP_BUFFER_SIZE      (2 + 65535)
 
 #define ROUNDUP(x, y) ((((x)+((y)-1))/(y))*(y))
 
@@ -48,7 +50,8 @@ DNSConnection::Options const DNSConnection::DEFAULT_OPTIONS;
 //
 
 DNSConnection::DNSConnection():
-  fd(NO_FD), num(0), generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t) this)), handler(NULL)
+  fd(NO_FD), num(0), generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t) this)), handler(NULL),
+  tcp(false), tcp_in(NULL), tcp_in_len(0), tcp_out(NULL), tcp_out_len(0), tcp_out_size(0)
 {
   memset(&ip, 0, sizeof(ip));
 }
@@ -61,6 +64,11 @@ DNSConnection::~DNSConnection()
 int
 DNSConnection::close()
 {
+  ats_free(tcp_in);
+  ats_free(tcp_out);
+  tcp_in = tcp_out = NULL;
+  tcp_in_len = tcp_out_len = tcp_out_size = 0;
+
   // don't close any of the standards
   if (fd >= 2) {
     int fd_save = fd;
@@ -78,6 +86,62 @@ DNSConnection::trigger()
   handler->triggered.enqueue(this);
 }
 
+int
+DNSConnection::send_msg(const char *msg, int len)
+{
+  if (tcp_out_len + len + 2 > tcp_out_size) {
+    tcp_out_size = max(tcp_out_size * 2, tcp_out_len + len + 2);
+    tcp_out = (char *)ats_realloc(tcp_out, tcp_out_size);
+  }
+  tcp_out[tcp_out_len++] = (len >> 8) & 0xFF;
+  tcp_out[tcp_out_len++] = len & 0xFF;
+  memcpy(tcp_out + tcp_out_len, msg, len);
+  tcp_out_len += len;
+  return flush();
+}
+
+int
+DNSConnection::flush()
+{
+  while (tcp_out_len > 0) {
+    int r = socketManager.send(fd, tcp_out, tcp_out_len, 0);
+    if (r == -EAGAIN)           // still connecting, or the socket is full
+      return 0;
+    if (r < 0)
+      return r;
+    tcp_out_len -= r;
+    memmove(tcp_out, tcp_out + r, tcp_out_len);
+  }
+  return 0;
+}
+
+int
+DNSConnection::recv_msg()
+{
+  if (!tcp_in)
+    tcp_in = (char *)ats_malloc(DNS_TCP_BUFFER_SIZE);
+  while (1) {
+    if (tcp_in_len >= 2) {
+      int len = ((unsigned char)tcp_in[0] << 8) | (unsigned char)tcp_in[1];
+      if (tcp_in_len >= len + 2)
+        return len;
+    }
+    int r = socketManager.recv(fd, tcp_in + tcp_in_len, DNS_TCP_BUFFER_SIZE - tcp_in_len, 0);
+    if (r == 0)
+      return -EPIPE;
+    if (r < 0)
+      return r;
+    tcp_in_len += r;
+  }
+}
+
+void
+DNSConnection::consume_msg(int len)
+{
+  tcp_in_len -= len + 2;
+  memmove(tcp_in, tcp_in + len + 2, tcp_in_len);
+}
+
 int
 DNSConnection::connect(sockaddr const* addr, Options const& opt)
 //                       bool non_blocking_connect, bool use_tcp, bool non_blocking, bool bind_random_port)
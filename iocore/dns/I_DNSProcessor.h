@@ -32,6 +32,7 @@
 #define  DNS_HOSTBUF_SIZE           8192
 #define  DOMAIN_SERVICE_PORT          53
 #define  DEFAULT_DOMAIN_NAME_SERVER    0        // use the default server
+#define  DNS_MAX_HANDLERS             16
 
 
 /**
@@ -122,7 +123,7 @@ struct DNSProcessor: public Processor
 
   // Open/close a link to a 'named' (done in start())
   //
-  void open(sockaddr const* ns = 0, int options = _res.options);
+  void open(sockaddr const* ns = 0, int options = _res.options, EThread *t = 0);
 
   DNSProcessor();
 
@@ -130,6 +131,10 @@ struct DNSProcessor: public Processor
   //
   EThread *thread;
   DNSHandler *handler;
+  /// The default resolver, split by query name so that identical queries
+  /// meet on the same handler.
+  DNSHandler *handlers[DNS_MAX_HANDLERS];
+  int n_handlers;
   ts_imp_res_state l_res;
   IpEndpoint local_ipv6;
   IpEndpoint local_ipv4;
@@ -144,6 +149,9 @@ struct DNSProcessor: public Processor
   Action *getby(const char *x, int len, int type, Continuation *cont, Options const& opt);
 
   void dns_init();
+
+  /// The default resolver handler for queries for @a qname.
+  DNSHandler *handler_for(const char *qname);
 };
 
 
@@ -80,6 +80,14 @@ struct DNSConnection {
   InkRand generator;
   DNSHandler* handler;
 
+  /// Set for the TCP connections queries are retried on when the UDP reply was truncated.
+  bool tcp;
+  char *tcp_in; ///< Received data, holds at least one maximum size message.
+  int tcp_in_len;
+  char *tcp_out; ///< Queries not yet written to the socket.
+  int tcp_out_len;
+  int tcp_out_size;
+
   int connect(sockaddr const* addr, Options const& opt = DEFAULT_OPTIONS);
 /*
               bool non_blocking_connect = NON_BLOCKING_CONNECT,
@@ -88,6 +96,19 @@ struct DNSConnection {
   int close();
   void trigger();
 
+  /// Queue the query @a msg for a TCP connection and write as much as the socket takes.
+  /// @return 0 or -errno.
+  int send_msg(const char *msg, int len);
+  /// Write queued queries to a TCP connection.
+  /// @return 0 or -errno.
+  int flush();
+  /// Read from a TCP connection.
+  /// @return the length of the next complete message, which is at @c tcp_in + 2,
+  /// -EAGAIN if there is none yet, or another -errno.
+  int recv_msg();
+  /// Drop the message of length @a len returned by @c recv_msg.
+  void consume_msg(int len);
+
   virtual ~DNSConnection();
   DNSConnection();
 
@@ -57,6 +57,7 @@ extern int dns_failover_number;
 extern int dns_failover_period;
 extern int dns_failover_try_period;
 extern int dns_max_dns_in_flight;
+extern int dns_tcp_fallback;
 extern unsigned int dns_sequence_number;
 
 //
@@ -102,9 +103,23 @@ enum DNS_Stats
   dns_max_retries_exceeded_stat,
   dns_sequence_number_stat,
   dns_in_flight_stat,
+  dns_coalesced_stat,
+  dns_tcp_retries_stat,
   DNS_Stat_Count
 };
 
+// Per nameserver stats of the default resolver, they follow the stats
+// above in the block.
+enum DNS_NS_Stats
+{
+  dns_ns_queries_stat,
+  dns_ns_response_time_stat,
+  dns_ns_failures_stat,
+  DNS_NS_Stat_Count
+};
+
+#define DNS_NS_STAT(_ns, _x) (DNS_Stat_Count + (_ns) * DNS_NS_Stat_Count + (_x))
+
 struct HostEnt;
 struct DNSHandler;
 
@@ -165,6 +180,7 @@ struct DNSEntry: public Continuation
   bool written_flag;
   bool once_written_flag;
   bool last;
+  bool tcp; ///< Send over TCP, the UDP reply was truncated.
   LINK(DNSEntry, dup_link);
   Que(DNSEntry, dup_link) dups;
 
@@ -180,7 +196,7 @@ struct DNSEntry: public Continuation
        host_res_style(HOST_RES_NONE),
        retries(DEFAULT_DNS_RETRIES),
        which_ns(NO_NAMESERVER_SELECTED), submit_time(0), send_time(0), qname_len(0), domains(0),
-       timeout(0), result_ent(0), dnsH(0), written_flag(false), once_written_flag(false), last(false)
+       timeout(0), result_ent(0), dnsH(0), written_flag(false), once_written_flag(false), last(false), tcp(false)
   {
     for (int i = 0; i < MAX_DNS_RETRIES; i++)
       id[i] = -1;
@@ -194,8 +210,10 @@ typedef int (DNSEntry::*DNSEntryHandler) (int, void *);
 struct DNSEntry;
 
 /**
-  One DNSHandler is allocated to handle all DNS traffic by polling a
-  UDP port.
+  A DNSHandler handles DNS traffic by polling a UDP port per nameserver,
+  and a TCP connection per nameserver for the queries whose UDP replies
+  were truncated.  The default resolver is made of one or more of these,
+  each on its own thread.
 
 */
 struct DNSHandler: public Continuation
@@ -207,6 +225,7 @@ struct DNSHandler: public Continuation
   int ifd[MAX_NAMED];
   int n_con;
   DNSConnection con[MAX_NAMED];
+  DNSConnection tcp_con[MAX_NAMED];
   int options;
   Queue<DNSEntry> entries;
   Queue<DNSConnection> triggered;
@@ -224,6 +243,8 @@ struct DNSHandler: public Continuation
 
   ink_res_state m_res;
   int txn_lookup_timeout;
+  EThread *thread; ///< Thread the handler runs on, if it has one of its own.
+  bool ns_stats; ///< Count per nameserver stats for this handler.
 
   InkRand generator;
   // bitmap of query ids in use
@@ -260,11 +281,14 @@ struct DNSHandler: public Continuation
   }
 
   void recv_dns(int event, Event *e);
+  void recv_tcp(DNSConnection *dnsc);
   int startEvent(int event, Event *e);
   int startEvent_sdns(int event, Event *e);
   int mainEvent(int event, Event *e);
 
   void open_con(sockaddr const* addr, bool failed = false, int icon = 0);
+  bool open_tcp(int ndx);
+  void close_tcp(int ndx);
   void failover();
   void rr_failure(int ndx);
   void recover();
@@ -322,7 +346,7 @@ struct DNSServer
 TS_INLINE DNSHandler::DNSHandler()
  : Continuation(NULL), n_con(0), options(0), in_flight(0), name_server(0), in_write_dns(0),
   hostent_cache(0), last_primary_retry(0), last_primary_reopen(0),
-  m_res(0), txn_lookup_timeout(0), generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t)this))
+  m_res(0), txn_lookup_timeout(0), thread(0), ns_stats(false), generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t)this))
 {
   ats_ip_invalidate(&ip);
   for (int i = 0; i < MAX_NAMED; i++) {
@@ -332,6 +356,7 @@ TS_INLINE DNSHandler::DNSHandler()
     crossed_failover_number[i] = 0;
     ns_down[i] = 1;
     con[i].handler = this;
+    tcp_con[i].handler = this;
   }
   memset(&qid_in_flight, 0, sizeof(qid_in_flight));  
   SET_HANDLER(&DNSHandler::startEvent);
@@ -30,6 +30,26 @@
 
 #include "P_EventSystem.h"
 
+enum
+{
+  allocator_magazine_allocs_stat,
+  allocator_magazine_local_allocs_stat,
+  allocator_numa_remote_frees_stat,
+  allocator_stat_count
+};
+
+static int
+allocator_stats_cb(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  uint64_t allocs, local_allocs;
+
+  ink_freelists_magazine_stats(&allocs, &local_allocs);
+  RecSetGlobalRawStatSum(rsb, allocator_magazine_allocs_stat, allocs);
+  RecSetGlobalRawStatSum(rsb, allocator_magazine_local_allocs_stat, local_allocs);
+  RecSetGlobalRawStatSum(rsb, allocator_numa_remote_frees_stat, ink_freelists_remote_frees());
+  return RecRawStatSyncSum(name, data_type, data, rsb, id);
+}
+
 void
 ink_event_system_init(ModuleVersion v)
 {
@@ -45,4 +65,12 @@ ink_event_system_init(ModuleVersion v)
   if (default_large_iobuffer_size > max_iobuffer_size)
     default_large_iobuffer_size = max_iobuffer_size;
   init_buffer_allocators();
+
+  RecRawStatBlock *rsb = RecAllocateRawStatBlock((int) allocator_stat_count);
+  RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.allocator.magazine.allocs", RECD_INT, RECP_NON_PERSISTENT,
+                     (int) allocator_magazine_allocs_stat, allocator_stats_cb);
+  RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.allocator.magazine.local_allocs", RECD_INT, RECP_NON_PERSISTENT,
+                     (int) allocator_magazine_local_allocs_stat, allocator_stats_cb);
+  RecRegisterRawStat(rsb, RECT_PROCESS, "proxy.process.allocator.numa.remote_frees", RECD_INT, RECP_NON_PERSISTENT,
+                     (int) allocator_numa_remote_frees_stat, allocator_stats_cb);
 }
@@ -56,7 +56,12 @@ init_buffer_allocators()
     name = NEW(new char[64]);
     snprintf(name, 64, "ioBufAllocator[%d]", i);
     ioBufAllocator[i].re_init(name, s, n, a);
+    thread_numa_init(ioBufAllocator[i]);
+    thread_magazine_init(ioBufAllocator[i], s);
   }
+  thread_numa_init(ioAllocator);
+  thread_numa_init(ioDataAllocator);
+  thread_numa_init(ioBlockAllocator);
 }
 
 int64_t
@@ -302,6 +302,7 @@ public:
 
   int id;
   unsigned int event_types;
+  int numa_node;                // the allocator pools of this thread, or -1
   bool is_event_type(EventType et);
   void set_event_type(EventType et);
 
@@ -51,6 +51,8 @@ struct ProtectedQueue
   ink_mutex lock;
   ink_cond might_have_data;
   Que(Event, link) localQueue;
+  /// eventfd of the owning thread, or -1 to signal through might_have_data.
+  int evfd;
 
   ProtectedQueue();
 };
@@ -37,6 +37,9 @@ class EThread;
 
 extern int thread_freelist_size;
 
+void thread_magazine_init(Allocator &a, int64_t type_size);
+void thread_numa_init(Allocator &a);
+
 struct ProxyAllocator
 {
   int allocated;
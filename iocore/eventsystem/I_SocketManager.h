@@ -71,6 +71,11 @@ struct SocketManager
   int64_t writev(int fd, struct iovec *vector, size_t count);
   int64_t write_vector(int fd, struct iovec *vector, size_t count, void *pOLP = 0);
   int64_t pwrite(int fd, void *buf, int len, off_t offset, char *tag = NULL);
+#ifdef SPLICE_F_MOVE
+  // moves up to len bytes between a pipe and another fd without copying
+  // them to user space, result is the number of bytes or -errno
+  int64_t splice(int fd_in, int fd_out, int64_t len);
+#endif
 
   int send(int fd, void *buf, int len, int flags);
   int sendto(int fd, void *buf, int len, int flags, struct sockaddr const* to, int tolen);
@@ -35,6 +35,7 @@
 
 TS_INLINE
 ProtectedQueue::ProtectedQueue()
+  : evfd(-1)
 {
   Event e;
   ink_mutex_init(&lock, "ProtectedQueue");
@@ -45,6 +46,14 @@ ProtectedQueue::ProtectedQueue()
 TS_INLINE void
 ProtectedQueue::signal()
 {
+  if (evfd >= 0) {
+    // The eventfd keeps its count until the owning thread reads it, so the
+    // wakeup can not be lost and no lock is needed.  Since the eventfd is
+    // also in the poll set of a net thread, this wakes it up as well.
+    uint64_t counter = 1;
+    ATS_UNUSED_RETURN(write(evfd, &counter, sizeof(uint64_t)));
+    return;
+  }
   // Need to get the lock before you can signal the thread
   ink_mutex_acquire(&lock);
   ink_cond_signal(&might_have_data);
@@ -54,6 +63,10 @@ ProtectedQueue::signal()
 TS_INLINE int
 ProtectedQueue::try_signal()
 {
+  if (evfd >= 0) {
+    signal();
+    return 1;
+  }
   // Need to get the lock before you can signal the thread
   if (ink_mutex_try_acquire(&lock)) {
     ink_cond_signal(&might_have_data);
@@ -124,6 +124,20 @@ SocketManager::readv(int fd, struct iovec *vector, size_t count)
   return r;
 }
 
+#ifdef SPLICE_F_MOVE
+TS_INLINE int64_t
+SocketManager::splice(int fd_in, int fd_out, int64_t len)
+{
+  int64_t r;
+  do {
+    if (likely((r =::splice(fd_in, NULL, fd_out, NULL, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) >= 0))
+      break;
+    r = -errno;
+  } while (transient_error());
+  return r;
+}
+#endif
+
 TS_INLINE int64_t
 SocketManager::vector_io(int fd, struct iovec *vector, size_t count, int read_request, void * /* pOLP ATS_UNUSED */)
 {
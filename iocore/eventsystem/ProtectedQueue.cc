@@ -24,9 +24,11 @@
 
   ProtectedQueue implements a FIFO queue with the following functionality:
     -# Multiple threads could be simultaneously trying to enqueue and
-      dequeue. Hence the queue needs to be protected with mutex.
+      dequeue. Enqueues are lock free pushes on an atomic list.
     -# In case the queue is empty, dequeue() sleeps for a specified amount
       of time, or until a new element is inserted, whichever is earlier.
+      Threads with an eventfd sleep on it, otherwise on a condition
+      variable protected by the queue mutex.
 
 */
 
@@ -44,6 +46,16 @@
 
 extern ClassAllocator<Event> eventAllocator;
 
+// With an eventfd, signal() writes the same eventfd the net thread's signal
+// hook writes, so the hook is only needed for threads signalled through the
+// condition variable.
+static inline void
+signal_hook(EThread *t)
+{
+  if (t->signal_hook && t->EventQueueExternal.evfd < 0)
+    t->signal_hook(t);
+}
+
 void
 ProtectedQueue::enqueue(Event *e , bool fast_signal)
 {
@@ -59,10 +71,8 @@ ProtectedQueue::enqueue(Event *e , bool fast_signal)
     if (inserting_thread != e_ethread) {
       if (!inserting_thread || !inserting_thread->ethreads_to_be_signalled) {
         signal();
-        if (fast_signal) {
-          if (e_ethread->signal_hook)
-            e_ethread->signal_hook(e_ethread);
-        }
+        if (fast_signal)
+          signal_hook(e_ethread);
       } else {
 #ifdef EAGER_SIGNALLING
         // Try to signal now and avoid deferred posting.
@@ -70,8 +80,12 @@ ProtectedQueue::enqueue(Event *e , bool fast_signal)
           return;
 #endif
         if (fast_signal) {
-          if (e_ethread->signal_hook)
-            e_ethread->signal_hook(e_ethread);
+          if (evfd >= 0) {
+            // one write both wakes the thread and replaces the deferred signal
+            signal();
+            return;
+          }
+          signal_hook(e_ethread);
         }
         int &t = inserting_thread->n_ethreads_to_be_signalled;
         EThread **sig_e = inserting_thread->ethreads_to_be_signalled;
@@ -129,8 +143,7 @@ flush_signals(EThread * thr)
   for (i = 0; i < n; i++) {
     if (thr->ethreads_to_be_signalled[i]) {
       thr->ethreads_to_be_signalled[i]->EventQueueExternal.signal();
-      if (thr->ethreads_to_be_signalled[i]->signal_hook)
-        thr->ethreads_to_be_signalled[i]->signal_hook(thr->ethreads_to_be_signalled[i]);
+      signal_hook(thr->ethreads_to_be_signalled[i]);
       thr->ethreads_to_be_signalled[i] = 0;
     }
   }
@@ -142,7 +155,25 @@ ProtectedQueue::dequeue_timed(ink_hrtime cur_time, ink_hrtime timeout, bool slee
 {
   (void) cur_time;
   Event *e;
-  if (sleep) {
+  if (sleep && evfd >= 0) {
+    // Only the first enqueue into an empty queue signals, so one wakeup
+    // covers every event pushed before the popall below.
+    if (INK_ATOMICLIST_EMPTY(al)) {
+      ink_hrtime delay = timeout - ink_get_based_hrtime_internal();
+      if (delay > 0) {
+        struct pollfd pfd;
+        pfd.fd = evfd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        // A signal left over from an event already dequeued only costs one
+        // extra pass, so the eventfd is read only when it woke us up.
+        if (poll(&pfd, 1, (int) ((delay + HRTIME_MSECOND - 1) / HRTIME_MSECOND)) > 0) {
+          uint64_t counter;
+          ATS_UNUSED_RETURN(read(evfd, &counter, sizeof(uint64_t)));
+        }
+      }
+    }
+  } else if (sleep) {
     ink_mutex_acquire(&lock);
     if (INK_ATOMICLIST_EMPTY(al)) {
       timespec ts = ink_based_hrtime_to_timespec(timeout);
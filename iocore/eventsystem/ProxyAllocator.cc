@@ -24,6 +24,46 @@
 
 int thread_freelist_size = 512;
 
+// At most this many bytes of blocks in each chain of a thread magazine.
+#define THREAD_MAGAZINE_BYTES (256 * 1024)
+
+void
+thread_magazine_init(Allocator &a, int64_t type_size)
+{
+  int size = 32;
+
+  REC_ReadConfigInteger(size, "proxy.config.allocator.magazine_size");
+  if (size > THREAD_MAGAZINE_BYTES / type_size)
+    size = THREAD_MAGAZINE_BYTES / type_size;
+  if (size > 0 && !a.enable_magazine(size))
+    Warning("no thread magazine for an allocator of %" PRId64 " byte blocks", type_size);
+}
+
+// Per NUMA node pools only mean something if the event threads stay on
+// their node, so they go with proxy.config.exec_thread.affinity.
+static int
+thread_numa_nodes()
+{
+  static int nodes = -1;
+
+  if (nodes < 0) {
+    int affinity = 0, numa_pools = 1;
+
+    REC_ReadConfigInteger(affinity, "proxy.config.exec_thread.affinity");
+    REC_ReadConfigInteger(numa_pools, "proxy.config.allocator.numa_pools");
+    nodes = affinity && numa_pools ? ink_freelists_numa_init() : 0;
+    Debug("iocore_thread", "allocator pools for %d NUMA nodes", nodes);
+  }
+  return nodes;
+}
+
+void
+thread_numa_init(Allocator &a)
+{
+  if (thread_numa_nodes() > 1 && !a.enable_numa())
+    Warning("no NUMA node pools for an allocator");
+}
+
 void*
 thread_alloc(Allocator &a, ProxyAllocator &l)
 {
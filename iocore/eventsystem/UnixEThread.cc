@@ -41,10 +41,11 @@ struct AIOCallback;
 
 EThread::EThread()
   : generator((uint64_t)ink_get_hrtime_internal() ^ (uint64_t)(uintptr_t)this),
+   diskHandler(NULL),
    ethreads_to_be_signalled(NULL),
    n_ethreads_to_be_signalled(0),
    main_accept_index(-1),
-   id(NO_ETHREAD_ID), event_types(0),
+   id(NO_ETHREAD_ID), event_types(0), numa_node(-1),
    signal_hook(0),
    tt(REGULAR), eventsem(NULL)
 {
@@ -53,11 +54,13 @@ EThread::EThread()
 
 EThread::EThread(ThreadType att, int anid)
   : generator((uint64_t)ink_get_hrtime_internal() ^ (uint64_t)(uintptr_t)this),
+    diskHandler(NULL),
     ethreads_to_be_signalled(NULL),
     n_ethreads_to_be_signalled(0),
     main_accept_index(-1),
     id(anid),
     event_types(0),
+    numa_node(-1),
     signal_hook(0),
     tt(att),
     eventsem(NULL),
@@ -78,6 +81,7 @@ EThread::EThread(ThreadType att, int anid)
   }
   fcntl(evfd, F_SETFD, FD_CLOEXEC);
   fcntl(evfd, F_SETFL, O_NONBLOCK);
+  EventQueueExternal.evfd = evfd;
 #elif TS_USE_PORT
   /* Solaris ports requires no crutches to do cross thread signaling.
    * We'll just port_send the event straight over the port.
@@ -93,10 +97,11 @@ EThread::EThread(ThreadType att, int anid)
 
 EThread::EThread(ThreadType att, Event * e, ink_sem * sem)
  : generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t) this)),
+   diskHandler(NULL),
    ethreads_to_be_signalled(NULL),
    n_ethreads_to_be_signalled(0),
    main_accept_index(-1),
-   id(NO_ETHREAD_ID), event_types(0),
+   id(NO_ETHREAD_ID), event_types(0), numa_node(-1),
    signal_hook(0),
    tt(att), oneevent(e), eventsem(sem)
 {
@@ -176,6 +181,8 @@ EThread::process_event(Event * e, int calling_code)
 
 void
 EThread::execute() {
+  ink_freelist_set_thread_node(numa_node);
+
   switch (tt) {
 
     case REGULAR: {
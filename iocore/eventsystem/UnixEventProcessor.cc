@@ -88,6 +88,19 @@ bind_cpu(ink_cpuset_t *cpuset, ink_thread tid)
   }
   return true;
 }
+
+static int
+numa_node_of_cpu(int cpu)
+{
+  int nodes = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_NODE);
+
+  for (int i = 0; i < nodes; i++) {
+    hwloc_obj_t node = hwloc_get_obj_by_type(ink_get_topology(), HWLOC_OBJ_NODE, i);
+    if (hwloc_bitmap_isset(node->cpuset, cpu))
+      return i;
+  }
+  return -1;
+}
 #endif
 
 EventType
@@ -175,12 +188,9 @@ EventProcessor::start(int n_event_threads, size_t stacksize)
 
   for (i = first_thread; i < n_ethreads; i++) {
     snprintf(thr_name, MAX_THREAD_NAME_LENGTH, "[ET_NET %d]", i);
-    ink_thread tid = all_ethreads[i]->start(thr_name, stacksize);
-    (void)tid;
-
 #if TS_USE_HWLOC
+    int logical_ratio = 1;
     if (affinity != 0) {
-      int logical_ratio;
       switch(affinity) {
       case 3:           // assign threads to logical cores
         logical_ratio = 1;
@@ -192,7 +202,15 @@ EventProcessor::start(int n_event_threads, size_t stacksize)
       default:
         logical_ratio = pu / socket;
       }
+      // the thread allocates from the pools of the node of its first cpu
+      all_ethreads[i]->numa_node = numa_node_of_cpu(((i - 1) * logical_ratio) % pu);
+    }
+#endif
+    ink_thread tid = all_ethreads[i]->start(thr_name, stacksize);
+    (void)tid;
 
+#if TS_USE_HWLOC
+    if (affinity != 0) {
       char debug_message[256];
       int len = snprintf(debug_message, sizeof(debug_message), "setaffinity tid: %" PTR_FMT ", net thread: %u cpu:", tid, i);
       for (int cpu_count = 0; cpu_count < logical_ratio; cpu_count++) {
@@ -0,0 +1,216 @@
+/** @file
+
+  Benchmark of cross thread event delivery
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @section details Details
+
+  Measures the one way latency of an event bounced between two event
+  threads, and the rate at which an event thread receives events
+  scheduled by 1 to TEST_THREADS - 1 other threads.  Both are run with
+  the threads signalled through their eventfd and through the queue
+  condition variable.
+ */
+
+#include "P_EventSystem.h"
+#include "I_Layout.h"
+
+#define TEST_THREADS     4
+#define PING_ROUNDS      20000
+#define BURST            256
+#define BURSTS           400
+#define TEST_TIMEOUT     HRTIME_SECONDS(30)
+
+Diags *diags;
+
+static volatile int done;
+static int failures;
+
+struct Ping:public Continuation
+{
+  EThread *peer[2];
+  int rounds;
+  ink_hrtime start;
+  ink_hrtime elapsed;
+
+  Ping(EThread *a, EThread *b):Continuation(new_ProxyMutex()), rounds(0), start(0), elapsed(0)
+  {
+    peer[0] = a;
+    peer[1] = b;
+    SET_HANDLER(&Ping::bounce);
+  }
+  int bounce(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    if (rounds == 0)
+      start = ink_get_hrtime_internal();
+    if (++rounds > PING_ROUNDS) {
+      elapsed = ink_get_hrtime_internal() - start;
+      done = 1;
+      return EVENT_DONE;
+    }
+    peer[rounds & 1]->schedule_imm(this);
+    return EVENT_DONE;
+  }
+};
+
+struct Sink:public Continuation
+{
+  int expected;
+  int received;
+  ink_hrtime start;
+  ink_hrtime elapsed;
+
+  Sink(int n):Continuation(new_ProxyMutex()), expected(n), received(0), start(0), elapsed(0)
+  {
+    SET_HANDLER(&Sink::receive);
+  }
+  int receive(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    if (++received == expected) {
+      elapsed = ink_get_hrtime_internal() - start;
+      done = 1;
+    }
+    return EVENT_DONE;
+  }
+};
+
+// Schedules BURSTS bursts of BURST events to the sink thread, yielding its
+// own thread between bursts so that the deferred signals get flushed.
+struct Source:public Continuation
+{
+  EThread *target;
+  Sink *sink;
+  int bursts;
+
+  Source(EThread *t, Sink *s):Continuation(new_ProxyMutex()), target(t), sink(s), bursts(BURSTS)
+  {
+    SET_HANDLER(&Source::produce);
+  }
+  int produce(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    for (int i = 0; i < BURST; i++)
+      target->schedule_imm(sink);
+    if (--bursts > 0)
+      this_ethread()->schedule_imm(this);
+    else
+      delete this;
+    return EVENT_DONE;
+  }
+};
+
+static bool
+wait_done()
+{
+  ink_hrtime deadline = ink_get_hrtime_internal() + TEST_TIMEOUT;
+  while (!done) {
+    if (ink_get_hrtime_internal() > deadline) {
+      printf("FAILED: events were not delivered within %d seconds\n", (int) (TEST_TIMEOUT / HRTIME_SECOND));
+      failures++;
+      return false;
+    }
+    usleep(1000);
+  }
+  return true;
+}
+
+// Switches the event threads between eventfd and condition variable
+// signalling, and lets threads already asleep time out.
+static void
+use_eventfd(bool on)
+{
+  for (int i = 0; i < eventProcessor.n_threads_for_type[ET_CALL]; i++) {
+    EThread *t = eventProcessor.eventthread[ET_CALL][i];
+#if HAVE_EVENTFD
+    t->EventQueueExternal.evfd = on ? t->evfd : -1;
+#else
+    (void) on;
+    (void) t;
+#endif
+  }
+  usleep(200000);
+}
+
+static void
+bench_latency(const char *mode)
+{
+  Ping *ping = new Ping(eventProcessor.eventthread[ET_CALL][0], eventProcessor.eventthread[ET_CALL][1]);
+
+  done = 0;
+  ping->peer[0]->schedule_imm(ping);
+  if (wait_done())
+    printf("%-8s latency: %8.2f usec one way\n", mode, (double) ping->elapsed / PING_ROUNDS / HRTIME_USECOND);
+  usleep(100000);
+  delete ping;
+}
+
+static void
+bench_throughput(const char *mode, int nsources)
+{
+  Sink *sink = new Sink(nsources * BURSTS * BURST);
+  EThread *target = eventProcessor.eventthread[ET_CALL][0];
+
+  done = 0;
+  sink->start = ink_get_hrtime_internal();
+  for (int i = 1; i <= nsources; i++)
+    eventProcessor.eventthread[ET_CALL][i]->schedule_imm(new Source(target, sink));
+  if (wait_done())
+    printf("%-8s throughput, %d sources: %8.0f events/sec\n", mode, nsources,
+           (double) sink->received * HRTIME_SECOND / sink->elapsed);
+  // let the threads finish processing before the sink goes away
+  usleep(100000);
+  delete sink;
+}
+
+// Runs the benchmarks from outside the event threads, since the main thread
+// becomes the first of them.
+static void *
+run_benchmarks(void * /* arg ATS_UNUSED */)
+{
+  for (int pass = 0; pass < 2; pass++) {
+    const char *mode = pass ? "condvar" : "eventfd";
+    use_eventfd(!pass);
+    bench_latency(mode);
+    for (int n = 1; n < TEST_THREADS; n++)
+      bench_throughput(mode, n);
+  }
+
+  if (failures) {
+    printf("test_ProtectedQueue: %d failures\n", failures);
+    exit(1);
+  }
+  printf("test_ProtectedQueue: all events delivered\n");
+  exit(0);
+  return NULL;
+}
+
+int
+main(int /* argc ATS_UNUSED */, const char * /* argv ATS_UNUSED */[])
+{
+  Layout::create();
+  diags = NEW(new Diags("", NULL, NULL));
+  RecProcessInit(RECM_STAND_ALONE);
+
+  ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
+  eventProcessor.start(TEST_THREADS, 1048576); // Hardcoded stacksize at 1MB
+
+  ink_thread_create(run_benchmarks, NULL);
+  this_thread()->execute();
+  return 0;
+}
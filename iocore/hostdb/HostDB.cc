@@ -54,6 +54,7 @@ unsigned int hostdb_ip_fail_timeout_interval = HOST_DB_IP_FAIL_TIMEOUT;
 unsigned int hostdb_serve_stale_but_revalidate = 0;
 char hostdb_filename[PATH_NAME_MAX + 1] = DEFAULT_HOST_DB_FILENAME;
 int hostdb_size = DEFAULT_HOST_DB_SIZE;
+int hostdb_max_size = DEFAULT_HOST_DB_MAX_SIZE;
 int hostdb_sync_frequency = 120;
 int hostdb_srv_enabled = 0;
 int hostdb_disable_reverse_lookup = 0;
@@ -64,7 +65,7 @@ ClassAllocator<HostDBContinuation> hostDBContAllocator("hostDBContAllocator");
 
 HostDBCache hostDB;
 
-static  Queue <HostDBContinuation > remoteHostDBQueue[MULTI_CACHE_PARTITIONS];
+static  Queue <HostDBContinuation > remoteHostDBQueue[STRIPED_CACHE_STRIPES];
 
 char *
 HostDBInfo::srvname(HostDBRoundRobin *rr)
@@ -76,11 +77,10 @@ HostDBInfo::srvname(HostDBRoundRobin *rr)
 }
 
 static inline int
-corrupt_debugging_callout(HostDBInfo * e, RebuildMC & r)
+corrupt_debugging_callout(HostDBInfo * e)
 {
-  Debug("hostdb", "corrupt %ld part %d",
-    (long)((char *) &e->app.rr.offset - r.data), r.partition);
-  return -1;
+  Debug("hostdb", "corrupt entry %" PRIx64 " %" PRIx64, e->tag(), e->md5_high);
+  return 0;
 }
 
 static inline bool
@@ -188,55 +188,36 @@ HostDBMD5::HostDBMD5()
 HostDBCache::HostDBCache()
 {
   tag_bits = HOST_DB_TAG_BITS;
-  max_hits = (1 << HOST_DB_HITS_BITS) - 1;
-  version.ink_major = HOST_DB_CACHE_MAJOR_VERSION;
-  version.ink_minor = HOST_DB_CACHE_MINOR_VERSION;
+  entry_version.ink_major = HOST_DB_CACHE_MAJOR_VERSION;
+  entry_version.ink_minor = HOST_DB_CACHE_MINOR_VERSION;
 }
 
 
 int
-HostDBCache::rebuild_callout(HostDBInfo * e, RebuildMC & r)
+HostDBCache::rebuild_callout(HostDBInfo * e, int heap_len)
 {
   if (e->round_robin && e->reverse_dns)
-    return corrupt_debugging_callout(e, r);
+    return corrupt_debugging_callout(e);
   if (e->reverse_dns) {
-    if (e->data.hostname_offset < 0)
-      return 0;
-    if (e->data.hostname_offset > 0) {
-      if (!valid_offset(e->data.hostname_offset - 1))
-        return corrupt_debugging_callout(e, r);
-      char *p = (char *) ptr(&e->data.hostname_offset, r.partition);
-      if (!p)
-        return corrupt_debugging_callout(e, r);
-      char *s = p;
-      while (*p && p - s < MAXDNAME) {
-        if (!valid_heap_pointer(p))
-          return corrupt_debugging_callout(e, r);
-        p++;
-      }
-      if (p - s >= MAXDNAME)
-        return corrupt_debugging_callout(e, r);
-    }
+    char *h = (char *) ptr(e, &e->data.hostname_offset);
+    if (!h || heap_len <= 0 || heap_len > MAXDNAME || h[heap_len - 1] || (int) strlen(h) + 1 != heap_len)
+      return corrupt_debugging_callout(e);
   }
   if (e->round_robin) {
-    if (e->app.rr.offset < 0)
-      return 0;
-    if (!valid_offset(e->app.rr.offset - 1))
-      return corrupt_debugging_callout(e, r);
-    HostDBRoundRobin *rr = (HostDBRoundRobin *) ptr(&e->app.rr.offset, r.partition);
-    if (!rr)
-      return corrupt_debugging_callout(e, r);
+    HostDBRoundRobin *rr = (HostDBRoundRobin *) ptr(e, &e->app.rr.offset);
+    if (!rr || rr->length != heap_len || heap_len < (int) sizeof(HostDBRoundRobin))
+      return corrupt_debugging_callout(e);
     if (rr->rrcount > HOST_DB_MAX_ROUND_ROBIN_INFO || rr->rrcount <= 0 ||
         rr->good > HOST_DB_MAX_ROUND_ROBIN_INFO || rr->good <= 0 || rr->good > rr->rrcount)
-      return corrupt_debugging_callout(e, r);
+      return corrupt_debugging_callout(e);
+    if ((int) (sizeof(HostDBRoundRobin) + rr->rrcount * sizeof(HostDBInfo)) > heap_len)
+      return corrupt_debugging_callout(e);
     for (int i = 0; i < rr->good; i++) {
-      if (!valid_heap_pointer(((char *) &rr->info[i + 1]) - 1))
-        return -1;
       if (!ats_is_ip(rr->info[i].ip()))
-        return corrupt_debugging_callout(e, r);
+        return corrupt_debugging_callout(e);
       if (rr->info[i].md5_high != e->md5_high ||
           rr->info[i].md5_low != e->md5_low || rr->info[i].md5_low_low != e->md5_low_low)
-        return corrupt_debugging_callout(e, r);
+        return corrupt_debugging_callout(e);
     }
   }
   if (e->is_ip_timeout())
@@ -245,6 +226,26 @@ HostDBCache::rebuild_callout(HostDBInfo * e, RebuildMC & r)
 }
 
 
+// Unlike HostDBInfo::heap_size() this resolves the offsets in this cache
+// rather than in hostDB, and does not trust the data.
+int
+HostDBCache::entry_heap_size(char *ae)
+{
+  HostDBInfo *e = (HostDBInfo *) ae;
+
+  if (e->reverse_dns) {
+    char *h = (char *) ptr(e, &e->data.hostname_offset);
+    if (h)
+      return strnlen(h, MAXDNAME) + 1;
+  } else if (e->round_robin) {
+    HostDBRoundRobin *r = (HostDBRoundRobin *) ptr(e, &e->app.rr.offset);
+    if (r)
+      return r->length;
+  }
+  return 0;
+}
+
+
 HostDBCache *
 HostDBProcessor::cache()
 {
@@ -363,13 +364,10 @@ HostDBSyncer::wait_event(int, void *)
 int
 HostDBCache::start(int flags)
 {
-  Store *hostDBStore;
-  Span *hostDBSpan;
   char storage_path[PATH_NAME_MAX + 1];
   int storage_size = 33554432; // 32MB default
 
   bool reconfigure = ((flags & PROCESSOR_RECONFIGURE) ? true : false);
-  bool fix = ((flags & PROCESSOR_FIX) ? true : false);
 
   storage_path[0] = '\0';
 
@@ -379,6 +377,7 @@ HostDBCache::start(int flags)
   REC_ReadConfigInt32(hostdb_enable, "proxy.config.hostdb");
   REC_ReadConfigString(hostdb_filename, "proxy.config.hostdb.filename", PATH_NAME_MAX);
   REC_ReadConfigInt32(hostdb_size, "proxy.config.hostdb.size");
+  REC_ReadConfigInt32(hostdb_max_size, "proxy.config.hostdb.max_size");
   REC_ReadConfigInt32(hostdb_srv_enabled, "proxy.config.srv_enabled");
   REC_ReadConfigString(storage_path, "proxy.config.hostdb.storage_path", PATH_NAME_MAX);
   REC_ReadConfigInt32(storage_size, "proxy.config.hostdb.storage_size");
@@ -399,37 +398,23 @@ HostDBCache::start(int flags)
     Warning("Please set 'proxy.config.hostdb.storage_path' or 'proxy.config.local_state_dir'");
   }
 
-  hostDBStore = NEW(new Store);
-  hostDBSpan = NEW(new Span);
-  hostDBSpan->init(storage_path, storage_size);
-  hostDBStore->add(hostDBSpan);
-
-  Debug("hostdb", "Opening %s, size=%d", hostdb_filename, hostdb_size);
-  if (open(hostDBStore, "hostdb.config", hostdb_filename, hostdb_size, reconfigure, fix, false /* slient */ ) < 0) {
-    xptr<char> rundir(RecConfigReadRuntimeDir());
-    xptr<char> config(Layout::relative_to(rundir, "hostdb.config"));
+  if (init(hostdb_size, hostdb_max_size, storage_size) < 0) {
+    Warning("could not initialize host database. Host database will be disabled");
+    hostdb_enable = 0;
+    return -1;
+  }
 
+  xptr<char> path(Layout::relative_to(storage_path, hostdb_filename));
+  if (reconfigure) {
     Note("reconfiguring host database");
-
-    if (unlink(config) < 0)
-      Debug("hostdb", "unable to unlink %s", (const char *)config);
-
-    delete hostDBStore;
-    hostDBStore = NEW(new Store);
-    hostDBSpan = NEW(new Span);
-    hostDBSpan->init(storage_path, storage_size);
-    hostDBStore->add(hostDBSpan);
-
-    if (open(hostDBStore, "hostdb.config", hostdb_filename, hostdb_size, true, fix) < 0) {
-      Warning("could not initialize host database. Host database will be disabled");
-      hostdb_enable = 0;
-      delete hostDBStore;
-      return -1;
-    }
+    if (unlink(path) < 0 && errno != ENOENT)
+      Debug("hostdb", "unable to unlink %s", (const char *)path);
   }
-  HOSTDB_SET_DYN_COUNT(hostdb_bytes_stat, totalsize);
-  //  XXX I don't see this being reference in the previous function calls, so I am going to delete it -bcall
-  delete hostDBStore;
+  Debug("hostdb", "Opening %s, size=%d, max_size=%d", (const char *)path, hostdb_size, hostdb_max_size);
+  if (load(path) >= 0)
+    Debug("hostdb", "loaded %d entries, dropped %d", loaded, dropped);
+
+  HOSTDB_SET_DYN_COUNT(hostdb_bytes_stat, heap_bytes());
   return 0;
 }
 
@@ -442,15 +427,13 @@ HostDBCache::start(int flags)
 int
 HostDBProcessor::start(int, size_t)
 {
-  hostDB.alloc_mutexes();
-
   if (hostDB.start(0) < 0)
     return -1;
 
   if (auto_clear_hostdb_flag)
     hostDB.clear();
 
-  HOSTDB_SET_DYN_COUNT(hostdb_total_entries_stat, hostDB.totalelements);
+  HOSTDB_SET_DYN_COUNT(hostdb_total_entries_stat, hostDB.capacity());
 
   statPagesManager.register_http("hostdb", register_ShowHostDB);
 
@@ -508,7 +491,7 @@ HostDBContinuation::init(HostDBMD5 const& the_md5, Options const& opt)
 
   host_res_style = opt.host_res_style;
   dns_lookup_timeout = opt.timeout;
-  mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  mutex = hostDB.lock_for(fold_md5(md5.hash));
   if (opt.cont) {
     action = opt.cont;
   } else {
@@ -519,14 +502,14 @@ HostDBContinuation::init(HostDBMD5 const& the_md5, Options const& opt)
 
 void
 HostDBContinuation::refresh_MD5() {
-  ProxyMutex* old_bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  ProxyMutex* old_bucket_mutex = hostDB.lock_for(fold_md5(md5.hash));
   // We're not pending DNS anymore.
   remove_trigger_pending_dns();
   md5.refresh();
   // Update the mutex if it's from the bucket.
   // Some call sites modify this after calling @c init so need to check.
   if (old_bucket_mutex == mutex)
-    mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+    mutex = hostDB.lock_for(fold_md5(md5.hash));
 }
 
 void
@@ -586,7 +569,7 @@ Lerror:
   cont->handleEvent(is_srv ? EVENT_SRV_LOOKUP : EVENT_HOST_DB_LOOKUP, NULL);
 Ldelete:
   Warning("bogus entry deleted from HostDB: %s", reason);
-  hostDB.delete_block(ar);
+  hostDB.remove(ar);
   return false;
 }
 
@@ -621,10 +604,10 @@ db_mark_for(sockaddr const* ip) {
 HostDBInfo *
 probe(ProxyMutex *mutex, HostDBMD5 const& md5, bool ignore_timeout)
 {
-  ink_assert(this_ethread() == hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets))->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(fold_md5(md5.hash))->thread_holding);
   if (hostdb_enable) {
     uint64_t folded_md5 = fold_md5(md5.hash);
-    HostDBInfo *r = hostDB.lookup_block(folded_md5, hostDB.levels);
+    HostDBInfo *r = hostDB.lookup(folded_md5);
     Debug("hostdb", "probe %.*s %" PRIx64 " %d [ignore_timeout = %d]",
           md5.host_len, md5.host_name, folded_md5, !!r, ignore_timeout);
     if (r && md5.hash[1] == r->md5_high) {
@@ -648,12 +631,12 @@ probe(ProxyMutex *mutex, HostDBMD5 const& md5, bool ignore_timeout)
 //error conditions
       if (r->reverse_dns && !r->hostname()) {
         Debug("hostdb", "missing reverse dns");
-        hostDB.delete_block(r);
+        hostDB.remove(r);
         return NULL;
       }
       if (r->round_robin && !r->rr()) {
         Debug("hostdb", "missing round-robin");
-        hostDB.delete_block(r);
+        hostDB.remove(r);
         return NULL;
       }
       // Check for stale (revalidate offline if we are the owner)
@@ -692,20 +675,17 @@ HostDBInfo *
 HostDBContinuation::insert(unsigned int attl)
 {
   uint64_t folded_md5 = fold_md5(md5.hash);
-  int bucket = folded_md5 % hostDB.buckets;
-
-  ink_assert(this_ethread() == hostDB.lock_for_bucket(bucket)->thread_holding);
-  // remove the old one to prevent buildup
-  HostDBInfo *old_r = hostDB.lookup_block(folded_md5, 3);
-  if (old_r)
-    hostDB.delete_block(old_r);
-  HostDBInfo *r = hostDB.insert_block(folded_md5, NULL, 0);
+  int stripe = hostDB.stripe_of(folded_md5);
+
+  ink_assert(this_ethread() == hostDB.lock_for(folded_md5)->thread_holding);
+  // replaces the old one, if any
+  HostDBInfo *r = hostDB.insert(folded_md5);
   r->md5_high = md5.hash[1];
   if (attl > HOST_DB_MAX_TTL)
     attl = HOST_DB_MAX_TTL;
   r->ip_timeout_interval = attl;
   r->ip_timestamp = hostdb_current_interval;
-  Debug("hostdb", "inserting for: %.*s: (md5: %" PRIx64 ") bucket: %d now: %u timeout: %u ttl: %u", md5.host_len, md5.host_name, folded_md5, bucket, r->ip_timestamp,
+  Debug("hostdb", "inserting for: %.*s: (md5: %" PRIx64 ") stripe: %d now: %u timeout: %u ttl: %u", md5.host_len, md5.host_name, folded_md5, stripe, r->ip_timestamp,
         r->ip_timeout_interval, attl);
   return r;
 }
@@ -763,7 +743,7 @@ HostDBProcessor::getby(Continuation * cont,
       // find the partition lock
       //
       // TODO: Could we reuse the "mutex" above safely? I think so but not sure.
-      ProxyMutex *bmutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+      ProxyMutex *bmutex = hostDB.lock_for(fold_md5(md5.hash));
       MUTEX_TRY_LOCK(lock, bmutex, thread);
       MUTEX_TRY_LOCK(lock2, cont->mutex, thread);
 
@@ -876,7 +856,7 @@ HostDBProcessor::getSRVbyname_imm(Continuation * cont, process_srv_info_pfn proc
   // Attempt to find the result in-line, for level 1 hits
   if (!force_dns) {
     // find the partition lock
-    ProxyMutex *bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+    ProxyMutex *bucket_mutex = hostDB.lock_for(fold_md5(md5.hash));
     MUTEX_TRY_LOCK(lock, bucket_mutex, thread);
 
     // If we can get the lock and a level 1 probe succeeds, return
@@ -964,7 +944,7 @@ HostDBProcessor::getbyname_imm(Continuation * cont, process_hostdb_info_pfn proc
     do {
       loop = false; // loop only on explicit set for retry
       // find the partition lock
-      ProxyMutex *bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+      ProxyMutex *bucket_mutex = hostDB.lock_for(fold_md5(md5.hash));
       MUTEX_LOCK(lock, bucket_mutex, thread);
 
       if (lock) {
@@ -1058,7 +1038,7 @@ HostDBProcessor::setby(const char *hostname, int len, sockaddr const* ip, HostDB
 
   // Attempt to find the result in-line, for level 1 hits
 
-  ProxyMutex *mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  ProxyMutex *mutex = hostDB.lock_for(fold_md5(md5.hash));
   EThread *thread = this_ethread();
   MUTEX_TRY_LOCK(lock, mutex, thread);
 
@@ -1114,6 +1094,68 @@ HostDBContinuation::setbyEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUS
   return EVENT_DONE;
 }
 
+// The connect family is a property of the host rather than of one of
+// its addresses, so it is set on the record and every round robin entry.
+static void
+do_setby_connect_family(HostDBInfo * r, unsigned int family, const char *hostname)
+{
+  HostDBRoundRobin *rr = r->round_robin ? r->rr() : NULL;
+
+  if (r->reverse_dns || r->is_srv)
+    return;
+
+  Debug("hostdb", "immediate connect family setby for %s", hostname ? hostname : "<addr>");
+  r->app.http_data.connect_family = family;
+  if (rr) {
+    for (int i = 0; i < rr->rrcount; i++)
+      rr->info[i].app.http_data.connect_family = family;
+  }
+}
+
+void
+HostDBProcessor::setby_connect_family(const char *hostname, int len, sockaddr const* ip, unsigned int family)
+{
+  if (!hostdb_enable || !hostname)
+    return;
+
+  HostDBMD5 md5;
+  md5.host_name = hostname;
+  md5.host_len = len ? len : strlen(hostname);
+  md5.ip.assign(ip);
+  md5.port = ip ? ats_ip_port_host_order(ip) : 0;
+  md5.db_mark = db_mark_for(ip);
+  md5.refresh();
+
+  ProxyMutex *mutex = hostDB.lock_for(fold_md5(md5.hash));
+  EThread *thread = this_ethread();
+  MUTEX_TRY_LOCK(lock, mutex, thread);
+
+  if (lock) {
+    HostDBInfo *r = probe(mutex, md5, false);
+    if (r)
+      do_setby_connect_family(r, family, hostname);
+    return;
+  }
+
+  HostDBContinuation *c = hostDBContAllocator.alloc();
+  c->init(md5);
+  c->app.http_data.connect_family = family;
+  SET_CONTINUATION_HANDLER(c, (HostDBContHandler) & HostDBContinuation::setbyConnectFamilyEvent);
+  thread->schedule_in(c, MUTEX_RETRY_DELAY);
+}
+
+int
+HostDBContinuation::setbyConnectFamilyEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+{
+  HostDBInfo *r = probe(mutex, md5, false);
+
+  if (r)
+    do_setby_connect_family(r, app.http_data.connect_family, md5.host_name);
+
+  hostdb_cont_free(this);
+  return EVENT_DONE;
+}
+
 
 static int
 remove_round_robin(HostDBInfo * r, const char *hostname, IpAddr const& ip)
@@ -1133,7 +1175,7 @@ remove_round_robin(HostDBInfo * r, const char *hostname, IpAddr const& ip)
         rr->info[rr->good - 1] = tmp;
         rr->good--;
         if (rr->good <= 0) {
-          hostDB.delete_block(r);
+          hostDB.remove(r);
           return false;
         } else {
           if (diags->on("hostdb")) {
@@ -1178,7 +1220,7 @@ HostDBProcessor::failed_connect_on_ip_for_name(Continuation * cont, sockaddr con
 #endif // SPLIT_DNS
   md5.refresh();
 
-  ProxyMutex *mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  ProxyMutex *mutex = hostDB.lock_for(fold_md5(md5.hash));
   EThread *thread = this_ethread();
   MUTEX_TRY_LOCK(lock, mutex, thread);
   if (lock) {
@@ -1240,7 +1282,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
 {
   HostDBInfo *i = NULL;
 
-  ink_assert(this_ethread() == hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets))->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(fold_md5(md5.hash))->thread_holding);
   if (!ip.isValid() || !aname || !aname[0]) {
     if (is_byname()) {
       Debug("hostdb", "lookup_done() failed for '%.*s'", md5.host_len, md5.host_name);
@@ -1303,7 +1345,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
     } else {
       Debug("hostdb", "done '%s' TTL %d", aname, ttl_seconds);
       const size_t s_size = strlen(aname) + 1;
-      void *s = hostDB.alloc(&i->data.hostname_offset, s_size);
+      void *s = hostDB.alloc(i, &i->data.hostname_offset, s_size);
       if (s) {
         ink_strlcpy((char *) s, aname, s_size);
         i->round_robin = false;
@@ -1312,7 +1354,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
       } else {
         ink_assert(!"out of room in hostdb data area");
         Warning("out of room in hostdb for reverse DNS data");
-        hostDB.delete_block(i);
+        hostDB.remove(i);
         return NULL;
       }
     }
@@ -1327,7 +1369,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
 int
 HostDBContinuation::dnsPendingEvent(int event, Event * e)
 {
-  ink_assert(this_ethread() == hostDB.lock_for_bucket(fold_md5(md5.hash) % hostDB.buckets)->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(fold_md5(md5.hash))->thread_holding);
   if (timeout) {
     timeout->cancel(this);
     timeout = NULL;
@@ -1373,7 +1415,7 @@ restore_info(HostDBInfo * r, HostDBInfo * old_r, HostDBInfo & old_info, HostDBRo
 int
 HostDBContinuation::dnsEvent(int event, HostEnt * e)
 {
-  ink_assert(this_ethread() == hostDB.lock_for_bucket(fold_md5(md5.hash) % hostDB.buckets)->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(fold_md5(md5.hash))->thread_holding);
   if (timeout) {
     timeout->cancel(this);
     timeout = NULL;
@@ -1488,7 +1530,7 @@ HostDBContinuation::dnsEvent(int event, HostEnt * e)
 
     if (rr) {
       const int rrsize = HostDBRoundRobin::size(n, e->srv_hosts.srv_hosts_length);
-      HostDBRoundRobin *rr_data = (HostDBRoundRobin *) hostDB.alloc(&r->app.rr.offset, rrsize);
+      HostDBRoundRobin *rr_data = (HostDBRoundRobin *) hostDB.alloc(r, &r->app.rr.offset, rrsize);
 
       Debug("hostdb", "allocating %d bytes for %d RR at %p %d", rrsize, n, rr_data, r->app.rr.offset);
 
@@ -2091,7 +2133,7 @@ get_hostinfo_ClusterFunction(ClusterHandler *ch, void *data, int /* len ATS_UNUS
 
   copt.host_res_style = host_res_style_for(&msg->ip.sa);
   c->init(md5, copt);
-  c->mutex = hostDB.lock_for_bucket(fold_md5(msg->md5) % hostDB.buckets);
+  c->mutex = hostDB.lock_for(fold_md5(msg->md5));
   c->action.mutex = c->mutex;
   dnsProcessor.thread->schedule_imm(c);
 }
@@ -2114,7 +2156,7 @@ put_hostinfo_ClusterFunction(ClusterHandler *ch, void *data, int /* len ATS_UNUS
   md5.db_mark = db_mark_for(&msg->ip.sa);
   copt.host_res_style = host_res_style_for(&msg->ip.sa);
   c->init(md5, copt);
-  c->mutex = hostDB.lock_for_bucket(fold_md5(msg->md5) % hostDB.buckets);
+  c->mutex = hostDB.lock_for(fold_md5(msg->md5));
   c->from_cont = msg->cont;     // cannot use action if cont freed due to timeout
   c->missing = msg->missing;
   c->round_robin = msg->round_robin;
@@ -2167,7 +2209,7 @@ HostDBInfo::hostname()
   if (!reverse_dns)
     return NULL;
 
-  return (char *) hostDB.ptr(&data.hostname_offset, hostDB.ptr_to_partition((char *) this));
+  return (char *) hostDB.ptr(this, &data.hostname_offset);
 }
 
 
@@ -2177,7 +2219,7 @@ HostDBInfo::rr()
   if (!round_robin)
     return NULL;
 
-  HostDBRoundRobin *r = (HostDBRoundRobin *) hostDB.ptr(&app.rr.offset, hostDB.ptr_to_partition((char *) this));
+  HostDBRoundRobin *r = (HostDBRoundRobin *) hostDB.ptr(this, &app.rr.offset);
 
   if (r && (r->rrcount > HOST_DB_MAX_ROUND_ROBIN_INFO || r->rrcount <= 0 || r->good > HOST_DB_MAX_ROUND_ROBIN_INFO || r->good <= 0)) {
     ink_assert(!"bad round-robin");
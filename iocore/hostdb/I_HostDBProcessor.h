@@ -110,6 +110,9 @@ union HostDBApplicationInfo
   //                      we tried the server & failed    //
   // fail_count         - Number of times we tried and    //
   //                       and failed to contact the host //
+  // connect_family     - one of ConnectFamily_t, the     //
+  //                      family whose address won the    //
+  //                      last connect race to the host   //
   //////////////////////////////////////////////////////////
   struct http_server_attr
   {
@@ -117,7 +120,8 @@ union HostDBApplicationInfo
     unsigned int pipeline_max:7;
     unsigned int keepalive_timeout:6;
     unsigned int fail_count:8;
-    unsigned int unused1:8;
+    unsigned int connect_family:2;
+    unsigned int unused1:6;
     unsigned int last_failure:32;
   } http_data;
 
@@ -129,6 +133,13 @@ union HostDBApplicationInfo
     HTTP_VERSION_11 = 3
   };
 
+  enum ConnectFamily_t
+  {
+    CONNECT_FAMILY_UNDEFINED = 0,
+    CONNECT_FAMILY_IPV4 = 1,
+    CONNECT_FAMILY_IPV6 = 2
+  };
+
   struct application_data_rr
   {
     int offset;
@@ -486,6 +497,17 @@ public:
   void setby_srv(const char *hostname, int len, const char *target,
       HostDBApplicationInfo * app);
 
+  /** Set the family of the address that won the last connect race to
+      @a hostname. This is kept for the host as a whole, on every round
+      robin entry, not just on the entry for @a aip.
+   */
+  void setby_connect_family(
+    const char *hostname, ///< Hostname.
+    int len, ///< Length of hostname.
+    sockaddr const* aip, ///< Address and port the host was resolved for.
+    unsigned int family ///< One of HostDBApplicationInfo::ConnectFamily_t.
+  );
+
 };
 
 void run_HostDBTest();
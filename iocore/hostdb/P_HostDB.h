@@ -45,6 +45,7 @@
 // HostDB files
 #include "P_DNS.h"
 #include "P_MultiCache.h"
+#include "P_StripedCache.h"
 #include "P_HostDBProcessor.h"
 
 
@@ -52,6 +52,7 @@ extern unsigned int hostdb_ip_stale_interval;
 extern unsigned int hostdb_ip_timeout_interval;
 extern unsigned int hostdb_ip_fail_timeout_interval;
 extern int hostdb_size;
+extern int hostdb_max_size;
 extern int hostdb_srv_enabled;
 extern char hostdb_filename[PATH_NAME_MAX + 1];
 
@@ -110,12 +111,13 @@ inline unsigned int HOSTDB_CLIENT_IP_HASH(
 #define CONFIGURATION_HISTORY_PROBE_DEPTH   1
 
 // Bump this any time hostdb format is changed
-#define HOST_DB_CACHE_MAJOR_VERSION         3
+#define HOST_DB_CACHE_MAJOR_VERSION         4
 #define HOST_DB_CACHE_MINOR_VERSION         0
-// 2.2: IP family split 2.1 : IPv6
+// 4.0: StripedCache 2.2: IP family split 2.1 : IPv6
 
 #define DEFAULT_HOST_DB_FILENAME             "host.db"
 #define DEFAULT_HOST_DB_SIZE                 (1<<14)
+#define DEFAULT_HOST_DB_MAX_SIZE             (1<<20)
 // Resolution of timeouts
 #define HOST_DB_TIMEOUT_INTERVAL             HRTIME_SECOND
 // Timeout DNS every 24 hours by default if ttl_mode is enabled
@@ -141,7 +143,7 @@ inline unsigned int HOSTDB_CLIENT_IP_HASH(
 
 
 #ifdef _HOSTDB_CC_
-template struct MultiCache <HostDBInfo >;
+template struct StripedCache <HostDBInfo >;
 #endif /* _HOSTDB_CC_ */
 
 struct ClusterMachine;
@@ -197,20 +199,14 @@ RecSetRawStatCount(hostdb_rsb, _x, _count);
 //
 // HostDBCache (Private)
 //
-struct HostDBCache: public MultiCache<HostDBInfo>
+struct HostDBCache: public StripedCache<HostDBInfo>
 {
-  int rebuild_callout(HostDBInfo * e, RebuildMC & r);
+  int rebuild_callout(HostDBInfo * e, int heap_len);
+  int entry_heap_size(char *e);
   int start(int flags = 0);
-  MultiCacheBase *dup()
-  {
-    return NEW(new HostDBCache);
-  }
-
-  // This accounts for an average of 2 HostDBInfo per DNS cache (for round-robin etc.)
-  // In addition, we can do a padding for additional SRV records storage.
   virtual size_t estimated_heap_bytes_per_entry() const { return sizeof(HostDBInfo) * 2 + 512 * hostdb_srv_enabled; }
 
-  Queue<HostDBContinuation, Continuation::Link_link> pending_dns[MULTI_CACHE_PARTITIONS];
+  Queue<HostDBContinuation, Continuation::Link_link> pending_dns[STRIPED_CACHE_STRIPES];
   Queue<HostDBContinuation, Continuation::Link_link> &pending_dns_for_hash(INK_MD5 & md5);
   HostDBCache();
 };
@@ -474,6 +470,7 @@ struct HostDBContinuation: public Continuation
   int retryEvent(int event, Event * e);
   int removeEvent(int event, Event * e);
   int setbyEvent(int event, Event * e);
+  int setbyConnectFamilyEvent(int event, Event * e);
 
   /// Recompute the MD5 and update ancillary values.
   void refresh_MD5();
@@ -531,7 +528,7 @@ HostDBContinuation():
   }
 };
 
-//extern Queue<HostDBContinuation>  remoteHostDBQueue[MULTI_CACHE_PARTITIONS];
+//extern Queue<HostDBContinuation>  remoteHostDBQueue[STRIPED_CACHE_STRIPES];
 
 inline unsigned int
 master_hash(INK_MD5 const& md5)
@@ -548,13 +545,13 @@ is_dotted_form_hostname(const char *c)
 inline Queue<HostDBContinuation> &
 HostDBCache::pending_dns_for_hash(INK_MD5 & md5)
 {
-  return pending_dns[partition_of_bucket((int) (fold_md5(md5) % hostDB.buckets))];
+  return pending_dns[stripe_of(fold_md5(md5))];
 }
 
 inline int
 HostDBContinuation::key_partition()
 {
-  return hostDB.partition_of_bucket(fold_md5(md5.hash) % hostDB.buckets);
+  return hostDB.stripe_of(fold_md5(md5.hash));
 }
 
 #endif /* _P_HostDBProcessor_h_ */
@@ -0,0 +1,273 @@
+/** @file
+
+  Resizable, lock striped in memory cache with persistence
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+  P_StripedCache.h
+
+  The entries are split by tag into a fixed number of stripes, each with
+  its own mutex, open addressed table and heap, so that operations on
+  different stripes never contend.  A stripe's table grows by allocating
+  a table of twice the size and moving a few of the old slots with each
+  insert, so that no single operation pays for the whole rehash; lookups
+  check both tables while a move is in progress.
+
+  Heap data is addressed by offsets which encode the stripe, so that
+  copies of entries made outside the lock can still be resolved.  Heap
+  memory is never moved in place: a compaction copies the live data into
+  the other halfspace, and the old one is reused by the next compaction.
+  Heap chunks are kept until the cache is reset, so such an offset always
+  resolves to memory of the cache, and each block starts with the tag of
+  the entry which owns it, so that a copy whose data has since been
+  reused for another entry gets none rather than the other entry's.
+
+ ****************************************************************************/
+
+#ifndef _P_StripedCache_h_
+#define _P_StripedCache_h_
+
+#include "I_EventSystem.h"
+
+//
+// Constants
+//
+
+#define STRIPED_CACHE_STRIPES          64
+#define STRIPED_CACHE_MIN_SLOTS        16
+// old slots moved to the new table by each insert while resizing
+#define STRIPED_CACHE_MIGRATE_SLOTS    16
+// slots examined for a victim when a stripe is at its maximum size
+#define STRIPED_CACHE_EVICT_WINDOW     8
+
+#define STRIPED_CACHE_HEAP_CHUNK       (64 * 1024)
+// per stripe and halfspace
+#define STRIPED_CACHE_HEAP_MAX_CHUNKS  256
+#define STRIPED_CACHE_HEAP_ALIGNMENT   8
+// the owner's tag in front of each heap block
+#define STRIPED_CACHE_HEAP_HEADER      8
+#define STRIPED_CACHE_OFFSET_BITS      25
+
+#define STRIPED_CACHE_MAGIC_NUMBER     0x5791BED
+// Update these if there is a change to the file format
+#define STRIPED_CACHE_MAJOR_VERSION    1
+#define STRIPED_CACHE_MINOR_VERSION    0
+
+#define STRIPED_CACHE_EVENT_SYNC       MULTI_CACHE_EVENT_EVENTS_START
+
+enum
+{
+  STRIPED_CACHE_SLOT_EMPTY,
+  STRIPED_CACHE_SLOT_FULL,
+  STRIPED_CACHE_SLOT_DEAD
+};
+
+struct StripedCacheStripe
+{
+  Ptr<ProxyMutex> mutex;
+
+  // the table, and the one being moved from while resizing
+  char *table;
+  uint8_t *state;
+  int size;
+  int count;
+  int dead;
+
+  char *old_table;
+  uint8_t *old_state;
+  int old_size;
+  int old_count;
+  int migrate_pos;
+
+  // heap chunks, the first STRIPED_CACHE_HEAP_MAX_CHUNKS are halfspace 0,
+  // allocated as they are first used and kept until reset()
+  char *chunk[2 * STRIPED_CACHE_HEAP_MAX_CHUNKS];
+  int halfspace;
+  int heap_used;                // bytes of the current halfspace handed out
+  int heap_free;                // of which no longer referenced
+
+  int entries() const { return count + old_count; }
+};
+
+struct StripedCacheBuffer;
+
+struct StripedCacheHeader
+{
+  unsigned int magic;
+  VersionNumber version;
+  VersionNumber entry_version;
+  int entry_size;
+  int tag_bits;
+  int stripes;
+};
+
+//
+// StripedCacheBase
+// The untyped part of the cache: tables, heaps and persistence.  Entries
+// are handled as entry_size bytes through the virtual entry_ methods,
+// which StripedCache<C> maps onto the methods of C.
+//
+struct StripedCacheBase
+{
+  VersionNumber entry_version;
+  int entry_size;
+  int tag_bits;
+  int initial_slots;            // per stripe
+  int max_entries;              // per stripe, 0 for no limit
+  int heap_chunks;              // per stripe and halfspace
+  char *path;
+
+  // load() statistics, for check()
+  int loaded;
+  int dropped;
+
+  StripedCacheStripe stripes[STRIPED_CACHE_STRIPES];
+
+  // Sizes the cache for about @a nominal entries, growing to at most
+  // @a amax_entries (0 for no limit).  The heap grows as needed to hold
+  // the heap data of amax_entries, as estimated_heap_bytes_per_entry()
+  // has it, and to at least @a heap_bytes.
+  int init(int nominal, int amax_entries, int64_t heap_bytes);
+  // drops every entry
+  void clear();
+  // frees everything
+  void reset();
+
+  // Reads the entries saved in @a apath, which is also where they are
+  // saved from then on.  Returns -1 if there was no usable file.
+  int load(const char *apath);
+  // Saves every stripe in turn, calling back @a cont when done.
+  void sync_partitions(Continuation *cont);
+  // Saves every stripe now, from a thread which is not an event thread.
+  int sync_all();
+  // Reports what load() read, saving the good entries if @a fix.
+  int check(bool fix);
+
+  uint64_t make_tag(uint64_t folded_md5)
+  {
+    uint64_t ttag = folded_md5 ? folded_md5 : 1;
+    return tag_bits < 64 ? ttag & ((((uint64_t) 1) << tag_bits) - 1) : ttag;
+  }
+  int stripe_of_tag(uint64_t tag) { return (int) (tag % STRIPED_CACHE_STRIPES); }
+  int stripe_of(uint64_t folded_md5) { return stripe_of_tag(make_tag(folded_md5)); }
+  ProxyMutex *lock_for(uint64_t folded_md5) { return stripes[stripe_of(folded_md5)].mutex; }
+
+  int entries();
+  int capacity();
+  int64_t heap_bytes();
+
+  //
+  // The remainder must be called with the stripe lock held.
+  //
+
+  char *lookup_entry(uint64_t tag);
+  char *insert_entry(uint64_t tag);
+  void remove_entry(char *e);
+
+  void *alloc(int stripe, uint64_t tag, int *poffset, int size);
+
+  // This may be called without the lock, on a copy of an entry; it
+  // returns NULL if the data of the entry tagged @a tag has been reused.
+  void *ptr(int *poffset, uint64_t tag);
+
+  virtual uint64_t entry_tag(char *e) = 0;
+  virtual int entry_hits(char *e) = 0;
+  virtual void entry_clear(char *e) = 0;
+  virtual int *entry_heap_offset(char *e) = 0;
+  virtual int entry_heap_size(char *e) = 0;
+  // return <= 0 to drop an entry read back by load()
+  virtual int entry_verify(char *e, int heap_len) = 0;
+  virtual size_t estimated_heap_bytes_per_entry() const { return 0; }
+
+  // internal
+  char *probe(StripedCacheStripe *s, char *table, uint8_t *state, int size, uint64_t tag, bool for_insert);
+  void start_resize(StripedCacheStripe *s, int nsize);
+  void migrate(StripedCacheStripe *s, int nslots);
+  void evict(StripedCacheStripe *s, uint64_t tag);
+  int heap_place(StripedCacheStripe *s, int size);
+  char *heap_block(int offset);
+  bool compact(StripedCacheStripe *s);
+  int save_stripe(int stripe, StripedCacheBuffer *b);
+  int open_sync(const char *suffix, char **ptmp);
+  int close_sync(int fd, char *tmp, bool ok);
+
+  StripedCacheBase();
+  virtual ~StripedCacheBase();
+};
+
+//
+// StripedCache
+// C must provide the MultiCacheBlock operations: tag(), reset(),
+// set_full(), set_empty(), heap_size(), heap_offset_ptr() and a hits
+// counter used to pick victims when a stripe is full.
+//
+template<class C> struct StripedCache: public StripedCacheBase
+{
+  C *lookup(uint64_t folded_md5)
+  {
+    return (C *) lookup_entry(make_tag(folded_md5));
+  }
+
+  C *insert(uint64_t folded_md5)
+  {
+    C *e = (C *) insert_entry(make_tag(folded_md5));
+    e->reset();
+    e->set_full(folded_md5, 1);
+    return e;
+  }
+
+  void remove(C *e)
+  {
+    remove_entry((char *) e);
+  }
+
+  void *alloc(C *e, int *poffset, int size)
+  {
+    return StripedCacheBase::alloc(stripe_of_tag(e->tag()), e->tag(), poffset, size);
+  }
+
+  void *ptr(C *e, int *poffset)
+  {
+    return StripedCacheBase::ptr(poffset, e->tag());
+  }
+
+  virtual int rebuild_callout(C *e, int heap_len)
+  {
+    (void) e;
+    (void) heap_len;
+    return 1;
+  }
+
+  virtual uint64_t entry_tag(char *e) { return ((C *) e)->tag(); }
+  virtual int entry_hits(char *e) { return ((C *) e)->hits; }
+  virtual void entry_clear(char *e) { ((C *) e)->set_empty(); }
+  virtual int *entry_heap_offset(char *e) { return ((C *) e)->heap_offset_ptr(); }
+  virtual int entry_heap_size(char *e) { return ((C *) e)->heap_size(); }
+  virtual int entry_verify(char *e, int heap_len) { return rebuild_callout((C *) e, heap_len); }
+
+  StripedCache()
+  {
+    entry_size = sizeof(C);
+  }
+};
+
+#endif /* _P_StripedCache_h_ */
@@ -0,0 +1,1004 @@
+/** @file
+
+  Resizable, lock striped in memory cache with persistence
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/****************************************************************************
+
+  StripedCache.cc
+
+
+ ****************************************************************************/
+
+#include "libts.h"
+#include "P_HostDB.h"
+#include "P_StripedCache.h"
+#include "P_EventSystem.h"      // FIXME: need to have this in I_* header files.
+#include "ink_file.h"
+#include "I_Tasks.h"
+
+#define OFFSET_MASK            ((1 << STRIPED_CACHE_OFFSET_BITS) - 1)
+#define HEAP_HALFSPACE_BYTES   (STRIPED_CACHE_HEAP_MAX_CHUNKS * STRIPED_CACHE_HEAP_CHUNK)
+
+//
+// Heap offsets are the stripe in the high bits and the aligned position
+// plus one in the low bits, so that 0 still means no data.
+//
+static inline int
+make_offset(int stripe, int pos)
+{
+  return (stripe << STRIPED_CACHE_OFFSET_BITS) | (pos / STRIPED_CACHE_HEAP_ALIGNMENT + 1);
+}
+
+static inline int
+offset_pos(int offset)
+{
+  return ((offset & OFFSET_MASK) - 1) * STRIPED_CACHE_HEAP_ALIGNMENT;
+}
+
+static inline int
+heap_align(int size)
+{
+  return (size + STRIPED_CACHE_HEAP_ALIGNMENT - 1) & ~(STRIPED_CACHE_HEAP_ALIGNMENT - 1);
+}
+
+// the heap space taken by @a size bytes of data
+static inline int
+heap_block_size(int size)
+{
+  return heap_align(STRIPED_CACHE_HEAP_HEADER + size);
+}
+
+static bool
+write_all(int fd, const char *buf, int len)
+{
+  while (len > 0) {
+    int r = write(fd, buf, len);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    buf += r;
+    len -= r;
+  }
+  return true;
+}
+
+struct StripedCacheBuffer
+{
+  char *data;
+  int len;
+  int size;
+
+  void append(const void *p, int n)
+  {
+    if (len + n > size) {
+      size = MAX(size * 2, len + n);
+      data = (char *) ats_realloc(data, size);
+    }
+    memcpy(data + len, p, n);
+    len += n;
+  }
+
+  StripedCacheBuffer():data(NULL), len(0), size(0) { }
+  ~StripedCacheBuffer() { ats_free(data); }
+};
+
+static void
+clear_stripe(StripedCacheStripe *s)
+{
+  s->table = NULL;
+  s->state = NULL;
+  s->size = s->count = s->dead = 0;
+  s->old_table = NULL;
+  s->old_state = NULL;
+  s->old_size = s->old_count = s->migrate_pos = 0;
+  memset(s->chunk, 0, sizeof(s->chunk));
+  s->halfspace = 0;
+  s->heap_used = s->heap_free = 0;
+}
+
+// Frees the tables and starts the heap over, keeping its chunks.
+static void
+free_tables(StripedCacheStripe *s)
+{
+  ats_free(s->table);
+  ats_free(s->state);
+  ats_free(s->old_table);
+  ats_free(s->old_state);
+  s->table = NULL;
+  s->state = NULL;
+  s->size = s->count = s->dead = 0;
+  s->old_table = NULL;
+  s->old_state = NULL;
+  s->old_size = s->old_count = s->migrate_pos = 0;
+  s->heap_used = s->heap_free = 0;
+}
+
+static void
+free_stripe(StripedCacheStripe *s)
+{
+  free_tables(s);
+  for (int c = 0; c < 2 * STRIPED_CACHE_HEAP_MAX_CHUNKS; c++)
+    ats_free(s->chunk[c]);
+  clear_stripe(s);
+}
+
+static void
+alloc_table(StripedCacheStripe *s, int size, int entry_size)
+{
+  s->table = (char *) ats_malloc(size * entry_size);
+  s->state = (uint8_t *) ats_calloc(size, 1);
+  s->size = size;
+  s->count = s->dead = 0;
+}
+
+StripedCacheBase::StripedCacheBase()
+  : entry_size(0), tag_bits(64), initial_slots(STRIPED_CACHE_MIN_SLOTS), max_entries(0),
+    heap_chunks(STRIPED_CACHE_HEAP_MAX_CHUNKS), path(NULL), loaded(0), dropped(0)
+{
+  entry_version.ink_major = 0;
+  entry_version.ink_minor = 0;
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++)
+    clear_stripe(&stripes[i]);
+}
+
+// Nothing is freed here, since hostDB is destroyed at exit while the
+// event threads may still be using it; call reset() first.
+StripedCacheBase::~StripedCacheBase()
+{
+}
+
+int
+StripedCacheBase::init(int nominal, int amax_entries, int64_t heap_bytes)
+{
+  int per_stripe = nominal / STRIPED_CACHE_STRIPES;
+
+  initial_slots = STRIPED_CACHE_MIN_SLOTS;
+  while (initial_slots * 3 / 4 < per_stripe && initial_slots < (1 << 24))
+    initial_slots *= 2;
+  max_entries = amax_entries > 0 ? MAX(1, amax_entries / STRIPED_CACHE_STRIPES) : 0;
+
+  // chunks are only allocated as they are used, this is just the limit
+  int64_t stripe_heap = MAX(heap_bytes / STRIPED_CACHE_STRIPES,
+                            (int64_t) max_entries * (int64_t) heap_block_size((int) estimated_heap_bytes_per_entry()));
+  int64_t chunks = (stripe_heap + STRIPED_CACHE_HEAP_CHUNK - 1) / STRIPED_CACHE_HEAP_CHUNK;
+  heap_chunks = (int) MIN(MAX(chunks, 1), STRIPED_CACHE_HEAP_MAX_CHUNKS);
+
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++) {
+    StripedCacheStripe *s = &stripes[i];
+    free_stripe(s);
+    alloc_table(s, initial_slots, entry_size);
+    if (!s->mutex)
+      s->mutex = new_ProxyMutex();
+  }
+  Debug("striped_cache", "%d stripes of %d slots, at most %d entries and %d heap chunks each",
+        STRIPED_CACHE_STRIPES, initial_slots, max_entries, heap_chunks);
+  return 0;
+}
+
+// The heap chunks are kept, since copies of the entries may still refer
+// to them.
+void
+StripedCacheBase::clear()
+{
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++) {
+    StripedCacheStripe *s = &stripes[i];
+    free_tables(s);
+    alloc_table(s, initial_slots, entry_size);
+  }
+}
+
+void
+StripedCacheBase::reset()
+{
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++) {
+    free_stripe(&stripes[i]);
+    stripes[i].mutex = NULL;
+  }
+  ats_free(path);
+  path = NULL;
+}
+
+int
+StripedCacheBase::entries()
+{
+  int n = 0;
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++)
+    n += stripes[i].entries();
+  return n;
+}
+
+int
+StripedCacheBase::capacity()
+{
+  return STRIPED_CACHE_STRIPES * (max_entries ? max_entries : initial_slots * 3 / 4);
+}
+
+int64_t
+StripedCacheBase::heap_bytes()
+{
+  return (int64_t) STRIPED_CACHE_STRIPES * heap_chunks * STRIPED_CACHE_HEAP_CHUNK;
+}
+
+//
+// Tables
+//
+
+char *
+StripedCacheBase::probe(StripedCacheStripe *s, char *table, uint8_t *state, int size, uint64_t tag, bool for_insert)
+{
+  (void) s;
+  unsigned int mask = size - 1;
+  unsigned int i = (unsigned int) (tag / STRIPED_CACHE_STRIPES) & mask;
+  int dead = -1;
+
+  for (int n = 0; n < size; n++, i = (i + 1) & mask) {
+    switch (state[i]) {
+    case STRIPED_CACHE_SLOT_EMPTY:
+      if (!for_insert)
+        return NULL;
+      return table + (dead >= 0 ? dead : (int) i) * entry_size;
+    case STRIPED_CACHE_SLOT_DEAD:
+      if (dead < 0)
+        dead = i;
+      break;
+    default:
+      if (!for_insert && entry_tag(table + i * entry_size) == tag)
+        return table + i * entry_size;
+      break;
+    }
+  }
+  return for_insert && dead >= 0 ? table + dead * entry_size : NULL;
+}
+
+char *
+StripedCacheBase::lookup_entry(uint64_t tag)
+{
+  StripedCacheStripe *s = &stripes[stripe_of_tag(tag)];
+  char *e = probe(s, s->table, s->state, s->size, tag, false);
+
+  if (!e && s->old_table)
+    e = probe(s, s->old_table, s->old_state, s->old_size, tag, false);
+  return e;
+}
+
+void
+StripedCacheBase::start_resize(StripedCacheStripe *s, int nsize)
+{
+  ink_assert(!s->old_table);
+  Debug("striped_cache", "stripe %d resizing from %d to %d slots, %d entries",
+        (int) (s - stripes), s->size, nsize, s->count);
+  s->old_table = s->table;
+  s->old_state = s->state;
+  s->old_size = s->size;
+  s->old_count = s->count;
+  s->migrate_pos = 0;
+  alloc_table(s, nsize, entry_size);
+}
+
+void
+StripedCacheBase::migrate(StripedCacheStripe *s, int nslots)
+{
+  while (nslots-- > 0 && s->migrate_pos < s->old_size) {
+    int i = s->migrate_pos++;
+    if (s->old_state[i] != STRIPED_CACHE_SLOT_FULL)
+      continue;
+    char *from = s->old_table + i * entry_size;
+    char *to = probe(s, s->table, s->state, s->size, entry_tag(from), true);
+    int j = (to - s->table) / entry_size;
+    if (s->state[j] == STRIPED_CACHE_SLOT_DEAD)
+      s->dead--;
+    s->state[j] = STRIPED_CACHE_SLOT_FULL;
+    memcpy(to, from, entry_size);
+    // dead rather than empty so that probes of the old table carry on
+    s->old_state[i] = STRIPED_CACHE_SLOT_DEAD;
+    s->count++;
+    s->old_count--;
+  }
+  if (s->migrate_pos >= s->old_size) {
+    ink_assert(!s->old_count);
+    ats_free(s->old_table);
+    ats_free(s->old_state);
+    s->old_table = NULL;
+    s->old_state = NULL;
+    s->old_size = s->old_count = s->migrate_pos = 0;
+  }
+}
+
+// Drops the entry with the fewest hits among the first few near the home
+// slot of @a tag.
+void
+StripedCacheBase::evict(StripedCacheStripe *s, uint64_t tag)
+{
+  if (s->old_table)
+    migrate(s, s->old_size);
+
+  unsigned int mask = s->size - 1;
+  unsigned int i = (unsigned int) (tag / STRIPED_CACHE_STRIPES) & mask;
+  char *victim = NULL;
+  int seen = 0;
+
+  for (int n = 0; n < s->size && seen < STRIPED_CACHE_EVICT_WINDOW; n++, i = (i + 1) & mask) {
+    if (s->state[i] != STRIPED_CACHE_SLOT_FULL)
+      continue;
+    char *e = s->table + i * entry_size;
+    if (!victim || entry_hits(e) < entry_hits(victim))
+      victim = e;
+    seen++;
+  }
+  if (victim)
+    remove_entry(victim);
+}
+
+char *
+StripedCacheBase::insert_entry(uint64_t tag)
+{
+  StripedCacheStripe *s = &stripes[stripe_of_tag(tag)];
+
+  if (s->old_table)
+    migrate(s, STRIPED_CACHE_MIGRATE_SLOTS);
+
+  char *e = lookup_entry(tag);
+  if (e)
+    remove_entry(e);
+  if (max_entries && s->entries() >= max_entries)
+    evict(s, tag);
+
+  // Once live and dead slots pass three quarters of the table, rebuild
+  // it: at twice the size if live entries pass half of it, otherwise at
+  // the same size, just to get rid of the dead slots.
+  if ((s->entries() + s->dead + 1) * 4 > s->size * 3) {
+    if (s->old_table)
+      migrate(s, s->old_size);
+    start_resize(s, (s->count + 1) * 2 > s->size ? s->size * 2 : s->size);
+    migrate(s, STRIPED_CACHE_MIGRATE_SLOTS);
+  }
+
+  e = probe(s, s->table, s->state, s->size, tag, true);
+  int i = (e - s->table) / entry_size;
+  if (s->state[i] == STRIPED_CACHE_SLOT_DEAD)
+    s->dead--;
+  s->state[i] = STRIPED_CACHE_SLOT_FULL;
+  s->count++;
+  memset(e, 0, entry_size);
+  return e;
+}
+
+void
+StripedCacheBase::remove_entry(char *e)
+{
+  StripedCacheStripe *s = &stripes[stripe_of_tag(entry_tag(e))];
+
+  if (e >= s->table && e < s->table + s->size * entry_size) {
+    s->state[(e - s->table) / entry_size] = STRIPED_CACHE_SLOT_DEAD;
+    s->count--;
+    s->dead++;
+  } else {
+    ink_assert(s->old_table && e >= s->old_table && e < s->old_table + s->old_size * entry_size);
+    s->old_state[(e - s->old_table) / entry_size] = STRIPED_CACHE_SLOT_DEAD;
+    s->old_count--;
+  }
+
+  int *off = entry_heap_offset(e);
+  if (off && *off > 0 && offset_pos(*off) / HEAP_HALFSPACE_BYTES == s->halfspace)
+    s->heap_free += heap_block_size(entry_heap_size(e));
+  entry_clear(e);
+}
+
+//
+// Heap
+//
+
+int
+StripedCacheBase::heap_place(StripedCacheStripe *s, int size)
+{
+  int off = s->heap_used % STRIPED_CACHE_HEAP_CHUNK;
+
+  if (off + size > STRIPED_CACHE_HEAP_CHUNK) {
+    if (s->heap_used / STRIPED_CACHE_HEAP_CHUNK + 1 >= heap_chunks)
+      return -1;
+    s->heap_free += STRIPED_CACHE_HEAP_CHUNK - off;
+    s->heap_used += STRIPED_CACHE_HEAP_CHUNK - off;
+  }
+  int c = s->heap_used / STRIPED_CACHE_HEAP_CHUNK;
+  if (c >= heap_chunks)
+    return -1;
+  c += s->halfspace * STRIPED_CACHE_HEAP_MAX_CHUNKS;
+  // published once, so that ptr() sees either nothing or the chunk for good
+  if (!s->chunk[c])
+    ink_atomic_swap(&s->chunk[c], (char *) ats_malloc(STRIPED_CACHE_HEAP_CHUNK));
+  int pos = c * STRIPED_CACHE_HEAP_CHUNK + s->heap_used % STRIPED_CACHE_HEAP_CHUNK;
+  s->heap_used += size;
+  return pos;
+}
+
+// Copies the live heap data of a stripe into the other halfspace.  What
+// was there was superseded by the previous compaction, so only copies of
+// entries taken before that could still refer to it, and they find the
+// tags of other entries there once it is overwritten.
+bool
+StripedCacheBase::compact(StripedCacheStripe *s)
+{
+  int stripe = s - stripes;
+  int to = !s->halfspace;
+  int before = s->heap_used - s->heap_free;
+  s->halfspace = to;
+  s->heap_used = 0;
+  s->heap_free = 0;
+
+  for (int t = 0; t < 2; t++) {
+    char *table = t ? s->old_table : s->table;
+    uint8_t *state = t ? s->old_state : s->state;
+    int size = t ? s->old_size : s->size;
+
+    for (int i = 0; i < size; i++) {
+      if (state[i] != STRIPED_CACHE_SLOT_FULL)
+        continue;
+      char *e = table + i * entry_size;
+      int *off = entry_heap_offset(e);
+      if (!off || *off <= 0)
+        continue;
+      char *p = heap_block(*off);
+      int len = p ? entry_heap_size(e) : 0;
+      int size = heap_block_size(len);
+      int pos = len > 0 && size <= STRIPED_CACHE_HEAP_CHUNK ? heap_place(s, size) : -1;
+      if (pos < 0) {
+        *off = 0;
+        remove_entry(e);
+        continue;
+      }
+      memcpy(s->chunk[pos / STRIPED_CACHE_HEAP_CHUNK] + pos % STRIPED_CACHE_HEAP_CHUNK, p,
+             STRIPED_CACHE_HEAP_HEADER + len);
+      *off = make_offset(stripe, pos);
+    }
+  }
+  Debug("striped_cache", "stripe %d compacted, %d bytes live before, %d after", stripe, before, s->heap_used);
+  return true;
+}
+
+void *
+StripedCacheBase::alloc(int stripe, uint64_t tag, int *poffset, int size)
+{
+  StripedCacheStripe *s = &stripes[stripe];
+
+  if (size <= 0 || heap_block_size(size) > STRIPED_CACHE_HEAP_CHUNK)
+    return NULL;
+  size = heap_block_size(size);
+  int pos = heap_place(s, size);
+  if (pos < 0 && s->heap_free >= size && compact(s))
+    pos = heap_place(s, size);
+  if (pos < 0)
+    return NULL;
+  *poffset = make_offset(stripe, pos);
+  char *p = s->chunk[pos / STRIPED_CACHE_HEAP_CHUNK] + pos % STRIPED_CACHE_HEAP_CHUNK;
+  memcpy(p, &tag, sizeof(tag));
+  return p + STRIPED_CACHE_HEAP_HEADER;
+}
+
+// The block at @a offset, starting with the tag of its owner.
+char *
+StripedCacheBase::heap_block(int offset)
+{
+  if (offset <= 0)
+    return NULL;
+  StripedCacheStripe *s = &stripes[(offset >> STRIPED_CACHE_OFFSET_BITS) % STRIPED_CACHE_STRIPES];
+  int c = offset_pos(offset) / STRIPED_CACHE_HEAP_CHUNK;
+  char *chunk = c < 2 * STRIPED_CACHE_HEAP_MAX_CHUNKS ? s->chunk[c] : NULL;
+  return chunk ? chunk + offset_pos(offset) % STRIPED_CACHE_HEAP_CHUNK : NULL;
+}
+
+void *
+StripedCacheBase::ptr(int *poffset, uint64_t tag)
+{
+  char *p = heap_block(*poffset);
+  uint64_t owner;
+
+  if (!p)
+    return NULL;
+  memcpy(&owner, p, sizeof(owner));
+  return owner == tag ? p + STRIPED_CACHE_HEAP_HEADER : NULL;
+}
+
+//
+// Persistence
+//
+// The file is a StripedCacheHeader followed, for each stripe, by its
+// index and number of entries and then each entry, the length of its heap
+// data and the data itself, and is closed by the magic number.  It is
+// written to a temporary file which then replaces the old one.
+//
+
+int
+StripedCacheBase::save_stripe(int stripe, StripedCacheBuffer *b)
+{
+  StripedCacheStripe *s = &stripes[stripe];
+  int32_t hdr[2] = { stripe, s->entries() };
+
+  b->append(hdr, sizeof(hdr));
+  for (int t = 0; t < 2; t++) {
+    char *table = t ? s->old_table : s->table;
+    uint8_t *state = t ? s->old_state : s->state;
+    int size = t ? s->old_size : s->size;
+
+    for (int i = 0; i < size; i++) {
+      if (state[i] != STRIPED_CACHE_SLOT_FULL)
+        continue;
+      char *e = table + i * entry_size;
+      int *off = entry_heap_offset(e);
+      char *p = off ? heap_block(*off) : NULL;
+      int32_t len = p ? entry_heap_size(e) : 0;
+      if (p)
+        p += STRIPED_CACHE_HEAP_HEADER;
+      b->append(e, entry_size);
+      b->append(&len, sizeof(len));
+      if (len > 0)
+        b->append(p, len);
+    }
+  }
+  return b->len;
+}
+
+int
+StripedCacheBase::open_sync(const char *suffix, char **ptmp)
+{
+  *ptmp = NULL;
+  if (!path)
+    return -1;
+
+  size_t n = strlen(path) + strlen(suffix) + 1;
+  char *tmp = (char *) ats_malloc(n);
+  snprintf(tmp, n, "%s%s", path, suffix);
+  int fd = ::open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    Warning("unable to open '%s' for writing: %d, %s", tmp, errno, strerror(errno));
+    ats_free(tmp);
+    return -1;
+  }
+
+  StripedCacheHeader h;
+  memset(&h, 0, sizeof(h));
+  h.magic = STRIPED_CACHE_MAGIC_NUMBER;
+  h.version.ink_major = STRIPED_CACHE_MAJOR_VERSION;
+  h.version.ink_minor = STRIPED_CACHE_MINOR_VERSION;
+  h.entry_version = entry_version;
+  h.entry_size = entry_size;
+  h.tag_bits = tag_bits;
+  h.stripes = STRIPED_CACHE_STRIPES;
+  if (!write_all(fd, (char *) &h, sizeof(h))) {
+    close_sync(fd, tmp, false);
+    return -1;
+  }
+  *ptmp = tmp;
+  return fd;
+}
+
+int
+StripedCacheBase::close_sync(int fd, char *tmp, bool ok)
+{
+  unsigned int magic = STRIPED_CACHE_MAGIC_NUMBER;
+
+  ok = ok && write_all(fd, (char *) &magic, sizeof(magic));
+  ok = ok && fsync(fd) == 0;
+  ok = (close(fd) == 0) && ok;
+  if (ok && rename(tmp, path) < 0) {
+    Warning("unable to rename '%s' to '%s': %d, %s", tmp, path, errno, strerror(errno));
+    ok = false;
+  }
+  if (!ok)
+    unlink(tmp);
+  ats_free(tmp);
+  return ok ? 0 : -1;
+}
+
+int
+StripedCacheBase::sync_all()
+{
+  char *tmp = NULL;
+  // not the file of a StripedCacheSync which may be in progress
+  int fd = open_sync(".shutdown", &tmp);
+  if (fd < 0)
+    return -1;
+
+  // the process may be going down, do blocking calls
+  EThread *t = (EThread *) 0xdeadbeef;
+  StripedCacheBuffer b;
+  bool ok = true;
+  for (int i = 0; i < STRIPED_CACHE_STRIPES && ok; i++) {
+    MUTEX_TAKE_LOCK(stripes[i].mutex, t);
+    b.len = 0;
+    save_stripe(i, &b);
+    MUTEX_UNTAKE_LOCK(stripes[i].mutex, t);
+    ok = write_all(fd, b.data, b.len);
+  }
+  return close_sync(fd, tmp, ok);
+}
+
+//
+// Saves the stripes one at a time, serializing each under its lock and
+// writing it out under the lock of the continuation to call back.
+//
+struct StripedCacheSync;
+typedef int (StripedCacheSync::*SCacheSyncHandler) (int, void *);
+
+struct StripedCacheSync: public Continuation
+{
+  StripedCacheBase *sc;
+  Continuation *cont;
+  int stripe;
+  int fd;
+  char *tmp;
+  bool ok;
+  StripedCacheBuffer buf;
+
+  int saveEvent(int event, Event *e)
+  {
+    (void) event;
+    buf.len = 0;
+    sc->save_stripe(stripe, &buf);
+    mutex = cont->mutex;
+    SET_HANDLER((SCacheSyncHandler) & StripedCacheSync::writeEvent);
+    e->schedule_imm();
+    return EVENT_CONT;
+  }
+
+  int writeEvent(int event, Event *e)
+  {
+    (void) event;
+    ok = ok && write_all(fd, buf.data, buf.len);
+    if (++stripe < STRIPED_CACHE_STRIPES && ok) {
+      mutex = sc->stripes[stripe].mutex;
+      SET_HANDLER((SCacheSyncHandler) & StripedCacheSync::saveEvent);
+      e->schedule_imm();
+      return EVENT_CONT;
+    }
+    ok = sc->close_sync(fd, tmp, ok) == 0;
+    Debug("striped_cache", "StripedCacheSync done (%s)", ok ? "ok" : "failed");
+    cont->handleEvent(STRIPED_CACHE_EVENT_SYNC, 0);
+    delete this;
+    return EVENT_DONE;
+  }
+
+  StripedCacheSync(Continuation *acont, StripedCacheBase *asc, int afd, char *atmp)
+    : Continuation(asc->stripes[0].mutex), sc(asc), cont(acont), stripe(0), fd(afd), tmp(atmp), ok(true)
+  {
+    SET_HANDLER((SCacheSyncHandler) & StripedCacheSync::saveEvent);
+  }
+};
+
+void
+StripedCacheBase::sync_partitions(Continuation *cont)
+{
+  char *tmp = NULL;
+  int fd = open_sync(".tmp", &tmp);
+
+  if (fd < 0)
+    eventProcessor.schedule_imm(cont, ET_CALL, STRIPED_CACHE_EVENT_SYNC);
+  else
+    eventProcessor.schedule_imm(NEW(new StripedCacheSync(cont, this, fd, tmp)), ET_TASK);
+}
+
+int
+StripedCacheBase::load(const char *apath)
+{
+  ats_free(path);
+  path = ats_strdup(apath);
+  loaded = dropped = 0;
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+  char *buf = NULL;
+  int64_t n = 0;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    buf = (char *) ats_malloc(st.st_size);
+    while (n < st.st_size) {
+      ssize_t r = read(fd, buf + n, st.st_size - n);
+      if (r < 0 && errno == EINTR)
+        continue;
+      if (r <= 0)
+        break;
+      n += r;
+    }
+  }
+  close(fd);
+
+  char *p = buf, *end = buf + n;
+  StripedCacheHeader h;
+  if (end - p < (int64_t) sizeof(h)) {
+    Warning("'%s' is truncated, ignoring it", path);
+    ats_free(buf);
+    return -1;
+  }
+  memcpy(&h, p, sizeof(h));
+  p += sizeof(h);
+  if (h.magic != STRIPED_CACHE_MAGIC_NUMBER || h.version.ink_major != STRIPED_CACHE_MAJOR_VERSION ||
+      h.entry_version.ink_major != entry_version.ink_major || h.entry_size != entry_size ||
+      h.tag_bits != tag_bits || h.stripes != STRIPED_CACHE_STRIPES) {
+    Note("'%s' is from an incompatible version, ignoring it", path);
+    ats_free(buf);
+    return -1;
+  }
+
+  char *from = (char *) ats_malloc(entry_size);
+  bool complete = false;
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++) {
+    int32_t hdr[2];
+    if (end - p < (int64_t) sizeof(hdr))
+      goto Ldone;
+    memcpy(hdr, p, sizeof(hdr));
+    p += sizeof(hdr);
+    for (int j = 0; j < hdr[1]; j++) {
+      int32_t len;
+      if (end - p < (int64_t) (entry_size + sizeof(len)))
+        goto Ldone;
+      memcpy(from, p, entry_size);
+      memcpy(&len, p + entry_size, sizeof(len));
+      p += entry_size + sizeof(len);
+      if (len < 0 || len > end - p)
+        goto Ldone;
+
+      uint64_t tag = entry_tag(from);
+      char *e = insert_entry(tag);
+      memcpy(e, from, entry_size);
+      int *off = entry_heap_offset(e);
+      if (off)
+        *off = 0;
+      void *d = len > 0 && off ? alloc(stripe_of_tag(tag), tag, off, len) : NULL;
+      if (d)
+        memcpy(d, p, len);
+      if ((len > 0 && !d) || entry_verify(e, len) <= 0) {
+        if (off)
+          *off = 0;
+        remove_entry(e);
+        dropped++;
+      } else
+        loaded++;
+      p += len;
+    }
+  }
+  if (end - p == (int64_t) sizeof(h.magic)) {
+    memcpy(&h.magic, p, sizeof(h.magic));
+    complete = h.magic == STRIPED_CACHE_MAGIC_NUMBER;
+  }
+Ldone:
+  if (!complete)
+    Warning("'%s' is truncated, %d entries recovered", path, loaded);
+  for (int i = 0; i < STRIPED_CACHE_STRIPES; i++) {
+    if (stripes[i].old_table)
+      migrate(&stripes[i], stripes[i].old_size);
+  }
+  ats_free(from);
+  ats_free(buf);
+  return loaded;
+}
+
+int
+StripedCacheBase::check(bool fix)
+{
+  printf("\t%d entries, %d dropped\n", loaded, dropped);
+  if (dropped && fix)
+    return sync_all();
+  return dropped ? -1 : 0;
+}
+
+//
+// Regression test
+//
+
+struct StripedCacheTestEntry
+{
+  uint64_t tag_;
+  int offset;
+  int length;
+  int value;
+  unsigned int hits:3;
+  unsigned int full:1;
+
+  uint64_t tag() { return tag_; }
+  void reset() { offset = length = value = 0; hits = 0; }
+  void set_full(uint64_t folded_md5, int buckets) { tag_ = folded_md5 / buckets; full = 1; }
+  void set_empty() { tag_ = 0; full = 0; }
+  int heap_size() { return offset > 0 ? length : 0; }
+  int *heap_offset_ptr() { return &offset; }
+};
+
+struct StripedCacheTest: public StripedCache<StripedCacheTestEntry>
+{
+  int rebuild_callout(StripedCacheTestEntry *e, int heap_len)
+  {
+    int *d = (int *) ptr(e, &e->offset);
+    return heap_len == e->length && d && *d == e->value;
+  }
+  size_t estimated_heap_bytes_per_entry() const { return 4 * sizeof(int); }
+};
+
+static uint64_t
+test_key(int i)
+{
+  // spread the keys across the stripes and tables, never 0
+  return (uint64_t) (i + 1) * 0x9E3779B97F4A7C15ULL;
+}
+
+static bool
+test_check(StripedCacheTest *sc, int first, int last)
+{
+  for (int i = first; i < last; i++) {
+    StripedCacheTestEntry *e = sc->lookup(test_key(i));
+    int *d = e ? (int *) sc->ptr(e, &e->offset) : NULL;
+    if (!e || e->value != i || !d || *d != i)
+      return false;
+  }
+  return true;
+}
+
+REGRESSION_TEST(StripedCache) (RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus) {
+  StripedCacheTest *sc = NEW(new StripedCacheTest);
+  const int n = 50000;
+  bool ok = true;
+
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  sc->tag_bits = 64;
+  sc->init(1024, 0, 1 << 20);
+
+  // grow the stripes well past their initial size
+  for (int i = 0; i < n; i++) {
+    uint64_t key = test_key(i);
+    StripedCacheTestEntry *e = sc->insert(key);
+    e->value = i;
+    e->length = (i % 5 + 1) * sizeof(int);
+    int *d = (int *) sc->alloc(e, &e->offset, e->length);
+    if (!d) {
+      rprintf(t, "heap allocation %d failed\n", i);
+      ok = false;
+      break;
+    }
+    *d = i;
+  }
+  if (ok && (sc->entries() != n || !test_check(sc, 0, n))) {
+    rprintf(t, "lookups failed after growing to %d entries\n", sc->entries());
+    ok = false;
+  }
+
+  // replace half of them, which forces heap compactions
+  for (int r = 0; ok && r < 32; r++) {
+    for (int i = 0; i < n; i += 2) {
+      StripedCacheTestEntry *e = sc->insert(test_key(i));
+      e->value = i;
+      e->length = sizeof(int);
+      int *d = (int *) sc->alloc(e, &e->offset, e->length);
+      if (!d) {
+        rprintf(t, "heap allocation %d failed after compaction\n", i);
+        ok = false;
+        break;
+      }
+      *d = i;
+    }
+  }
+  if (ok && (sc->entries() != n || !test_check(sc, 0, n))) {
+    rprintf(t, "lookups failed after replacing entries\n");
+    ok = false;
+  }
+
+  // a copy taken outside the lock gets its own heap data or none, never
+  // that of another entry, once its block has been reused
+  if (ok) {
+    StripedCacheTestEntry *e = sc->insert(test_key(n));
+    e->value = n;
+    e->length = sizeof(int);
+    int *d = (int *) sc->alloc(e, &e->offset, e->length);
+    if (d)
+      *d = n;
+    StripedCacheTestEntry copy = *e;
+    StripedCacheStripe *s = &sc->stripes[sc->stripe_of_tag(copy.tag())];
+    int halfspace = s->halfspace, compactions = 0;
+    int pos = offset_pos(copy.offset) % HEAP_HALFSPACE_BYTES;
+    int copy_halfspace = offset_pos(copy.offset) / HEAP_HALFSPACE_BYTES;
+    bool reused = false;
+
+    sc->remove(e);
+    for (int r = 0; !reused && r < 1000; r++) {
+      for (int i = 0; !reused && i < n; i += 2) {
+        e = sc->insert(test_key(i));
+        e->value = i;
+        e->length = sizeof(int);
+        if ((d = (int *) sc->alloc(e, &e->offset, e->length)))
+          *d = i;
+        if (s->halfspace != halfspace) {
+          halfspace = s->halfspace;
+          compactions++;
+        }
+        reused = compactions >= 2 && s->halfspace == copy_halfspace &&
+          s->heap_used >= pos + heap_block_size(sizeof(int));
+      }
+    }
+    d = (int *) sc->ptr(&copy, &copy.offset);
+    if (!reused || d) {
+      rprintf(t, "stale copy resolved to %d after %d compactions\n", d ? *d : -1, compactions);
+      ok = false;
+    }
+  }
+
+  // save and read back
+  char path[PATH_NAME_MAX + 1];
+  snprintf(path, sizeof(path), "/tmp/striped_cache_test.%d", (int) getpid());
+  if (ok) {
+    ats_free(sc->path);
+    sc->path = ats_strdup(path);
+    StripedCacheTest *sc2 = NEW(new StripedCacheTest);
+    sc2->tag_bits = 64;
+    sc2->init(1024, 0, 1 << 20);
+    if (sc->sync_all() < 0 || sc2->load(path) != n || !test_check(sc2, 0, n)) {
+      rprintf(t, "save and load failed, %d loaded %d dropped\n", sc2->loaded, sc2->dropped);
+      ok = false;
+    }
+    sc2->reset();
+    delete sc2;
+    unlink(path);
+  }
+
+  // removal, and eviction once the entry limit is reached
+  if (ok) {
+    for (int i = 0; i < n; i += 2)
+      sc->remove(sc->lookup(test_key(i)));
+    if (sc->entries() != n / 2 || sc->lookup(test_key(0)) || !sc->lookup(test_key(1))) {
+      rprintf(t, "removal failed, %d entries\n", sc->entries());
+      ok = false;
+    }
+    sc->init(1024, 4096, 1 << 20);
+    for (int i = 0; i < n; i++)
+      sc->insert(test_key(i))->value = i;
+    if (sc->entries() > 4096) {
+      rprintf(t, "%d entries exceed the limit of 4096\n", sc->entries());
+      ok = false;
+    }
+  }
+
+  // the heap is sized for the entry limit, not just the heap size given
+  if (ok) {
+    const int limit = n * 16;
+
+    sc->init(1024, limit, 1 << 20);
+    if (sc->heap_bytes() < (int64_t) limit * 4 * (int64_t) sizeof(int)) {
+      rprintf(t, "heap of %" PRId64 " bytes too small for %d entries\n", sc->heap_bytes(), limit);
+      ok = false;
+    }
+    for (int i = 0; ok && i < limit; i++) {
+      StripedCacheTestEntry *e = sc->insert(test_key(i));
+      e->value = i;
+      e->length = 4 * sizeof(int);
+      int *d = (int *) sc->alloc(e, &e->offset, e->length);
+      if (!d) {
+        rprintf(t, "heap allocation %d failed below the entry limit\n", i);
+        ok = false;
+        break;
+      }
+      *d = i;
+    }
+  }
+
+  sc->reset();
+  delete sc;
+  *pstatus = ok ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED;
+}
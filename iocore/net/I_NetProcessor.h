@@ -192,7 +192,9 @@ public:
     case of connect the cont could be called back with NET_EVENT_OPEN
     event and OS could still be in the process of establishing the
     connection. Re-entrant Callbacks: same as connect. If unix
-    asynchronous type connect is desired use connect_re().
+    asynchronous type connect is desired use connect_re(). Called
+    on sslNetProcessor, the cont is called back once the SSL
+    handshake is done as well.
 
     @param cont Continuation to be called back with events.
     @param addr Address to which to connect (includes port).
@@ -315,6 +315,37 @@ public:
   */
   virtual void cancel_OOB();
 
+  /**
+    Moves the data read by this connection to @a target inside the
+    kernel, through a pipe, instead of through the read buffer. The
+    read VIO of this connection and the write VIO of @a target must
+    already be set up. Their progress is reported as usual, but the
+    spliced data never shows up in the read buffer; @a target writes it
+    once its write buffer is empty. The splice ends when a new read or
+    write is started on either connection.
+
+    @param target connection that writes the data read by this one.
+    @return @c false if the connections do not support splicing.
+
+  */
+  virtual bool splice_to(NetVConnection * target);
+
+  /**
+    Moves this connection to the calling net thread @a t, so that its
+    I/O is done there from now on. No read or write may be in progress,
+    and the caller must hold the mutexes of the VIOs, which are not
+    carried over. On success this connection is closed without closing
+    the socket, and must not be used any more.
+
+    @param c continuation whose mutex the moved connection takes.
+    @param t the calling thread.
+    @return the connection on @a t, @c this if it already is on @a t,
+    or @c NULL if it could not be moved, in which case this connection
+    is left as it was.
+
+  */
+  virtual NetVConnection *migrate_to_current_thread(Continuation * c, EThread * t);
+
   ////////////////////////////////////////////////////////////
   // Set the timeouts associated with this connection.      //
   // active_timeout is for the total elasped time of        //
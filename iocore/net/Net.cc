@@ -111,6 +111,15 @@ register_net_stats()
   RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.net.inactivity_cop_lock_acquire_failure",
                      RECD_INT, RECP_NULL, (int) inactivity_cop_lock_acquire_failure_stat,
                      RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.ssl.origin_session_cache.hit",
+                     RECD_INT, RECP_NULL, (int) ssl_origin_session_cache_hit_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.ssl.origin_session_cache.miss",
+                     RECD_INT, RECP_NULL, (int) ssl_origin_session_cache_miss_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.ssl.origin_session_reused",
+                     RECD_INT, RECP_NULL, (int) ssl_origin_session_reused_stat, RecRawStatSyncSum);
 }
 
 void
@@ -44,3 +44,15 @@ NetVConnection::cancel_OOB()
   return;
 }
 
+bool
+NetVConnection::splice_to(NetVConnection *)
+{
+  return false;
+}
+
+NetVConnection *
+NetVConnection::migrate_to_current_thread(Continuation *, EThread *)
+{
+  return NULL;
+}
+
@@ -51,6 +51,9 @@ enum Net_Stats
   socks_connections_unsuccessful_stat,
   socks_connections_currently_open_stat,
   inactivity_cop_lock_acquire_failure_stat,
+  ssl_origin_session_cache_hit_stat,
+  ssl_origin_session_cache_miss_stat,
+  ssl_origin_session_reused_stat,
   Net_Stat_Count
 };
 
@@ -108,6 +111,7 @@ do { \
 #include "P_SSLNetProcessor.h"
 #include "P_SSLNetAccept.h"
 #include "P_SSLCertLookup.h"
+#include "P_SSLSessionCache.h"
 
 #undef  NET_SYSTEM_MODULE_VERSION
 #define NET_SYSTEM_MODULE_VERSION makeModuleVersion(                    \
@@ -96,6 +96,7 @@ struct NetAccept:public Continuation
   uint32_t sockopt_flags;
   uint32_t packet_mark;
   uint32_t packet_tos;
+  int defer_accept; ///< TCP_DEFER_ACCEPT timeout of the listen socket, 0 if not set.
   EventType etype;
   UnixNetVConnection *epoll_vc; // only storage for epoll events
   EventIO ep;
@@ -113,6 +114,7 @@ struct NetAccept:public Continuation
   virtual void init_accept_per_thread();
   // 0 == success
   int do_listen(bool non_blocking, bool transparent = false);
+  int do_reuseport_listen(NetAccept *a);
 
   int do_blocking_accept(EThread * t);
   virtual int acceptEvent(int event, void *e);
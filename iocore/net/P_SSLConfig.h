@@ -67,6 +67,9 @@ struct SSLConfigParams : public ConfigInfo
   int     ssl_session_cache; // SSL_SESSION_CACHE_MODE
   int     ssl_session_cache_size;
   int     ssl_session_cache_timeout;
+  int     ssl_origin_session_cache;
+  int     ssl_origin_session_cache_size;
+  int     ssl_origin_session_cache_timeout;
 
   char *  clientCertPath;
   char *  clientKeyPath;
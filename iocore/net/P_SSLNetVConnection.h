@@ -89,6 +89,13 @@ public:
   int sslServerHandShakeEvent(int &err);
   int sslClientHandShakeEvent(int &err);
   virtual void net_read_io(NetHandler * nh, EThread * lthread);
+  // the data goes through SSL in user space
+  virtual bool splice_to(NetVConnection * /* target ATS_UNUSED */) { return false; }
+  // the SSL state is tied to the connection
+  virtual NetVConnection *migrate_to_current_thread(Continuation * /* c ATS_UNUSED */, EThread * /* t ATS_UNUSED */)
+  {
+    return NULL;
+  }
   virtual int64_t load_buffer_and_write(int64_t towrite, int64_t &wattempted, int64_t &total_wrote, MIOBufferAccessor & buf, int &needs);
   void registerNextProtocolSet(const SSLNextProtocolSet *);
 
@@ -118,6 +125,11 @@ private:
   bool sslClientConnection;
   const SSLNextProtocolSet * npnSet;
   Continuation * npnEndpoint;
+
+  // key of this origin in ssl_origin_session_cache, and whether a cached
+  // session was offered to it
+  INK_MD5 originSessionKey;
+  bool originSessionOffered;
 };
 
 typedef int (SSLNetVConnection::*SSLNetVConnHandler) (int, void *);
@@ -0,0 +1,87 @@
+/** @file
+
+  Client side (origin) SSL session cache
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef __P_SSLSESSIONCACHE_H__
+#define __P_SSLSESSIONCACHE_H__
+
+#include "libts.h"
+#include "P_EventSystem.h"
+#include <openssl/ssl.h>
+
+/**
+   Cache of the SSL sessions negotiated with origin servers.
+
+   Sessions are keyed by the origin address, port and SNI server name, and
+   are offered to the origin on the next connection to it so that the
+   handshake can be abbreviated.  The cache is split into stripes, each with
+   its own mutex and a small fixed number of slots, so that net threads only
+   contend when their origins hash to the same stripe.  The stripe locks are
+   only ever tried; on contention the lookup is treated as a miss and the
+   store is dropped, so a net thread never blocks on the cache.
+*/
+struct SSLOriginSessionCache
+{
+  SSLOriginSessionCache();
+  ~SSLOriginSessionCache();
+
+  /// Sizes the cache for @a nentries sessions kept for at most @a timeout seconds.
+  void init(int nentries, int timeout);
+  bool enabled() const { return stripes != NULL; }
+
+  /// Computes the key of the origin at @a addr with server name @a sni (may be NULL).
+  static void make_key(INK_MD5 &key, sockaddr const *addr, const char *sni);
+
+  /// Attaches the session cached for @a key to @a ssl.  Returns false on a miss.
+  bool get(const INK_MD5 &key, SSL *ssl, EThread *t);
+  /// Stores the session negotiated by @a ssl under @a key.
+  void put(const INK_MD5 &key, SSL *ssl, EThread *t);
+  /// Drops the session cached for @a key, e.g. after a failed resumption.
+  void remove(const INK_MD5 &key, EThread *t);
+
+  // private
+  struct Entry
+  {
+    INK_MD5 key;
+    SSL_SESSION *session;
+    ink_hrtime expire;
+    ink_hrtime last_used;
+  };
+
+  struct Stripe
+  {
+    Ptr<ProxyMutex> mutex;
+    Entry *entries;
+  };
+
+  Stripe *stripe(const INK_MD5 &key) { return &stripes[key[1] & (nstripes - 1)]; }
+  Entry *find(Stripe *s, const INK_MD5 &key, ink_hrtime now);
+
+  Stripe *stripes;
+  int nstripes;
+  int stripe_size;
+  ink_hrtime timeout;
+};
+
+extern SSLOriginSessionCache ssl_origin_session_cache;
+
+#endif /* __P_SSLSESSIONCACHE_H__ */
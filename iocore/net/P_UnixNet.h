@@ -196,6 +196,10 @@ public:
   time_t sec;
   int cycles;
 
+  // per thread accept counter, see net_count_thread_accept()
+  RecRawStatBlock *accept_rsb;
+  int accept_stat_id;
+
   int startNetEvent(int event, Event * data);
   int mainNetEvent(int event, Event * data);
   int mainNetEventExt(int event, Event * data);
@@ -209,6 +213,16 @@ get_NetHandler(EThread * t)
 {
   return (NetHandler *) ETHREAD_GET_PTR(t, unix_netProcessor.netHandler_offset);
 }
+// Counts a connection accepted on thread @a t.  Threads without a NetHandler
+// have zeroed thread private data, so they have no accept_rsb.
+static inline void
+net_count_thread_accept(EThread * t)
+{
+  NetHandler *nh = get_NetHandler(t);
+  if (nh->accept_rsb)
+    RecIncrRawStatSum(nh->accept_rsb, t, nh->accept_stat_id, 1);
+}
+
 static inline PollCont *
 get_PollCont(EThread * t)
 {
@@ -603,7 +617,10 @@ TS_INLINE int EventIO::stop() {
     struct epoll_event ev;
     memset(&ev, 0, sizeof(struct epoll_event));
     ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
-    return epoll_ctl(event_loop->epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+    // forget the loop, a second stop() could remove a reused fd
+    int retval = epoll_ctl(event_loop->epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+    event_loop = 0;
+    return retval;
 #endif
 #if TS_USE_PORT
     int retval = port_dissociate(event_loop->port_fd, PORT_SOURCE_FD, fd);
@@ -96,6 +96,33 @@ struct OOB_callback:public Continuation
   }
 };
 
+/**
+  Pipe that carries the data of a spliced pair of connections.
+
+  It is shared by the connection that splices the data it reads into
+  the pipe and the connection that splices it out to its socket. Both
+  only touch it with their VIO mutex held, which for a tunnel is the
+  same mutex.
+*/
+struct NetSplicePipe:public RefCountObj
+{
+  int fd[2];
+  int64_t size;                 ///< Capacity of the pipe.
+  int64_t avail;                ///< Bytes in the pipe.
+
+  int64_t space() const { return size - avail; }
+  /// Moves up to @a len bytes from @a from into the pipe, result is the number of bytes or -errno.
+  int64_t fill(int from, int64_t len);
+  /// Moves up to @a len bytes from the pipe to @a to, result is the number of bytes or -errno.
+  int64_t drain(int to, int64_t len);
+
+  /// Returns a new pipe, or @c NULL if the system does not support splicing or is out of descriptors.
+  static NetSplicePipe *create();
+
+  NetSplicePipe();
+  virtual ~NetSplicePipe();
+};
+
 class UnixNetVConnection:public NetVConnection
 {
 public:
@@ -108,6 +135,9 @@ public:
   virtual Action *send_OOB(Continuation *cont, char *buf, int len);
   virtual void cancel_OOB();
 
+  virtual bool splice_to(NetVConnection *target);
+  virtual NetVConnection *migrate_to_current_thread(Continuation *c, EThread *t);
+
   virtual void setSSLHandshakeWantsRead(bool /* flag */) { return; }
   virtual bool getSSLHandshakeWantsRead() { return false; }
   virtual void setSSLHandshakeWantsWrite(bool /* flag */) { return; }
@@ -233,6 +263,8 @@ public:
   ink_hrtime submit_time;
   OOB_callback *oob_ptr;
   bool from_accept_thread;
+  Ptr<NetSplicePipe> read_pipe;   ///< Reads go to this pipe instead of the read buffer.
+  Ptr<NetSplicePipe> write_pipe;  ///< Writes take from this pipe once the write buffer is empty.
 
   int startEvent(int event, Event *e);
   int acceptEvent(int event, Event *e);
@@ -65,6 +65,9 @@ SSLConfigParams::SSLConfigParams()
   ssl_session_cache = SSL_SESSION_CACHE_MODE_SERVER;
   ssl_session_cache_size = 1024*20;
   ssl_session_cache_timeout = 0;
+  ssl_origin_session_cache = 1;
+  ssl_origin_session_cache_size = 2048;
+  ssl_origin_session_cache_timeout = 300;
 }
 
 SSLConfigParams::~SSLConfigParams()
@@ -211,6 +214,11 @@ SSLConfigParams::initialize()
   REC_ReadConfigInteger(ssl_session_cache_size, "proxy.config.ssl.session_cache.size");
   REC_ReadConfigInteger(ssl_session_cache_timeout, "proxy.config.ssl.session_cache.timeout");
 
+  // Origin (client side) SSL session cache configurations
+  REC_ReadConfigInteger(ssl_origin_session_cache, "proxy.config.ssl.origin_session_cache");
+  REC_ReadConfigInteger(ssl_origin_session_cache_size, "proxy.config.ssl.origin_session_cache.size");
+  REC_ReadConfigInteger(ssl_origin_session_cache_timeout, "proxy.config.ssl.origin_session_cache.timeout");
+
   // SSL record size
   REC_EstablishStaticConfigInt32(ssl_maxrecord, "proxy.config.ssl.max_record_size");
 
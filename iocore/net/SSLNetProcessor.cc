@@ -63,6 +63,8 @@ SSLNetProcessor::start(int number_of_ssl_threads, size_t stacksize)
   client_ctx = SSLInitClientContext(params);
   if (!client_ctx) {
     SSLError("Can't initialize the SSL client, HTTPS in remap rules will not function");
+  } else if (params->ssl_origin_session_cache) {
+    ssl_origin_session_cache.init(params->ssl_origin_session_cache_size, params->ssl_origin_session_cache_timeout);
   }
 
   if (number_of_ssl_threads < 1) {
@@ -436,7 +436,8 @@ SSLNetVConnection::SSLNetVConnection():
   sslHandShakeComplete(false),
   sslClientConnection(false),
   npnSet(NULL),
-  npnEndpoint(NULL)
+  npnEndpoint(NULL),
+  originSessionOffered(false)
 {
   ssl = NULL;
 }
@@ -467,6 +468,7 @@ SSLNetVConnection::free(EThread * t) {
   sslClientConnection = false;
   npnSet = NULL;
   npnEndpoint= NULL;
+  originSessionOffered = false;
 
   if (from_accept_thread) {
     sslNetVCAllocator.free(this);  
@@ -498,6 +500,19 @@ SSLNetVConnection::sslStartHandShake(int event, int &err)
     ink_assert(event == SSL_EVENT_CLIENT);
     if (this->ssl == NULL) {
       this->ssl = make_ssl_connection(ssl_NetProcessor.client_ctx, this);
+      if (this->ssl != NULL && ssl_origin_session_cache.enabled()) {
+        const char * servername = NULL;
+#if TS_USE_TLS_SNI
+        servername = SSL_get_servername(this->ssl, TLSEXT_NAMETYPE_host_name);
+#endif
+        SSLOriginSessionCache::make_key(originSessionKey, this->get_remote_addr(), servername);
+        originSessionOffered = ssl_origin_session_cache.get(originSessionKey, this->ssl, this_ethread());
+        if (originSessionOffered) {
+          NET_INCREMENT_DYN_STAT(ssl_origin_session_cache_hit_stat);
+        } else {
+          NET_INCREMENT_DYN_STAT(ssl_origin_session_cache_miss_stat);
+        }
+      }
     }
     ink_assert(event == SSL_EVENT_CLIENT);
     return (sslClientHandShakeEvent(err));
@@ -606,6 +621,15 @@ SSLNetVConnection::sslClientHandShakeEvent(int &err)
     X509_free(server_cert);
     sslHandShakeComplete = 1;
 
+    if (ssl_origin_session_cache.enabled()) {
+      if (SSL_session_reused(ssl)) {
+        Debug("ssl", "SSLNetVConnection::sslClientHandShakeEvent, resumed cached origin session");
+        NET_INCREMENT_DYN_STAT(ssl_origin_session_reused_stat);
+      } else {
+        ssl_origin_session_cache.put(originSessionKey, ssl, this_ethread());
+      }
+    }
+
     return EVENT_DONE;
 
   case SSL_ERROR_WANT_WRITE:
@@ -639,6 +663,10 @@ SSLNetVConnection::sslClientHandShakeEvent(int &err)
   default:
     err = errno;
     SSLError("sslClientHandShakeEvent");
+    // don't offer a session the origin may have choked on again
+    if (originSessionOffered) {
+      ssl_origin_session_cache.remove(originSessionKey, this_ethread());
+    }
     return EVENT_ERROR;
     break;
 
@@ -0,0 +1,167 @@
+/** @file
+
+  Client side (origin) SSL session cache
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "P_Net.h"
+#include "P_SSLSessionCache.h"
+
+#define SSL_ORIGIN_SESSION_CACHE_STRIPES      256
+#define SSL_ORIGIN_SESSION_CACHE_MIN_SLOTS    4
+
+SSLOriginSessionCache ssl_origin_session_cache;
+
+SSLOriginSessionCache::SSLOriginSessionCache()
+  : stripes(NULL), nstripes(0), stripe_size(0), timeout(0)
+{
+}
+
+SSLOriginSessionCache::~SSLOriginSessionCache()
+{
+  if (stripes) {
+    for (int i = 0; i < nstripes; i++) {
+      for (int j = 0; j < stripe_size; j++) {
+        if (stripes[i].entries[j].session)
+          SSL_SESSION_free(stripes[i].entries[j].session);
+      }
+      ats_free(stripes[i].entries);
+      stripes[i].mutex = NULL;
+    }
+    delete[] stripes;
+  }
+}
+
+void
+SSLOriginSessionCache::init(int nentries, int atimeout)
+{
+  ink_assert(stripes == NULL);
+  if (nentries <= 0)
+    return;
+
+  // Small caches get fewer stripes rather than stripes with a single slot,
+  // where two origins in the same stripe would keep evicting each other.
+  nstripes = SSL_ORIGIN_SESSION_CACHE_STRIPES;
+  while (nstripes > 1 && nentries / nstripes < SSL_ORIGIN_SESSION_CACHE_MIN_SLOTS)
+    nstripes /= 2;
+  stripe_size = (nentries + nstripes - 1) / nstripes;
+  timeout = HRTIME_SECONDS(atimeout);
+
+  stripes = new Stripe[nstripes];
+  for (int i = 0; i < nstripes; i++) {
+    stripes[i].mutex = new_ProxyMutex();
+    stripes[i].entries = (Entry *)ats_malloc(stripe_size * sizeof(Entry));
+    memset(stripes[i].entries, 0, stripe_size * sizeof(Entry));
+  }
+  Debug("ssl", "origin session cache of %d sessions in %d stripes, timeout %d seconds",
+        nstripes * stripe_size, nstripes, atimeout);
+}
+
+void
+SSLOriginSessionCache::make_key(INK_MD5 &key, sockaddr const *addr, const char *sni)
+{
+  char buf[INET6_ADDRPORTSTRLEN + TS_MAX_HOST_NAME_LEN + 1];
+  int len;
+
+  ats_ip_nptop(addr, buf, INET6_ADDRPORTSTRLEN);
+  len = strlen(buf);
+  if (sni)
+    len += snprintf(buf + len, sizeof(buf) - len, "/%s", sni);
+  key.encodeBuffer(buf, min(len, (int)sizeof(buf) - 1));
+}
+
+SSLOriginSessionCache::Entry *
+SSLOriginSessionCache::find(Stripe *s, const INK_MD5 &key, ink_hrtime now)
+{
+  for (int i = 0; i < stripe_size; i++) {
+    Entry *e = &s->entries[i];
+    if (e->session && e->key == key) {
+      if (e->expire > now)
+        return e;
+      SSL_SESSION_free(e->session);
+      e->session = NULL;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+bool
+SSLOriginSessionCache::get(const INK_MD5 &key, SSL *ssl, EThread *t)
+{
+  Stripe *s = stripe(key);
+  MUTEX_TRY_LOCK(lock, s->mutex, t);
+  if (!lock)
+    return false;
+
+  ink_hrtime now = ink_get_hrtime();
+  Entry *e = find(s, key, now);
+  if (!e)
+    return false;
+  e->last_used = now;
+  // SSL_set_session() takes its own reference, so the entry can be evicted
+  // while the connection still holds the session.
+  return SSL_set_session(ssl, e->session) == 1;
+}
+
+void
+SSLOriginSessionCache::put(const INK_MD5 &key, SSL *ssl, EThread *t)
+{
+  Stripe *s = stripe(key);
+  MUTEX_TRY_LOCK(lock, s->mutex, t);
+  if (!lock)
+    return;
+
+  SSL_SESSION *session = SSL_get1_session(ssl);
+  if (!session)
+    return;
+
+  ink_hrtime now = ink_get_hrtime();
+  Entry *e = find(s, key, now);
+  if (!e) {
+    // take a free slot, or else the least recently used one
+    e = &s->entries[0];
+    for (int i = 0; i < stripe_size && e->session; i++) {
+      if (!s->entries[i].session || s->entries[i].last_used < e->last_used)
+        e = &s->entries[i];
+    }
+  }
+  if (e->session)
+    SSL_SESSION_free(e->session);
+  e->key = key;
+  e->session = session;
+  e->expire = now + timeout;
+  e->last_used = now;
+}
+
+void
+SSLOriginSessionCache::remove(const INK_MD5 &key, EThread *t)
+{
+  Stripe *s = stripe(key);
+  MUTEX_TRY_LOCK(lock, s->mutex, t);
+  if (!lock)
+    return;
+
+  Entry *e = find(s, key, ink_get_hrtime());
+  if (e) {
+    SSL_SESSION_free(e->session);
+    e->session = NULL;
+  }
+}
@@ -220,7 +220,7 @@ initialize_thread_for_net(EThread *thread)
 
 // NetHandler method definitions
 
-NetHandler::NetHandler():Continuation(NULL), trigger_event(0)
+NetHandler::NetHandler():Continuation(NULL), trigger_event(0), accept_rsb(NULL), accept_stat_id(0)
 {
   SET_HANDLER((NetContHandler) & NetHandler::startNetEvent);
 }
@@ -116,6 +116,7 @@ net_accept(NetAccept * na, void *ep, bool blockable)
     }
     count++;
     na->alloc_cache = NULL;
+    net_count_thread_accept(e->ethread);
 
     vc->submit_time = ink_get_hrtime();
     ats_ip_copy(&vc->server_addr, &vc->con.addr);
@@ -226,6 +227,14 @@ NetAccept::init_accept_per_thread()
     if (i < n - 1) {
       a = NEW(new NetAccept);
       *a = *this;
+      if (server.f_reuseport) {
+        if (do_reuseport_listen(a)) {
+          delete a;
+          continue;
+        }
+        // counted down again when this listener closes its own socket
+        NET_SUM_GLOBAL_DYN_STAT(net_accepts_currently_open_stat, 1);
+      }
     } else
       a = this;
     EThread *t = eventProcessor.eventthread[ET_NET][i];
@@ -254,6 +263,25 @@ NetAccept::do_listen(bool non_blocking, bool transparent)
     if ((res = server.listen(non_blocking, recv_bufsize, send_bufsize, transparent)))
       Warning("unable to listen on port %d: %d %d, %s", ntohs(server.accept_addr.port()), res, errno, strerror(errno));
   }
+  if (!res) {
+#ifdef TCP_DEFER_ACCEPT
+    // set tcp defer accept timeout if it is configured, this will not trigger an accept until there is
+    // data on the socket ready to be read
+    if (defer_accept > 0) {
+      setsockopt(server.fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer_accept, sizeof(int));
+    }
+#endif
+#ifdef TCP_INIT_CWND
+    int tcp_init_cwnd = 0;
+    REC_ReadConfigInteger(tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
+    if (tcp_init_cwnd > 0) {
+      Debug("net", "Setting initial congestion window to %d", tcp_init_cwnd);
+      if (setsockopt(server.fd, IPPROTO_TCP, TCP_INIT_CWND, &tcp_init_cwnd, sizeof(int)) != 0) {
+        Error("Cannot set initial congestion window to %d", tcp_init_cwnd);
+      }
+    }
+#endif
+  }
   if (callback_on_open && !action_->cancelled) {
     if (res)
       action_->continuation->handleEvent(NET_EVENT_ACCEPT_FAILED, this);
@@ -265,6 +293,25 @@ NetAccept::do_listen(bool non_blocking, bool transparent)
 }
 
 
+//
+// Give a per thread copy of a SO_REUSEPORT listener its own socket bound
+// to the same address, so that the kernel spreads the incoming connections
+// over the threads instead of waking all of them on one shared socket.
+//
+int
+NetAccept::do_reuseport_listen(NetAccept *a)
+{
+  int res;
+
+  a->server.fd = NO_FD;
+  a->callback_on_open = false; // only the first listener reports to the acceptor
+  if ((res = a->do_listen(NON_BLOCKING, server.f_inbound_transparent)))
+    Warning("unable to open a SO_REUSEPORT listener on port %d, the port will be served by fewer threads",
+            ats_ip_port_host_order(&server.accept_addr));
+  return res;
+}
+
+
 int
 NetAccept::do_blocking_accept(EThread * t)
 {
@@ -388,6 +435,16 @@ NetAccept::acceptFastEvent(int event, void *ep)
   UnixNetVConnection *vc = NULL;
   int loop = accept_till_done;
 
+  // Cancelling the accept action only closes the first listener, the
+  // other SO_REUSEPORT listeners close their own sockets.
+  if (unlikely(action_->cancelled) && server.f_reuseport && server.fd != NO_FD) {
+    server.close();
+    e->cancel();
+    NET_DECREMENT_DYN_STAT(net_accepts_currently_open_stat);
+    delete this;
+    return EVENT_DONE;
+  }
+
   do {
     if (!backdoor && check_net_throttle(ACCEPT, ink_get_hrtime())) {
       ifd = -1;
@@ -466,6 +523,7 @@ NetAccept::acceptFastEvent(int event, void *ep)
       goto Lerror;
     }
     vc->con.fd = fd;
+    net_count_thread_accept(e->ethread);
 
     NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
     vc->id = net_next_connection_number();
@@ -548,6 +606,7 @@ NetAccept::NetAccept()
     sockopt_flags(0),
     packet_mark(0),
     packet_tos(0),
+    defer_accept(0),
     etype(0)
 { }
 
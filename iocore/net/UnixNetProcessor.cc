@@ -89,6 +89,7 @@ UnixNetProcessor::accept_internal(Continuation *cont, int fd, AcceptOptions cons
   EThread *thread = this_ethread();
   ProxyMutex *mutex = thread->mutex;
   int accept_threads = opt.accept_threads; // might be changed.
+  int reuseport = 0;
   IpEndpoint accept_ip; // local binding address.
   char thr_name[MAX_THREAD_NAME_LENGTH];
 
@@ -99,6 +100,7 @@ UnixNetProcessor::accept_internal(Continuation *cont, int fd, AcceptOptions cons
   if (opt.accept_threads < 0) {
     REC_ReadConfigInteger(accept_threads, "proxy.config.accept_threads");
   }
+  REC_ReadConfigInteger(reuseport, "proxy.config.net.listen_reuseport");
 
   NET_INCREMENT_DYN_STAT(net_accepts_currently_open_stat);
 
@@ -127,6 +129,22 @@ UnixNetProcessor::accept_internal(Continuation *cont, int fd, AcceptOptions cons
   REC_ReadConfigInteger(should_filter_int, "proxy.config.net.defer_accept");
   if (should_filter_int > 0 && opt.etype == ET_NET)
     na->server.http_accept_filter = true;
+  na->defer_accept = should_filter_int;
+
+  // With SO_REUSEPORT every net thread listens on its own socket, which
+  // replaces both the accept threads and the shared listen socket.
+  if (reuseport && opt.frequent_accept) {
+#ifdef SO_REUSEPORT
+    if (fd == NO_FD) {
+      na->server.f_reuseport = true;
+      accept_threads = 0;
+    } else {
+      Warning("port %d was opened by traffic_manager, it can not use SO_REUSEPORT listeners", opt.local_port);
+    }
+#else
+    Warning("SO_REUSEPORT is not supported, port %d uses a shared listen socket", opt.local_port);
+#endif
+  }
 
   na->action_ = NEW(new NetAcceptAction());
   *na->action_ = cont;
@@ -164,23 +182,6 @@ UnixNetProcessor::accept_internal(Continuation *cont, int fd, AcceptOptions cons
   } else
     na->init_accept();
 
-#ifdef TCP_DEFER_ACCEPT
-  // set tcp defer accept timeout if it is configured, this will not trigger an accept until there is
-  // data on the socket ready to be read
-  if (should_filter_int > 0) {
-    setsockopt(na->server.fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &should_filter_int, sizeof(int));
-  }
-#endif
-#ifdef TCP_INIT_CWND
- int tcp_init_cwnd = 0;
- REC_ReadConfigInteger(tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
- if(tcp_init_cwnd > 0) {
-    Debug("net", "Setting initial congestion window to %d", tcp_init_cwnd);
-    if(setsockopt(na->server.fd, IPPROTO_TCP, TCP_INIT_CWND, &tcp_init_cwnd, sizeof(int)) != 0) {
-      Error("Cannot set initial congestion window to %d", tcp_init_cwnd);
-    }
- }
-#endif
   return na->action_;
 }
 
@@ -334,6 +335,13 @@ struct CheckConnect:public Continuation
       if (!action_.cancelled)
         action_.continuation->handleEvent(NET_EVENT_OPEN_FAILED, (void *) -ENET_CONNECT_TIMEOUT);
       break;
+    case VC_EVENT_ERROR:
+      // as when an SSL handshake fails
+      Debug("iocore_net_connect", "connect error");
+      vc->do_io_close();
+      if (!action_.cancelled)
+        action_.continuation->handleEvent(NET_EVENT_OPEN_FAILED, (void *) -ENET_CONNECT_FAILED);
+      break;
     default:
       ink_assert(!"unknown connect event");
       if (!action_.cancelled)
@@ -345,13 +353,15 @@ struct CheckConnect:public Continuation
     return EVENT_DONE;
   }
 
-  Action *connect_s(Continuation * cont, sockaddr const* target,
+  Action *connect_s(NetProcessor * processor, Continuation * cont, sockaddr const* target,
                     int _timeout, NetVCOptions * opt)
   {
     action_ = cont;
     timeout = HRTIME_SECONDS(_timeout);
     recursion++;
-    netProcessor.connect_re(this, target, opt);
+    // an SSL connection is open once its handshake is done, which is
+    // when it first becomes writable
+    processor->connect_re(this, target, opt);
     recursion--;
     if (connect_status != NET_EVENT_OPEN_FAILED)
       return &action_;
@@ -380,7 +390,7 @@ NetProcessor::connect_s(Continuation * cont, sockaddr const* target,
 {
   Debug("iocore_net_connect", "NetProcessor::connect_s called");
   CheckConnect *c = NEW(new CheckConnect(cont->mutex));
-  return c->connect_s(cont, target, timeout, opt);
+  return c->connect_s(this, cont, target, timeout, opt);
 }
 
 
@@ -408,6 +418,19 @@ UnixNetProcessor::start(int, size_t)
     initialize_thread_for_http_sessions(netthreads[i], i);
   }
 
+  // Per thread accept counters, to check how evenly new connections
+  // are spread over the threads.
+  RecRawStatBlock *accept_rsb = RecAllocateRawStatBlock(n_netthreads);
+  if (accept_rsb) {
+    char name[64];
+    for (int i = 0; i < n_netthreads; ++i) {
+      snprintf(name, sizeof(name), "proxy.process.%s.thread.%d.accepts", etype == ET_NET ? "net" : "ssl", i);
+      RecRegisterRawStat(accept_rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT, i, RecRawStatSyncSum);
+      get_NetHandler(netthreads[i])->accept_rsb = accept_rsb;
+      get_NetHandler(netthreads[i])->accept_stat_id = i;
+    }
+  }
+
   RecData d;
   d.rec_int = 0;
   change_net_connections_throttle(NULL, RECD_INT, d, NULL);
@@ -41,6 +41,75 @@ typedef struct iovec IOVec;
 // Global
 ClassAllocator<UnixNetVConnection> netVCAllocator("netVCAllocator");
 
+#define NET_SPLICE_PIPE_DEFAULT_SIZE 65536
+
+NetSplicePipe::NetSplicePipe()
+  : size(0), avail(0)
+{
+  fd[0] = fd[1] = NO_FD;
+}
+
+NetSplicePipe::~NetSplicePipe()
+{
+  if (fd[0] != NO_FD)
+    socketManager.close(fd[0]);
+  if (fd[1] != NO_FD)
+    socketManager.close(fd[1]);
+}
+
+NetSplicePipe *
+NetSplicePipe::create()
+{
+#ifdef SPLICE_F_MOVE
+  NetSplicePipe *p = new NetSplicePipe;
+
+  if (pipe2(p->fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+    Debug("iocore_net", "could not create a splice pipe: %s", strerror(errno));
+    p->fd[0] = p->fd[1] = NO_FD;
+    delete p;
+    return NULL;
+  }
+#ifdef F_GETPIPE_SZ
+  p->size = fcntl(p->fd[1], F_GETPIPE_SZ);
+#endif
+  if (p->size <= 0)
+    p->size = NET_SPLICE_PIPE_DEFAULT_SIZE;
+  return p;
+#else
+  return NULL;
+#endif
+}
+
+int64_t
+NetSplicePipe::fill(int from, int64_t len)
+{
+#ifdef SPLICE_F_MOVE
+  int64_t r = socketManager.splice(from, fd[1], len);
+  if (r > 0)
+    avail += r;
+  return r;
+#else
+  (void) from;
+  (void) len;
+  return -ENOTSUP;
+#endif
+}
+
+int64_t
+NetSplicePipe::drain(int to, int64_t len)
+{
+#ifdef SPLICE_F_MOVE
+  int64_t r = socketManager.splice(fd[0], to, len);
+  if (r > 0)
+    avail -= r;
+  return r;
+#else
+  (void) to;
+  (void) len;
+  return -ENOTSUP;
+#endif
+}
+
 //
 // Reschedule a UnixNetVConnection by moving it
 // onto or off of the ready_list
@@ -231,7 +300,9 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     read_disable(nh, vc);
     return;
   }
-  int64_t toread = buf.writer()->write_avail();
+  // spliced data goes to the pipe, the read buffer is left alone
+  NetSplicePipe *rpipe = vc->read_pipe;
+  int64_t toread = rpipe ? rpipe->space() : buf.writer()->write_avail();
   if (toread > ntodo)
     toread = ntodo;
 
@@ -239,7 +310,10 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
   int64_t rattempted = 0, total_read = 0;
   int niov = 0;
   IOVec tiovec[NET_MAX_IOV];
-  if (toread) {
+  if (toread && rpipe) {
+    r = rpipe->fill(vc->con.fd, toread);
+    NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_stat, 1);
+  } else if (toread) {
     IOBufferBlock *b = buf.writer()->first_write_block();
     do {
       niov = 0;
@@ -275,11 +349,20 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
       else
         r = total_read - rattempted + r;
     }
+  }
+  if (toread) {
     // check for errors
     if (r <= 0) {
 
       if (r == -EAGAIN || r == -ENOTCONN) {
         NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_nodata_stat, 1);
+        // A pipe holding partly filled pages can be full before its byte
+        // count says so.  The socket may still have data, so keep the
+        // trigger and wait for the writer to drain the pipe.
+        if (rpipe && rpipe->avail) {
+          read_disable(nh, vc);
+          return;
+        }
         vc->read.triggered = 0;
         nh->read_ready_list.remove(vc);
         return;
@@ -298,7 +381,8 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     NET_SUM_DYN_STAT(net_read_bytes_stat, r);
 
     // Add data to buffer and signal continuation.
-    buf.writer()->fill(r);
+    if (!rpipe)
+      buf.writer()->fill(r);
 #ifdef DEBUG
     if (buf.writer()->write_avail() <= 0)
       Debug("iocore_net", "read_from_net, read buffer full");
@@ -313,6 +397,7 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     // If there are no more bytes to read, signal read complete
     ink_assert(ntodo >= 0);
     if (s->vio.ntodo() <= 0) {
+      vc->read_pipe = NULL;     // the writer holds on to the rest
       read_signal_done(VC_EVENT_READ_COMPLETE, nh, vc);
       Debug("iocore_net", "read_from_net, read finished - signal done");
       return;
@@ -327,7 +412,9 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     }
   }
   // If here are is no more room, or nothing to do, disable the connection
-  if (s->vio.ntodo() <= 0 || !s->enabled || !buf.writer()->write_avail()) {
+  // (the callback may have ended the splice)
+  rpipe = vc->read_pipe;
+  if (s->vio.ntodo() <= 0 || !s->enabled || !(rpipe ? rpipe->space() > 0 : buf.writer()->write_avail())) {
     read_disable(nh, vc);
     return;
   }
@@ -336,6 +423,18 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
 }
 
 
+// Bytes ready to be written.  Spliced data was read after anything in
+// the write buffer, so the pipe is only drained once the buffer is empty.
+static inline int64_t
+write_ready(UnixNetVConnection *vc, MIOBufferAccessor & buf)
+{
+  int64_t n = buf.reader()->read_avail();
+
+  if (!n && vc->write_pipe)
+    n = vc->write_pipe->avail;
+  return n;
+}
+
 //
 // Write the data for a UnixNetVConnection.
 // Rescheduling the UnixNetVConnection when necessary.
@@ -412,7 +511,7 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
   ink_assert(buf.writer());
 
   // Calculate amount to write
-  int64_t towrite = buf.reader()->read_avail();
+  int64_t towrite = write_ready(vc, buf);
   if (towrite > ntodo)
     towrite = ntodo;
   int signalled = 0;
@@ -429,7 +528,7 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     }
     signalled = 1;
     // Recalculate amount to write
-    towrite = buf.reader()->read_avail();
+    towrite = write_ready(vc, buf);
     if (towrite > ntodo)
       towrite = ntodo;
   }
@@ -442,7 +541,13 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
 
   int64_t total_wrote = 0, wattempted = 0;
   int needs = 0;
-  int64_t r = vc->load_buffer_and_write(towrite, wattempted, total_wrote, buf, needs);
+  int64_t r;
+  NetSplicePipe *wpipe = buf.reader()->read_avail() ? NULL : (NetSplicePipe *) vc->write_pipe;
+  if (wpipe) {
+    r = wpipe->drain(vc->con.fd, towrite);
+    needs |= EVENTIO_WRITE;
+  } else
+    r = vc->load_buffer_and_write(towrite, wattempted, total_wrote, buf, needs);
 
   // if we have already moved some bytes successfully, summarize in r
   if (total_wrote != wattempted) {
@@ -479,15 +584,18 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     NET_SUM_DYN_STAT(net_write_bytes_stat, r);
 
     // Remove data from the buffer and signal continuation.
-    ink_assert(buf.reader()->read_avail() >= r);
-    buf.reader()->consume(r);
-    ink_assert(buf.reader()->read_avail() >= 0);
+    if (!wpipe) {
+      ink_assert(buf.reader()->read_avail() >= r);
+      buf.reader()->consume(r);
+      ink_assert(buf.reader()->read_avail() >= 0);
+    }
     s->vio.ndone += r;
 
     net_activity(vc, thread);
     // If there are no more bytes to write, signal write complete,
     ink_assert(ntodo >= 0);
     if (s->vio.ntodo() <= 0) {
+      vc->write_pipe = NULL;
       write_signal_done(VC_EVENT_WRITE_COMPLETE, nh, vc);
       return;
     } else if (!signalled) {
@@ -500,7 +608,7 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
         return;
       }
     }
-    if (!buf.reader()->read_avail()) {
+    if (!write_ready(vc, buf)) {
       write_disable(nh, vc);
       return;
     }
@@ -541,6 +649,7 @@ VIO *
 UnixNetVConnection::do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf)
 {
   ink_assert(!closed);
+  read_pipe = NULL;
   read.vio.op = VIO::READ;
   read.vio.mutex = c->mutex;
   read.vio._cont = c;
@@ -562,6 +671,7 @@ VIO *
 UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *reader, bool owner)
 {
   ink_assert(!closed);
+  write_pipe = NULL;
   write.vio.op = VIO::WRITE;
   write.vio.mutex = c->mutex;
   write.vio._cont = c;
@@ -650,6 +760,81 @@ OOB_callback::retry_OOB_send(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED
   return EVENT_DONE;
 }
 
+bool
+UnixNetVConnection::splice_to(NetVConnection *target)
+{
+  UnixNetVConnection *t = dynamic_cast<UnixNetVConnection *>(target);
+
+  // SSL connections have to see the data
+  if (!t || t == this || dynamic_cast<SSLNetVConnection *>(t))
+    return false;
+  if (read.vio.op != VIO::READ || t->write.vio.op != VIO::WRITE || read_pipe || t->write_pipe)
+    return false;
+  ink_assert(read.vio.mutex == t->write.vio.mutex);
+
+  NetSplicePipe *p = NetSplicePipe::create();
+  if (!p)
+    return false;
+  read_pipe = p;
+  t->write_pipe = p;
+  Debug("iocore_net", "splicing %d to %d through pipe %d/%d", con.fd, t->con.fd, p->fd[1], p->fd[0]);
+  return true;
+}
+
+NetVConnection *
+UnixNetVConnection::migrate_to_current_thread(Continuation *c, EThread *t)
+{
+  ink_assert(t == this_ethread());
+  NetHandler *to_nh = get_NetHandler(t);
+
+  if (nh == to_nh)
+    return this;
+  if (read_pipe || write_pipe || oob_ptr || closed)
+    return NULL;
+  MUTEX_TRY_LOCK(lock, to_nh->mutex, t);
+  if (!lock)
+    return NULL;
+
+  // The new connection counts as open until it is freed, like this one.
+  UnixNetVConnection *vc = THREAD_ALLOC_INIT(netVCAllocator, t);
+  NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
+  vc->con = con;
+  vc->thread = t;
+  vc->nh = to_nh;
+  if (vc->ep.start(get_PollDescriptor(t), vc, EVENTIO_READ|EVENTIO_WRITE) < 0) {
+    Debug("iocore_net", "migrate_to_current_thread : failed EventIO::start");
+    vc->con.fd = NO_FD;
+    vc->free(t);
+    return NULL;
+  }
+
+  // From here on the socket belongs to the new connection.  This one is
+  // closed by its own thread, which still may have it on its lists, and
+  // which no longer gets events for the socket.
+  ep.stop();
+  con.fd = NO_FD;
+
+  vc->mutex = c->mutex;
+  vc->id = id;
+  vc->submit_time = submit_time;
+  vc->options = options;
+  vc->flags = flags;
+  ats_ip_copy(&vc->server_addr, &server_addr);
+  ats_ip_copy(&vc->remote_addr, &remote_addr);
+  vc->got_remote_addr = got_remote_addr;
+  ats_ip_copy(&vc->local_addr, &local_addr);
+  vc->got_local_addr = got_local_addr;
+  SET_CONTINUATION_HANDLER(vc, (NetVConnHandler) & UnixNetVConnection::mainEvent);
+  to_nh->open_list.enqueue(vc);
+  vc->active_timeout_in = active_timeout_in;
+  if (inactivity_timeout_in)
+    vc->set_inactivity_timeout(inactivity_timeout_in);
+
+  Debug("iocore_net", "migrated fd %d from thread %p to thread %p", vc->con.fd, thread, t);
+  do_io_close();
+  return vc;
+}
+
 void
 UnixNetVConnection::cancel_OOB()
 {
@@ -1161,6 +1346,8 @@ UnixNetVConnection::free(EThread *t)
   write.triggered = 0;
   options.reset();
   closed = 0;
+  read_pipe = NULL;
+  write_pipe = NULL;
   ink_assert(!read.ready_link.prev && !read.ready_link.next);
   ink_assert(!read.enable_link.next);
   ink_assert(!write.ready_link.prev && !write.ready_link.next);
@@ -161,6 +161,41 @@ struct RecRawStatBlock
 };
 
 
+//-------------------------------------------------------------------------
+// RawHistogram Structures
+//-------------------------------------------------------------------------
+// Log-linear buckets as in HdrHistogram: the values below
+// 2^REC_HISTOGRAM_SUB_BITS get a bucket each, and every power of two
+// above that is split into 2^REC_HISTOGRAM_SUB_BITS buckets, so that a
+// bucket is never wider than 1/16th of the values it holds.  Values of
+// 2^REC_HISTOGRAM_MAX_BITS and over all go into the last bucket.
+#define REC_HISTOGRAM_SUB_BITS  4
+#define REC_HISTOGRAM_MAX_BITS  36
+#define REC_HISTOGRAM_BUCKETS   ((REC_HISTOGRAM_MAX_BITS - REC_HISTOGRAM_SUB_BITS + 1) << REC_HISTOGRAM_SUB_BITS)
+// number of raw-stat syncs the exported percentiles are computed over
+#define REC_HISTOGRAM_WINDOW    12
+
+struct RecRawHistogram
+{
+  int64_t buckets[REC_HISTOGRAM_BUCKETS];
+};
+
+struct RecRecord;
+
+// WARNING!  As with the RecRawStatBlock, don't touch the contents.
+struct RecRawHistogramBlock
+{
+  off_t ethr_hist_offset;       // thread local histogram storage
+  RecRawHistogram *window;      // totals at the last REC_HISTOGRAM_WINDOW syncs
+  int window_pos;
+  RecRecord **records;          // the exported records of each histogram
+  int num_hists;                // number of histograms in this block
+  int max_hists;                // maximum number of histograms for this block
+  RecRawHistogramBlock *next;
+  ink_mutex mutex;
+};
+
+
 //-------------------------------------------------------------------------
 // RecCore Callback Types
 //-------------------------------------------------------------------------
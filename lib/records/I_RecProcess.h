@@ -49,6 +49,22 @@ RecRawStatBlock *RecAllocateRawStatBlock(int num_stats);
 int RecRegisterRawStat(RecRawStatBlock * rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id, RecRawStatSyncCb sync_cb);
 
 
+//-------------------------------------------------------------------------
+// RawHistogram Registration
+//-------------------------------------------------------------------------
+// Each histogram is exported as the records <name>.p50, <name>.p90,
+// <name>.p99 and <name>.p999, holding those percentiles (in the unit the
+// values are recorded in) of the values recorded over the last
+// REC_HISTOGRAM_WINDOW raw-stat syncs, and <name>.count, the number of
+// values recorded over that window.
+RecRawHistogramBlock *RecAllocateRawHistogramBlock(int num_hists);
+int RecRegisterRawHistogram(RecRawHistogramBlock * rhb, RecT rec_type, const char *name, int id);
+
+// Returns the upper bound of the bucket holding the value at @a quantile
+// (0 to 1) of the values counted in @a hist, or 0 if there are none.
+int64_t RecRawHistogramPercentile(const RecRawHistogram * hist, double quantile);
+
+
 // RecRawStatRange* RecAllocateRawStatRange (int num_buckets);
 
 // int RecRegisterRawStatRange (RecRawStatRange *rsr,
@@ -159,4 +175,43 @@ RecIncrRawStatCount(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t in
   return REC_ERR_OKAY;
 }
 
+
+//-------------------------------------------------------------------------
+// RecRecordRawHistogram
+//-------------------------------------------------------------------------
+// Like the RecIncrRawStatXXX calls, recording only touches the calling
+// thread's copy of the histogram and doesn't need any atomics; the copies
+// are added up when the stats are synced.
+inline int
+raw_histogram_bucket(int64_t value)
+{
+  if (value < (1 << REC_HISTOGRAM_SUB_BITS)) {
+    return value < 0 ? 0 : (int) value;
+  }
+  int msb = 63 - __builtin_clzll((uint64_t) value);
+  if (msb >= REC_HISTOGRAM_MAX_BITS) {
+    return REC_HISTOGRAM_BUCKETS - 1;
+  }
+  return ((msb - REC_HISTOGRAM_SUB_BITS + 1) << REC_HISTOGRAM_SUB_BITS) +
+    (int) ((value >> (msb - REC_HISTOGRAM_SUB_BITS)) & ((1 << REC_HISTOGRAM_SUB_BITS) - 1));
+}
+
+inline RecRawHistogram *
+raw_histogram_get_tlp(RecRawHistogramBlock * rhb, int id, EThread * ethread)
+{
+  ink_assert((id >= 0) && (id < rhb->max_hists));
+  if (ethread == NULL) {
+    ethread = this_ethread();
+  }
+  return (((RecRawHistogram *) ((char *) (ethread) + rhb->ethr_hist_offset)) + id);
+}
+
+inline int
+RecRecordRawHistogram(RecRawHistogramBlock * rhb, EThread * ethread, int id, int64_t value)
+{
+  RecRawHistogram *tlp = raw_histogram_get_tlp(rhb, id, ethread);
+  tlp->buckets[raw_histogram_bucket(value)] += 1;
+  return REC_ERR_OKAY;
+}
+
 #endif /* !_I_REC_PROCESS_H_ */
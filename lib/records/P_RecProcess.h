@@ -41,4 +41,6 @@ int RecRegisterRawStatSyncCb(const char *name, RecRawStatSyncCb sync_cb, RecRawS
 
 int RecExecRawStatSyncCbs();
 
+int RecExecRawHistogramSyncs();
+
 #endif
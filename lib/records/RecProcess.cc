@@ -44,6 +44,7 @@ static int g_rec_remote_sync_interval_ms = REC_REMOTE_SYNC_INTERVAL_MS;
 static Event *raw_stat_sync_cont_event;
 static Event *config_update_cont_event;
 static Event *sync_cont_event;
+static RecRawHistogramBlock *g_rhb_list = NULL;
 
 //-------------------------------------------------------------------------
 // i_am_the_record_owner, only used for librecprocess.a
@@ -151,6 +152,34 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 }
 
 
+//-------------------------------------------------------------------------
+// raw_histogram_get_total
+//-------------------------------------------------------------------------
+static void
+raw_histogram_get_total(RecRawHistogramBlock *rhb, int id, RecRawHistogram *total)
+{
+  int i, j;
+  RecRawHistogram *tlp;
+
+  memset(total, 0, sizeof(RecRawHistogram));
+
+  // get thread local values
+  for (i = 0; i < eventProcessor.n_ethreads; i++) {
+    tlp = ((RecRawHistogram *) ((char *) (eventProcessor.all_ethreads[i]) + rhb->ethr_hist_offset)) + id;
+    for (j = 0; j < REC_HISTOGRAM_BUCKETS; j++) {
+      total->buckets[j] += tlp->buckets[j];
+    }
+  }
+
+  for (i = 0; i < eventProcessor.n_dthreads; i++) {
+    tlp = ((RecRawHistogram *) ((char *) (eventProcessor.all_dthreads[i]) + rhb->ethr_hist_offset)) + id;
+    for (j = 0; j < REC_HISTOGRAM_BUCKETS; j++) {
+      total->buckets[j] += tlp->buckets[j];
+    }
+  }
+}
+
+
 //-------------------------------------------------------------------------
 // raw_stat_sync_to_global
 //-------------------------------------------------------------------------
@@ -337,6 +366,7 @@ struct raw_stat_sync_cont: public Continuation
   int exec_callbacks(int event, Event *e)
   {
     RecExecRawStatSyncCbs();
+    RecExecRawHistogramSyncs();
     Debug("statsproc", "raw_stat_sync_cont() processed");
 
     return EVENT_CONT;
@@ -571,6 +601,130 @@ Ldone:
 }
 
 
+//-------------------------------------------------------------------------
+// RecAllocateRawHistogramBlock
+//-------------------------------------------------------------------------
+static const struct
+{
+  const char *suffix;
+  double quantile;              // < 0 for the count
+} raw_histogram_exports[] = {
+  { "p50", 0.5 },
+  { "p90", 0.9 },
+  { "p99", 0.99 },
+  { "p999", 0.999 },
+  { "count", -1 }
+};
+
+RecRawHistogramBlock *
+RecAllocateRawHistogramBlock(int num_hists)
+{
+  off_t ethr_hist_offset;
+  RecRawHistogramBlock *rhb;
+
+  // allocate thread-local histogram memory
+  if ((ethr_hist_offset = eventProcessor.allocate(num_hists * sizeof(RecRawHistogram))) == -1) {
+    return NULL;
+  }
+  // create the histogram-block structure
+  rhb = (RecRawHistogramBlock *)ats_malloc(sizeof(RecRawHistogramBlock));
+  memset(rhb, 0, sizeof(RecRawHistogramBlock));
+  rhb->ethr_hist_offset = ethr_hist_offset;
+  rhb->window = (RecRawHistogram *)ats_malloc(num_hists * REC_HISTOGRAM_WINDOW * sizeof(RecRawHistogram));
+  memset(rhb->window, 0, num_hists * REC_HISTOGRAM_WINDOW * sizeof(RecRawHistogram));
+  rhb->records = (RecRecord **)ats_malloc(num_hists * countof(raw_histogram_exports) * sizeof(RecRecord *));
+  memset(rhb->records, 0, num_hists * countof(raw_histogram_exports) * sizeof(RecRecord *));
+  rhb->num_hists = 0;
+  rhb->max_hists = num_hists;
+  ink_mutex_init(&(rhb->mutex), "histogram mutex");
+
+  // the raw-stat syncer walks the list without locking it
+  do {
+    rhb->next = g_rhb_list;
+  } while (!ink_atomic_cas(&g_rhb_list, rhb->next, rhb));
+  return rhb;
+}
+
+
+//-------------------------------------------------------------------------
+// RecRegisterRawHistogram
+//-------------------------------------------------------------------------
+int
+RecRegisterRawHistogram(RecRawHistogramBlock *rhb, RecT rec_type, const char *name, int id)
+{
+  Debug("stats", "RecRegisterRawHistogram(%s): rhb pointer:%p id:%d\n", name, rhb, id);
+
+  // check to see if we're good to proceed
+  ink_assert(id < rhb->max_hists);
+
+  RecRecord *r;
+  RecData data_default;
+  memset(&data_default, 0, sizeof(RecData));
+
+  for (unsigned i = 0; i < countof(raw_histogram_exports); i++) {
+    char export_name[1024];
+
+    snprintf(export_name, sizeof(export_name), "%s.%s", name, raw_histogram_exports[i].suffix);
+    if ((r = RecRegisterStat(rec_type, export_name, RECD_INT, data_default, RECP_NON_PERSISTENT)) == NULL) {
+      return REC_ERR_FAIL;
+    }
+    if (i_am_the_record_owner(r->rec_type)) {
+      r->sync_required = r->sync_required | REC_PEER_SYNC_REQUIRED;
+    } else {
+      send_register_message(r);
+    }
+    rhb->records[id * countof(raw_histogram_exports) + i] = r;
+  }
+
+  ink_mutex_acquire(&(rhb->mutex));
+  rhb->num_hists++;
+  ink_mutex_release(&(rhb->mutex));
+
+  return REC_ERR_OKAY;
+}
+
+
+//-------------------------------------------------------------------------
+// RecRawHistogramPercentile
+//-------------------------------------------------------------------------
+static int64_t
+raw_histogram_bucket_max(int bucket)
+{
+  if (bucket < (1 << REC_HISTOGRAM_SUB_BITS)) {
+    return bucket;
+  }
+  int shift = (bucket >> REC_HISTOGRAM_SUB_BITS) - 1;
+  int64_t low = ((int64_t) ((1 << REC_HISTOGRAM_SUB_BITS) + (bucket & ((1 << REC_HISTOGRAM_SUB_BITS) - 1)))) << shift;
+  return low + (((int64_t) 1) << shift) - 1;
+}
+
+int64_t
+RecRawHistogramPercentile(const RecRawHistogram *hist, double quantile)
+{
+  int64_t count = 0, seen = 0, rank;
+  int i;
+
+  for (i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+    count += hist->buckets[i];
+  }
+  if (count == 0) {
+    return 0;
+  }
+  // the nearest rank, allowing for the quantile not being exact
+  rank = (int64_t) ceil(quantile * count - 1e-9);
+  if (rank < 1) {
+    rank = 1;
+  }
+  for (i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  return raw_histogram_bucket_max(i < REC_HISTOGRAM_BUCKETS ? i : REC_HISTOGRAM_BUCKETS - 1);
+}
+
+
 //-------------------------------------------------------------------------
 // RecRawStatSync...
 //-------------------------------------------------------------------------
@@ -887,3 +1041,53 @@ RecExecRawStatSyncCbs()
 
   return REC_ERR_OKAY;
 }
+
+
+//-------------------------------------------------------------------------
+// RecExecRawHistogramSyncs
+//-------------------------------------------------------------------------
+// The thread local histograms only ever grow, so the values recorded over
+// the window are the current totals less the totals REC_HISTOGRAM_WINDOW
+// syncs ago, which are then replaced by the current ones.
+int
+RecExecRawHistogramSyncs()
+{
+  RecRawHistogram total, window;
+  const unsigned num_exports = countof(raw_histogram_exports);
+
+  for (RecRawHistogramBlock *rhb = g_rhb_list; rhb != NULL; rhb = rhb->next) {
+    ink_mutex_acquire(&(rhb->mutex));
+    for (int id = 0; id < rhb->max_hists; id++) {
+      RecRecord **records = rhb->records + id * num_exports;
+      RecRawHistogram *oldest = rhb->window + id * REC_HISTOGRAM_WINDOW + rhb->window_pos;
+      int64_t count = 0;
+
+      if (records[0] == NULL) {
+        continue;
+      }
+      raw_histogram_get_total(rhb, id, &total);
+      for (int i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+        window.buckets[i] = total.buckets[i] - oldest->buckets[i];
+        count += window.buckets[i];
+      }
+      memcpy(oldest, &total, sizeof(RecRawHistogram));
+
+      for (unsigned i = 0; i < num_exports; i++) {
+        RecRecord *r = records[i];
+
+        rec_mutex_acquire(&(r->lock));
+        if (raw_histogram_exports[i].quantile < 0) {
+          r->data.rec_int = count;
+        } else {
+          r->data.rec_int = RecRawHistogramPercentile(&window, raw_histogram_exports[i].quantile);
+        }
+        r->sync_required = REC_SYNC_REQUIRED;
+        rec_mutex_release(&(r->lock));
+      }
+    }
+    rhb->window_pos = (rhb->window_pos + 1) % REC_HISTOGRAM_WINDOW;
+    ink_mutex_release(&(rhb->mutex));
+  }
+
+  return REC_ERR_OKAY;
+}
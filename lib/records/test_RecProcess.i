@@ -539,6 +539,82 @@ Test03()
 
 }
 
+//-------------------------------------------------------------------------
+// Test04: RawHistogram Tests
+//
+// Checks the percentiles computed from a histogram filled in by hand,
+// then registers a histogram that a continuation records rand() % 1000
+// into every second, so that its exported percentiles
+// (proxy.process.test_histogram_a.p50 etc.) should settle around 500,
+// 900, 990 and 999, give or take a bucket.
+//-------------------------------------------------------------------------
+
+static RecRawHistogramBlock *g_rhb = NULL;
+
+#define PERCENTILE_TEST(hist, q, low, high, failures) \
+  do { \
+    int64_t v = RecRawHistogramPercentile(&hist, q); \
+    if (v >= low && v <= high) { \
+      printf("  percentile %g: %" PRId64 " PASS\n", q, v); \
+    } else { \
+      printf("  percentile %g: %" PRId64 " FAIL\n", q, v); \
+      failures++; \
+    } \
+  } while (0);
+
+struct RawHistogramCont:public Continuation
+{
+  RawHistogramCont(ProxyMutex * m):Continuation(m)
+  {
+    SET_HANDLER(&RawHistogramCont::dummy_function);
+  }
+  int dummy_function(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    for (int i = 0; i < 1000; i++) {
+      RecRecordRawHistogram(g_rhb, mutex->thread_holding, 0, rand() % 1000);
+    }
+    return 0;
+  }
+};
+
+void
+Test04()
+{
+  printf("[Test04: RawHistogram Test]\n");
+  int failures = 0;
+
+  // values 1 to 100000, each counted once
+  RecRawHistogram *hist = (RecRawHistogram *) ats_malloc(sizeof(RecRawHistogram));
+  memset(hist, 0, sizeof(RecRawHistogram));
+  for (int64_t v = 1; v <= 100000; v++) {
+    hist->buckets[raw_histogram_bucket(v)]++;
+  }
+  // a bucket is at most 1/16th wider than the values in it
+  PERCENTILE_TEST(*hist, 0.5, 50000, 53125, failures);
+  PERCENTILE_TEST(*hist, 0.99, 99000, 105187, failures);
+  PERCENTILE_TEST(*hist, 0.999, 99900, 106143, failures);
+  PERCENTILE_TEST(*hist, 1.0, 100000, 106250, failures);
+  // small values are exact
+  memset(hist, 0, sizeof(RecRawHistogram));
+  hist->buckets[raw_histogram_bucket(3)] = 99;
+  hist->buckets[raw_histogram_bucket(7)] = 1;
+  PERCENTILE_TEST(*hist, 0.99, 3, 3, failures);
+  PERCENTILE_TEST(*hist, 0.999, 7, 7, failures);
+  ats_free(hist);
+
+  if (failures == 0) {
+    printf("  SUMMARY: PASS\n");
+  } else {
+    printf("  SUMMARY: FAIL\n");
+  }
+
+  g_rhb = RecAllocateRawHistogramBlock(1);
+  RecRegisterRawHistogram(g_rhb, RECT_PROCESS, "proxy.process.test_histogram_a", 0);
+
+  RawHistogramCont *hc = new RawHistogramCont(new_ProxyMutex());
+  eventProcessor.schedule_every(hc, HRTIME_SECONDS(1), ET_CALL, EVENT_INTERVAL, NULL);
+}
+
 //-------------------------------------------------------------------------
 // DumpRecordHtCont
 //-------------------------------------------------------------------------
@@ -658,6 +734,7 @@ main(int argc, char **argv)
   Test01();
   Test02();
   Test03();
+  Test04();
   TreeTest02();
 
 
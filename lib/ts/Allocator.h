@@ -95,6 +95,31 @@ public:
     ink_freelist_init(&this->fl, name, element_size, chunk_size, alignment);
   }
 
+  /**
+    Keeps up to 2 * size freed blocks in each thread, so that a thread
+    mostly reuses its own blocks without touching the shared free list.
+    Call before other threads use the allocator.
+
+    @return false if the allocator can not have them.
+  */
+  bool
+  enable_magazine(unsigned int size)
+  {
+    return ink_freelist_magazine_init(this->fl, size) != 0;
+  }
+
+  /**
+    Splits the allocator into one pool per NUMA node, see
+    ink_freelist_numa_init. Call before other threads use the allocator.
+
+    @return false if the allocator can not be split.
+  */
+  bool
+  enable_numa()
+  {
+    return ink_freelist_numa_init(this->fl) != 0;
+  }
+
 protected:
   InkFreeList *fl;
 };
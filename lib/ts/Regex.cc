@@ -145,3 +145,302 @@ DFA::match(const char *str, int length) const
   return -1;
 }
 
+
+RegexPrefilter::RegexPrefilter()
+  : _states(NULL), _nstates(0), _states_size(0), _outputs(NULL), _noutputs(0), _outputs_size(0),
+    _always(NULL), _npatterns(0), _compiled(false)
+{
+  new_state(0); // root
+  for (int c = 0; c < 256; c++)
+    _root_next[c] = 0;
+}
+
+RegexPrefilter::~RegexPrefilter()
+{
+  ats_free(_states);
+  ats_free(_outputs);
+  ats_free(_always);
+}
+
+int
+RegexPrefilter::new_state(unsigned char c)
+{
+  if (_nstates == _states_size) {
+    _states_size = _states_size ? _states_size * 2 : 64;
+    _states = (State *)ats_realloc(_states, _states_size * sizeof(State));
+  }
+  State *s = &_states[_nstates];
+  s->first_child = 0;
+  s->next_sibling = 0;
+  s->fail = 0;
+  s->dict = 0;
+  s->out = -1;
+  s->c = c;
+  return _nstates++;
+}
+
+int
+RegexPrefilter::child(int state, unsigned char c) const
+{
+  if (state == 0)
+    return _root_next[c];
+  for (int s = _states[state].first_child; s; s = _states[s].next_sibling) {
+    if (_states[s].c == c)
+      return s;
+  }
+  return 0;
+}
+
+int
+RegexPrefilter::add(const char *pattern)
+{
+  char literal[256];
+  int id = _npatterns++;
+  int len = required_literal(pattern, literal, sizeof(literal));
+
+  _compiled = false;
+  if ((id & 7) == 0) {
+    _always = (unsigned char *)ats_realloc(_always, id / 8 + 1);
+    _always[id / 8] = 0;
+  }
+
+  if (len == 0) {
+    _always[id >> 3] |= 1 << (id & 7);
+    return id;
+  }
+
+  int state = 0;
+  for (int i = 0; i < len; i++) {
+    unsigned char c = (unsigned char)literal[i];
+    int next = child(state, c);
+    if (!next) {
+      next = new_state(c);
+      if (state == 0) {
+        _root_next[c] = next;
+      } else {
+        _states[next].next_sibling = _states[state].first_child;
+        _states[state].first_child = next;
+      }
+    }
+    state = next;
+  }
+
+  if (_noutputs == _outputs_size) {
+    _outputs_size = _outputs_size ? _outputs_size * 2 : 64;
+    _outputs = (Output *)ats_realloc(_outputs, _outputs_size * sizeof(Output));
+  }
+  _outputs[_noutputs].id = id;
+  _outputs[_noutputs].next = _states[state].out;
+  _states[state].out = _noutputs++;
+  return id;
+}
+
+void
+RegexPrefilter::compile()
+{
+  // Breadth first, so the fail state of a state is always done before it
+  int *queue = (int *)ats_malloc(_nstates * sizeof(int));
+  int head = 0, tail = 0;
+
+  for (int c = 0; c < 256; c++) {
+    if (_root_next[c]) {
+      _states[_root_next[c]].fail = 0;
+      _states[_root_next[c]].dict = 0;
+      queue[tail++] = _root_next[c];
+    }
+  }
+  while (head < tail) {
+    int state = queue[head++];
+    for (int s = _states[state].first_child; s; s = _states[s].next_sibling) {
+      int f = _states[state].fail;
+      while (f && !child(f, _states[s].c))
+        f = _states[f].fail;
+      f = child(f, _states[s].c);
+      _states[s].fail = f;
+      _states[s].dict = _states[f].out >= 0 ? f : _states[f].dict;
+      queue[tail++] = s;
+    }
+  }
+  ats_free(queue);
+  _compiled = true;
+}
+
+void
+RegexPrefilter::match(const char *str, int length, unsigned char *candidates) const
+{
+  int state = 0;
+
+  ink_assert(_compiled);
+  memcpy(candidates, _always, candidates_size());
+  for (int i = 0; i < length; i++) {
+    unsigned char c = (unsigned char)str[i];
+    int next;
+    while (!(next = child(state, c)) && state)
+      state = _states[state].fail;
+    state = next;
+    for (int s = _states[state].out >= 0 ? state : _states[state].dict; s; s = _states[s].dict) {
+      for (int o = _states[s].out; o >= 0; o = _outputs[o].next)
+        candidates[_outputs[o].id >> 3] |= 1 << (_outputs[o].id & 7);
+    }
+  }
+}
+
+// Skips the bracket expression starting at pattern[i], returns the index after it
+static int
+skip_bracket(const char *pattern, int i)
+{
+  i++;
+  if (pattern[i] == '^')
+    i++;
+  if (pattern[i] == ']')
+    i++;
+  while (pattern[i] && pattern[i] != ']') {
+    if (pattern[i] == '\\' && pattern[i + 1])
+      i++;
+    i++;
+  }
+  return pattern[i] ? i + 1 : -1;
+}
+
+// Skips the group starting at pattern[i], returns the index after it
+static int
+skip_group(const char *pattern, int i)
+{
+  int depth = 0;
+  while (pattern[i]) {
+    if (pattern[i] == '\\' && pattern[i + 1]) {
+      i += 2;
+    } else if (pattern[i] == '[') {
+      if ((i = skip_bracket(pattern, i)) < 0)
+        return -1;
+    } else {
+      if (pattern[i] == '(')
+        depth++;
+      else if (pattern[i] == ')' && --depth == 0)
+        return i + 1;
+      i++;
+    }
+  }
+  return -1;
+}
+
+int
+RegexPrefilter::required_literal(const char *pattern, char *buf, int bufsize)
+{
+  char run[256];
+  int run_len = 0, best_len = 0;
+  bool last_literal = false;    // the last atom was appended to run
+  int i = 0;
+
+  // Inline options could make the match case insensitive
+  if (strstr(pattern, "(?"))
+    return 0;
+  // A top level alternation has no required literal
+  while (pattern[i]) {
+    if (pattern[i] == '\\' && pattern[i + 1]) {
+      i += 2;
+    } else if (pattern[i] == '[') {
+      if ((i = skip_bracket(pattern, i)) < 0)
+        return 0;
+    } else if (pattern[i] == '(') {
+      if ((i = skip_group(pattern, i)) < 0)
+        return 0;
+    } else if (pattern[i] == '|') {
+      return 0;
+    } else {
+      i++;
+    }
+  }
+
+#define FLUSH_RUN() do { \
+    if (run_len > best_len) { \
+      best_len = min(run_len, bufsize - 1); \
+      memcpy(buf, run, best_len); \
+    } \
+    run_len = 0; \
+  } while (0)
+
+  i = 0;
+  while (pattern[i]) {
+    char c = pattern[i];
+    switch (c) {
+    case '\\':
+      // escapes taking arguments, and \Q...\E quoting, are not worth parsing
+      if (pattern[i + 1] && strchr("xcopPgkNQ0123456789", pattern[i + 1]))
+        return 0;
+      if (!pattern[i + 1] || ParseRules::is_alnum(pattern[i + 1])) {
+        // character class, back reference, anchor ...
+        FLUSH_RUN();
+        last_literal = false;
+        i += pattern[i + 1] ? 2 : 1;
+      } else {
+        if (run_len == (int)sizeof(run))
+          FLUSH_RUN();
+        run[run_len++] = pattern[i + 1];
+        last_literal = true;
+        i += 2;
+      }
+      break;
+    case '[':
+      FLUSH_RUN();
+      last_literal = false;
+      i = skip_bracket(pattern, i);
+      break;
+    case '(':
+      FLUSH_RUN();
+      last_literal = false;
+      i = skip_group(pattern, i);
+      break;
+    case '*':
+    case '?':
+    case '{':
+      // the previous atom is optional
+      if (last_literal && run_len > 0)
+        run_len--;
+      FLUSH_RUN();
+      last_literal = false;
+      if (c == '{') {
+        while (pattern[i] && pattern[i] != '}')
+          i++;
+      }
+      if (pattern[i])
+        i++;
+      // lazy or possessive quantifier
+      if (pattern[i] == '?' || pattern[i] == '+')
+        i++;
+      break;
+    case '+':
+      // the previous atom is required, but what follows may not be adjacent to it
+      FLUSH_RUN();
+      last_literal = false;
+      i++;
+      if (pattern[i] == '?' || pattern[i] == '+')
+        i++;
+      break;
+    case '.':
+    case '^':
+    case '$':
+    case ')':
+    case ']':
+    case '}':
+      FLUSH_RUN();
+      last_literal = false;
+      i++;
+      break;
+    default:
+      if (run_len == (int)sizeof(run))
+        FLUSH_RUN();
+      run[run_len++] = c;
+      last_literal = true;
+      i++;
+      break;
+    }
+  }
+  FLUSH_RUN();
+
+#undef FLUSH_RUN
+
+  if (best_len > 0)
+    buf[best_len] = '\0';
+  return best_len;
+}
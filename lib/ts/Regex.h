@@ -63,5 +63,84 @@ private:
   dfa_pattern * _my_patterns;
 };
 
+/**
+   Literal prefilter for a list of regular expressions.
+
+   Each pattern added is reduced to the longest literal string that every
+   match of it must contain.  The literals of all patterns are compiled into
+   one Aho-Corasick automaton, so a single pass over a subject string finds
+   every pattern that can possibly match it, and only those need to be run
+   through pcre_exec().  Patterns for which no literal can be extracted
+   (alternations, inline options, ...) always pass the filter.
+
+   Pattern ids are handed out in the order the patterns are added, so a
+   caller walking its patterns in order keeps first-match semantics.
+*/
+class RegexPrefilter
+{
+public:
+  RegexPrefilter();
+  ~RegexPrefilter();
+
+  /// Adds @a pattern and returns its id.  Invalidates a previous compile().
+  int add(const char *pattern);
+
+  /// Builds the automaton; must be called after the last add() and before match().
+  void compile();
+
+  bool compiled() const { return _compiled; }
+  int count() const { return _npatterns; }
+
+  /// Size in bytes of the candidate bitmap passed to match().
+  int candidates_size() const { return (_npatterns + 7) / 8; }
+
+  /// Sets the bit of every pattern that may match @a str in @a candidates.
+  void match(const char *str, int length, unsigned char *candidates) const;
+
+  static bool is_candidate(const unsigned char *candidates, int id)
+  {
+    return (candidates[id >> 3] & (1 << (id & 7))) != 0;
+  }
+
+  /// Copies the longest literal any match of @a pattern must contain into
+  /// @a buf and returns its length, or 0 if there is none.
+  static int required_literal(const char *pattern, char *buf, int bufsize);
+
+private:
+  struct State
+  {
+    int first_child;
+    int next_sibling;
+    int fail;                   // longest proper suffix which is also a trie state
+    int dict;                   // nearest state on the fail chain with outputs
+    int out;                    // head of this state's output list
+    unsigned char c;
+  };
+
+  struct Output
+  {
+    int id;
+    int next;
+  };
+
+  int child(int state, unsigned char c) const;
+  int new_state(unsigned char c);
+
+  State *_states;
+  int _nstates;
+  int _states_size;
+  Output *_outputs;
+  int _noutputs;
+  int _outputs_size;
+  int _root_next[256];
+  unsigned char *_always;       // bitmap of the patterns without a literal
+  int _npatterns;
+  bool _compiled;
+
+  // noncopyable
+  RegexPrefilter(const RegexPrefilter &);
+  RegexPrefilter & operator =(const RegexPrefilter &);
+};
+
 
 #endif /* __TS_REGEX_H__ */
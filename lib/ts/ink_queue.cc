@@ -43,9 +43,12 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <pthread.h>
 #include "ink_atomic.h"
 #include "ink_queue.h"
 #include "ink_memory.h"
+#include "ink_align.h"
+#include "ink_defs.h"
 #include "ink_error.h"
 #include "ink_assert.h"
 #include "ink_resource.h"
@@ -111,6 +114,12 @@ ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
   f->allocated = 0;
   f->allocated_base = 0;
   f->used_base = 0;
+  f->magazine_size = 0;
+  f->magazine_idx = 0;
+  f->magazines = NULL;
+  f->node = -1;
+  f->nodes = NULL;
+  f->remote_frees = 0;
   *fl = f;
 #endif
 }
@@ -131,6 +140,175 @@ ink_freelist_create(const char *name, uint32_t type_size, uint32_t chunk_size,
 int fake_global_for_ink_queue = 0;
 #endif
 
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+/*
+ * Per thread magazines.  A freelist with a magazine size keeps two
+ * chains of up to that many freed items in each thread, linked as on
+ * the freelist.  Allocations take from the loaded chain and frees add
+ * to it.  When it is full, the other chain goes back to the freelist in
+ * one push and the full one takes its place.
+ */
+#define MAX_FREELIST_MAGAZINES 256
+
+struct _InkFreeListMagazine
+{
+  void *head[2];                // [0] loaded, [1] full or empty
+  void *tail[2];
+  uint32_t count[2];
+  uint64_t allocs, local_allocs;        // by this thread
+  InkFreeList *f;
+  struct _InkFreeListMagazine *next;    // of the freelist
+};
+typedef struct _InkFreeListMagazine InkFreeListMagazine;
+
+static volatile uint32_t freelist_magazines = 0;
+static __thread InkFreeListMagazine *thread_magazines[MAX_FREELIST_MAGAZINES];
+static pthread_key_t thread_magazines_key;
+static pthread_once_t thread_magazines_once = PTHREAD_ONCE_INIT;
+
+static void freelist_free(InkFreeList * f, void *item);
+
+// Gives the items in the magazines of an exiting thread back to their
+// freelists, which would otherwise never see them again.
+static void
+freelist_magazines_flush(void *)
+{
+  for (uint32_t i = 0; i < MAX_FREELIST_MAGAZINES; i++) {
+    InkFreeListMagazine *m = thread_magazines[i];
+
+    if (!m)
+      continue;
+    for (int j = 0; j < 2; j++) {
+      if (m->count[j])
+        ink_freelist_free_bulk(m->f, m->head[j], m->tail[j], m->count[j]);
+      m->head[j] = m->tail[j] = NULL;
+      m->count[j] = 0;
+    }
+    thread_magazines[i] = NULL;
+  }
+}
+
+static void
+freelist_magazines_key_init()
+{
+  pthread_key_create(&thread_magazines_key, freelist_magazines_flush);
+}
+
+static inline InkFreeListMagazine *
+freelist_magazine(InkFreeList * f)
+{
+  InkFreeListMagazine *m = thread_magazines[f->magazine_idx];
+
+  if (unlikely(m == NULL)) {
+    m = (InkFreeListMagazine *)ats_calloc(1, sizeof(InkFreeListMagazine));
+    m->f = f;
+    // flushed when the thread exits, but kept for the stats
+    pthread_once(&thread_magazines_once, freelist_magazines_key_init);
+    pthread_setspecific(thread_magazines_key, thread_magazines);
+    do {
+      m->next = f->magazines;
+    } while (!ink_atomic_cas(&f->magazines, m->next, m));
+    thread_magazines[f->magazine_idx] = m;
+  }
+  return m;
+}
+
+static inline void
+freelist_magazine_rotate(InkFreeListMagazine * m)
+{
+  void *head = m->head[1], *tail = m->tail[1];
+  uint32_t count = m->count[1];
+
+  m->head[1] = m->head[0];
+  m->tail[1] = m->tail[0];
+  m->count[1] = m->count[0];
+  m->head[0] = head;
+  m->tail[0] = tail;
+  m->count[0] = count;
+}
+
+static inline void *
+freelist_magazine_pop(InkFreeList * f)
+{
+  InkFreeListMagazine *m = freelist_magazine(f);
+  void *item;
+
+  m->allocs++;
+  if (!m->count[0]) {
+    if (!m->count[1])
+      return NULL;
+    freelist_magazine_rotate(m);
+  }
+  item = m->head[0];
+  m->head[0] = TO_PTR(*ADDRESS_OF_NEXT(item, 0));
+  m->count[0]--;
+  m->local_allocs++;
+  return item;
+}
+
+static inline void
+freelist_magazine_push(InkFreeList * f, void *item)
+{
+  InkFreeListMagazine *m = freelist_magazine(f);
+
+  if (m->count[0] >= f->magazine_size) {
+    if (m->count[1]) {
+      ink_freelist_free_bulk(f, m->head[1], m->tail[1], m->count[1]);
+      m->head[1] = m->tail[1] = NULL;
+      m->count[1] = 0;
+    }
+    freelist_magazine_rotate(m);
+  }
+  if (!m->count[0])
+    m->tail[0] = item;
+  *ADDRESS_OF_NEXT(item, 0) = FROM_PTR(m->head[0]);
+  m->head[0] = item;
+  m->count[0]++;
+}
+
+/*
+ * NUMA node pools.  The chunks of the pool of each node come from a
+ * range of address space bound to that node, as large as all of memory,
+ * so that the pool of an item is known from its address.  The pools
+ * never give chunks back, so the ranges are only ever bumped.
+ */
+#define MAX_FREELIST_NODES 8
+
+static int freelist_nodes = 0;
+static char *freelist_node_memory = NULL;
+static int64_t freelist_node_size = 0;
+static volatile int64_t freelist_node_used[MAX_FREELIST_NODES];
+static __thread int thread_node = -1;
+
+static void *
+freelist_node_alloc(int node, uint32_t alignment, int64_t size)
+{
+  int64_t old, offset;
+  char *base = freelist_node_memory + node * freelist_node_size;
+
+  if (alignment < INK_MIN_ALIGN)
+    alignment = INK_MIN_ALIGN;
+  // the mapping is only page aligned, so align the address, not the offset
+  do {
+    old = freelist_node_used[node];
+    offset = (int64_t) INK_ALIGN((uintptr_t) base + old, (uintptr_t) alignment) - (int64_t) (uintptr_t) base;
+    if (offset + size > freelist_node_size)
+      ink_fatal(1, "ink_freelist_new: out of memory on NUMA node %d", node);
+  } while (!ink_atomic_cas(&freelist_node_used[node], old, offset + size));
+  return base + offset;
+}
+
+static inline InkFreeList *
+freelist_node_pool(InkFreeList * f, void *item)
+{
+  uint64_t offset = (uint64_t) ((char *) item - freelist_node_memory);
+
+  if (offset < (uint64_t) freelist_nodes * freelist_node_size)
+    return f->nodes[offset / freelist_node_size];
+  return f;
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
 int fastmemtotal = 0;
 void *
 ink_freelist_new(InkFreeList * f)
@@ -143,6 +321,15 @@ ink_freelist_new(InkFreeList * f)
   head_p next;
   int result = 0;
 
+  if (f->nodes && thread_node >= 0)
+    f = f->nodes[thread_node];
+
+  if (f->magazine_size) {
+    void *p = freelist_magazine_pop(f);
+    if (p)
+      return p;
+  }
+
   do {
     INK_QUEUE_LD(item, f->head);
     if (TO_PTR(FREELIST_POINTER(item)) == NULL) {
@@ -161,7 +348,9 @@ ink_freelist_new(InkFreeList * f)
 #ifdef DEBUG
       char *oldsbrk = (char *) sbrk(0), *newsbrk = NULL;
 #endif
-      if (f->alignment)
+      if (f->node >= 0)
+        newp = freelist_node_alloc(f->node, f->alignment, (int64_t) f->chunk_size * type_size);
+      else if (f->alignment)
         newp = ats_memalign(f->alignment, f->chunk_size * type_size);
       else
         newp = ats_malloc(f->chunk_size * type_size);
@@ -185,7 +374,7 @@ ink_freelist_new(InkFreeList * f)
         for (int j = 0; j < (int)type_size; j++)
           a[j] = str[j % 4];
 #endif
-        ink_freelist_free(f, a);
+        freelist_free(f, a);
 #ifdef MEMPROTECT
         if (f->type_size >= MEMPROTECT_SIZE) {
           a += type_size - page_size;
@@ -247,11 +436,6 @@ ink_freelist_free(InkFreeList * f, void *item)
 #if TS_USE_RECLAIMABLE_FREELIST
   return reclaimable_freelist_free(f, item);
 #else
-  volatile_void_p *adr_of_next = (volatile_void_p *) ADDRESS_OF_NEXT(item, 0);
-  head_p h;
-  head_p item_pair;
-  int result;
-
   // ink_assert(!((long)item&(f->alignment-1))); XXX - why is this no longer working? -bcall
 
 #ifdef DEADBEEF
@@ -264,6 +448,41 @@ ink_freelist_free(InkFreeList * f, void *item)
   }
 #endif /* DEADBEEF */
 
+  if (f->nodes) {
+    InkFreeList *pool = freelist_node_pool(f, item);
+
+    // only items of the pool this thread allocates from go to its magazine
+    if (pool != (thread_node >= 0 ? f->nodes[thread_node] : f)) {
+      if (pool->node >= 0 && thread_node >= 0)
+        ink_atomic_increment(&f->remote_frees, 1);
+      freelist_free(pool, item);
+      return;
+    }
+    f = pool;
+  }
+
+  if (f->magazine_size)
+    freelist_magazine_push(f, item);
+  else
+    freelist_free(f, item);
+#endif /* TS_USE_RECLAIMABLE_FREELIST */
+#else
+  if (f->alignment)
+    ats_memalign_free(item);
+  else
+    ats_free(item);
+#endif
+}
+
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+static void
+freelist_free(InkFreeList * f, void *item)
+{
+  volatile_void_p *adr_of_next = (volatile_void_p *) ADDRESS_OF_NEXT(item, 0);
+  head_p h;
+  head_p item_pair;
+  int result;
+
   result = 0;
   do {
     INK_QUEUE_LD(h, f->head);
@@ -289,12 +508,199 @@ ink_freelist_free(InkFreeList * f, void *item)
 
   ink_atomic_increment((int *) &f->used, -1);
   ink_atomic_increment(&fastalloc_mem_in_use, -(int64_t) f->type_size);
-#endif /* TS_USE_RECLAIMABLE_FREELIST */
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
+// Frees the num_item items from head to tail, linked through their first
+// word as on the freelist, with a single push.
+void
+ink_freelist_free_bulk(InkFreeList * f, void *head, void *tail, uint32_t num_item)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  volatile_void_p *adr_of_next = (volatile_void_p *) ADDRESS_OF_NEXT(tail, 0);
+  head_p h;
+  head_p item_pair;
+  int result = 0;
+
+  do {
+    INK_QUEUE_LD(h, f->head);
+    *adr_of_next = FREELIST_POINTER(h);
+    SET_FREELIST_POINTER_VERSION(item_pair, FROM_PTR(head), FREELIST_VERSION(h));
+    INK_MEMORY_BARRIER;
+#if TS_HAS_128BIT_CAS
+       result = ink_atomic_cas((__int128_t*) & f->head, h.data, item_pair.data);
 #else
-  if (f->alignment)
-    ats_memalign_free(item);
-  else
-    ats_free(item);
+       result = ink_atomic_cas((int64_t *) & f->head, h.data, item_pair.data);
+#endif
+  }
+  while (result == 0);
+
+  ink_atomic_increment((int *) &f->used, -(int) num_item);
+  ink_atomic_increment(&fastalloc_mem_in_use, -(int64_t) f->type_size * num_item);
+#else
+  void *item = head;
+  for (uint32_t i = 0; i < num_item; i++) {
+    void *next = TO_PTR(*ADDRESS_OF_NEXT(item, 0));
+    ink_freelist_free(f, item);
+    item = next;
+  }
+  (void) tail;
+#endif
+}
+
+int
+ink_freelist_magazine_init(InkFreeList * f, uint32_t size)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  uint32_t idx;
+
+  if (f->magazine_size || !size)
+    return f->magazine_size != 0;
+  if (f->nodes) {
+    for (int i = 0; i < freelist_nodes; i++)
+      if (!ink_freelist_magazine_init(f->nodes[i], size))
+        return 0;
+  }
+  idx = ink_atomic_increment(&freelist_magazines, 1);
+  if (idx >= MAX_FREELIST_MAGAZINES)
+    return 0;
+  f->magazine_idx = idx;
+  INK_MEMORY_BARRIER;
+  f->magazine_size = size;
+  return 1;
+#else
+  (void) f;
+  (void) size;
+  return 0;
+#endif
+}
+
+int
+ink_freelists_numa_init()
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST && TS_USE_HWLOC
+  hwloc_topology_t topology = ink_get_topology();
+  int nodes = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NODE);
+  int64_t size = (int64_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+  char *memory;
+
+  if (freelist_nodes || nodes < 2 || size <= 0)
+    return freelist_nodes;
+  if (nodes > MAX_FREELIST_NODES)
+    nodes = MAX_FREELIST_NODES;
+
+  // only address space until it is used, the pages land on the node as they are touched
+  memory = (char *) mmap(NULL, size * nodes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (memory == MAP_FAILED)
+    return 0;
+  for (int i = 0; i < nodes; i++) {
+    hwloc_obj_t obj = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NODE, i);
+    if (hwloc_set_area_membind(topology, memory + i * size, size, obj->cpuset, HWLOC_MEMBIND_BIND, 0) < 0) {
+      munmap(memory, size * nodes);
+      return 0;
+    }
+  }
+  return ink_freelists_numa_init_range(memory, size, nodes);
+#else
+  return 0;
+#endif
+}
+
+int
+ink_freelists_numa_init_range(void *memory, int64_t size, int nodes)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  if (freelist_nodes || nodes < 2 || nodes > MAX_FREELIST_NODES)
+    return freelist_nodes;
+  freelist_node_memory = (char *) memory;
+  freelist_node_size = size;
+  freelist_nodes = nodes;
+  return nodes;
+#else
+  (void) memory;
+  (void) size;
+  (void) nodes;
+  return 0;
+#endif
+}
+
+int
+ink_freelist_numa_init(InkFreeList * f)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  InkFreeList **nodes;
+
+  if (f->nodes)
+    return 1;
+  if (!freelist_nodes || f->node >= 0)
+    return 0;
+  nodes = (InkFreeList **)ats_malloc(freelist_nodes * sizeof(InkFreeList *));
+  for (int i = 0; i < freelist_nodes; i++) {
+    const char *name = f->name ? f->name : "<unknown>";
+    size_t len = strlen(name) + 16;
+    char *node_name = (char *)ats_malloc(len);
+
+    snprintf(node_name, len, "%s@node%d", name, i);
+    ink_freelist_init(&nodes[i], node_name, f->type_size, f->chunk_size, f->alignment);
+    nodes[i]->node = i;
+    if (f->magazine_size)
+      ink_freelist_magazine_init(nodes[i], f->magazine_size);
+  }
+  INK_MEMORY_BARRIER;
+  f->nodes = nodes;
+  return 1;
+#else
+  (void) f;
+  return 0;
+#endif
+}
+
+void
+ink_freelist_set_thread_node(int node)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  thread_node = node < freelist_nodes ? node : -1;
+#else
+  (void) node;
+#endif
+}
+
+int64_t
+ink_freelists_remote_frees()
+{
+  int64_t remote_frees = 0;
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  for (ink_freelist_list *fll = freelists; fll; fll = fll->next)
+    remote_frees += fll->fl->remote_frees;
+#endif
+  return remote_frees;
+}
+
+void
+ink_freelist_magazine_stats(InkFreeList * f, uint64_t * allocs, uint64_t * local_allocs)
+{
+  *allocs = *local_allocs = 0;
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  for (InkFreeListMagazine *m = f->magazines; m; m = m->next) {
+    *allocs += m->allocs;
+    *local_allocs += m->local_allocs;
+  }
+#else
+  (void) f;
+#endif
+}
+
+void
+ink_freelists_magazine_stats(uint64_t * allocs, uint64_t * local_allocs)
+{
+  *allocs = *local_allocs = 0;
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  for (ink_freelist_list *fll = freelists; fll; fll = fll->next) {
+    uint64_t a, l;
+    ink_freelist_magazine_stats(fll->fl, &a, &l);
+    *allocs += a;
+    *local_allocs += l;
+  }
 #endif
 }
 
@@ -360,6 +766,20 @@ ink_freelists_dump(FILE * f)
             (uint64_t)fll->fl->used * (uint64_t)fll->fl->type_size, fll->fl->type_size, fll->fl->name ? fll->fl->name : "<unknown>");
     fll = fll->next;
   }
+
+#if !TS_USE_RECLAIMABLE_FREELIST
+  // in-use above includes what the thread magazines hold
+  fprintf(f, "\n magazine |       allocations  |  local  |   free list name\n");
+  fprintf(f, "----------|--------------------|---------|----------------------------------\n");
+  for (fll = freelists; fll; fll = fll->next) {
+    uint64_t allocs, local_allocs;
+    if (!fll->fl->magazine_size)
+      continue;
+    ink_freelist_magazine_stats(fll->fl, &allocs, &local_allocs);
+    fprintf(f, " %8u | %18" PRIu64 " | %6.2f%% | memory/%s\n", fll->fl->magazine_size, allocs,
+            allocs ? 100.0 * local_allocs / allocs : 0.0, fll->fl->name ? fll->fl->name : "<unknown>");
+  }
+#endif
 #else // ! TS_USE_FREELIST
   // TODO?
 #endif
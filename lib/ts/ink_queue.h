@@ -152,12 +152,19 @@ extern "C"
   extern int64_t cfg_enable_reclaim;
   extern int64_t cfg_debug_filter;
 #else
+  struct _InkFreeListMagazine;
+
   struct _InkFreeList
   {
     volatile head_p head;
     const char *name;
     uint32_t type_size, chunk_size, used, allocated, alignment;
     uint32_t allocated_base, used_base;
+    uint32_t magazine_size, magazine_idx;       // per thread, if not 0, see ink_freelist_magazine_init
+    struct _InkFreeListMagazine *volatile magazines;
+    int node;                                   // of this pool, or -1
+    struct _InkFreeList **nodes;                // pools, if split, see ink_freelist_numa_init
+    volatile int64_t remote_frees;              // to the pool of another node
   };
 
   inkcoreapi extern volatile int64_t fastalloc_mem_in_use;
@@ -184,6 +191,35 @@ extern "C"
                                     uint32_t alignment);
   inkcoreapi void *ink_freelist_new(InkFreeList * f);
   inkcoreapi void ink_freelist_free(InkFreeList * f, void *item);
+  inkcoreapi void ink_freelist_free_bulk(InkFreeList * f, void *head, void *tail, uint32_t num_item);
+
+  /*
+   * Keeps up to 2 * size freed items of the freelist in each thread, to
+   * be allocated again by that thread without touching the shared list.
+   * Returns 0 if the freelist can not have them.  Can not be undone.
+   * The items in the magazines of a thread go back to the freelist when
+   * the thread exits.
+   */
+  inkcoreapi int ink_freelist_magazine_init(InkFreeList * f, uint32_t size);
+  void ink_freelist_magazine_stats(InkFreeList * f, uint64_t * allocs, uint64_t * local_allocs);
+  void ink_freelists_magazine_stats(uint64_t * allocs, uint64_t * local_allocs);
+
+  /*
+   * Splits a freelist into one pool per NUMA node, the chunks of each
+   * pool placed on its node.  A thread allocates from the pool of the
+   * node given by ink_freelist_set_thread_node, and items go back to the
+   * pool they came from.  ink_freelists_numa_init sets up the memory of
+   * the nodes once, and returns how many there are, or 0 if there is
+   * only one or it can not.  Then ink_freelist_numa_init splits a
+   * freelist, before other threads use it, and returns 0 if it can not.
+   * ink_freelists_numa_init_range sets up the nodes over given memory
+   * instead, @a size bytes for each, without binding it; for tests.
+   */
+  inkcoreapi int ink_freelists_numa_init();
+  int ink_freelists_numa_init_range(void *memory, int64_t size, int nodes);
+  inkcoreapi int ink_freelist_numa_init(InkFreeList * f);
+  inkcoreapi void ink_freelist_set_thread_node(int node);
+  int64_t ink_freelists_remote_frees();
   void ink_freelists_dump(FILE * f);
   void ink_freelists_dump_baselinerel(FILE * f);
   void ink_freelists_snap_baseline();
@@ -0,0 +1,228 @@
+/** @file
+
+  Tests and benchmark for the RegexPrefilter
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libts.h"
+#include "Regex.h"
+
+static int failures = 0;
+
+#define CHECK(_x) do { \
+    if (!(_x)) { \
+      fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #_x); \
+      failures++; \
+    } \
+  } while (0)
+
+static void
+check_literal(const char *pattern, const char *expected)
+{
+  char buf[256];
+  int len = RegexPrefilter::required_literal(pattern, buf, sizeof(buf));
+
+  if (expected == NULL) {
+    if (len != 0) {
+      fprintf(stderr, "FAILED: literal of [%s] is [%s], expected none\n", pattern, buf);
+      failures++;
+    }
+  } else if (len != (int)strlen(expected) || memcmp(buf, expected, len) != 0) {
+    fprintf(stderr, "FAILED: literal of [%s] is [%.*s], expected [%s]\n", pattern, len, buf, expected);
+    failures++;
+  }
+}
+
+static void
+test_required_literal()
+{
+  check_literal("www\\.example\\.com", "www.example.com");
+  check_literal("^(.*)\\.example\\.com$", ".example.com");
+  check_literal("^[a-z]+\\.cdn[0-9]\\.net$", ".cdn");
+  check_literal("img(s)?\\.foo\\.org", ".foo.org");
+  check_literal("abc*def", "def");
+  check_literal("abx?yz", "ab");
+  check_literal("ab{2,3}cdef", "cdef");
+  check_literal("abc+def", "abc");
+  check_literal("foo|bar", NULL);
+  check_literal("(?i)example", NULL);
+  check_literal("\\x41bcd", NULL);
+  check_literal(".*", NULL);
+  check_literal("\\d+\\.\\w+", ".");
+  check_literal("(a|b)\\.example\\.com", ".example.com");
+}
+
+// Compiles patterns, returns the number that compiled
+static int
+compile_patterns(const char **patterns, int n, pcre **re)
+{
+  const char *error;
+  int erroffset;
+
+  for (int i = 0; i < n; i++) {
+    re[i] = pcre_compile(patterns[i], 0, &error, &erroffset, NULL);
+    if (re[i] == NULL)
+      return i;
+  }
+  return n;
+}
+
+// The list walk of UrlRewrite::_regexMappingLookup
+static int
+first_match_walk(pcre **re, int n, const char *host, int len)
+{
+  int ovector[30];
+
+  for (int i = 0; i < n; i++) {
+    if (pcre_exec(re[i], NULL, host, len, 0, 0, ovector, 30) > 0)
+      return i;
+  }
+  return -1;
+}
+
+static int
+first_match_prefiltered(const RegexPrefilter &filter, pcre **re, int n, const char *host, int len,
+                        unsigned char *candidates)
+{
+  int ovector[30];
+
+  filter.match(host, len, candidates);
+  for (int i = 0; i < n; i++) {
+    if (RegexPrefilter::is_candidate(candidates, i) && pcre_exec(re[i], NULL, host, len, 0, 0, ovector, 30) > 0)
+      return i;
+  }
+  return -1;
+}
+
+static void
+test_first_match()
+{
+  static const char *patterns[] = {
+    "^www\\.example\\.com$",
+    "^(.*)\\.example\\.com$",
+    "^img[0-9]+\\.static\\.net$",
+    "^(foo|bar)\\.org$",
+    "^([a-z]+)\\.example\\.(com|net)$",
+    "cdn",
+    "^.*$"
+  };
+  static const char *hosts[] = {
+    "www.example.com", "a.example.com", "img12.static.net", "img.static.net", "bar.org", "x.example.net",
+    "mycdn.io", "nothing.at.all", ""
+  };
+  static const int npatterns = (int)countof(patterns);
+  pcre *re[npatterns];
+  RegexPrefilter filter;
+
+  CHECK(compile_patterns(patterns, npatterns, re) == npatterns);
+  for (int i = 0; i < npatterns; i++)
+    CHECK(filter.add(patterns[i]) == i);
+  filter.compile();
+
+  unsigned char *candidates = (unsigned char *)ats_malloc(filter.candidates_size());
+  for (unsigned i = 0; i < countof(hosts); i++) {
+    int len = strlen(hosts[i]);
+    int walk = first_match_walk(re, npatterns, hosts[i], len);
+    int filtered = first_match_prefiltered(filter, re, npatterns, hosts[i], len, candidates);
+    if (walk != filtered) {
+      fprintf(stderr, "FAILED: [%s] matched rule %d walking, %d prefiltered\n", hosts[i], walk, filtered);
+      failures++;
+    }
+  }
+  ats_free(candidates);
+  for (int i = 0; i < npatterns; i++)
+    pcre_free(re[i]);
+}
+
+// Compares the lookup cost of the list walk and of the prefiltered walk for
+// remap style host rules, for a miss and for a hit on the last rule.
+static void
+bench(int nrules)
+{
+  static const int LOOKUPS = 2000;
+  char **patterns = (char **)ats_malloc(nrules * sizeof(char *));
+  pcre **re = (pcre **)ats_malloc(nrules * sizeof(pcre *));
+  RegexPrefilter filter;
+  char buf[128];
+
+  for (int i = 0; i < nrules; i++) {
+    snprintf(buf, sizeof(buf), "^(.*)\\.site%d\\.example\\.com$", i);
+    patterns[i] = ats_strdup(buf);
+    filter.add(patterns[i]);
+  }
+  filter.compile();
+  if (compile_patterns((const char **)patterns, nrules, re) != nrules) {
+    fprintf(stderr, "FAILED: could not compile the benchmark rules\n");
+    failures++;
+    return;
+  }
+
+  unsigned char *candidates = (unsigned char *)ats_malloc(filter.candidates_size());
+  const char *miss = "www.unknown-site.example.org";
+  snprintf(buf, sizeof(buf), "www.site%d.example.com", nrules - 1);
+  const char *hosts[] = { miss, buf };
+
+  for (int h = 0; h < 2; h++) {
+    int len = strlen(hosts[h]);
+    int walk = 0, filtered = 0;
+
+    ink_hrtime start = ink_get_hrtime_internal();
+    for (int i = 0; i < LOOKUPS; i++)
+      walk = first_match_walk(re, nrules, hosts[h], len);
+    ink_hrtime walk_time = ink_get_hrtime_internal() - start;
+
+    start = ink_get_hrtime_internal();
+    for (int i = 0; i < LOOKUPS; i++)
+      filtered = first_match_prefiltered(filter, re, nrules, hosts[h], len, candidates);
+    ink_hrtime filtered_time = ink_get_hrtime_internal() - start;
+
+    CHECK(walk == filtered);
+    printf("%5d rules, %s: list walk %8.2f usec/lookup, prefiltered %8.2f usec/lookup\n", nrules,
+           h ? "hit on last rule" : "miss            ", (double)walk_time / LOOKUPS / HRTIME_USECOND,
+           (double)filtered_time / LOOKUPS / HRTIME_USECOND);
+  }
+
+  ats_free(candidates);
+  for (int i = 0; i < nrules; i++) {
+    pcre_free(re[i]);
+    ats_free(patterns[i]);
+  }
+  ats_free(re);
+  ats_free(patterns);
+}
+
+int
+main(int /* argc ATS_UNUSED */, char * /* argv ATS_UNUSED */[])
+{
+  test_required_literal();
+  test_first_match();
+  for (int nrules = 10; nrules <= 2560; nrules *= 4)
+    bench(nrules);
+
+  if (failures) {
+    printf("test_Regex: %d failures\n", failures);
+    return 1;
+  }
+  printf("test_Regex: all tests passed\n");
+  return 0;
+}
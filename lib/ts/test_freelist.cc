@@ -25,10 +25,12 @@
 #include <string.h>
 #include "ink_thread.h"
 #include "ink_queue.h"
+#include "ink_memory.h"
 
 
 #define NTHREADS 64
 InkFreeList *flist = NULL;
+InkFreeList *mlist = NULL;      // with thread magazines
 
 
 void *
@@ -60,6 +62,22 @@ test(void *d)
     ink_freelist_free(flist, m2);
     ink_freelist_free(flist, m3);
 
+    // more than fit in a thread magazine, so some go back in bulk
+    void *m[40];
+    for (int i = 0; i < 40; i++) {
+      m[i] = ink_freelist_new(mlist);
+      memset(m[i], id, 64);
+    }
+    for (int i = 0; i < 40; i++) {
+      for (int j = 0; j < 64; j++) {
+        if (((unsigned char *) m[i])[j] != (unsigned char) id) {
+          printf("0x%08" PRIx64 " also given to another thread\n", (uint64_t)(uintptr_t)m[i]);
+          exit(1);
+        }
+      }
+      ink_freelist_free(mlist, m[i]);
+    }
+
     // break out of the test if we have run more then 60 seconds
     if (++count % 1000 == 0 && (start + 60) < time(NULL)) {
       return NULL;
@@ -69,12 +87,114 @@ test(void *d)
 }
 
 
+static void *
+test_exit(void *d)
+{
+  InkFreeList *f = (InkFreeList *) d;
+  void *m[8];
+
+  for (int i = 0; i < 8; i++)
+    m[i] = ink_freelist_new(f);
+  for (int i = 0; i < 8; i++)
+    ink_freelist_free(f, m[i]);
+  return NULL;
+}
+
+// The items left in the magazine of a thread go back when it exits.
+static void
+test_magazine_exit()
+{
+  InkFreeList *f = ink_freelist_create("bark", 64, 16, 8);
+
+  ink_freelist_magazine_init(f, 16);
+  ink_thread_join(ink_thread_create(test_exit, f));
+  if (f->used) {
+    printf("magazine not flushed at thread exit, %u in use\n", f->used);
+    exit(1);
+  }
+}
+
+
+#define NODE_RANGE (1024 * 1024)
+
+static void
+check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("split pools: %s\n", what);
+    exit(1);
+  }
+}
+
+static bool
+in_node(char *memory, int node, void *item)
+{
+  return (char *) item >= memory + node * NODE_RANGE && (char *) item < memory + (node + 1) * NODE_RANGE;
+}
+
+// Routes frees of a freelist split over two fake NUMA node ranges, only
+// page aligned so that the chunks have to be aligned in them.
+static void
+test_split_pools()
+{
+  char *memory = (char *) ats_memalign(8192, 2 * NODE_RANGE + 8192) + 4096;
+  InkFreeList *f = ink_freelist_create("purr", 64, 16, 8);
+  InkFreeList *a = ink_freelist_create("hiss", 8192, 4, 8192);
+  void *m0, *m1, *m2, *p;
+
+  check(ink_freelists_numa_init_range(memory, NODE_RANGE, 2) == 2, "no nodes");
+  ink_freelist_magazine_init(f, 4);
+  check(ink_freelist_numa_init(f) && ink_freelist_numa_init(a), "not split");
+
+  ink_freelist_set_thread_node(0);
+  m0 = ink_freelist_new(f);
+  check(in_node(memory, 0, m0), "node 0 item not in its range");
+  p = ink_freelist_new(a);
+  check(in_node(memory, 0, p) && !((uintptr_t) p & 8191), "node 0 item not aligned");
+  ink_freelist_free(a, p);
+
+  ink_freelist_set_thread_node(1);
+  m1 = ink_freelist_new(f);
+  check(in_node(memory, 1, m1), "node 1 item not in its range");
+
+  // its own pool's item goes to the magazine, and comes back first
+  uint32_t used = f->nodes[1]->used;
+  ink_freelist_free(f, m1);
+  check(f->nodes[1]->used == used, "home item not in the magazine");
+  check(ink_freelist_new(f) == m1, "home item not reused");
+
+  // another node's item goes straight back to that node's pool
+  used = f->nodes[0]->used;
+  ink_freelist_free(f, m0);
+  check(f->remote_frees == 1, "remote free not counted");
+  check(f->nodes[0]->used == used - 1, "remote item not in its pool");
+  check(ink_freelist_new(f) != m0, "remote item in the magazine");
+
+  // items from outside the ranges go back to the freelist itself
+  ink_freelist_set_thread_node(-1);
+  m2 = ink_freelist_new(f);
+  check(!in_node(memory, 0, m2) && !in_node(memory, 1, m2), "unsplit item in a node range");
+  ink_freelist_set_thread_node(0);
+  check(ink_freelist_new(f) == m0, "remote item not back in its pool");
+  used = f->used;
+  ink_freelist_free(f, m2);
+  check(f->used == used - 1 && f->remote_frees == 1, "unsplit item not back in the freelist");
+
+  ink_freelist_set_thread_node(-1);
+}
+
+
 int
 main(int /* argc ATS_UNUSED */, char */*argv ATS_UNUSED */[])
 {
   int i;
 
+  test_magazine_exit();
+  test_split_pools();
+
   flist = ink_freelist_create("woof", 64, 256, 8);
+  mlist = ink_freelist_create("meow", 64, 256, 8);
+  ink_freelist_magazine_init(mlist, 16);
 
   for (i = 0; i < NTHREADS; i++) {
     fprintf(stderr, "Create thread %d\n", i);
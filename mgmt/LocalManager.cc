@@ -1065,6 +1065,16 @@ LocalManager::listenForProxy()
   if (!run_proxy)
     return;
 
+#ifdef SO_REUSEPORT
+  // Each traffic_server net thread binds its own SO_REUSEPORT socket, which
+  // the kernel would refuse while a socket bound here without it exists.
+  bool found;
+  if (REC_readInteger("proxy.config.net.listen_reuseport", &found) && found) {
+    mgmt_log(stderr, "[LocalManager::listenForProxy] Leaving the proxy ports to traffic_server SO_REUSEPORT listeners\n");
+    return;
+  }
+#endif
+
   // We are not already bound, bind the port
   for ( int i = 0, n = lmgmt->m_proxy_ports.length() ; i < n ; ++i ) {
     HttpProxyPort& p = lmgmt->m_proxy_ports[i];
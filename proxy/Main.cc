@@ -489,11 +489,11 @@ cmd_check_internal(char * /* cmd ATS_UNUSED */, bool fix = false)
   }
   printf("Host Database\n");
   HostDBCache hd;
-  if (hd.start(fix) < 0) {
+  if (hd.start(fix ? PROCESSOR_FIX : PROCESSOR_CHECK) < 0) {
     printf("\tunable to open Host Database, %s failed\n", n);
     return CMD_OK;
   }
-  res = hd.check("hostdb.config", fix) < 0 || res;
+  res = hd.check(fix) < 0 || res;
   hd.reset();
 
   if (cacheProcessor.start() < 0) {
@@ -1674,6 +1674,8 @@ static void *
 mgmt_restart_shutdown_callback(void *, char *, int /* data_len ATS_UNUSED */)
 {
   sync_cache_dir_on_shutdown();
+  if (hostdb_enable)
+    hostDBProcessor.cache()->sync_all();
   return NULL;
 }
 
@@ -34,6 +34,9 @@
 #define PARENT_ReadConfigInteger REC_ReadConfigInteger
 #define PARENT_ReadConfigStringAlloc REC_ReadConfigStringAlloc
 
+// Points on the consistent hash ring for a parent of weight 1.0
+#define PARENT_CHASH_POINTS_PER_WEIGHT 160
+
 typedef ControlMatcher<ParentRecord, ParentResult> P_table;
 
 // Global Vars for Parent Selection
@@ -58,7 +61,8 @@ static const char *ParentResultStr[] = {
 static const char *ParentRRStr[] = {
   "false",
   "strict",
-  "true"
+  "true",
+  "consistent_hash"
 };
 
 //
@@ -233,6 +237,7 @@ ParentConfigParams::findParent(HttpRequestData * rdata, ParentResult * result)
   // initialized, the code in FindParent can get into an infinite loop!
   result->start_parent = 0;
   result->last_parent = 0;
+  result->last_node = 0;
 
   // Check to see if the parent was set through the
   //   api
@@ -480,7 +485,6 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RequestData * r
 {
   Debug("cdn", "Entering FindParent (the inner loop)");
   int cur_index = 0;
-  bool parentUp = false;
   bool parentRetry = false;
   bool bypass_ok = (go_direct == true && config->DNS_ParentOnly == 0);
 
@@ -488,6 +492,11 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RequestData * r
 
   ink_assert(num_parents > 0 || go_direct == true);
 
+  if (round_robin == P_CONSISTENT_HASH && parents != NULL) {
+    FindConsistentHashParent(first_call, result, request_info, config);
+    return;
+  }
+
   if (first_call == true) {
     if (parents == NULL) {
       // We should only get into this state if
@@ -544,26 +553,7 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RequestData * r
   //   should be retried
   do {
     // DNS ParentOnly inhibits bypassing the parent so always return that t
-    if ((parents[cur_index].failedAt == 0) || (parents[cur_index].failCount < config->FailThreshold)) {
-      Debug("parent_select", "config->FailThreshold = %d", config->FailThreshold);
-      Debug("parent_select", "Selecting a down parent due to little failCount"
-            "(faileAt: %u failCount: %d)", (unsigned)parents[cur_index].failedAt, parents[cur_index].failCount);
-      parentUp = true;
-    } else {
-      if ((result->wrap_around) || ((parents[cur_index].failedAt + config->ParentRetryTime) < request_info->xact_start)) {
-        Debug("parent_select", "Parent[%d].failedAt = %u, retry = %u,xact_start = %" PRId64 " but wrap = %d", cur_index,
-              (unsigned)parents[cur_index].failedAt, config->ParentRetryTime, (int64_t)request_info->xact_start, result->wrap_around);
-        // Reuse the parent
-        parentUp = true;
-        parentRetry = true;
-        Debug("parent_select", "Parent marked for retry %s:%d", parents[cur_index].hostname, parents[cur_index].port);
-
-      } else {
-        parentUp = false;
-      }
-    }
-
-    if (parentUp == true) {
+    if (ParentAvailable(cur_index, result, request_info, config, &parentRetry) == true) {
       result->r = PARENT_SPECIFIED;
       result->hostname = parents[cur_index].hostname;
       result->port = parents[cur_index].port;
@@ -597,6 +587,176 @@ NO_PARENTS:
   result->port = 0;
 }
 
+// bool ParentRecord::ParentAvailable(int index, ParentResult* result,
+//                                    HttpRequestData* rdata, ParentConfigParams* config, bool* retry)
+//
+//    Returns true if the parent at index is up, or is down but
+//      should be retried in which case retry is set to true
+//
+bool
+ParentRecord::ParentAvailable(int index, ParentResult * result, HttpRequestData * rdata, ParentConfigParams * config,
+                              bool *retry)
+{
+  pRecord *pRec = parents + index;
+
+  *retry = false;
+  if ((pRec->failedAt == 0) || (pRec->failCount < config->FailThreshold)) {
+    Debug("parent_select", "config->FailThreshold = %d", config->FailThreshold);
+    Debug("parent_select", "Selecting a down parent due to little failCount"
+          "(faileAt: %u failCount: %d)", (unsigned)pRec->failedAt, pRec->failCount);
+    return true;
+  }
+  if ((result->wrap_around) || ((pRec->failedAt + config->ParentRetryTime) < rdata->xact_start)) {
+    Debug("parent_select", "Parent[%d].failedAt = %u, retry = %u,xact_start = %" PRId64 " but wrap = %d", index,
+          (unsigned)pRec->failedAt, config->ParentRetryTime, (int64_t)rdata->xact_start, result->wrap_around);
+    // Reuse the parent
+    *retry = true;
+    Debug("parent_select", "Parent marked for retry %s:%d", pRec->hostname, pRec->port);
+    return true;
+  }
+  return false;
+}
+
+// void ParentRecord::FindConsistentHashParent(bool first_call, ParentResult* result,
+//                                             HttpRequestData* rdata, ParentConfigParams* config)
+//
+//    Picks the parent owning the first ring node at or after the
+//      hash of the request URL.  When a parent is down, or on a call
+//      from nextParent, the ring is walked clockwise to the next
+//      parent not yet tried, so a failed parent's keys are spread
+//      over the ring instead of all moving to one neighbour
+//
+void
+ParentRecord::FindConsistentHashParent(bool first_call, ParentResult * result, HttpRequestData * rdata,
+                                       ParentConfigParams * config)
+{
+  bool bypass_ok = (go_direct == true && config->DNS_ParentOnly == 0);
+  bool parentRetry = false;
+  bool *tried = (bool *)alloca(num_parents * sizeof(bool));
+  uint32_t node;
+
+  memset(tried, 0, num_parents * sizeof(bool));
+
+  if (first_call == true) {
+    INK_MD5 md5;
+    uint32_t hash = 0;
+    int lo = 0, hi = chash_nodes;
+
+    if (rdata->hdr != NULL) {
+      rdata->hdr->url_get()->MD5_get(&md5);
+      hash = md5.word(0);
+    }
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (chash_ring[mid].hash < hash)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    node = result->start_parent = lo % chash_nodes;
+  } else {
+    // The parents already tried are the ones passed on the way
+    //   from the first choice to the last one
+    node = result->start_parent;
+    tried[chash_ring[node].parent] = true;
+    while (node != result->last_node) {
+      node = (node + 1) % chash_nodes;
+      tried[chash_ring[node].parent] = true;
+    }
+  }
+
+  for (;;) {
+    int cur_index = chash_ring[node].parent;
+
+    if (tried[cur_index] == false) {
+      tried[cur_index] = true;
+      if (ParentAvailable(cur_index, result, rdata, config, &parentRetry) == true) {
+        result->r = PARENT_SPECIFIED;
+        result->hostname = parents[cur_index].hostname;
+        result->port = parents[cur_index].port;
+        result->last_parent = cur_index;
+        result->last_node = node;
+        result->retry = parentRetry;
+        ink_assert(result->hostname != NULL);
+        ink_assert(result->port != 0);
+        Debug("parent_select", "Chosen parent = %s.%d (ring node %u)", result->hostname, result->port, node);
+        return;
+      }
+    }
+
+    node = (node + 1) % chash_nodes;
+    if (node == result->start_parent) {
+      // We've wrapped around so bypass if we can
+      if (bypass_ok == true)
+        break;
+      // Bypass disabled so keep trying, ignoring whether we think
+      //   a parent is down or not
+      result->wrap_around = true;
+      memset(tried, 0, num_parents * sizeof(bool));
+    }
+  }
+
+  // Could not find a parent
+  if (this->go_direct == true) {
+    result->r = PARENT_DIRECT;
+  } else {
+    result->r = PARENT_FAIL;
+  }
+
+  result->hostname = NULL;
+  result->port = 0;
+}
+
+static int
+chash_node_compare(const void *a, const void *b)
+{
+  const pChashNode *x = (const pChashNode *)a;
+  const pChashNode *y = (const pChashNode *)b;
+
+  if (x->hash != y->hash)
+    return x->hash < y->hash ? -1 : 1;
+  return x->parent - y->parent;
+}
+
+// void ParentRecord::BuildConsistentHash()
+//
+//    Builds the consistent hash ring.  Each parent is placed on the
+//      ring PARENT_CHASH_POINTS_PER_WEIGHT * weight times, ketama style,
+//      with the points derived from its hostname and port, so adding or
+//      removing a parent only moves the keys adjacent to its own points
+//
+void
+ParentRecord::BuildConsistentHash()
+{
+  char buf[MAXDNAME + 32];
+  INK_MD5 md5;
+  int n = 0;
+
+  ats_free(chash_ring);
+  chash_nodes = 0;
+  for (int i = 0; i < num_parents; i++) {
+    chash_nodes += max(1, (int)(parents[i].weight * PARENT_CHASH_POINTS_PER_WEIGHT));
+  }
+  chash_ring = (pChashNode *)ats_malloc(sizeof(pChashNode) * chash_nodes);
+
+  for (int i = 0; i < num_parents; i++) {
+    int points = max(1, (int)(parents[i].weight * PARENT_CHASH_POINTS_PER_WEIGHT));
+
+    // Each MD5 digest yields four points
+    for (int j = 0; j < points; j += 4) {
+      int len = snprintf(buf, sizeof(buf), "%s:%d-%d", parents[i].hostname, parents[i].port, j / 4);
+      md5.encodeBuffer(buf, len);
+      for (int k = 0; k < 4 && j + k < points; k++) {
+        chash_ring[n].hash = md5.word(k);
+        chash_ring[n].parent = i;
+        n++;
+      }
+    }
+  }
+  ink_assert(n == chash_nodes);
+  qsort(chash_ring, chash_nodes, sizeof(pChashNode), chash_node_compare);
+}
+
 // const char* ParentRecord::ProcessParents(char* val)
 //
 //   Reads in the value of a "round-robin" or "order"
@@ -613,6 +773,7 @@ ParentRecord::ProcessParents(char *val)
   int numTok;
   const char *current;
   int port;
+  float weight;
   char *tmp;
   const char *errPtr;
 
@@ -650,6 +811,17 @@ ParentRecord::ProcessParents(char *val)
     //   port
     char *scan = tmp + 1;
     for (; *scan != '\0' && ParseRules::is_digit(*scan); scan++);
+    // An optional weight for consistent hashing may follow the port
+    weight = 1.0;
+    if (*scan == '|') {
+      char *end;
+      weight = strtof(scan + 1, &end);
+      if (end == scan + 1 || weight <= 0) {
+        errPtr = "Malformed parent weight";
+        goto MERROR;
+      }
+      scan = end;
+    }
     for (; *scan != '\0' && ParseRules::is_wslfcr(*scan); scan++);
     if (*scan != '\0') {
       errPtr = "Garbage trailing entry or invalid separator";
@@ -670,6 +842,7 @@ ParentRecord::ProcessParents(char *val)
     this->parents[i].port = port;
     this->parents[i].failedAt = 0;
     this->parents[i].scheme = scheme;
+    this->parents[i].weight = weight;
   }
 
   num_parents = numTok;
@@ -755,6 +928,8 @@ ParentRecord::Init(matcher_line * line_info)
         round_robin = P_STRICT_ROUND_ROBIN;
       } else if (strcasecmp(val, "false") == 0) {
         round_robin = P_NO_ROUND_ROBIN;
+      } else if (strcasecmp(val, "consistent_hash") == 0) {
+        round_robin = P_CONSISTENT_HASH;
       } else {
         round_robin = P_NO_ROUND_ROBIN;
         errPtr = "invalid argument to round_robin directive";
@@ -792,6 +967,10 @@ ParentRecord::Init(matcher_line * line_info)
     snprintf(errBuf, errBufLen, "%s No parent specified in parent.config at line %d", modulePrefix, line_num);
     return errBuf;
   }
+
+  if (this->round_robin == P_CONSISTENT_HASH && this->parents != NULL) {
+    BuildConsistentHash();
+  }
   // Process any modifiers to the directive, if they exist
   if (line_info->num_el > 0) {
     tmp = ProcessModifiers(line_info);
@@ -834,6 +1013,7 @@ ParentRecord::UpdateMatch(ParentResult * result, RequestData * rdata)
 ParentRecord::~ParentRecord()
 {
   ats_free(parents);
+  ats_free(chash_ring);
 }
 
 void
@@ -1219,6 +1399,59 @@ EXCLUSIVE_REGRESSION_TEST(PARENTSELECTION) (RegressionTest * /* t ATS_UNUSED */,
       ink_assert(0);
     }
   }
+
+  // Test 173 - 177 consistent hashing
+  static const int CHASH_URLS = 1000;
+  char url[64];
+  char chash_first[CHASH_URLS][16];
+  int carrot = 0, potato = 0, turnip = 0, leek = 0, same = 0, moved = 0;
+
+  tbl[0] = '\0';
+  T("dest_domain=chash.net parent=carrot:80,potato:80,turnip:80|2.0,leek:80 round_robin=consistent_hash\n")
+    REBUILD
+    // Test 173 - a URL always maps to the same parent
+    ST(173)
+  for (c = 0; c < CHASH_URLS; c++) {
+    snprintf(url, sizeof(url), "http://www.chash.net/%d", c);
+    REINIT br(request, "www.chash.net");
+    request->hdr->url_set(url, strlen(url));
+    FP ink_strlcpy(chash_first[c], result->r == PARENT_SPECIFIED ? result->hostname : "", sizeof(chash_first[c]));
+    carrot += verify(result, PARENT_SPECIFIED, "carrot", 80);
+    potato += verify(result, PARENT_SPECIFIED, "potato", 80);
+    turnip += verify(result, PARENT_SPECIFIED, "turnip", 80);
+    leek += verify(result, PARENT_SPECIFIED, "leek", 80);
+    REINIT br(request, "www.chash.net");
+    request->hdr->url_set(url, strlen(url));
+    FP same += verify(result, PARENT_SPECIFIED, chash_first[c], 80);
+  }
+  RE(same == CHASH_URLS && carrot + potato + turnip + leek == CHASH_URLS, 173)
+    // Test 174 - the weight 2 parent gets the largest share
+    ST(174)
+  RE(turnip > carrot && turnip > potato && turnip > leek && carrot && potato && leek, 174)
+    // Test 175 - removing a parent only moves the URLs it had
+    tbl[0] = '\0';
+  T("dest_domain=chash.net parent=carrot:80,potato:80,turnip:80|2.0 round_robin=consistent_hash\n")
+    REBUILD ST(175)
+  for (c = 0; c < CHASH_URLS; c++) {
+    snprintf(url, sizeof(url), "http://www.chash.net/%d", c);
+    REINIT br(request, "www.chash.net");
+    request->hdr->url_set(url, strlen(url));
+    FP if (strcmp(chash_first[c], "leek") != 0 && !verify(result, PARENT_SPECIFIED, chash_first[c], 80))
+      moved++;
+  }
+  RE(moved == 0, 175)
+    // Test 176 - nextParent moves to a different parent
+    ST(176) REINIT br(request, "www.chash.net");
+  request->hdr->url_set("http://www.chash.net/0", strlen("http://www.chash.net/0"));
+  FP ink_strlcpy(chash_first[0], result->hostname, sizeof(chash_first[0]));
+  params->markParentDown(result);
+  params->nextParent(request, result);
+  RE(result->r == PARENT_SPECIFIED && strcmp(result->hostname, chash_first[0]) != 0, 176)
+    // Test 177 - a down parent is skipped on new lookups
+    ST(177) REINIT br(request, "www.chash.net");
+  request->hdr->url_set("http://www.chash.net/0", strlen("http://www.chash.net/0"));
+  FP RE(result->r == PARENT_SPECIFIED && strcmp(result->hostname, chash_first[0]) != 0, 177)
+
   delete request;
   delete result;
 
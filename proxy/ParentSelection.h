@@ -61,7 +61,7 @@ struct ParentResult
 {
   ParentResult()
     : r(PARENT_UNDEFINED), hostname(NULL), port(0), line_number(0), epoch(NULL), rec(NULL),
-      last_parent(0), start_parent(0), wrap_around(false), retry(false)
+      last_parent(0), start_parent(0), last_node(0), wrap_around(false), retry(false)
   { };
 
   // For outside consumption
@@ -75,7 +75,8 @@ struct ParentResult
   P_table *epoch;               // A pointer to the table used.
   ParentRecord *rec;
   uint32_t last_parent;
-  uint32_t start_parent;
+  uint32_t start_parent;        // for consistent hashing, the ring node of the first choice
+  uint32_t last_node;           // for consistent hashing, the ring node of last_parent
   bool wrap_around;
   bool retry;
 };
@@ -162,13 +163,26 @@ struct pRecord
   int failCount;
   int32_t upAt;
   const char *scheme;           // for which parent matches (if any)
+  float weight;                 // share of the consistent hash ring
 };
 
 enum ParentRR_t
 {
   P_NO_ROUND_ROBIN = 0,
   P_STRICT_ROUND_ROBIN,
-  P_HASH_ROUND_ROBIN
+  P_HASH_ROUND_ROBIN,
+  P_CONSISTENT_HASH
+};
+
+// struct pChashNode
+//
+//    A point on the consistent hash ring, the ring is kept
+//      sorted by hash
+//
+struct pChashNode
+{
+  uint32_t hash;
+  int parent;
 };
 
 // class ParentRecord : public ControlBase
@@ -180,7 +194,8 @@ class ParentRecord: public ControlBase
 {
 public:
   ParentRecord()
-    : parents(NULL), num_parents(0), round_robin(P_NO_ROUND_ROBIN), rr_next(0), go_direct(true)
+    : parents(NULL), num_parents(0), round_robin(P_NO_ROUND_ROBIN), rr_next(0), go_direct(true),
+      chash_ring(NULL), chash_nodes(0)
   { }
 
   ~ParentRecord();
@@ -198,9 +213,14 @@ public:
   const char *scheme;
   //private:
   const char *ProcessParents(char *val);
+  void BuildConsistentHash();
+  bool ParentAvailable(int index, ParentResult *result, HttpRequestData *rdata, ParentConfigParams *config, bool *retry);
+  void FindConsistentHashParent(bool firstCall, ParentResult *result, HttpRequestData *rdata, ParentConfigParams *config);
   ParentRR_t round_robin;
   volatile uint32_t rr_next;
   bool go_direct;
+  pChashNode *chash_ring;
+  int chash_nodes;
 };
 
 // Helper Functions
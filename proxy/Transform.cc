@@ -112,9 +112,9 @@ TransformProcessor::null_transform(ProxyMutex *mutex)
   -------------------------------------------------------------------------*/
 
 INKVConnInternal *
-TransformProcessor::range_transform(ProxyMutex *mut, RangeRecord *ranges, int num_fields, HTTPHdr *transform_resp, const char * content_type, int content_type_len, int64_t content_length)
+TransformProcessor::range_transform(ProxyMutex *mut, RangeRecord *ranges, int num_fields, HTTPHdr *transform_resp, const char * content_type, int content_type_len, int64_t content_length, bool seeked)
 {
-  RangeTransform *range_transform = NEW(new RangeTransform(mut, ranges, num_fields, transform_resp, content_type, content_type_len, content_length));
+  RangeTransform *range_transform = NEW(new RangeTransform(mut, ranges, num_fields, transform_resp, content_type, content_type_len, content_length, seeked));
   return range_transform;
 }
 
@@ -747,7 +747,7 @@ TransformTest::run()
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
-RangeTransform::RangeTransform(ProxyMutex *mut, RangeRecord *ranges, int num_fields, HTTPHdr * transform_resp, const char * content_type, int content_type_len, int64_t content_length)
+RangeTransform::RangeTransform(ProxyMutex *mut, RangeRecord *ranges, int num_fields, HTTPHdr * transform_resp, const char * content_type, int content_type_len, int64_t content_length, bool seeked)
   : INKVConnInternal(NULL, reinterpret_cast<TSMutex>(mut)),
   m_output_buf(NULL),
   m_output_reader(NULL),
@@ -755,10 +755,14 @@ RangeTransform::RangeTransform(ProxyMutex *mut, RangeRecord *ranges, int num_fie
   m_output_vio(NULL),
   m_range_content_length(0),
   m_num_range_fields(num_fields),
-  m_current_range(0), m_content_type(content_type), m_content_type_len(content_type_len), m_ranges(ranges), m_output_cl(content_length), m_done(0)
+  m_current_range(0), m_content_type(content_type), m_content_type_len(content_type_len), m_ranges(ranges), m_output_cl(content_length), m_done(0),
+  m_seeked(seeked)
 {
   SET_HANDLER(&RangeTransform::handle_event);
 
+  if (m_seeked)
+    m_ranges[0]._done_byte = m_ranges[0]._start - 1;
+
   m_num_chars_for_cl = num_chars_for_int(m_range_content_length);
   Debug("http_trans", "RangeTransform creation finishes");
 }
@@ -924,7 +928,7 @@ RangeTransform::transform_to_range()
         // not need to go back to the start of the IOBuffereReader.
         // Otherwise, reset the IOBufferReader.
         //if ( *start > prev_end )
-        *done_byte = prev_end;
+        *done_byte = m_seeked ? *start - 1 : prev_end;
         //else
         //  reader->reset();
 
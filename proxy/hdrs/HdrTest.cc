@@ -77,6 +77,7 @@ HdrTest::go(RegressionTest * t, int /* atype ATS_UNUSED */)
   status = status & test_http_parser_eos_boundary_cases();
   status = status & test_http_mutation();
   status = status & test_mime();
+  status = status & test_mime_scanner();
   status = status & test_http();
 
   return (status ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED);
@@ -625,6 +626,146 @@ HdrTest::test_mime()
   return (failures_to_status("test_mime", 0));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// Parses @a request fed @a step bytes at a time and prints the result into @a buf.
+// Returns the printed length, or -1 if the request did not parse.
+int
+HdrTest::test_mime_scanner_parse_aux(const char *request, int step, char *buf, int bufsize)
+{
+  HTTPHdr hdr;
+  HTTPParser parser;
+  const char *start = request;
+  const char *end = request + strlen(request);
+  int err, bufindex = 0, dumpoffset = 0;
+
+  http_parser_init(&parser);
+  hdr.create(HTTP_TYPE_REQUEST);
+  do {
+    const char *chunk_end = (end - start > step) ? start + step : end;
+    err = hdr.parse_req(&parser, &start, chunk_end, chunk_end == end);
+  } while (err == PARSE_CONT && start < end);
+
+  if (err == PARSE_DONE)
+    hdr.print(buf, bufsize, &bufindex, &dumpoffset);
+  hdr.destroy();
+  http_parser_clear(&parser);
+  return (err == PARSE_DONE) ? bufindex : -1;
+}
+
+int
+HdrTest::test_mime_scanner()
+{
+  static const char request[] =
+    "GET /images/logo.png?size=large&format=webp HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/31.0 Safari/537.36\r\n"
+    "Accept: image/webp,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip,deflate,sdch\r\n"
+    "Accept-Language: en-US,en;q=0.8\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=7f3a9c1e5b2d4f6a8c0e; prefs=lang:en|tz:UTC; tracking=disabled; ab=bucket-17\r\n"
+    "Referer: http://www.example.com/index.html\r\n"
+    "If-Modified-Since: Tue, 08 Oct 2013 20:32:17 GMT\r\n"
+    "If-None-Match: \"5e1f-4e8b0c1d2a3b4\"\r\n"
+    "X-Forwarded-For: 10.1.2.3, 192.168.10.20\r\n"
+    "X-Continued: first part\r\n"
+    "  second part: with a colon\r\n"
+    "Via:http/1.1 proxy.example.com (ApacheTrafficServer)\r\n"
+    "X-No-Colon-Garbage-Line\r\n"
+    "X-Spaced-Name : value\n"
+    "X-Empty:\r\n"
+    "\r\n";
+  static const int steps[] = { 1, 3, 16, 31, 64, (int) sizeof(request) };
+  static const int ITERATIONS = 20000;
+
+  int failures = 0;
+  int len = (int) strlen(request);
+  char expected[4096], got[4096];
+  int expected_len;
+
+  bri_box("test_mime_scanner");
+
+  MIMEScanImpl best = mime_scan_impl_best();
+
+  // The line scan of each implementation against the scalar one, for every
+  // position of the LF and of the colon in lines around the vector sizes.
+  char line[100];
+  for (int impl = MIME_SCAN_SSE2; impl <= best; impl++) {
+    for (int n = 0; n <= 70; n++) {
+      for (int lf = -1; lf < n; lf++) {
+        for (int c = -1; c < n; c++) {
+          const char *scalar_colon = NULL, *colon = NULL, *scalar_lf, *impl_lf;
+
+          memset(line, 'a', n);
+          if (c >= 0)
+            line[c] = ':';
+          if (lf >= 0)
+            line[lf] = '\n';
+          mime_scan_impl_set(MIME_SCAN_SCALAR);
+          scalar_lf = mime_scan_line(line, line + n, &scalar_colon);
+          mime_scan_impl_set((MIMEScanImpl) impl);
+          impl_lf = mime_scan_line(line, line + n, &colon);
+          if (impl_lf != scalar_lf || colon != scalar_colon) {
+            if (++failures < 10)
+              printf("FAILED: %s line scan, length %d, LF at %d, colon at %d\n",
+                     mime_scan_impl_name((MIMEScanImpl) impl), n, lf, c);
+          }
+        }
+      }
+    }
+  }
+
+  // Whole requests, fed in pieces so that the field lines are also built up
+  // in the scanner buffer, must parse the same with every implementation.
+  mime_scan_impl_set(MIME_SCAN_SCALAR);
+  expected_len = test_mime_scanner_parse_aux(request, len, expected, sizeof(expected));
+  if (expected_len <= 0) {
+    printf("FAILED: scalar parse of the request\n");
+    ++failures;
+  }
+  for (int impl = MIME_SCAN_SCALAR; impl <= best && expected_len > 0; impl++) {
+    mime_scan_impl_set((MIMEScanImpl) impl);
+    for (unsigned i = 0; i < countof(steps); i++) {
+      int got_len = test_mime_scanner_parse_aux(request, steps[i], got, sizeof(got));
+      if (got_len != expected_len || memcmp(got, expected, expected_len) != 0) {
+        printf("FAILED: %s parse in pieces of %d bytes differs:\n[%.*s]\n", mime_scan_impl_name((MIMEScanImpl) impl),
+               steps[i], got_len, got);
+        ++failures;
+      }
+    }
+  }
+
+  // Benchmark the parse of the request with each implementation.
+  for (int impl = MIME_SCAN_SCALAR; impl <= best; impl++) {
+    HTTPParser parser;
+    const char *start;
+    int nfields = 0;
+
+    mime_scan_impl_set((MIMEScanImpl) impl);
+    http_parser_init(&parser);
+    ink_hrtime t = ink_get_hrtime_internal();
+    for (int i = 0; i < ITERATIONS; i++) {
+      HTTPHdr hdr;
+      hdr.create(HTTP_TYPE_REQUEST);
+      start = request;
+      hdr.parse_req(&parser, &start, request + len, true);
+      nfields = hdr.fields_count();
+      hdr.destroy();
+      http_parser_clear(&parser);
+    }
+    t = ink_get_hrtime_internal() - t;
+    printf("%-6s scan: %8.1f ns/request, %6.1f ns/field, %d fields\n", mime_scan_impl_name((MIMEScanImpl) impl),
+           (double) t / ITERATIONS / HRTIME_NSECOND, (double) t / ITERATIONS / HRTIME_NSECOND / (nfields ? nfields : 1),
+           nfields);
+  }
+  mime_scan_impl_set(best);
+
+  return (failures_to_status("test_mime_scanner", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
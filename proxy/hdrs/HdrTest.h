@@ -68,6 +68,7 @@ private:
   int test_insert_comma_vals();
   int test_parse_comma_list();
   int test_mime();
+  int test_mime_scanner();
   int test_http();
   int test_http_mutation();
 
@@ -76,6 +77,7 @@ private:
   int test_http_hdr_copy_over_aux(int testnum, const char *request, const char *response);
   int test_http_aux(const char *request, const char *response);
   int test_arena_aux(Arena * arena, int len);
+  int test_mime_scanner_parse_aux(const char *request, int step, char *buf, int bufsize);
   void bri_box(const char *s);
   int failures_to_status(const char *testname, int nfail);
 };
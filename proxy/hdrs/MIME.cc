@@ -32,6 +32,11 @@
 #include "HdrUtils.h"
 #include "HttpCompat.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MIME_SCAN_SIMD 1
+#include <immintrin.h>
+#endif
+
 /***********************************************************************
  *                                                                     *
  *                    C O M P I L E    O P T I O N S                   *
@@ -603,6 +608,8 @@ mime_init()
     init = 0;
     
     hdrtoken_init();
+    mime_scan_impl_set(mime_scan_impl_best());
+
     day_names_dfa = NEW(new DFA);
     day_names_dfa->compile(day_names, SIZEOF(day_names), RE_CASE_INSENSITIVE);
     
@@ -2168,6 +2175,122 @@ MIMEField* MIMEHdr::get_host_port_values(
  *                          P A R S E R                                *
  *                                                                     *
  ***********************************************************************/
+
+// The scanner finds the end of a field line and the ':' that ends its name
+// in the same pass over the input.  The vector versions compare 16 or 32
+// bytes at a time against LF and ':' and keep only the colons before the
+// first LF of the block.  They all leave the tail of the input to the
+// scalar version.
+
+static const char *
+mime_scan_line_scalar(const char *s, const char *e, const char **colon)
+{
+  const char *lf = (const char *) memchr(s, ParseRules::CHAR_LF, e - s);
+
+  if (colon && !*colon)
+    *colon = (const char *) memchr(s, ':', (lf ? lf : e) - s);
+  return lf;
+}
+
+#if MIME_SCAN_SIMD
+static const char *
+mime_scan_line_sse2(const char *s, const char *e, const char **colon)
+{
+  const __m128i lf = _mm_set1_epi8(ParseRules::CHAR_LF);
+  const __m128i co = _mm_set1_epi8(':');
+
+  for (; e - s >= 16; s += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) s);
+    unsigned lf_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, lf));
+
+    if (colon && !*colon) {
+      unsigned colon_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, co));
+      if (lf_mask)
+        colon_mask &= (lf_mask & -lf_mask) - 1;
+      if (colon_mask)
+        *colon = s + __builtin_ctz(colon_mask);
+    }
+    if (lf_mask)
+      return s + __builtin_ctz(lf_mask);
+  }
+  return mime_scan_line_scalar(s, e, colon);
+}
+
+__attribute__ ((target("avx2"))) static const char *
+mime_scan_line_avx2(const char *s, const char *e, const char **colon)
+{
+  const __m256i lf = _mm256_set1_epi8(ParseRules::CHAR_LF);
+  const __m256i co = _mm256_set1_epi8(':');
+
+  for (; e - s >= 32; s += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) s);
+    unsigned lf_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf));
+
+    if (colon && !*colon) {
+      unsigned colon_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, co));
+      if (lf_mask)
+        colon_mask &= (lf_mask & -lf_mask) - 1;
+      if (colon_mask)
+        *colon = s + __builtin_ctz(colon_mask);
+    }
+    if (lf_mask)
+      return s + __builtin_ctz(lf_mask);
+  }
+  return mime_scan_line_sse2(s, e, colon);
+}
+#endif
+
+const char *(*mime_scan_line) (const char *s, const char *e, const char **colon) = mime_scan_line_scalar;
+
+MIMEScanImpl
+mime_scan_impl_best()
+{
+#if MIME_SCAN_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return MIME_SCAN_AVX2;
+  return MIME_SCAN_SSE2;        // always there on x86_64
+#else
+  return MIME_SCAN_SCALAR;
+#endif
+}
+
+MIMEScanImpl
+mime_scan_impl_set(MIMEScanImpl impl)
+{
+  if (impl > mime_scan_impl_best())
+    impl = mime_scan_impl_best();
+
+  switch (impl) {
+#if MIME_SCAN_SIMD
+  case MIME_SCAN_AVX2:
+    mime_scan_line = mime_scan_line_avx2;
+    break;
+  case MIME_SCAN_SSE2:
+    mime_scan_line = mime_scan_line_sse2;
+    break;
+#endif
+  default:
+    impl = MIME_SCAN_SCALAR;
+    mime_scan_line = mime_scan_line_scalar;
+    break;
+  }
+  return impl;
+}
+
+const char *
+mime_scan_impl_name(MIMEScanImpl impl)
+{
+  switch (impl) {
+  case MIME_SCAN_AVX2:
+    return "avx2";
+  case MIME_SCAN_SSE2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
 void
 _mime_scanner_init(MIMEScanner *scanner)
 {
@@ -2175,7 +2298,7 @@ _mime_scanner_init(MIMEScanner *scanner)
   scanner->m_line_size = 0;
   scanner->m_line_length = 0;
   scanner->m_state = MIME_PARSE_BEFORE;
-
+  scanner->m_colon_offset = -1;
 }
 
 //////////////////////////////////////////////////////
@@ -2237,7 +2360,7 @@ mime_scanner_get(MIMEScanner *S,
                  bool raw_input_eof, ///< All data has been received for this header.
                  int raw_input_scan_type)
 {
-  const char *raw_input_c, *lf_ptr;
+  const char *raw_input_c, *lf_ptr, *colon_ptr;
   MIMEParseResult zret = PARSE_CONT;
   // Need this for handling dangling CR.
   static char const RAW_CR = ParseRules::CHAR_CR;
@@ -2251,6 +2374,7 @@ mime_scanner_get(MIMEScanner *S,
     ptrdiff_t runway = raw_input_e - raw_input_c; // remaining input.
     switch (S->m_state) {
     case MIME_PARSE_BEFORE: // waiting to find a field.
+      S->m_colon_offset = -1;
       if (ParseRules::is_cr(*raw_input_c)) {
         ++raw_input_c;
         if (runway >= 2 && ParseRules::is_lf(*raw_input_c)) {
@@ -2284,7 +2408,18 @@ mime_scanner_get(MIMEScanner *S,
       }
       break;
     case MIME_PARSE_INSIDE:
-      lf_ptr = static_cast<char const*>(memchr(raw_input_c, ParseRules::CHAR_LF, runway));
+      // Field lines are also searched for the end of the field name, which
+      // is the first ':' of the line, continuations included.
+      colon_ptr = NULL;
+      if (MIME_SCANNER_TYPE_FIELD == raw_input_scan_type && S->m_colon_offset < 0) {
+        lf_ptr = mime_scan_line(raw_input_c, raw_input_e, &colon_ptr);
+        // The output line is what has been buffered followed by the input
+        // from *raw_input_s on.
+        if (colon_ptr)
+          S->m_colon_offset = S->m_line_length + (int) (colon_ptr - *raw_input_s);
+      } else {
+        lf_ptr = mime_scan_line(raw_input_c, raw_input_e, NULL);
+      }
       if (lf_ptr) {
         raw_input_c = lf_ptr + 1;
         if (MIME_SCANNER_TYPE_LINE == raw_input_scan_type) {
@@ -2452,8 +2587,11 @@ mime_parser_parse(MIMEParser *parser, HdrHeap *heap, MIMEHdrImpl *mh, const char
       continue;                 // toss away garbage line
 
     // find name last
-    colon = (char *) memchr(line_c, ':', (line_e - line_c));
-    if (!colon)
+    // the scanner has already found the colon
+    if (scanner->m_colon_offset < 0 || scanner->m_colon_offset >= line_e - line_c)
+      continue;                 // toss away garbage line
+    colon = line_c + scanner->m_colon_offset;
+    if (*colon != ':')
       continue;                 // toss away garbage line
     field_name_last = colon - 1;
     while ((field_name_last >= field_name_first) && is_ws(*field_name_last))
@@ -261,6 +261,15 @@ struct MIMEScanner
   int m_line_size;              // total allocated size of buffer
 //  int m_state;                  // state of scanning state machine
   MimeParseState m_state; ///< Parsing machine state.
+  int m_colon_offset;           ///< Offset of the first ':' in the field line, -1 if not seen yet.
+};
+
+/// Implementations of the line scan of the MIME scanner.
+enum MIMEScanImpl
+{
+  MIME_SCAN_SCALAR,
+  MIME_SCAN_SSE2,
+  MIME_SCAN_AVX2
 };
 
 
@@ -658,6 +667,15 @@ void mime_field_name_value_set(HdrHeap * heap, MIMEHdrImpl * mh, MIMEField * fie
 void mime_field_value_append(HdrHeap * heap, MIMEHdrImpl * mh, MIMEField * field,
                              const char *value, int length, bool prepend_comma, const char separator);
 
+/** Returns the first LF in [@a s, @a e), or NULL if there is none.  If @a colon
+    is not NULL and *@a colon is NULL, *@a colon is set to the first ':' before
+    that LF (or before @a e if there is no LF), if any. */
+extern const char *(*mime_scan_line) (const char *s, const char *e, const char **colon);
+/// Selects the line scan, falling back to the best one this CPU supports.  Returns the one selected.
+MIMEScanImpl mime_scan_impl_set(MIMEScanImpl impl);
+MIMEScanImpl mime_scan_impl_best();
+const char *mime_scan_impl_name(MIMEScanImpl impl);
+
 void mime_scanner_init(MIMEScanner * scanner);
 void mime_scanner_clear(MIMEScanner * scanner);
 void mime_scanner_append(MIMEScanner * scanner, const char *data, int data_size);
@@ -70,7 +70,7 @@ HttpCacheSM::HttpCacheSM():
   captive_action(),
   open_read_cb(false), open_write_cb(false), open_read_tries(0),
   read_request_hdr(NULL), read_config(NULL),
-  read_pin_in_cache(0), retry_write(true), open_write_tries(0),
+  read_pin_in_cache(0), retry_write(true), collapsing(false), open_write_tries(0),
   lookup_url(NULL), lookup_max_recursive(0), current_lookup_level(0)
 {
 }
@@ -156,6 +156,43 @@ HttpCacheSM::state_cache_open_read(int event, void *data)
   return VC_EVENT_CONT;
 }
 
+// The segment head read ahead of a segment, see do_segment_head_read.
+// Whether or not there is one the segment is looked up next.
+int
+HttpCacheSM::state_segment_head_read(int event, void *data)
+{
+  STATE_ENTER(&HttpCacheSM::state_segment_head_read, event);
+  ink_assert(captive_action.cancelled == 0);
+  pending_action = NULL;
+
+  switch (event) {
+  case CACHE_EVENT_OPEN_READ:
+    {
+      CacheVConnection *vc = (CacheVConnection *) data;
+      void *validator;
+      int len;
+
+      if (vc->get_single_data(&validator, &len) == 0 && len == sizeof(INK_MD5)) {
+        memcpy(&master_sm->t_state.range_segment_head, validator, sizeof(INK_MD5));
+        master_sm->t_state.range_segment_head_found = true;
+      }
+      vc->do_io(VIO::CLOSE);
+      break;
+    }
+
+  case CACHE_EVENT_OPEN_READ_FAILED:
+    // none, or it is being rewritten; segments are then taken as they are
+    break;
+
+  default:
+    ink_release_assert(0);
+  }
+
+  SET_HANDLER(&HttpCacheSM::state_cache_open_read);
+  do_cache_open_read();
+  return VC_EVENT_CONT;
+}
+
 int
 HttpCacheSM::state_cache_open_write(int event, void *data)
 {
@@ -173,12 +210,45 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
     break;
 
   case CACHE_EVENT_OPEN_WRITE_FAILED:
+    if (data == (void *) -ECACHE_DOC_BUSY && collapse_miss()) {
+      // Another transaction is fetching the object; read it from that
+      // writer rather than fetching it from the origin again
+      Debug("http_cache", "[%" PRId64 "] [state_cache_open_write] object is being written, "
+            "reading from the writer", master_sm->sm_id);
+      collapsing = true;
+      open_read_cb = false;
+      do_cache_open_read();
+      break;
+    }
     // The cache is hosed or full or something.
     // Forward the failure to the main sm
     open_write_cb = true;
     master_sm->handleEvent(event, data);
     break;
 
+  case CACHE_EVENT_OPEN_READ:
+    // Read from the writer which got the write lock instead of us,
+    // HttpSM takes it for a hit.  Only this is a collapsed request; a
+    // lookup that finds the object being written is read while writer.
+    ink_assert(collapsing && cache_read_vc == NULL);
+    HTTP_INCREMENT_DYN_STAT(http_current_cache_connections_stat);
+    HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_requests_stat);
+    collapsing = false;
+    cache_read_vc = (CacheVConnection *) data;
+    open_read_cb = true;
+    open_write_cb = true;
+    master_sm->handleEvent(event, data);
+    break;
+
+  case CACHE_EVENT_OPEN_READ_FAILED:
+    // The writer went away or did not make progress in time, proxy only
+    ink_assert(collapsing);
+    collapsing = false;
+    open_read_cb = true;
+    open_write_cb = true;
+    master_sm->handleEvent(CACHE_EVENT_OPEN_WRITE_FAILED, (void *) -ECACHE_DOC_BUSY);
+    break;
+
   default:
     ink_release_assert(0);
   }
@@ -186,6 +256,17 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
   return VC_EVENT_CONT;
 }
 
+// A miss that lost the write lock to another transaction can wait for
+// that one's response, if it was looked up in the cache (so the read
+// parameters are set) and is not a transform or alternate URL write.
+bool
+HttpCacheSM::collapse_miss()
+{
+  return master_sm->t_state.http_config_param->cache_collapsed_forwarding && retry_write && !collapsing &&
+    open_read_cb && cache_read_vc == NULL && read_config != NULL &&
+    master_sm->t_state.cache_info.action == HttpTransact::CACHE_PREPARE_TO_WRITE;
+}
+
 void
 HttpCacheSM::do_schedule_in()
 {
@@ -213,7 +294,8 @@ HttpCacheSM::do_cache_open_read()
   //Initialising read-while-write-inprogress flag
   this->readwhilewrite_inprogress = false;
   Action *action_handle = cacheProcessor.open_read(this, this->lookup_url, master_sm->t_state.cache_control.cluster_cache_local, this->read_request_hdr, this->read_config,
-                                                   this->read_pin_in_cache);
+                                                   this->read_pin_in_cache, CACHE_FRAG_TYPE_HTTP,
+                                                   master_sm->t_state.range_segment, master_sm->t_state.range_segment_size);
 
   if (action_handle != ACTION_RESULT_DONE) {
     pending_action = action_handle;
@@ -230,6 +312,36 @@ HttpCacheSM::do_cache_open_read()
   }
 }
 
+// Reads the segment head of the object before looking up one of its
+// segments, so that a segment of another version than the head's is not
+// served as a hit.  The head is a single fragment, the validator is taken
+// straight from it.
+Action *
+HttpCacheSM::do_segment_head_read()
+{
+  INK_MD5 key;
+  int len;
+  const char *hostname = lookup_url->host_get(&len);
+
+  ink_assert(pending_action == NULL);
+  master_sm->t_state.range_segment_head_found = false;
+  lookup_url->MD5_get(&key);
+  Cache::segment_head_key(&key);
+  SET_HANDLER(&HttpCacheSM::state_segment_head_read);
+
+  // like the segments, the head is kept in the local cache
+  Action *action_handle = cacheProcessor.open_read(this, &key, true, CACHE_FRAG_TYPE_NONE, (char *) hostname, len);
+
+  if (action_handle != ACTION_RESULT_DONE) {
+    pending_action = action_handle;
+  }
+  if (open_read_cb == true) {
+    return ACTION_RESULT_DONE;
+  } else {
+    return &captive_action;
+  }
+}
+
 Action *
 HttpCacheSM::open_read(URL * url, HTTPHdr * hdr, CacheLookupHttpConfig * params, time_t pin_in_cache)
 {
@@ -245,7 +357,10 @@ HttpCacheSM::open_read(URL * url, HTTPHdr * hdr, CacheLookupHttpConfig * params,
   lookup_max_recursive++;
   current_lookup_level++;
   open_read_cb = false;
-  act_return = do_cache_open_read();
+  if (master_sm->t_state.range_segment >= 0)
+    act_return = do_segment_head_read();
+  else
+    act_return = do_cache_open_read();
   // the following logic is based on the assumption that the secnod
   // lookup won't happen if the HttpSM hasn't been called back for the
   // first lookup
@@ -306,7 +421,8 @@ HttpCacheSM::open_write(URL * url, HTTPHdr * request, CacheHTTPInfo * old_info,
                                                     // INKqa11166
                                                     allow_multiple ? (CacheHTTPInfo *) CACHE_ALLOW_MULTIPLE_WRITES :
                                                     old_info,
-                                                    pin_in_cache);
+                                                    pin_in_cache, CACHE_FRAG_TYPE_HTTP,
+                                                    master_sm->t_state.range_segment, master_sm->t_state.range_segment_size);
 
   if (action_handle != ACTION_RESULT_DONE) {
     pending_action = action_handle;
@@ -322,3 +438,138 @@ HttpCacheSM::open_write(URL * url, HTTPHdr * request, CacheHTTPInfo * old_info,
     return &captive_action;
   }
 }
+
+// Writes the segment head of an object, its validator and nothing else,
+// on its own as the transaction which found the head out of date goes on.
+struct SegmentHeadWriter:public Continuation
+{
+  MIOBuffer *buf;
+  IOBufferReader *reader;
+  CacheVConnection *vc;
+
+  SegmentHeadWriter(INK_MD5 * validator)
+    : Continuation(new_ProxyMutex()), buf(new_MIOBuffer(BUFFER_SIZE_INDEX_128)), reader(buf->alloc_reader()), vc(NULL)
+  {
+    buf->write((char *) validator, sizeof(INK_MD5));
+    SET_HANDLER(&SegmentHeadWriter::handle_event);
+  }
+
+  ~SegmentHeadWriter()
+  {
+    free_MIOBuffer(buf);
+  }
+
+  int handle_event(int event, void *data)
+  {
+    switch (event) {
+    case CACHE_EVENT_OPEN_WRITE:
+      vc = (CacheVConnection *) data;
+      vc->do_io_write(this, sizeof(INK_MD5), reader);
+      return EVENT_CONT;
+    case VC_EVENT_WRITE_READY:
+      return EVENT_CONT;
+    case VC_EVENT_WRITE_COMPLETE:
+      vc->do_io(VIO::CLOSE);
+      break;
+    case CACHE_EVENT_OPEN_WRITE_FAILED:
+      // another transaction is writing it
+      break;
+    default:
+      vc->do_io(VIO::ABORT);
+      break;
+    }
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
+// Makes @a validator that of the version the segments of the object at
+// @a url are to be of, overwriting the segment head it has.
+void
+HttpCacheSM::write_segment_head(URL * url, INK_MD5 * validator)
+{
+  SegmentHeadWriter *writer = new SegmentHeadWriter(validator);
+  INK_MD5 key;
+  int len;
+  const char *hostname = url->host_get(&len);
+
+  url->MD5_get(&key);
+  Cache::segment_head_key(&key);
+  MUTEX_LOCK(lock, writer->mutex, this_ethread());
+  cacheProcessor.open_write(writer, &key, true, CACHE_FRAG_TYPE_NONE, sizeof(INK_MD5), CACHE_WRITE_OPT_OVERWRITE,
+                            (time_t) 0, (char *) hostname, len);
+}
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+// Hands the object being written to the reader, as the cache does
+struct CollapseTestVC:public CacheVConnection
+{
+  VIO *do_io_read(Continuation *, int64_t, MIOBuffer *) { return NULL; }
+  VIO *do_io_pread(Continuation *, int64_t, MIOBuffer *, int64_t) { return NULL; }
+  VIO *do_io_pread_ranges(Continuation *, MIOBuffer *, int, int64_t const *) { return NULL; }
+  VIO *do_io_write(Continuation *, int64_t, IOBufferReader *, bool) { return NULL; }
+  void do_io_close(int) { }
+  void reenable(VIO *) { }
+  void reenable_re(VIO *) { }
+  int get_header(void **, int *) { return -1; }
+  int set_header(void *, int) { return -1; }
+  int get_single_data(void **, int *) { return -1; }
+#ifdef HTTP_CACHE
+  void set_http_info(CacheHTTPInfo *) { }
+  void get_http_info(CacheHTTPInfo **info) { *info = NULL; }
+#endif
+  bool is_ram_cache_hit() const { return false; }
+  bool set_disk_io_priority(int) { return false; }
+  int get_disk_io_priority() { return 0; }
+  bool set_pin_in_cache(time_t) { return false; }
+  time_t get_pin_in_cache() { return 0; }
+  int64_t get_object_size() { return 0; }
+  bool is_pread_capable() { return false; }
+};
+
+struct CollapseTestSM:public HttpSM
+{
+  int events;
+
+  CollapseTestSM() : events(0) { SET_HANDLER(&CollapseTestSM::handle_event); }
+  int handle_event(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */) { events++; return EVENT_DONE; }
+};
+
+REGRESSION_TEST(HttpCacheSM_collapsed_requests)(RegressionTest * t, int /* atype ATS_UNUSED */, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  CollapseTestSM *sm = NEW(new CollapseTestSM);
+  HttpCacheSM cache_sm;
+  CollapseTestVC writer_vc;
+  int64_t before, after;
+
+  box = REGRESSION_TEST_PASSED;
+  sm->mutex = new_ProxyMutex();
+  MUTEX_LOCK(lock, sm->mutex, this_ethread());
+  cache_sm.init(sm, sm->mutex);
+  HTTP_READ_DYN_SUM(http_cache_collapsed_requests_stat, before);
+
+  // a lookup that finds the object being written is not collapsed
+  cache_sm.handler = (ContinuationHandler) &HttpCacheSM::state_cache_open_read;
+  cache_sm.handleEvent(CACHE_EVENT_OPEN_READ, &writer_vc);
+  HTTP_READ_DYN_SUM(http_cache_collapsed_requests_stat, after);
+  box.check(sm->events == 1 && cache_sm.cache_read_vc == &writer_vc, "open read not passed on");
+  box.check(after == before, "read while writer counted as %" PRId64 " collapsed requests", after - before);
+  cache_sm.close_read();
+
+  // a miss that lost the write lock and reads from the writer is, once
+  cache_sm.handler = (ContinuationHandler) &HttpCacheSM::state_cache_open_write;
+  cache_sm.collapsing = true;
+  cache_sm.open_read_cb = false;
+  cache_sm.handleEvent(CACHE_EVENT_OPEN_READ, &writer_vc);
+  HTTP_READ_DYN_SUM(http_cache_collapsed_requests_stat, after);
+  box.check(sm->events == 2 && cache_sm.cache_read_vc == &writer_vc && !cache_sm.collapsing,
+            "collapsed read not passed on");
+  box.check(after == before + 1, "collapsed request counted %" PRId64 " times", after - before);
+  cache_sm.close_read();
+
+  delete sm;
+}
+#endif
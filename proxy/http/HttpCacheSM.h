@@ -72,6 +72,8 @@ public:
   Action *open_write(URL * url,
                      HTTPHdr * request, CacheHTTPInfo * old_info, time_t pin_in_cache, bool retry, bool allow_multiple);
 
+  static void write_segment_head(URL * url, INK_MD5 * validator);
+
   CacheVConnection *cache_read_vc;
   CacheVConnection *cache_write_vc;
 
@@ -143,11 +145,15 @@ public:
     lookup_url = url;
   }
 
+  friend void RegressionTest_HttpCacheSM_collapsed_requests(RegressionTest *, int, int *);
 private:
 
   void do_schedule_in();
   Action *do_cache_open_read();
+  Action *do_segment_head_read();
+  bool collapse_miss();
 
+  int state_segment_head_read(int event, void *data);
   int state_cache_open_read(int event, void *data);
   int state_cache_open_write(int event, void *data);
 
@@ -163,6 +169,7 @@ private:
 
   // Open write parameters
   bool retry_write;
+  bool collapsing;              // reading from the writer that beat us to the write lock
   int open_write_tries;
 
   // Common parameters
@@ -26,6 +26,9 @@
 #include <string.h>
 #include "HttpConfig.h"
 #include "HTTP.h"
+#include "HttpSM.h"
+#include "HttpClientSession.h"
+#include "HttpServerSession.h"
 #include "ProcessManager.h"
 #include "ProxyConfig.h"
 #include "ICPProcessor.h"
@@ -58,6 +61,7 @@
 
 
 RecRawStatBlock *http_rsb;
+RecRawHistogramBlock *http_rhb;
 #define HTTP_CLEAR_DYN_STAT(x) \
 do { \
 	RecSetRawStatSum(http_rsb, x, 0); \
@@ -616,6 +620,14 @@ register_stat_callbacks()
                      "proxy.process.http.total_transactions_time",
                      RECD_INT, RECP_NULL, (int) http_total_transactions_time_stat, RecRawStatSyncSum);
 
+  RecRegisterRawHistogram(http_rhb, RECT_PROCESS, "proxy.process.http.latency.first_byte", (int) http_first_byte_hist);
+  RecRegisterRawHistogram(http_rhb, RECT_PROCESS, "proxy.process.http.latency.origin_connect",
+                          (int) http_origin_connect_hist);
+  RecRegisterRawHistogram(http_rhb, RECT_PROCESS, "proxy.process.http.latency.cache_open_read",
+                          (int) http_cache_open_read_hist);
+  RecRegisterRawHistogram(http_rhb, RECT_PROCESS, "proxy.process.http.latency.dns_lookup", (int) http_dns_lookup_hist);
+  RecRegisterRawHistogram(http_rhb, RECT_PROCESS, "proxy.process.http.latency.transaction", (int) http_transaction_hist);
+
   RecRegisterRawStat(http_rsb, RECT_PROCESS,
                      "proxy.process.http.total_transactions_think_time",
                      RECD_INT, RECP_NULL, (int) http_total_transactions_think_time_stat, RecRawStatSyncSum);
@@ -804,6 +816,43 @@ register_stat_callbacks()
                      "proxy.process.http.background_fill_bytes_completed_stat",
                      RECD_INT, RECP_NULL, (int) http_background_fill_bytes_completed_stat, RecRawStatSyncSum);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.tunnel_splices",
+                     RECD_COUNTER, RECP_NULL, (int) http_tunnel_splices_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.happy_eyeballs.races",
+                     RECD_COUNTER, RECP_NULL, (int) http_happy_eyeballs_races_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.happy_eyeballs.fallbacks",
+                     RECD_COUNTER, RECP_NULL, (int) http_happy_eyeballs_fallbacks_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.happy_eyeballs.fallback_wins",
+                     RECD_COUNTER, RECP_NULL, (int) http_happy_eyeballs_fallback_wins_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_limit.queued",
+                     RECD_COUNTER, RECP_NULL, (int) http_origin_limit_queued_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_limit.rejected",
+                     RECD_COUNTER, RECP_NULL, (int) http_origin_limit_rejected_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_limit.queue_timeouts",
+                     RECD_COUNTER, RECP_NULL, (int) http_origin_limit_queue_timeouts_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.origin_limit.cuts",
+                     RECD_COUNTER, RECP_NULL, (int) http_origin_limit_cuts_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.local_hits",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_local_hits_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.migrations",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_migrations_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.misses",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_misses_stat, RecRawStatSyncCount);
+
   RecRegisterRawStat(http_rsb, RECT_PROCESS,
                      "proxy.process.http.cache_write_errors",
                      RECD_INT, RECP_NULL, (int) http_cache_write_errors, RecRawStatSyncSum);
@@ -812,6 +861,10 @@ register_stat_callbacks()
                      "proxy.process.http.cache_read_errors",
                      RECD_INT, RECP_NULL, (int) http_cache_read_errors, RecRawStatSyncSum);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.cache_collapsed_requests",
+                     RECD_COUNTER, RECP_NULL, (int) http_cache_collapsed_requests_stat, RecRawStatSyncCount);
+
   ////////////////////////////////////////////////////////////////////////////////
   // status code counts
   ////////////////////////////////////////////////////////////////////////////////
@@ -1116,6 +1169,7 @@ HttpConfig::startup()
 {
 
   http_rsb = RecAllocateRawStatBlock((int) http_stat_count);
+  http_rhb = RecAllocateRawHistogramBlock((int) http_hist_count);
   register_configs();
   register_stat_callbacks();
 
@@ -1141,10 +1195,25 @@ HttpConfig::startup()
   HttpEstablishStaticConfigFloat(cfg_reclaim_factor, "proxy.config.allocator.reclaim_factor");
 #endif
 
+  // before the event threads start allocating
+  thread_numa_init(httpSMAllocator);
+  thread_numa_init(httpClientSessionAllocator);
+  thread_numa_init(httpServerSessionAllocator);
+  thread_magazine_init(httpSMAllocator, sizeof(HttpSM));
+  thread_magazine_init(httpClientSessionAllocator, sizeof(HttpClientSession));
+  thread_magazine_init(httpServerSessionAllocator, sizeof(HttpServerSession));
+
   HttpEstablishStaticConfigLongLong(c.server_max_connections, "proxy.config.http.server_max_connections");
   HttpEstablishStaticConfigLongLong(c.oride.server_tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections, "proxy.config.http.origin_max_connections");
   HttpEstablishStaticConfigLongLong(c.origin_min_keep_alive_connections, "proxy.config.http.origin_min_keep_alive_connections");
+  HttpEstablishStaticConfigByte(c.origin_limit, "proxy.config.http.origin_limit.enabled");
+  HttpEstablishStaticConfigLongLong(c.origin_limit_min, "proxy.config.http.origin_limit.min");
+  HttpEstablishStaticConfigLongLong(c.origin_limit_max, "proxy.config.http.origin_limit.max");
+  HttpEstablishStaticConfigFloat(c.origin_limit_latency_tolerance, "proxy.config.http.origin_limit.latency_tolerance");
+  HttpEstablishStaticConfigFloat(c.origin_limit_backoff, "proxy.config.http.origin_limit.backoff");
+  HttpEstablishStaticConfigLongLong(c.origin_limit_queue_size, "proxy.config.http.origin_limit.queue_size");
+  HttpEstablishStaticConfigLongLong(c.origin_limit_queue_timeout, "proxy.config.http.origin_limit.queue_timeout");
   HttpEstablishStaticConfigLongLong(c.attach_server_session_to_client, "proxy.config.http.attach_server_session_to_client");
 
   HttpEstablishStaticConfigByte(c.parent_proxy_routing_enable, "proxy.config.http.parent_proxy_routing_enable");
@@ -1208,6 +1277,8 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.parent_connect_attempts, "proxy.config.http.parent_proxy.total_connect_attempts");
   HttpEstablishStaticConfigLongLong(c.per_parent_connect_attempts, "proxy.config.http.parent_proxy.per_parent_connect_attempts");
   HttpEstablishStaticConfigLongLong(c.parent_connect_timeout, "proxy.config.http.parent_proxy.connect_attempts_timeout");
+  HttpEstablishStaticConfigByte(c.happy_eyeballs, "proxy.config.http.happy_eyeballs.enabled");
+  HttpEstablishStaticConfigLongLong(c.happy_eyeballs_delay, "proxy.config.http.happy_eyeballs.delay");
 
   HttpEstablishStaticConfigLongLong(c.oride.sock_recv_buffer_size_out, "proxy.config.net.sock_recv_buffer_size_out");
   HttpEstablishStaticConfigLongLong(c.oride.sock_send_buffer_size_out, "proxy.config.net.sock_send_buffer_size_out");
@@ -1266,6 +1337,9 @@ HttpConfig::startup()
 
   // open write failure retries
   HttpEstablishStaticConfigLongLong(c.max_cache_open_write_retries, "proxy.config.http.cache.max_open_write_retries");
+  HttpEstablishStaticConfigByte(c.cache_collapsed_forwarding, "proxy.config.http.cache.collapsed_forwarding");
+
+  HttpEstablishStaticConfigLongLong(c.cache_range_segment_size, "proxy.config.http.cache.range.segment_size");
 
   HttpEstablishStaticConfigByte(c.oride.cache_http, "proxy.config.http.cache.http");
   HttpEstablishStaticConfigByte(c.oride.cache_cluster_cache_local, "proxy.config.http.cache.cluster_cache_local");
@@ -1284,6 +1358,8 @@ HttpConfig::startup()
   HttpEstablishStaticConfigByte(c.ignore_accept_encoding_mismatch, "proxy.config.http.cache.ignore_accept_encoding_mismatch");
   HttpEstablishStaticConfigByte(c.ignore_accept_charset_mismatch, "proxy.config.http.cache.ignore_accept_charset_mismatch");
 
+  HttpEstablishStaticConfigByte(c.splice_tunnel, "proxy.config.http.splice_tunnel");
+
   HttpEstablishStaticConfigByte(c.oride.cache_when_to_revalidate, "proxy.config.http.cache.when_to_revalidate");
   HttpEstablishStaticConfigByte(c.cache_when_to_add_no_cache_to_msie_requests,
                                     "proxy.config.http.cache.when_to_add_no_cache_to_msie_requests");
@@ -1399,6 +1475,24 @@ HttpConfig::reconfigure()
     params->origin_min_keep_alive_connections = params->oride.origin_max_connections;
   }
 
+  params->origin_limit = INT_TO_BOOL(m_master.origin_limit);
+  params->origin_limit_min = m_master.origin_limit_min;
+  params->origin_limit_max = m_master.origin_limit_max;
+  if (params->origin_limit_min < 1)
+    params->origin_limit_min = 1;
+  if (params->origin_limit_max < params->origin_limit_min) {
+    Warning("origin_limit.max < origin_limit.min, setting max=min, please correct your records.config");
+    params->origin_limit_max = params->origin_limit_min;
+  }
+  params->origin_limit_latency_tolerance = m_master.origin_limit_latency_tolerance;
+  if (params->origin_limit_latency_tolerance < 1.0)
+    params->origin_limit_latency_tolerance = 1.0;
+  params->origin_limit_backoff = m_master.origin_limit_backoff;
+  if (params->origin_limit_backoff <= 0.0 || params->origin_limit_backoff >= 1.0)
+    params->origin_limit_backoff = 0.9;
+  params->origin_limit_queue_size = m_master.origin_limit_queue_size;
+  params->origin_limit_queue_timeout = m_master.origin_limit_queue_timeout;
+
   params->parent_proxy_routing_enable = INT_TO_BOOL(m_master.parent_proxy_routing_enable);
   params->enable_url_expandomatic = INT_TO_BOOL(m_master.enable_url_expandomatic);
 
@@ -1455,6 +1549,8 @@ HttpConfig::reconfigure()
   params->parent_connect_attempts = m_master.parent_connect_attempts;
   params->per_parent_connect_attempts = m_master.per_parent_connect_attempts;
   params->parent_connect_timeout = m_master.parent_connect_timeout;
+  params->happy_eyeballs = INT_TO_BOOL(m_master.happy_eyeballs);
+  params->happy_eyeballs_delay = m_master.happy_eyeballs_delay;
 
   params->oride.sock_recv_buffer_size_out = m_master.oride.sock_recv_buffer_size_out;
   params->oride.sock_send_buffer_size_out = m_master.oride.sock_send_buffer_size_out;
@@ -1512,6 +1608,9 @@ HttpConfig::reconfigure()
 
   // open write failure retries
   params->max_cache_open_write_retries = m_master.max_cache_open_write_retries;
+  params->cache_collapsed_forwarding = INT_TO_BOOL(m_master.cache_collapsed_forwarding);
+
+  params->cache_range_segment_size = m_master.cache_range_segment_size;
 
   params->oride.cache_http = INT_TO_BOOL(m_master.oride.cache_http);
   params->oride.cache_cluster_cache_local = INT_TO_BOOL(m_master.oride.cache_cluster_cache_local);
@@ -1529,6 +1628,8 @@ HttpConfig::reconfigure()
   params->ignore_accept_encoding_mismatch = m_master.ignore_accept_encoding_mismatch;
   params->ignore_accept_charset_mismatch = m_master.ignore_accept_charset_mismatch;
 
+  params->splice_tunnel = INT_TO_BOOL(m_master.splice_tunnel);
+
   params->oride.cache_when_to_revalidate = m_master.oride.cache_when_to_revalidate;
   params->cache_when_to_add_no_cache_to_msie_requests = m_master.cache_when_to_add_no_cache_to_msie_requests;
 
@@ -178,6 +178,21 @@ enum
   http_background_fill_bytes_aborted_stat,
   http_background_fill_bytes_completed_stat,
 
+  http_tunnel_splices_stat,
+
+  http_happy_eyeballs_races_stat,
+  http_happy_eyeballs_fallbacks_stat,
+  http_happy_eyeballs_fallback_wins_stat,
+
+  http_origin_limit_queued_stat,
+  http_origin_limit_rejected_stat,
+  http_origin_limit_queue_timeouts_stat,
+  http_origin_limit_cuts_stat,
+
+  http_server_session_pool_local_hits_stat,
+  http_server_session_pool_migrations_stat,
+  http_server_session_pool_misses_stat,
+
   http_response_document_size_100_stat,
   http_response_document_size_1K_stat,
   http_response_document_size_3K_stat,
@@ -298,6 +313,9 @@ enum
   http_cache_write_errors,
   http_cache_read_errors,
 
+  // misses served from another transaction's write
+  http_cache_collapsed_requests_stat,
+
   // status code stats
   http_response_status_100_count_stat,
   http_response_status_101_count_stat,
@@ -364,6 +382,22 @@ do { \
 #define HTTP_READ_DYN_SUM(x, S) RecGetRawStatSum(http_rsb, (int)x, &S) // This aggregates threads too
 #define HTTP_READ_GLOBAL_DYN_SUM(x, S) RecGetGlobalRawStatSum(http_rsb, (int)x, &S)
 
+/* Latency histograms, exported as percentiles in microseconds */
+enum
+{
+  http_first_byte_hist,
+  http_origin_connect_hist,
+  http_cache_open_read_hist,
+  http_dns_lookup_hist,
+  http_transaction_hist,
+
+  http_hist_count
+};
+
+extern RecRawHistogramBlock *http_rhb;
+
+#define HTTP_RECORD_HISTOGRAM(x, t) RecRecordRawHistogram(http_rhb, mutex->thread_holding, (int) x, ink_hrtime_to_usec(t))
+
 #define HTTP_ConfigReadInteger         REC_ConfigReadInteger
 #define HTTP_ConfigReadString          REC_ConfigReadString
 #define HTTP_RegisterConfigUpdateFunc  REC_RegisterConfigUpdateFunc
@@ -643,6 +677,17 @@ public:
 
   MgmtInt server_max_connections;
   MgmtInt origin_min_keep_alive_connections; // TODO: This one really ought to be overridable, but difficult right now.
+
+  // Adaptive limit on the requests in flight to each origin server,
+  // see OriginLimit. Requests over it wait up to origin_limit_queue_timeout
+  // msec in a queue of origin_limit_queue_size.
+  MgmtByte origin_limit;
+  MgmtInt origin_limit_min;
+  MgmtInt origin_limit_max;
+  MgmtFloat origin_limit_latency_tolerance;
+  MgmtFloat origin_limit_backoff;
+  MgmtInt origin_limit_queue_size;
+  MgmtInt origin_limit_queue_timeout;
   MgmtInt attach_server_session_to_client;
 
   MgmtByte parent_proxy_routing_enable;
@@ -681,6 +726,11 @@ public:
   MgmtInt per_parent_connect_attempts;
   MgmtInt parent_connect_timeout;
 
+  // Race origin connects to IPv4 and IPv6 addresses, starting the
+  // second one after happy_eyeballs_delay msec (RFC 6555)
+  MgmtByte happy_eyeballs;
+  MgmtInt happy_eyeballs_delay;
+
   ///////////////////////////////////////////////////////////////////
   // Privacy: fields which are removed from the user agent request //
   ///////////////////////////////////////////////////////////////////
@@ -707,6 +757,12 @@ public:
   // open write failure retries.
   MgmtInt max_cache_open_write_retries;
 
+  // read from the writer of a miss instead of fetching it again
+  MgmtByte cache_collapsed_forwarding;
+
+  // size of the segments range requests are cached in, 0 to disable
+  MgmtInt cache_range_segment_size;
+
   ///////////////////
   // cache control //
   ///////////////////
@@ -783,6 +839,12 @@ public:
   MgmtByte ignore_accept_encoding_mismatch;
   MgmtByte ignore_accept_charset_mismatch;
 
+  ///////////////////////////////////////////////////////////////////
+  // Move the body of pass-through tunnels between the client and  //
+  // origin sockets in the kernel (splice) instead of in buffers.   //
+  ///////////////////////////////////////////////////////////////////
+  MgmtByte splice_tunnel;
+
   OverridableHttpConfigParams oride;
 
 private:
@@ -878,6 +940,13 @@ HttpConfigParams::HttpConfigParams()
     proxy_hostname_len(0),
     server_max_connections(0),
     origin_min_keep_alive_connections(0),
+    origin_limit(0),
+    origin_limit_min(8),
+    origin_limit_max(256),
+    origin_limit_latency_tolerance(2.0),
+    origin_limit_backoff(0.9),
+    origin_limit_queue_size(64),
+    origin_limit_queue_timeout(1000),
     parent_proxy_routing_enable(0),
     disable_ssl_parenting(0),
     enable_url_expandomatic(0),
@@ -899,6 +968,8 @@ HttpConfigParams::HttpConfigParams()
     parent_connect_attempts(4),
     per_parent_connect_attempts(2),
     parent_connect_timeout(30),
+    happy_eyeballs(0),
+    happy_eyeballs_delay(250),
     anonymize_other_header_list(NULL),
     global_user_agent_header(NULL),
     global_user_agent_header_size(0),
@@ -909,6 +980,8 @@ HttpConfigParams::HttpConfigParams()
     cache_vary_default_images(NULL),
     cache_vary_default_other(NULL),
     max_cache_open_write_retries(1),
+    cache_collapsed_forwarding(0),
+    cache_range_segment_size(0),
     cache_enable_default_vary_headers(0),
     cache_when_to_add_no_cache_to_msie_requests(-1),
     connect_ports_string(NULL),
@@ -929,7 +1002,8 @@ HttpConfigParams::HttpConfigParams()
     ignore_accept_mismatch(0),
     ignore_accept_language_mismatch(0),
     ignore_accept_encoding_mismatch(0),
-    ignore_accept_charset_mismatch(0)
+    ignore_accept_charset_mismatch(0),
+    splice_tunnel(0)
 {
 }
 
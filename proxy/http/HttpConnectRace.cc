@@ -0,0 +1,293 @@
+/** @file
+
+  Happy Eyeballs (RFC 6555) connects to origin servers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "HttpConnectRace.h"
+#include "HttpConfig.h"
+#include "HttpTransact.h"
+#include "P_Net.h"
+
+ClassAllocator<HttpConnectRace> httpConnectRaceAllocator("httpConnectRaceAllocator");
+
+int
+HttpConnectAttempt::handle_connect(int event, void *data)
+{
+  return race->attempt_done(idx, event, data);
+}
+
+HttpConnectRace::HttpConnectRace()
+  : Continuation(NULL), processor(NULL), hostname(NULL), primary_error(0), fail_window(0), timeout(0), delay(0),
+    lookup(NULL), timer(NULL), lead(PRIMARY), have_alternate(false), looked_up(false), delay_passed(false),
+    done(false), recursion(0)
+{
+  SET_HANDLER(&HttpConnectRace::main_handler);
+  for (int i = 0; i < 2; i++) {
+    connecting[i] = NULL;
+    state[i] = ATTEMPT_IDLE;
+  }
+}
+
+Action *
+HttpConnectRace::connect(Continuation * cont, NetProcessor * processor, const char *hostname, sockaddr const *addr,
+                         NetVCOptions const &opt, NetVCOptions const &alt_opt, bool alternate_first,
+                         ink_hrtime delay, int timeout, sockaddr const *client_addr, int fail_window)
+{
+  HttpConnectRace *race = httpConnectRaceAllocator.alloc();
+  ProxyMutex *mutex = cont->mutex;
+
+  race->mutex = cont->mutex;
+  race->action_ = cont;
+  race->processor = processor;
+  race->hostname = ats_strdup(hostname);
+  ats_ip_copy(&race->addr[PRIMARY], addr);
+  race->opt[PRIMARY] = opt;
+  race->opt[ALTERNATE] = alt_opt;
+  race->delay = delay;
+  race->delay_passed = delay <= 0;
+  race->timeout = timeout;
+  ats_ip_copy(&race->client_addr, client_addr);
+  race->fail_window = fail_window;
+  race->lead = alternate_first ? ALTERNATE : PRIMARY;
+  for (int i = 0; i < 2; i++) {
+    HttpConnectAttempt *a = &race->attempt[i];
+    a->mutex = cont->mutex;
+    a->race = race;
+    a->idx = i;
+    SET_CONTINUATION_HANDLER(a, &HttpConnectAttempt::handle_connect);
+  }
+  HTTP_INCREMENT_DYN_STAT(http_happy_eyeballs_races_stat);
+
+  race->recursion++;
+  // a trailing primary still goes after the stagger, even if the lookup
+  // of the address to lead with has not come back by then
+  if (race->lead == PRIMARY || race->delay_passed)
+    race->start_attempt(PRIMARY);
+  else
+    race->timer = this_ethread()->schedule_in(race, delay);
+
+  if (!race->done) {
+    HostDBProcessor::Options hopt;
+    hopt.port = ats_ip_port_host_order(addr);
+    hopt.host_res_style = ats_is_ip6(addr) ? HOST_RES_IPV4_ONLY : HOST_RES_IPV6_ONLY;
+    race->lookup = ACTION_RESULT_NONE;
+    Action *a = hostDBProcessor.getbyname_re(race, race->hostname, 0, hopt);
+    // the lookup may have called back already
+    if (race->lookup == ACTION_RESULT_NONE)
+      race->lookup = a == ACTION_RESULT_DONE ? NULL : a;
+  }
+  race->recursion--;
+
+  if (race->done) {
+    race->free();
+    return ACTION_RESULT_DONE;
+  }
+  return &race->action_;
+}
+
+int
+HttpConnectRace::main_handler(int event, void *data)
+{
+  recursion++;
+  if (action_.cancelled) {
+    cancel_all();
+    done = true;
+  } else if (event == EVENT_HOST_DB_LOOKUP) {
+    lookup = NULL;
+    lookup_done((HostDBInfo *) data);
+  } else {
+    ink_assert(event == EVENT_INTERVAL);
+    timer = NULL;
+    delay_passed = true;
+    // the trailing attempt starts now, if its address is known
+    int trail = 1 - lead;
+    if (can_start(trail))
+      start_attempt(trail);
+  }
+  recursion--;
+
+  if (done && !recursion) {
+    free();
+    return EVENT_DONE;
+  }
+  return EVENT_CONT;
+}
+
+void
+HttpConnectRace::lookup_done(HostDBInfo * r)
+{
+  looked_up = true;
+  if (r && !r->failed()) {
+    HostDBInfo *info = r;
+
+    if (r->round_robin) {
+      HostDBRoundRobin *rr = r->rr();
+      info = rr ? rr->select_best_http(&client_addr.sa, ink_cluster_time(), fail_window) : NULL;
+    }
+    // with an *_ONLY style only the other family can come back, but be sure
+    if (info && ats_is_ip(info->ip()) && info->ip()->sa_family != addr[PRIMARY].sa.sa_family) {
+      ats_ip_copy(&addr[ALTERNATE], info->ip());
+      addr[ALTERNATE].port() = addr[PRIMARY].port();
+      have_alternate = true;
+    }
+  }
+
+  if (is_debug_tag_set("http_connect_race")) {
+    ip_text_buffer ipb;
+    Debug("http_connect_race", "%s: other family %s", hostname,
+          have_alternate ? ats_ip_ntop(&addr[ALTERNATE].sa, ipb, sizeof(ipb)) : "not found");
+  }
+
+  if (lead == ALTERNATE && !have_alternate) {
+    // with nothing to lead with, the primary goes alone, now
+    lead = PRIMARY;
+    if (timer) {
+      timer->cancel();
+      timer = NULL;
+    }
+    if (can_start(PRIMARY))
+      start_attempt(PRIMARY);
+    else if (state[PRIMARY] == ATTEMPT_FAILED)
+      finish(NET_EVENT_OPEN_FAILED, (void *) primary_error);
+  } else if (lead == ALTERNATE) {
+    // the primary may have started already, if the lookup took longer
+    // than the stagger; if not, the timer armed in connect() starts it
+    if (can_start(ALTERNATE))
+      start_attempt(ALTERNATE);
+    if (delay_passed && can_start(PRIMARY))
+      start_attempt(PRIMARY);
+  } else if (can_start(ALTERNATE) && (delay_passed || state[PRIMARY] == ATTEMPT_FAILED)) {
+    start_attempt(ALTERNATE);
+  } else if (!have_alternate && state[PRIMARY] == ATTEMPT_FAILED) {
+    finish(NET_EVENT_OPEN_FAILED, (void *) primary_error);
+  }
+}
+
+bool
+HttpConnectRace::can_start(int idx) const
+{
+  return state[idx] == ATTEMPT_IDLE && (idx == PRIMARY || have_alternate);
+}
+
+void
+HttpConnectRace::start_attempt(int idx)
+{
+  ip_port_text_buffer ipb;
+  Debug("http_connect_race", "%s: connecting to %s", hostname, ats_ip_nptop(&addr[idx].sa, ipb, sizeof(ipb)));
+
+  if (idx != lead)
+    HTTP_INCREMENT_DYN_STAT(http_happy_eyeballs_fallbacks_stat);
+
+  // the trailing attempt waits out the stagger, unless it goes now
+  if (idx == lead && state[1 - idx] == ATTEMPT_IDLE && !timer && delay > 0)
+    timer = this_ethread()->schedule_in(this, delay);
+  else if (timer && idx != lead) {
+    timer->cancel();
+    timer = NULL;
+  }
+
+  state[idx] = ATTEMPT_CONNECTING;
+  connecting[idx] = ACTION_RESULT_NONE;
+  Action *a = processor->connect_s(&attempt[idx], &addr[idx].sa, timeout, &opt[idx]);
+  // the connect may have called back already
+  if (connecting[idx] == ACTION_RESULT_NONE)
+    connecting[idx] = a == ACTION_RESULT_DONE ? NULL : a;
+}
+
+int
+HttpConnectRace::attempt_done(int idx, int event, void *data)
+{
+  recursion++;
+  connecting[idx] = NULL;
+
+  if (done || action_.cancelled) {
+    // too late, the race is over
+    if (event == NET_EVENT_OPEN)
+      ((NetVConnection *) data)->do_io_close();
+    cancel_all();
+    done = true;
+  } else if (event == NET_EVENT_OPEN) {
+    Debug("http_connect_race", "%s: %s connect won", hostname, idx == PRIMARY ? "primary" : "alternate");
+    if (idx != lead)
+      HTTP_INCREMENT_DYN_STAT(http_happy_eyeballs_fallback_wins_stat);
+    finish(NET_EVENT_OPEN, data);
+  } else {
+    int other = 1 - idx;
+
+    Debug("http_connect_race", "%s: %s connect failed", hostname, idx == PRIMARY ? "primary" : "alternate");
+    state[idx] = ATTEMPT_FAILED;
+    if (idx == PRIMARY)
+      primary_error = (intptr_t) data;
+
+    if (can_start(other)) {
+      start_attempt(other);
+    } else if (state[other] == ATTEMPT_FAILED || (state[other] == ATTEMPT_IDLE && looked_up)) {
+      // the error of the given address, if it was tried
+      finish(NET_EVENT_OPEN_FAILED, (void *) (primary_error ? primary_error : (intptr_t) data));
+    }
+    // otherwise wait for the other connect, or for its address
+  }
+  recursion--;
+
+  if (done && !recursion) {
+    free();
+    return EVENT_DONE;
+  }
+  return EVENT_CONT;
+}
+
+void
+HttpConnectRace::finish(int event, void *data)
+{
+  cancel_all();
+  done = true;
+  action_.continuation->handleEvent(event, data);
+}
+
+void
+HttpConnectRace::cancel_all()
+{
+  for (int i = 0; i < 2; i++) {
+    if (connecting[i] && connecting[i] != ACTION_RESULT_NONE) {
+      connecting[i]->cancel();
+      connecting[i] = NULL;
+    }
+  }
+  if (lookup && lookup != ACTION_RESULT_NONE) {
+    lookup->cancel();
+    lookup = NULL;
+  }
+  if (timer) {
+    timer->cancel();
+    timer = NULL;
+  }
+}
+
+void
+HttpConnectRace::free()
+{
+  ats_free(hostname);
+  hostname = NULL;
+  mutex.clear();
+  for (int i = 0; i < 2; i++)
+    attempt[i].mutex.clear();
+  httpConnectRaceAllocator.free(this);
+}
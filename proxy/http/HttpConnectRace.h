@@ -0,0 +1,124 @@
+/** @file
+
+  Happy Eyeballs (RFC 6555) connects to origin servers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HTTP_CONNECT_RACE_H_
+#define _HTTP_CONNECT_RACE_H_
+
+#include "libts.h"
+#include "P_EventSystem.h"
+#include "I_Net.h"
+#include "I_HostDB.h"
+
+class HttpConnectRace;
+
+struct HttpConnectAttempt:public Continuation
+{
+  HttpConnectRace *race;
+  int idx;
+
+  int handle_connect(int event, void *data);
+};
+
+/**
+  Connects to a host on an address of either family, whichever connects
+  first.
+
+  The race connects to the address HostDB gave for the host, and looks
+  up an address of the other family for it at the same time.  If the
+  first connect is not done within the stagger delay, or fails, it
+  connects to that address as well and takes the first of the two to be
+  established, closing the other.  If the other family won the last race
+  to the host, it leads and the given address trails instead; the given
+  address is still connected to after the stagger delay if the lookup has
+  not come back by then, and at once if it finds no address.
+
+  The continuation is called back as by NetProcessor::connect_s(), with
+  NET_EVENT_OPEN and the NetVConnection of the winner, whose remote
+  address tells which one it was, or NET_EVENT_OPEN_FAILED and the error
+  of the given address when neither can be connected to.
+*/
+class HttpConnectRace:public Continuation
+{
+public:
+  HttpConnectRace();
+
+  /** Races connects to @a addr (with @a opt) and an address of the
+      other family of @a hostname (with @a alt_opt), through @a processor,
+      each with @a timeout (seconds).  @a client_addr and @a fail_window
+      select among round robin addresses as HttpSM does.
+  */
+  static Action *connect(Continuation * cont, NetProcessor * processor, const char *hostname, sockaddr const *addr,
+                         NetVCOptions const &opt, NetVCOptions const &alt_opt, bool alternate_first,
+                         ink_hrtime delay, int timeout, sockaddr const *client_addr, int fail_window);
+
+  int main_handler(int event, void *data);
+  int attempt_done(int idx, int event, void *data);
+
+private:
+  enum
+  {
+    ATTEMPT_IDLE = 0,
+    ATTEMPT_CONNECTING,
+    ATTEMPT_FAILED
+  };
+
+  // the given address and that of the other family
+  enum
+  {
+    PRIMARY = 0,
+    ALTERNATE
+  };
+
+  void lookup_done(HostDBInfo * r);
+  void start_attempt(int idx);
+  bool can_start(int idx) const;
+  void finish(int event, void *data);
+  void cancel_all();
+  void free();
+
+  Action action_;
+  NetProcessor *processor;
+  char *hostname;
+  IpEndpoint addr[2];
+  NetVCOptions opt[2];
+  HttpConnectAttempt attempt[2];
+  Action *connecting[2];
+  int state[2];
+  intptr_t primary_error;
+  IpEndpoint client_addr;
+  int fail_window;
+  int timeout;
+  ink_hrtime delay;
+  Action *lookup;
+  Event *timer;
+  int lead;
+  bool have_alternate;
+  bool looked_up;
+  bool delay_passed;
+  bool done;
+  int recursion;
+};
+
+extern ClassAllocator<HttpConnectRace> httpConnectRaceAllocator;
+
+#endif
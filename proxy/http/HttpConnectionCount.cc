@@ -22,6 +22,356 @@
  */
 
 #include "HttpConnectionCount.h"
+#include "P_EventSystem.h"
 
 
 ConnectionCount ConnectionCount::_connectionCount;
+
+OriginLimit OriginLimit::_originLimit;
+
+OriginLimit::Origin *
+OriginLimit::getOrigin(const IpEndpoint& addr, const Config& config, ink_hrtime now)
+{
+  ConnectionCount::ConnAddr caddr(addr);
+  Origin *origin = _origins.get(caddr);
+
+  if (origin == NULL) {
+    origin = NEW(new Origin);
+    memset(&origin->stats, 0, sizeof(origin->stats));
+    // A host not heard from yet is trusted with the most
+    origin->stats.limit = config.max_limit;
+    origin->slow_start = true;
+    origin->last_cut = 0;
+    origin->last_used = now;
+    origin->window_start = 0;
+    origin->window_min = 0;
+    origin->last_window_min = 0;
+    _origins.put(caddr, origin);
+  }
+  return origin;
+}
+
+// Schedules the waiters that fit under the limit to retry
+void
+OriginLimit::wake(Origin *origin)
+{
+  int room = (int) origin->stats.limit - origin->stats.in_flight;
+
+  for (int i = 0; i < origin->waiters.length() && i < room; i++) {
+    Waiter& waiter = origin->waiters[i];
+
+    if (waiter.cont && !waiter.wakeup)
+      waiter.wakeup = waiter.thread->schedule_imm_signal(waiter.cont, ORIGIN_LIMIT_EVENT_WAKEUP);
+  }
+}
+
+// Forgets the origins with nothing in flight or queued for a while, the
+// map having no removal of its own
+void
+OriginLimit::sweep(ink_hrtime now)
+{
+  typedef MapElem<ConnectionCount::ConnAddr, Origin *> OriginElem;
+  Vec<ConnectionCount::ConnAddr> addrs;
+  Vec<Origin *> origins;
+  int total = 0;
+
+  _lastSweep = now;
+  form_Map(OriginElem, elem, _origins) {
+    Origin *origin = elem->value;
+
+    total++;
+    if (origin->stats.in_flight == 0 && origin->waiters.length() == 0 &&
+        now - origin->last_used >= ORIGIN_LIMIT_IDLE_TIMEOUT) {
+      delete origin;
+    } else {
+      addrs.add(elem->key);
+      origins.add(origin);
+    }
+  }
+  if (origins.length() == total)
+    return;
+  _origins.clear();
+  for (int i = 0; i < origins.length(); i++)
+    _origins.put(addrs[i], origins[i]);
+}
+
+OriginLimit::Result
+OriginLimit::acquire(const IpEndpoint& addr, int64_t& ticket, const Config& config, Continuation *cont)
+{
+  Result result;
+
+  ink_mutex_acquire(&_mutex);
+  Origin *origin = getOrigin(addr, config, ink_get_hrtime());
+  int room = (int) origin->stats.limit - origin->stats.in_flight;
+
+  if (ticket == 0) {
+    // Newcomers do not jump the queue
+    if (room > 0 && origin->waiters.length() == 0) {
+      result = ACQUIRED;
+    } else if (origin->waiters.length() < config.max_queue) {
+      Waiter& waiter = origin->waiters.add();
+
+      ticket = ++_nextTicket;
+      waiter.ticket = ticket;
+      waiter.cont = cont;
+      waiter.thread = cont ? this_ethread() : NULL;
+      waiter.wakeup = NULL;
+      origin->stats.queued++;
+      result = QUEUED;
+    } else {
+      origin->stats.rejected++;
+      result = REJECTED;
+    }
+  } else {
+    int i;
+
+    result = QUEUED;
+    for (i = 0; i < origin->waiters.length(); i++) {
+      if (origin->waiters[i].ticket == ticket)
+        break;
+    }
+    // Those ahead that fit under the limit too have been woken as well
+    if (i < origin->waiters.length()) {
+      // the caller holds the mutex of the continuation, and it is either
+      // the wake up that is running or one that is not wanted any more
+      if (origin->waiters[i].wakeup) {
+        origin->waiters[i].wakeup->cancel();
+        origin->waiters[i].wakeup = NULL;
+      }
+      if (i < room) {
+        origin->waiters.remove_index(i);
+        ticket = 0;
+        result = ACQUIRED;
+      }
+    }
+  }
+
+  if (result == ACQUIRED) {
+    origin->stats.in_flight++;
+    origin->stats.requests++;
+    wake(origin);
+  }
+  ink_mutex_release(&_mutex);
+  return result;
+}
+
+void
+OriginLimit::abandon(const IpEndpoint& addr, int64_t ticket)
+{
+  ConnectionCount::ConnAddr caddr(addr);
+
+  ink_mutex_acquire(&_mutex);
+  Origin *origin = _origins.get(caddr);
+  if (origin) {
+    for (int i = 0; i < origin->waiters.length(); i++) {
+      if (origin->waiters[i].ticket == ticket) {
+        // the caller holds the mutex of the continuation
+        if (origin->waiters[i].wakeup)
+          origin->waiters[i].wakeup->cancel();
+        origin->waiters.remove_index(i);
+        wake(origin);
+        break;
+      }
+    }
+  }
+  ink_mutex_release(&_mutex);
+}
+
+bool
+OriginLimit::cut(Origin *origin, ink_hrtime now, const Config& config)
+{
+  // One cut per round trip, as all the responses of a round trip see the
+  // same overload
+  if (now - origin->last_cut < origin->stats.avg_latency)
+    return false;
+
+  origin->stats.limit *= config.backoff;
+  if (origin->stats.limit < config.min_limit)
+    origin->stats.limit = config.min_limit;
+  origin->slow_start = false;
+  origin->last_cut = now;
+  origin->stats.cuts++;
+  return true;
+}
+
+bool
+OriginLimit::release(const IpEndpoint& addr, ink_hrtime latency, bool failed, const Config& config, ink_hrtime now)
+{
+  if (now == 0)
+    now = ink_get_hrtime();
+
+  ink_mutex_acquire(&_mutex);
+  Origin *origin = getOrigin(addr, config, now);
+  Stats& stats = origin->stats;
+  bool reached = stats.in_flight >= (int) stats.limit || origin->waiters.length() > 0;
+  bool cut_limit = false;
+
+  origin->last_used = now;
+  if (stats.in_flight > 0) {
+    stats.in_flight--;
+  } else {
+    Error("number of requests in flight to an origin should be greater than zero");
+  }
+
+  if (failed) {
+    stats.failures++;
+    cut_limit = cut(origin, now, config);
+  } else if (latency > 0) {
+    if (stats.avg_latency == 0)
+      stats.avg_latency = latency;
+    else
+      stats.avg_latency += (latency - stats.avg_latency) / 8;
+
+    // The lowest latency of this window and the last
+    if (origin->window_min == 0) {
+      origin->window_min = latency;
+      origin->window_start = now;
+    } else if (now - origin->window_start >= ORIGIN_LIMIT_BASE_WINDOW) {
+      origin->last_window_min = origin->window_min;
+      origin->window_min = latency;
+      origin->window_start = now;
+    } else if (latency < origin->window_min) {
+      origin->window_min = latency;
+    }
+    stats.base_latency = origin->window_min;
+    if (origin->last_window_min && origin->last_window_min < stats.base_latency)
+      stats.base_latency = origin->last_window_min;
+
+    if (stats.avg_latency > stats.base_latency * config.tolerance) {
+      cut_limit = cut(origin, now, config);
+    } else if (reached) {
+      stats.limit += origin->slow_start ? 1.0 : 1.0 / stats.limit;
+    }
+  }
+
+  // A limit set lower since the host was first seen applies at once
+  if (stats.limit > config.max_limit)
+    stats.limit = config.max_limit;
+  else if (stats.limit < config.min_limit)
+    stats.limit = config.min_limit;
+
+  wake(origin);
+  if (now - _lastSweep >= ORIGIN_LIMIT_IDLE_TIMEOUT)
+    sweep(now);
+  ink_mutex_release(&_mutex);
+  return cut_limit;
+}
+
+void
+OriginLimit::snapshot(Vec<ConnectionCount::ConnAddr>& addrs, Vec<Stats>& stats)
+{
+  ink_mutex_acquire(&_mutex);
+  typedef MapElem<ConnectionCount::ConnAddr, Origin *> OriginElem;
+
+  form_Map(OriginElem, elem, _origins) {
+    addrs.add(elem->key);
+    stats.add(elem->value->stats);
+    stats.last().waiting = elem->value->waiters.length();
+  }
+  ink_mutex_release(&_mutex);
+}
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+static bool
+origin_limit_stats(const IpEndpoint& addr, OriginLimit::Stats& stats)
+{
+  Vec<ConnectionCount::ConnAddr> addrs;
+  Vec<OriginLimit::Stats> all;
+
+  OriginLimit::getInstance()->snapshot(addrs, all);
+  for (int i = 0; i < addrs.length(); i++) {
+    if (ats_ip_addr_eq(&addrs[i]._addr, &addr)) {
+      stats = all[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+REGRESSION_TEST(OriginLimit_aimd)(RegressionTest * t, int /* atype ATS_UNUSED */, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  OriginLimit *limit = OriginLimit::getInstance();
+  OriginLimit::Config config;
+  OriginLimit::Stats stats;
+  IpEndpoint addr;
+  ink_hrtime now = ink_get_hrtime();
+  int64_t ticket = 0;
+
+  box = REGRESSION_TEST_PASSED;
+  config.min_limit = 2;
+  config.max_limit = 8;
+  config.tolerance = 2.0;
+  config.backoff = 0.5;
+  config.max_queue = 1;
+  // TEST-NET-1, no real origin
+  ats_ip4_set(&addr, htonl(0xc0000201));
+
+  // the base latency is the lowest, and a smoothed latency within the
+  // tolerance of it keeps the limit
+  box.check(limit->acquire(addr, ticket, config) == OriginLimit::ACQUIRED, "first request not let through");
+  box.check(!limit->release(addr, HRTIME_MSECONDS(10), false, config, now), "limit cut on the first response");
+  origin_limit_stats(addr, stats);
+  box.check(stats.limit == 8 && stats.base_latency == HRTIME_MSECONDS(10), "limit %g, base latency %" PRId64,
+            stats.limit, (int64_t) stats.base_latency);
+
+  // over the tolerance it is cut, once per smoothed latency
+  now += HRTIME_SECONDS(1);
+  limit->acquire(addr, ticket, config);
+  box.check(limit->release(addr, HRTIME_MSECONDS(100), false, config, now), "limit not cut on a slow response");
+  limit->acquire(addr, ticket, config);
+  box.check(!limit->release(addr, HRTIME_MSECONDS(100), false, config, now + HRTIME_MSECONDS(1)),
+            "limit cut twice in one round trip");
+  origin_limit_stats(addr, stats);
+  box.check(stats.limit == 4 && stats.cuts == 1, "limit %g after %" PRId64 " cuts, expected 4 after 1", stats.limit,
+            stats.cuts);
+
+  // failures cut it too, down to the minimum
+  for (int i = 0; i < 3; i++) {
+    now += HRTIME_SECONDS(1);
+    limit->acquire(addr, ticket, config);
+    limit->release(addr, 0, true, config, now);
+  }
+  origin_limit_stats(addr, stats);
+  box.check(stats.limit == 2 && stats.failures == 3, "limit %g after failures, expected 2", stats.limit);
+
+  // past slow start it grows by one per limit's worth of responses, only
+  // while it is reached
+  // (once the smoothed latency is back within the tolerance)
+  now += HRTIME_SECONDS(1);
+  for (int i = 0; i < 8; i++) {
+    limit->acquire(addr, ticket, config);
+    limit->release(addr, HRTIME_MSECONDS(10), false, config, now);
+  }
+  origin_limit_stats(addr, stats);
+  box.check(stats.limit == 2 && stats.avg_latency < HRTIME_MSECONDS(20), "limit %g grew while not reached",
+            stats.limit);
+  box.check(limit->acquire(addr, ticket, config) == OriginLimit::ACQUIRED &&
+            limit->acquire(addr, ticket, config) == OriginLimit::ACQUIRED, "requests under the limit held back");
+  limit->release(addr, HRTIME_MSECONDS(10), false, config, now);
+  origin_limit_stats(addr, stats);
+  box.check(stats.limit == 2.5, "limit %g, expected 2.5", stats.limit);
+
+  // over the limit requests queue, in order, up to the queue size
+  box.check(limit->acquire(addr, ticket, config) == OriginLimit::ACQUIRED, "request under the limit held back");
+  box.check(limit->acquire(addr, ticket, config) == OriginLimit::QUEUED && ticket != 0, "request over the limit not queued");
+  int64_t other = 0;
+  box.check(limit->acquire(addr, other, config) == OriginLimit::REJECTED, "request over a full queue not rejected");
+  box.check(limit->acquire(addr, ticket, config) == OriginLimit::QUEUED, "queued request let through over the limit");
+  limit->release(addr, HRTIME_MSECONDS(10), false, config, now);
+  box.check(limit->acquire(addr, ticket, config) == OriginLimit::ACQUIRED && ticket == 0, "queued request not let through");
+  limit->release(addr, HRTIME_MSECONDS(10), false, config, now);
+  limit->release(addr, HRTIME_MSECONDS(10), false, config, now);
+
+  // and once idle the origin is forgotten
+  now += ORIGIN_LIMIT_IDLE_TIMEOUT;
+  ats_ip4_set(&addr, htonl(0xc0000202));
+  limit->acquire(addr, ticket, config);
+  limit->release(addr, HRTIME_MSECONDS(10), false, config, now);
+  box.check(origin_limit_stats(addr, stats), "busy origin forgotten");
+  ats_ip4_set(&addr, htonl(0xc0000201));
+  box.check(!origin_limit_stats(addr, stats), "idle origin not forgotten");
+}
+#endif
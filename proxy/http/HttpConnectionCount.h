@@ -24,8 +24,10 @@
 //
 #include "libts.h"
 #include "Map.h"
+#include "I_EventSystem.h"
 
 #ifndef _HTTP_CONNECTION_COUNT_H_
+#define _HTTP_CONNECTION_COUNT_H_
 
 /**
  * Singleton class to keep track of the number of connections per host
@@ -93,4 +95,140 @@ private:
   ink_mutex _mutex;
 };
 
+// Sent to a state machine turned away by the origin limit
+#define ORIGIN_LIMIT_EVENT_OVERLOADED (CONGESTION_EVENT_EVENTS_START + 5)
+// Sent to a queued state machine when a slot of the origin may be free
+#define ORIGIN_LIMIT_EVENT_WAKEUP (CONGESTION_EVENT_EVENTS_START + 6)
+// How long the lowest latency of an origin is its base latency
+#define ORIGIN_LIMIT_BASE_WINDOW HRTIME_SECONDS(60)
+// How long an origin with nothing in flight or queued is remembered
+#define ORIGIN_LIMIT_IDLE_TIMEOUT HRTIME_SECONDS(300)
+
+/**
+ * Singleton class to keep an adaptive limit on the number of requests
+ * in flight to each origin server.
+ *
+ * The limit follows the latency of the origin's responses (AIMD).  It
+ * is cut by the backoff factor when the smoothed latency goes over the
+ * tolerance times the base latency, or a request fails, at most once per
+ * smoothed latency.  Otherwise it grows while it is reached: by one per
+ * response until the first cut (slow start), then by one per limit's
+ * worth of responses.  The base latency is the lowest seen in the last
+ * one or two minutes, so that a lasting change of the origin is taken
+ * as its new normal.
+ *
+ * Requests over the limit wait in a queue of bounded length, and take a
+ * freed slot in order of arrival.  They are called back when a slot may
+ * be theirs, rather than polling.  Origins idle for
+ * ORIGIN_LIMIT_IDLE_TIMEOUT are forgotten.
+ */
+class OriginLimit
+{
+public:
+  struct Config {
+    int min_limit;
+    int max_limit;
+    float tolerance;
+    float backoff;
+    int max_queue;
+  };
+
+  enum Result {
+    ACQUIRED,
+    QUEUED,
+    REJECTED
+  };
+
+  /// Limit state of one origin server, as shown on the stat pages
+  struct Stats {
+    int in_flight;
+    int waiting;
+    double limit;
+    ink_hrtime base_latency;
+    ink_hrtime avg_latency;
+    int64_t requests;
+    int64_t failures;
+    int64_t cuts;
+    int64_t queued;
+    int64_t rejected;
+  };
+
+  /**
+   * Static method to get the instance of the class
+   * @return Returns a pointer to the instance of the class
+   */
+  static OriginLimit *getInstance() {
+    return &_originLimit;
+  }
+
+  /**
+   * Takes a slot for a request to the host, or a place in its queue
+   * @param addr IP address of the host
+   * @param ticket 0 for a new request, which gets the ticket of its
+   *   place in the queue if it is queued; that ticket when it retries
+   * @param cont Called back with ORIGIN_LIMIT_EVENT_WAKEUP, on the
+   *   thread it is queued from, when a slot may be free for it; it must
+   *   then retry, and abandon() its place before it goes away
+   * @return ACQUIRED with a slot, QUEUED to retry later with the
+   *   ticket, REJECTED if the queue is full
+   */
+  Result acquire(const IpEndpoint& addr, int64_t& ticket, const Config& config, Continuation *cont = NULL);
+
+  /**
+   * Gives up a place in the queue of the host, cancelling its wake up.
+   * Must be called with the mutex of its continuation held.
+   */
+  void abandon(const IpEndpoint& addr, int64_t ticket);
+
+  /**
+   * Returns a slot taken with acquire() and adapts the limit of the host
+   * @param latency Response latency, 0 if there is none to go by
+   * @param failed Whether the request failed at the origin
+   * @param now The current time, 0 to look it up
+   * @return Whether the limit was cut
+   */
+  bool release(const IpEndpoint& addr, ink_hrtime latency, bool failed, const Config& config, ink_hrtime now = 0);
+
+  /**
+   * Copies the state of every host for display
+   */
+  void snapshot(Vec<ConnectionCount::ConnAddr>& addrs, Vec<Stats>& stats);
+
+private:
+  // Hide the constructor and copy constructor
+  OriginLimit() : _nextTicket(0), _lastSweep(0) {
+    ink_mutex_init(&_mutex, "OriginLimitMutex");
+  }
+  OriginLimit(const OriginLimit & /* x ATS_UNUSED */) { }
+
+  struct Waiter {
+    int64_t ticket;
+    Continuation *cont;
+    EThread *thread;
+    Event *wakeup;              // scheduled and not yet retried
+  };
+
+  struct Origin {
+    Stats stats;
+    bool slow_start;
+    ink_hrtime last_cut;
+    ink_hrtime last_used;
+    ink_hrtime window_start;
+    ink_hrtime window_min;
+    ink_hrtime last_window_min;
+    Vec<Waiter> waiters;
+  };
+
+  Origin *getOrigin(const IpEndpoint& addr, const Config& config, ink_hrtime now);
+  bool cut(Origin *origin, ink_hrtime now, const Config& config);
+  void wake(Origin *origin);
+  void sweep(ink_hrtime now);
+
+  static OriginLimit _originLimit;
+  HashMap<ConnectionCount::ConnAddr, ConnectionCount::ConnAddrHashFns, Origin *> _origins;
+  int64_t _nextTicket;
+  ink_hrtime _lastSweep;
+  ink_mutex _mutex;
+};
+
 #endif
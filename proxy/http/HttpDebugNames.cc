@@ -29,6 +29,7 @@
 #include "ICPevents.h"
 #include "HttpSM.h"
 #include "HttpUpdateSM.h"
+#include "HttpConnectionCount.h"
 
 //----------------------------------------------------------------------------
 const char *
@@ -59,6 +60,8 @@ HttpDebugNames::get_server_state_name(HttpTransact::ServerState_t state)
     return "CONGEST_CONTROL_CONGESTED_ON_F";
   case HttpTransact::CONGEST_CONTROL_CONGESTED_ON_M:
     return "CONGEST_CONTROL_CONGESTED_ON_M";
+  case HttpTransact::ORIGIN_OVERLOADED:
+    return "ORIGIN_OVERLOADED";
   }
 
   return ("unknown state name");
@@ -227,6 +230,10 @@ HttpDebugNames::get_event_name(int event)
     return ("CONGESTION_EVENT_CONGESTED_ON_F");
   case CONGESTION_EVENT_CONGESTED_ON_M:
     return ("CONGESTION_EVENT_CONGESTED_ON_M");
+  case ORIGIN_LIMIT_EVENT_OVERLOADED:
+    return ("ORIGIN_LIMIT_EVENT_OVERLOADED");
+  case ORIGIN_LIMIT_EVENT_WAKEUP:
+    return ("ORIGIN_LIMIT_EVENT_WAKEUP");
 
     //////////////////////////////
     //  Plugin Events
@@ -33,6 +33,7 @@
 #include "HttpPages.h"
 #include "HttpSM.h"
 #include "HttpDebugNames.h"
+#include "HttpConnectionCount.h"
 
 HttpSMListBucket HttpSMList[HTTP_LIST_BUCKETS];
 
@@ -58,6 +59,8 @@ HttpPagesHandler::HttpPagesHandler(Continuation * cont, HTTPHdr * header)
     request = arena.str_store(request, length);
     SET_HANDLER(&HttpPagesHandler::handle_smdetails);
 
+  } else if (strncmp(request, "origin_limits", sizeof("origin_limits")) == 0) {
+    SET_HANDLER(&HttpPagesHandler::handle_origin_limits);
   } else {
     SET_HANDLER(&HttpPagesHandler::handle_smlist);
   }
@@ -427,6 +430,73 @@ HttpPagesHandler::handle_smlist(int event, void */* data ATS_UNUSED */)
   return EVENT_DONE;
 }
 
+int
+HttpPagesHandler::handle_origin_limits(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+{
+  Vec<ConnectionCount::ConnAddr> addrs;
+  Vec<OriginLimit::Stats> stats;
+  static const char *columns[] = { "Origin", "In flight", "Limit", "Waiting", "Base latency (ms)",
+                                   "Latency (ms)", "Requests", "Failures", "Cuts", "Queued", "Rejected" };
+  int ncolumns = sizeof(columns) / sizeof(columns[0]);
+
+  OriginLimit::getInstance()->snapshot(addrs, stats);
+
+  resp_begin("Http:Origin Limits");
+  resp_begin_table(1, ncolumns, 100);
+  resp_begin_row();
+  for (int i = 0; i < ncolumns; i++) {
+    resp_begin_column();
+    resp_add("<b>%s</b>", columns[i]);
+    resp_end_column();
+  }
+  resp_end_row();
+
+  for (int i = 0; i < addrs.length(); i++) {
+    char addrbuf[INET6_ADDRSTRLEN];
+    OriginLimit::Stats& s = stats[i];
+
+    resp_begin_row();
+    resp_begin_column();
+    resp_add("%s", ats_ip_ntop(&addrs[i]._addr.sa, addrbuf, sizeof(addrbuf)));
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%d", s.in_flight);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%.1f", s.limit);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%d", s.waiting);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%.1f", (double) s.base_latency / HRTIME_MSECOND);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%.1f", (double) s.avg_latency / HRTIME_MSECOND);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, s.requests);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, s.failures);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, s.cuts);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, s.queued);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, s.rejected);
+    resp_end_column();
+    resp_end_row();
+  }
+  resp_end_table();
+
+  resp_end();
+  return handle_callback(EVENT_NONE, NULL);
+}
+
 int
 HttpPagesHandler::handle_callback(int /* event ATS_UNUSED */, void * /* edata ATS_UNUSED */)
 {
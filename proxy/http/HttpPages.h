@@ -62,6 +62,7 @@ public:
 
   int handle_smlist(int event, void *edata);
   int handle_smdetails(int event, void *edata);
+  int handle_origin_limits(int event, void *edata);
   int handle_callback(int event, void *edata);
   Action action;
 
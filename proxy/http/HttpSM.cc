@@ -28,6 +28,8 @@
 #include "HttpServerSession.h"
 #include "HttpDebugNames.h"
 #include "HttpSessionManager.h"
+#include "HttpConnectRace.h"
+#include "HttpConnectionCount.h"
 #include "P_Cache.h"
 #include "P_Net.h"
 #include "StatPages.h"
@@ -312,7 +314,8 @@ HttpSM::HttpSM()
     history_pos(0), tunnel(), ua_entry(NULL),
     ua_session(NULL), background_fill(BACKGROUND_FILL_NONE),
     ua_raw_buffer_reader(NULL),
-    server_entry(NULL), server_session(NULL), shared_session_retries(0),
+    server_entry(NULL), server_session(NULL), shared_session_retries(0), server_connect_raced(false),
+    origin_limit_held(false), origin_limit_ticket(0), origin_limit_wait_start(0),
     server_buffer_reader(NULL),
     transform_info(), post_transform_info(), has_active_plugin_agents(false),
     second_cache_sm(NULL),
@@ -1092,6 +1095,9 @@ HttpSM::state_raw_http_server_open(int event, void *data)
   milestones.server_connect_end = ink_get_hrtime();
   NetVConnection *netvc = NULL;
 
+  // woken before the wait for the origin limit timed out
+  if (event == ORIGIN_LIMIT_EVENT_WAKEUP && pending_action)
+    pending_action->cancel();
   pending_action = NULL;
   switch (event) {
   case NET_EVENT_OPEN:
@@ -1105,13 +1111,20 @@ HttpSM::state_raw_http_server_open(int event, void *data)
     server_entry->vc = netvc = (NetVConnection *) data;
     server_entry->vc_type = HTTP_RAW_SERVER_VC;
     t_state.current.state = HttpTransact::CONNECTION_ALIVE;
+    // A tunnel would hold its slot for as long as it lasts
+    origin_limit_release(0, false);
 
     netvc->set_inactivity_timeout(HRTIME_SECONDS(t_state.txn_conf->transaction_no_activity_timeout_out));
     netvc->set_active_timeout(HRTIME_SECONDS(t_state.txn_conf->transaction_active_timeout_out));
     break;
 
+  case EVENT_INTERVAL:
+  case ORIGIN_LIMIT_EVENT_WAKEUP:
+    do_http_server_open(true);
+    return 0;
   case VC_EVENT_ERROR:
   case NET_EVENT_OPEN_FAILED:
+    origin_limit_release(0, true);
     if (t_state.pCongestionEntry != NULL) {
       t_state.current.state = HttpTransact::CONNECTION_ERROR;
       call_transact_and_set_next_state(HttpTransact::HandleResponse);
@@ -1128,6 +1141,9 @@ HttpSM::state_raw_http_server_open(int event, void *data)
   case CONGESTION_EVENT_CONGESTED_ON_M:
     t_state.current.state = HttpTransact::CONGEST_CONTROL_CONGESTED_ON_M;
     break;
+  case ORIGIN_LIMIT_EVENT_OVERLOADED:
+    t_state.current.state = HttpTransact::ORIGIN_OVERLOADED;
+    break;
 
   default:
     ink_release_assert(0);
@@ -1639,13 +1655,22 @@ HttpSM::state_http_server_open(int event, void *data)
   STATE_ENTER(&HttpSM::state_http_server_open, event);
   // TODO decide whether to uncomment after finish testing redirect
   // ink_assert(server_entry == NULL);
+  // woken before the wait for the origin limit timed out
+  if (event == ORIGIN_LIMIT_EVENT_WAKEUP && pending_action)
+    pending_action->cancel();
   pending_action = NULL;
   milestones.server_connect_end = ink_get_hrtime();
   HttpServerSession *session;
 
+  bool raced = server_connect_raced;
+  server_connect_raced = false;
+
   switch (event) {
   case NET_EVENT_OPEN:
-    session = (2 == t_state.txn_conf->share_server_sessions) ? 
+    if (raced)
+      note_server_connect_race(((NetVConnection *) data)->get_remote_addr());
+
+    session = (t_state.txn_conf->share_server_sessions >= 2) ? 
       THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding) :
       httpServerSessionAllocator.alloc();
     session->share_session = t_state.txn_conf->share_server_sessions;
@@ -1681,10 +1706,12 @@ HttpSM::state_http_server_open(int event, void *data)
     handle_http_server_open();
     return 0;
   case EVENT_INTERVAL:
+  case ORIGIN_LIMIT_EVENT_WAKEUP:
     do_http_server_open();
     break;
   case VC_EVENT_ERROR:
   case NET_EVENT_OPEN_FAILED:
+    origin_limit_release(0, true);
     t_state.current.state = HttpTransact::CONNECTION_ERROR;
     // save the errno from the connect fail for future use (passed as negative value, flip back)
     t_state.current.server->set_connect_fail(event == NET_EVENT_OPEN_FAILED ? -reinterpret_cast<intptr_t>(data) : ECONNABORTED);
@@ -1719,6 +1746,10 @@ HttpSM::state_http_server_open(int event, void *data)
     t_state.current.state = HttpTransact::CONGEST_CONTROL_CONGESTED_ON_M;
     call_transact_and_set_next_state(HttpTransact::HandleResponse);
     return 0;
+  case ORIGIN_LIMIT_EVENT_OVERLOADED:
+    t_state.current.state = HttpTransact::ORIGIN_OVERLOADED;
+    call_transact_and_set_next_state(HttpTransact::HandleResponse);
+    return 0;
 
   default:
     Error("[HttpSM::state_http_server_open] Unknown event: %d", event);
@@ -1813,6 +1844,14 @@ HttpSM::state_read_server_response_header(int event, void *data)
     server_entry->read_vio->nbytes = server_entry->read_vio->ndone;
     http_parser_clear(&http_parser);
     milestones.server_read_header_done = ink_get_hrtime();
+
+    // A request body would count its upload in the latency
+    if (origin_limit_held) {
+      bool unavailable = state == PARSE_DONE &&
+        t_state.hdr_info.server_response.status_get() == HTTP_STATUS_SERVICE_UNAVAILABLE;
+      origin_limit_release(t_state.hdr_info.request_content_length > 0 ? 0 :
+                           milestones.server_read_header_done - milestones.server_begin_write, unavailable);
+    }
   }
 
   switch (state) {
@@ -2471,6 +2510,13 @@ HttpSM::state_cache_open_read(int event, void *data)
 
     DebugSM("http", "[%" PRId64 "] cache_open_read - " "CACHE_EVENT_OPEN_READ_FAILED", sm_id);
     DebugSM("http", "[state_cache_open_read] open read failed.");
+    // The whole object is not cached, look up the segment holding the range
+    if (data != (void *) -ECACHE_DOC_BUSY && t_state.range_segment < 0 &&
+        (t_state.range_segment = HttpTransact::range_segment_for_request(&t_state)) >= 0) {
+      DebugSM("http", "[%" PRId64 "] cache_open_read - looking up segment %" PRId64, sm_id, t_state.range_segment);
+      do_cache_lookup_and_read();
+      break;
+    }
     // Inform HttpTransact somebody else is updating the document
     // HttpCacheSM already waited so transact should go ahead.
     if (data == (void *) -ECACHE_DOC_BUSY)
@@ -4235,6 +4281,7 @@ HttpSM::do_range_setup_if_necessary()
   ink_assert(field != NULL);
   
   t_state.range_setup = HttpTransact::RANGE_NONE;
+  t_state.range_in_cache = false;
 
   if (t_state.method == HTTP_WKSIDX_GET && t_state.hdr_info.client_request.version_get() == HTTPVersion(1, 1)) {
     do_range_parse(field);
@@ -4249,6 +4296,9 @@ HttpSM::do_range_setup_if_necessary()
         api_hooks.get(TS_HTTP_RESPONSE_TRANSFORM_HOOK) == NULL) {
       Debug("http_trans", "Unable to accelerate range request, fallback to transform");
       content_type = t_state.cache_info.object_read->response_get()->value_get(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, &field_content_type_len);
+      // if the cache can seek, it reads only the fragments under the ranges
+      // and the transform just adds the boundaries
+      t_state.range_in_cache = cache_sm.cache_read_vc->is_pread_capable();
       //create a Range: transform processor for requests of type Range: bytes=1-2,4-5,10-100 (eg. multiple ranges)
       range_trans = transformProcessor.range_transform(mutex,
           t_state.ranges,
@@ -4256,13 +4306,75 @@ HttpSM::do_range_setup_if_necessary()
           &t_state.hdr_info.transform_response,
           content_type,
           field_content_type_len,
-          t_state.cache_info.object_read->object_size_get()
+          t_state.cache_info.object_read->object_size_get(),
+          t_state.range_in_cache
           );
       api_hooks.append(TS_HTTP_RESPONSE_TRANSFORM_HOOK, range_trans);
     }
   }
 }
 
+// sets up the Range transformation of the segment in response for the part
+// of the client's range it holds.  The segment's body starts at its own
+// offset in the object, which is where the transform starts counting from.
+// It runs ahead of any plugin transform, which so sees the client's range
+// as when a 206 is passed through.  If the segment does not hold the
+// range, range_setup says whether its start is past the end of the object.
+bool
+HttpSM::do_range_segment_setup(HTTPHdr *response)
+{
+  int64_t start, end, seg_start, seg_end, total;
+  INKVConnInternal *range_trans;
+  int field_content_type_len = -1;
+  const char *content_type;
+
+  ink_assert(t_state.range_segment >= 0 && t_state.ranges == NULL);
+
+  if (!HttpTransact::parse_single_range(&t_state.hdr_info.client_request, &start, &end) ||
+      !HttpTransact::parse_content_range(response, &seg_start, &seg_end, &total)) {
+    t_state.range_setup = HttpTransact::RANGE_NOT_HANDLED;
+    return false;
+  }
+  if (start < seg_start || start > seg_end) {
+    Debug("http_range", "[%" PRId64 "] segment %" PRId64 "-%" PRId64 "/%" PRId64 " does not hold %" PRId64,
+          sm_id, seg_start, seg_end, total, start);
+    t_state.range_setup = start >= total ? HttpTransact::RANGE_NOT_SATISFIABLE : HttpTransact::RANGE_NOT_HANDLED;
+    return false;
+  }
+  // only the end of the object cuts the (closed) range short
+  if (end > seg_end) {
+    if (seg_end != total - 1) {
+      t_state.range_setup = HttpTransact::RANGE_NOT_HANDLED;
+      return false;
+    }
+    end = seg_end;
+  }
+
+  t_state.ranges = NEW(new RangeRecord[1]);
+  t_state.ranges[0]._start = start;
+  t_state.ranges[0]._end = end;
+  t_state.ranges[0]._done_byte = seg_start - 1;
+  t_state.num_range_fields = 1;
+  t_state.range_output_cl = end - start + 1;
+  t_state.range_segment_total = total;
+  t_state.range_setup = HttpTransact::RANGE_REQUESTED;
+  // the cache gets the segment, the client just its part of it
+  t_state.api_info.cache_untransformed = true;
+
+  Debug("http_range", "[%" PRId64 "] serving %" PRId64 "-%" PRId64 " from segment %" PRId64 "-%" PRId64 "/%" PRId64,
+        sm_id, start, end, seg_start, seg_end, total);
+  content_type = response->value_get(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, &field_content_type_len);
+  range_trans = transformProcessor.range_transform(mutex,
+      t_state.ranges,
+      t_state.num_range_fields,
+      &t_state.hdr_info.transform_response,
+      content_type,
+      field_content_type_len,
+      total);
+  api_hooks.prepend(TS_HTTP_RESPONSE_TRANSFORM_HOOK, range_trans);
+  return true;
+}
+
 
 void
 HttpSM::do_cache_lookup_and_read()
@@ -4425,6 +4537,159 @@ HttpSM::do_cache_prepare_action(HttpCacheSM * c_sm, CacheHTTPInfo * object_read_
   }
 }
 
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpSM::can_race_server_connect()
+//
+//  Whether the connect to the origin server may race an address of the
+//  other family (Happy Eyeballs, RFC 6555).  The address must be one
+//  HostDB gave for the host name, and nothing must tie the connect to
+//  its family.
+//
+//////////////////////////////////////////////////////////////////////////
+bool
+HttpSM::can_race_server_connect(NetVCOptions const& opt)
+{
+  HostResStyle style = ua_session ? ua_session->host_res_style : HOST_RES_IPV4;
+  IpAddr literal;
+
+  if (!t_state.http_config_param->happy_eyeballs || t_state.current.request_to != HttpTransact::ORIGIN_SERVER)
+    return false;
+  if (!t_state.dns_info.lookup_success || t_state.dns_info.srv_lookup_success || t_state.api_server_addr_set ||
+      t_state.dns_info.os_addr_style == HttpTransact::DNSLookupInfo::OS_ADDR_TRY_CLIENT ||
+      t_state.dns_info.os_addr_style == HttpTransact::DNSLookupInfo::OS_ADDR_USE_CLIENT)
+    return false;
+  if (opt.addr_binding == NetVCOptions::FOREIGN_ADDR || style == HOST_RES_IPV4_ONLY || style == HOST_RES_IPV6_ONLY)
+    return false;
+  if (!t_state.current.server->name || 0 == literal.load(t_state.current.server->name))
+    return false;
+  return ats_ip_addr_eq(&t_state.current.server->addr.sa, t_state.host_db_info.ip());
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpSM::note_server_connect_race()
+//
+//  Records the family of the address that won a raced connect in HostDB,
+//  for the next connect to the host, and makes it the server address.
+//
+//////////////////////////////////////////////////////////////////////////
+void
+HttpSM::note_server_connect_race(sockaddr const* winner)
+{
+  unsigned int family = ats_is_ip6(winner) ? HostDBApplicationInfo::CONNECT_FAMILY_IPV6 :
+    HostDBApplicationInfo::CONNECT_FAMILY_IPV4;
+
+  if (t_state.host_db_info.app.http_data.connect_family != family) {
+    t_state.host_db_info.app.http_data.connect_family = family;
+    hostDBProcessor.setby_connect_family(t_state.current.server->name, strlen(t_state.current.server->name),
+                                         &t_state.current.server->addr.sa, family);
+  }
+
+  if (!ats_ip_addr_eq(winner, &t_state.current.server->addr.sa)) {
+    char addrbuf[INET6_ADDRPORTSTRLEN];
+    DebugSM("http", "[%" PRId64 "] connected to %s on its other address %s", sm_id, t_state.current.server->name,
+            ats_ip_nptop(winner, addrbuf, sizeof(addrbuf)));
+    ats_ip_copy(&t_state.current.server->addr, winner);
+  }
+}
+
+static void
+origin_limit_config(HttpConfigParams const* params, OriginLimit::Config& config)
+{
+  config.min_limit = params->origin_limit_min;
+  config.max_limit = params->origin_limit_max;
+  config.tolerance = params->origin_limit_latency_tolerance;
+  config.backoff = params->origin_limit_backoff;
+  config.max_queue = params->origin_limit_queue_size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpSM::origin_limit_acquire()
+//
+//  Takes a slot under the adaptive limit of the origin server.  If the
+//  limit is reached, waits in the queue of the origin until it wakes the
+//  state machine for a slot, or turns the request away when the queue is
+//  full or the wait times out.  Returns false unless the request can go
+//  to the origin now.
+//
+//////////////////////////////////////////////////////////////////////////
+bool
+HttpSM::origin_limit_acquire()
+{
+  OriginLimit::Config config;
+  bool waiting = origin_limit_ticket != 0;
+  ink_hrtime wait;
+  char addrbuf[INET6_ADDRSTRLEN];
+
+  origin_limit_config(t_state.http_config_param, config);
+  if (!waiting)
+    ats_ip_copy(&origin_limit_addr, &t_state.current.server->addr);
+
+  switch (OriginLimit::getInstance()->acquire(origin_limit_addr, origin_limit_ticket, config, this)) {
+  case OriginLimit::ACQUIRED:
+    origin_limit_held = true;
+    return true;
+  case OriginLimit::QUEUED:
+    if (!waiting) {
+      DebugSM("http", "[%" PRId64 "] waiting for the limit of %s", sm_id,
+              ats_ip_ntop(&origin_limit_addr.sa, addrbuf, sizeof(addrbuf)));
+      HTTP_INCREMENT_DYN_STAT(http_origin_limit_queued_stat);
+      origin_limit_wait_start = ink_get_hrtime();
+    }
+    wait = origin_limit_wait_start + HRTIME_MSECONDS(t_state.http_config_param->origin_limit_queue_timeout) -
+      ink_get_hrtime();
+    if (wait <= 0) {
+      DebugSM("http", "[%" PRId64 "] timed out waiting for the limit of %s", sm_id,
+              ats_ip_ntop(&origin_limit_addr.sa, addrbuf, sizeof(addrbuf)));
+      HTTP_INCREMENT_DYN_STAT(http_origin_limit_queue_timeouts_stat);
+      OriginLimit::getInstance()->abandon(origin_limit_addr, origin_limit_ticket);
+      origin_limit_ticket = 0;
+      handleEvent(ORIGIN_LIMIT_EVENT_OVERLOADED, NULL);
+      return false;
+    }
+    // the origin limit wakes us up sooner when a slot is free
+    ink_assert(pending_action == NULL);
+    pending_action = eventProcessor.schedule_in(this, wait);
+    return false;
+  case OriginLimit::REJECTED:
+  default:
+    DebugSM("http", "[%" PRId64 "] queue full for the limit of %s", sm_id,
+            ats_ip_ntop(&origin_limit_addr.sa, addrbuf, sizeof(addrbuf)));
+    HTTP_INCREMENT_DYN_STAT(http_origin_limit_rejected_stat);
+    handleEvent(ORIGIN_LIMIT_EVENT_OVERLOADED, NULL);
+    return false;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpSM::origin_limit_release()
+//
+//  Returns the slot taken by origin_limit_acquire(), or gives up the
+//  place in the queue, feeding the outcome of the request to the limit
+//  of the origin server.
+//
+//////////////////////////////////////////////////////////////////////////
+void
+HttpSM::origin_limit_release(ink_hrtime latency, bool failed)
+{
+  OriginLimit::Config config;
+
+  if (origin_limit_ticket) {
+    OriginLimit::getInstance()->abandon(origin_limit_addr, origin_limit_ticket);
+    origin_limit_ticket = 0;
+  }
+  if (!origin_limit_held)
+    return;
+
+  origin_limit_held = false;
+  origin_limit_config(t_state.http_config_param, config);
+  if (OriginLimit::getInstance()->release(origin_limit_addr, latency, failed, config))
+    HTTP_INCREMENT_DYN_STAT(http_origin_limit_cuts_stat);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //
 //  HttpSM::do_http_server_open()
@@ -4491,6 +4756,12 @@ HttpSM::do_http_server_open(bool raw)
       return;
     }
   }
+  // Hold the request back while the origin server has as many in flight
+  //  as it can take
+  if (t_state.http_config_param->origin_limit && t_state.current.request_to == HttpTransact::ORIGIN_SERVER &&
+      !origin_limit_held && !origin_limit_acquire()) {
+    return;
+  }
   // If this is not a raw connection, we try to get a session from the
   //  shared session pool.  Raw connections are for SSLs tunnel and
   //  require a new connection
@@ -4633,7 +4904,54 @@ HttpSM::do_http_server_open(bool raw)
     }
   }
 
-  if (t_state.scheme == URL_WKSIDX_HTTPS) {
+  // Setup the timeouts
+  // Set the inactivity timeout to the connect timeout so that we
+  //   we fail this server if it doesn't start sending the response
+  //   header
+  MgmtInt connect_timeout;
+  if (t_state.method == HTTP_WKSIDX_POST || t_state.method == HTTP_WKSIDX_PUT) {
+    connect_timeout = t_state.txn_conf->post_connect_attempts_timeout;
+  } else if (t_state.current.server == &t_state.parent_info) {
+    connect_timeout = t_state.http_config_param->parent_connect_timeout;
+  } else {
+    if (t_state.pCongestionEntry != NULL)
+      connect_timeout = t_state.pCongestionEntry->connect_timeout();
+    else
+      connect_timeout = t_state.txn_conf->connect_attempts_timeout;
+  }
+
+  if (can_race_server_connect(opt)) {
+    // Happy Eyeballs: race an address of the other family, leading with
+    // it if it won the last race to this host
+    int alt_family = AF_INET6 == ip_family ? AF_INET : AF_INET6;
+    int alt_won = AF_INET6 == alt_family ? HostDBApplicationInfo::CONNECT_FAMILY_IPV6 :
+      HostDBApplicationInfo::CONNECT_FAMILY_IPV4;
+    NetVCOptions alt_opt = opt;
+
+    alt_opt.ip_family = alt_family;
+    if (opt.addr_binding == NetVCOptions::INTF_ADDR) {
+      IpAddr& alt_ip = AF_INET6 == alt_family ? ua_session->outbound_ip6 : ua_session->outbound_ip4;
+      if (alt_ip.isValid()) {
+        alt_opt.local_ip = alt_ip;
+      } else {
+        alt_opt.addr_binding = NetVCOptions::ANY_ADDR;
+        alt_opt.local_ip = IpAddr();
+      }
+    }
+
+    DebugSM("http", "calling HttpConnectRace::connect");
+    server_connect_raced = true;
+    connect_action_handle = HttpConnectRace::connect(this,
+                                                     t_state.scheme == URL_WKSIDX_HTTPS ? &sslNetProcessor : &netProcessor,
+                                                     t_state.current.server->name,
+                                                     &t_state.current.server->addr.sa,    // addr + port
+                                                     opt, alt_opt,
+                                                     t_state.host_db_info.app.http_data.connect_family == alt_won,
+                                                     HRTIME_MSECONDS(t_state.http_config_param->happy_eyeballs_delay),
+                                                     connect_timeout,
+                                                     &t_state.client_info.addr.sa,
+                                                     (int) t_state.txn_conf->down_server_timeout);
+  } else if (t_state.scheme == URL_WKSIDX_HTTPS) {
     DebugSM("http", "calling sslNetProcessor.connect_re");
     connect_action_handle = sslNetProcessor.connect_re(this,    // state machine
                                                        &t_state.current.server->addr.sa,    // addr + port
@@ -4645,21 +4963,6 @@ HttpSM::do_http_server_open(bool raw)
                                                       &t_state.current.server->addr.sa,    // addr + port
                                                       &opt);
     } else {
-      // Setup the timeouts
-      // Set the inactivity timeout to the connect timeout so that we
-      //   we fail this server if it doesn't start sending the response
-      //   header
-      MgmtInt connect_timeout;
-      if (t_state.method == HTTP_WKSIDX_POST || t_state.method == HTTP_WKSIDX_PUT) {
-        connect_timeout = t_state.txn_conf->post_connect_attempts_timeout;
-      } else if (t_state.current.server == &t_state.parent_info) {
-        connect_timeout = t_state.http_config_param->parent_connect_timeout;
-      } else {
-        if (t_state.pCongestionEntry != NULL)
-          connect_timeout = t_state.pCongestionEntry->connect_timeout();
-        else
-          connect_timeout = t_state.txn_conf->connect_attempts_timeout;
-      }
       DebugSM("http", "calling netProcessor.connect_s");
       connect_action_handle = netProcessor.connect_s(this,      // state machine
                                                      &t_state.current.server->addr.sa,    // addr + port
@@ -5040,6 +5343,9 @@ HttpSM::handle_server_setup_error(int event, void *data)
 
   STATE_ENTER(&HttpSM::handle_server_setup_error, event);
 
+  // A closed keep-alive connection says nothing of the load of the origin
+  origin_limit_release(0, event != VC_EVENT_EOS);
+
   // If there is POST or PUT tunnel wait for the tunnel
   //  to figure out that things have gone to hell
 
@@ -6396,6 +6702,8 @@ HttpSM::kill_this()
       pending_action = NULL;
     }
 
+    origin_limit_release(0, false);
+
     cache_sm.end_both();
     if (second_cache_sm)
       second_cache_sm->end_both();
@@ -6564,16 +6872,21 @@ HttpSM::update_stats()
     os_read_time = -1;
   }
 
-  // TS-2032: This code is never used, but leaving it here in case we want to add these
-  // to the metrics code.
-#if 0
-  ink_hrtime cache_lookup_time;
-  if (milestones.cache_open_read_end != 0 && milestones.cache_open_read_begin != 0) {
-    cache_lookup_time = milestones.cache_open_read_end - milestones.cache_open_read_begin;
-  } else {
-    cache_lookup_time = -1;
+  // Latency histograms, for the steps this transaction went through. The
+  // origin may have been connected to more than once, only the last attempt
+  // is counted.
+  if (milestones.ua_read_header_done != 0 && milestones.ua_begin_write >= milestones.ua_read_header_done) {
+    HTTP_RECORD_HISTOGRAM(http_first_byte_hist, milestones.ua_begin_write - milestones.ua_read_header_done);
+  }
+  if (milestones.server_connect != 0 && milestones.server_connect_end >= milestones.server_connect) {
+    HTTP_RECORD_HISTOGRAM(http_origin_connect_hist, milestones.server_connect_end - milestones.server_connect);
+  }
+  if (milestones.cache_open_read_begin != 0 && milestones.cache_open_read_end >= milestones.cache_open_read_begin) {
+    HTTP_RECORD_HISTOGRAM(http_cache_open_read_hist, milestones.cache_open_read_end - milestones.cache_open_read_begin);
+  }
+  if (milestones.dns_lookup_begin != 0 && milestones.dns_lookup_end >= milestones.dns_lookup_begin) {
+    HTTP_RECORD_HISTOGRAM(http_dns_lookup_hist, milestones.dns_lookup_end - milestones.dns_lookup_begin);
   }
-#endif
 
   HttpTransact::update_size_and_time_stats(&t_state, total_time, ua_write_time, os_read_time, client_request_hdr_bytes,
                                            client_request_body_bytes, client_response_hdr_bytes, client_response_body_bytes,
@@ -209,6 +209,7 @@ public:
   //  the session timeouts and initiate a read while
   //  holding the lock for the server session
   void attach_server_session(HttpServerSession * s);
+  HttpServerSession *get_server_session() const { return server_session; }
 
   // Called by transact.  Updates are fire and forget
   //  so there are no callbacks and are safe to do
@@ -223,6 +224,10 @@ public:
   void do_range_parse(MIMEField *range_field);
   void calculate_output_cl(int64_t, int64_t);
   void parse_range_and_compare(MIMEField*, int64_t);
+
+  // Called by transact for a range served from a cached segment.  Sets up
+  // the Range transformation of the segment in @a response.
+  bool do_range_segment_setup(HTTPHdr *response);
   
   // Called by transact to prevent reset problems
   //  failed PUSH requests
@@ -317,6 +322,12 @@ protected:
   HttpVCTableEntry *server_entry;
   HttpServerSession *server_session;
   int shared_session_retries;
+  bool server_connect_raced;
+  // Slot or place in the queue taken from OriginLimit for the request
+  bool origin_limit_held;
+  int64_t origin_limit_ticket;
+  ink_hrtime origin_limit_wait_start;
+  IpEndpoint origin_limit_addr;
   IOBufferReader *server_buffer_reader;
   void remove_server_entry();
 
@@ -406,6 +417,10 @@ protected:
   void do_hostdb_reverse_lookup();
   void do_cache_lookup_and_read();
   void do_http_server_open(bool raw = false);
+  bool can_race_server_connect(NetVCOptions const& opt);
+  void note_server_connect_race(sockaddr const* winner);
+  bool origin_limit_acquire();
+  void origin_limit_release(ink_hrtime latency, bool failed);
   void do_setup_post_tunnel(HttpVC_t to_vc_type);
   void do_cache_prepare_write();
   void do_cache_prepare_write_transform();
@@ -531,6 +546,8 @@ public:
   bool set_server_session_private(bool private_session);
 };
 
+extern SparseClassAllocator<HttpSM> httpSMAllocator;
+
 //Function to get the cache_sm object - YTS Team, yamsat
 inline HttpCacheSM &
 HttpSM::get_cache_sm()
@@ -548,7 +565,6 @@ HttpSM::get_ua_entry()
 inline HttpSM *
 HttpSM::allocate()
 {
-  extern SparseClassAllocator<HttpSM> httpSMAllocator;
   return httpSMAllocator.alloc();
 }
 
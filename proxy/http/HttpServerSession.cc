@@ -51,7 +51,7 @@ HttpServerSession::destroy()
   }
 
   mutex.clear();
-  if (2 == share_session)
+  if (share_session >= 2)
     THREAD_FREE(this, httpServerSessionAllocator, this_thread());
   else
     httpServerSessionAllocator.free(this);
@@ -112,6 +112,11 @@ public:
   {
     return server_vc;
   };
+  /// Replaces the connection after it has been migrated to another thread.
+  void set_netvc(NetVConnection *new_vc)
+  {
+    server_vc = new_vc;
+  };
 
   // Keys for matching hostnames
   IpEndpoint server_ip;
@@ -39,25 +39,68 @@
 #define FIRST_LEVEL_HASH(x)   ats_ip_hash(x) % HSM_LEVEL1_BUCKETS
 #define SECOND_LEVEL_HASH(x)  ats_ip_hash(x) % HSM_LEVEL2_BUCKETS
 
+// The threads with a per-thread pool, searched for sessions to migrate
+static EThread *pool_threads[MAX_EVENT_THREADS];
+static int n_pool_threads = 0;
+
 // Initialize a thread to handle HTTP session management
 void
 initialize_thread_for_http_sessions(EThread *thread, int /* thread_index ATS_UNUSED */)
 {
+  // the SSL threads may be the net threads
+  if (thread->l1_hash)
+    return;
   thread->l1_hash = NEW(new SessionBucket[HSM_LEVEL1_BUCKETS]);
   for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i)
     thread->l1_hash[i].mutex = new_ProxyMutex();
   //thread->l1_hash[i].mutex = thread->mutex;
+  pool_threads[n_pool_threads++] = thread;
 }
 
 
 HttpSessionManager httpSessionManager;
 
 SessionBucket::SessionBucket()
-  : Continuation(NULL)
+  : Continuation(NULL), n_sessions(0)
 {
   SET_HANDLER(&SessionBucket::session_handler);
 }
 
+// Returns the session to ip for hostname_hash, if there is one in the bucket
+HttpServerSession *
+SessionBucket::find(sockaddr const* ip, INK_MD5 &hostname_hash)
+{
+  int l2_index = SECOND_LEVEL_HASH(ip);
+
+  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
+  for (HttpServerSession *b = l2_hash[l2_index].head; b != NULL; b = b->hash_link.next) {
+    if (ats_ip_addr_eq(&b->server_ip.sa, ip) &&
+        ats_ip_port_cast(ip) == ats_ip_port_cast(&b->server_ip) &&
+        hostname_hash == b->hostname_hash)
+      return b;
+  }
+  return NULL;
+}
+
+void
+SessionBucket::insert(HttpServerSession *s)
+{
+  int l2_index = SECOND_LEVEL_HASH(&s->server_ip.sa);
+
+  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
+  lru_list.enqueue(s);
+  l2_hash[l2_index].push(s);
+  n_sessions++;
+}
+
+void
+SessionBucket::remove(HttpServerSession *s)
+{
+  lru_list.remove(s);
+  l2_hash[SECOND_LEVEL_HASH(&s->server_ip.sa)].remove(s);
+  n_sessions--;
+}
+
 // int SessionBucket::session_handler(int event, void* data)
 //
 //   Called from the NetProcessor to left us know that a
@@ -121,8 +164,7 @@ SessionBucket::session_handler(int event, void *data)
       Debug("http_ss", "[%" PRId64 "] [session_bucket] session received io notice [%s]",
             s->con_id, HttpDebugNames::get_event_name(event));
       ink_assert(s->state == HSS_KA_SHARED);
-      lru_list.remove(s);
-      l2_hash[l2_index].remove(s);
+      remove(s);
       s->do_io_close();
       found = true;
       break;
@@ -164,9 +206,7 @@ HttpSessionManager::purge_keepalives()
     if (lock) {
       while (b->lru_list.head) {
         HttpServerSession *sess = b->lru_list.head;
-        b->lru_list.remove(sess);
-        int l2_index = SECOND_LEVEL_HASH(&sess->server_ip.sa);
-        b->l2_hash[l2_index].remove(sess);
+        b->remove(sess);
         sess->do_io_close();
       }
     } else {
@@ -178,31 +218,64 @@ HttpSessionManager::purge_keepalives()
 HSMresult_t
 _acquire_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_hash, HttpSM *sm)
 {
-  HttpServerSession *b;
-  HttpServerSession *to_return = NULL;
-  int l2_index = SECOND_LEVEL_HASH(ip);
-
-  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
-
   // Check to see if an appropriate connection is in
   //  the 2nd level bucket
-  b = bucket->l2_hash[l2_index].head;
-  while (b != NULL) {
-    if (ats_ip_addr_eq(&b->server_ip.sa, ip) &&
-      ats_ip_port_cast(ip) == ats_ip_port_cast(&b->server_ip)
-    ) {
-      if (hostname_hash == b->hostname_hash) {
-        bucket->lru_list.remove(b);
-        bucket->l2_hash[l2_index].remove(b);
-        b->state = HSS_ACTIVE;
-        to_return = b;
-        Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", to_return->con_id);
-        sm->attach_server_session(to_return);
-        return HSM_DONE;
-      }
+  HttpServerSession *to_return = bucket->find(ip, hostname_hash);
+
+  if (to_return != NULL) {
+    bucket->remove(to_return);
+    to_return->state = HSS_ACTIVE;
+    Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", to_return->con_id);
+    sm->attach_server_session(to_return);
+    return HSM_DONE;
+  }
+
+  return HSM_NOT_FOUND;
+}
+
+// Looks for a session in the pools of the other threads, and moves it to
+//  this thread.  The session counts of the buckets are read without the
+//  bucket locks, so only buckets which had sessions in them are locked,
+//  and the locks are only tried.  The scan starts after this thread so that
+//  the threads do not all pick from the same pools first.
+static HSMresult_t
+_migrate_session(int l1_index, sockaddr const* ip, INK_MD5 &hostname_hash, HttpSM *sm, EThread *ethread)
+{
+  int n = n_pool_threads;
+  int start = 0;
+
+  while (start < n && pool_threads[start] != ethread)
+    start++;
+
+  for (int i = 1; i < n; i++) {
+    EThread *t = pool_threads[(start + i) % n];
+    SessionBucket *bucket = t->l1_hash + l1_index;
+
+    if (t == ethread || bucket->n_sessions <= 0)
+      continue;
+
+    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+    if (!lock)
+      continue;
+
+    HttpServerSession *s = bucket->find(ip, hostname_hash);
+    if (s == NULL)
+      continue;
+
+    // The bucket mutex is the mutex of the session's VIOs, so its thread
+    //  can not call back into the bucket while the connection moves.
+    NetVConnection *vc = s->get_netvc()->migrate_to_current_thread(sm, ethread);
+    if (vc == NULL) {
+      Debug("http_ss", "[%" PRId64 "] [acquire session] could not migrate session", s->con_id);
+      continue;
     }
 
-    b = b->hash_link.next;
+    bucket->remove(s);
+    s->set_netvc(vc);
+    s->state = HSS_ACTIVE;
+    Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session migrated from thread %p", s->con_id, t);
+    sm->attach_server_session(s);
+    return HSM_DONE;
   }
 
   return HSM_NOT_FOUND;
@@ -257,9 +330,29 @@ HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockad
 
   ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
 
-  if (2 == sm->t_state.txn_conf->share_server_sessions) {
+  if (sm->t_state.txn_conf->share_server_sessions >= 2) {
+    ProxyMutex *mutex = sm->mutex;
+    SessionBucket *bucket = ethread->l1_hash + l1_index;
+    HSMresult_t result = HSM_RETRY;
+
     ink_assert(ethread->l1_hash);
-    return _acquire_session(ethread->l1_hash + l1_index, ip, hostname_hash, sm);
+    // Only a thread migrating a session away contends for this lock
+    {
+      MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+      if (lock)
+        result = _acquire_session(bucket, ip, hostname_hash, sm);
+    }
+    if (result == HSM_DONE) {
+      HTTP_INCREMENT_DYN_STAT(http_server_session_pool_local_hits_stat);
+      return HSM_DONE;
+    }
+    if (3 == sm->t_state.txn_conf->share_server_sessions &&
+        _migrate_session(l1_index, ip, hostname_hash, sm, ethread) == HSM_DONE) {
+      HTTP_INCREMENT_DYN_STAT(http_server_session_pool_migrations_stat);
+      return HSM_DONE;
+    }
+    HTTP_INCREMENT_DYN_STAT(http_server_session_pool_misses_stat);
+    return result == HSM_RETRY ? HSM_RETRY : HSM_NOT_FOUND;
   } else {
     SessionBucket *bucket = g_l1_hash + l1_index;
 
@@ -283,7 +376,7 @@ HttpSessionManager::release_session(HttpServerSession *to_release)
 
   ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
 
-  if (2 == to_release->share_session) {
+  if (to_release->share_session >= 2) {
     bucket = ethread->l1_hash + l1_index;
   } else {
     bucket = g_l1_hash + l1_index;
@@ -291,13 +384,8 @@ HttpSessionManager::release_session(HttpServerSession *to_release)
 
   MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
   if (lock) {
-    int l2_index = SECOND_LEVEL_HASH(&to_release->server_ip.sa);
-
-    ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
-
     // First insert the session on to our lists
-    bucket->lru_list.enqueue(to_release);
-    bucket->l2_hash[l2_index].push(to_release);
+    bucket->insert(to_release);
     to_release->state = HSS_KA_SHARED;
 
     // Now we need to issue a read on the connection to detect
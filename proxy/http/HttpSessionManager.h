@@ -51,8 +51,14 @@ class SessionBucket: public Continuation
 public:
   SessionBucket();
   int session_handler(int event, void *data);
+  HttpServerSession *find(sockaddr const *ip, INK_MD5 &hostname_hash);
+  void insert(HttpServerSession *s);
+  void remove(HttpServerSession *s);
   Que(HttpServerSession, lru_link) lru_list;
   DList(HttpServerSession, hash_link) l2_hash[HSM_LEVEL2_BUCKETS];
+  // Number of sessions in the bucket.  Changed under the bucket mutex, but
+  // read without it by other threads looking for a session to migrate.
+  volatile int n_sessions;
 };
 
 enum HSMresult_t
@@ -1613,7 +1613,9 @@ HttpTransact::OSDNSLookup(State* s)
     // HostDB addresses. We use those if they're different from the CTA.
     // In all cases we now commit to client or HostDB for our source.
     if (s->host_db_info.round_robin) {
-      HostDBInfo* cta = s->host_db_info.rr()->select_next(&s->current.server->addr.sa);
+      // the round robin data may have been reused since the lookup
+      HostDBRoundRobin *rr = s->host_db_info.rr();
+      HostDBInfo* cta = rr ? rr->select_next(&s->current.server->addr.sa) : NULL;
       if (cta) {
         // found another addr, lock in host DB.
         s->host_db_info = *cta;
@@ -1856,6 +1858,9 @@ HttpTransact::DecideCacheLookup(State* s)
       ink_assert(s->cache_info.lookup_url->valid() == true);
     }
 
+    // the whole object is looked up first, a segment only if it misses
+    s->range_segment = -1;
+
     TRANSACT_RETURN(CACHE_LOOKUP, NULL);
   } else {
     ink_assert(s->cache_info.action != CACHE_DO_LOOKUP && s->cache_info.action != CACHE_DO_SERVE);
@@ -2249,7 +2254,9 @@ HttpTransact::issue_revalidate(State* s)
     s->cache_info.action = CACHE_PREPARE_TO_UPDATE;
     break;
   case HTTP_STATUS_PARTIAL_CONTENT:
-    ink_assert(!"unexpected status code");
+    // only segments are cached as 206, refetch the whole segment
+    ink_assert(s->range_segment >= 0);
+    s->cache_info.action = CACHE_PREPARE_TO_UPDATE;
     break;
   }
 }
@@ -2313,6 +2320,19 @@ HttpTransact::HandleCacheOpenReadHitFreshness(State* s)
     }
   }
 
+  // a segment cached from another version of the object than the one in
+  // its segment head has to be refetched; without a head the segment's
+  // version becomes the head's
+  if (s->range_segment >= 0 && s->cache_lookup_result != HttpTransact::CACHE_LOOKUP_HIT_STALE) {
+    if (!range_segment_validator_matches(s, obj->response_get())) {
+      DebugTxn("http_seq", "[HttpTransact::HandleCacheOpenReadHitFreshness] " "Segment of another version");
+      s->cache_lookup_result = HttpTransact::CACHE_LOOKUP_HIT_STALE;
+      s->is_revalidation_necessary = true;
+    } else if (range_segment_validator_set(s, obj->response_get())) {
+      HttpCacheSM::write_segment_head(s->cache_info.lookup_url, &s->range_segment_head);
+    }
+  }
+
   ink_assert(s->cache_lookup_result != HttpTransact::CACHE_LOOKUP_MISS);
   if (s->cache_lookup_result == HttpTransact::CACHE_LOOKUP_HIT_STALE)
     SET_VIA_STRING(VIA_DETAIL_CACHE_LOOKUP, VIA_DETAIL_MISS_EXPIRED);
@@ -2741,8 +2761,13 @@ HttpTransact::build_response_from_cache(State* s, HTTPWarningCode warning_code)
       // Check if cached response supports Range. If it does, append
       // Range transformation plugin
       // only if the cached response is a 200 OK
-      if (client_response_code == HTTP_STATUS_OK && client_request->presence(MIME_PRESENCE_RANGE)) {
-        s->state_machine->do_range_setup_if_necessary();
+      // A segment serves the part of the range it holds.
+      if (s->range_segment >= 0 ||
+          (client_response_code == HTTP_STATUS_OK && client_request->presence(MIME_PRESENCE_RANGE))) {
+        if (s->range_segment >= 0)
+          s->state_machine->do_range_segment_setup(cached_response);
+        else
+          s->state_machine->do_range_setup_if_necessary();
         if (s->range_setup == RANGE_NOT_SATISFIABLE) {
           build_error_response(s, HTTP_STATUS_RANGE_NOT_SATISFIABLE, "Requested Range Not Satisfiable","","");
           s->cache_info.action = CACHE_DO_NO_ACTION;
@@ -2754,6 +2779,7 @@ HttpTransact::build_response_from_cache(State* s, HTTPWarningCode warning_code)
           // this late.
           DebugTxn("http_seq", "[HttpTransact::HandleCacheOpenReadHit] Out-of-order Range request - tunneling");
           s->cache_info.action = CACHE_DO_NO_ACTION;
+          s->range_segment = -1;
           if (s->force_dns) {
             HandleCacheOpenReadMiss(s); // DNS is already completed no need of doing DNS
           } else {
@@ -3098,6 +3124,8 @@ HttpTransact::OriginServerRawOpen(State* s)
   case CONGEST_CONTROL_CONGESTED_ON_F:
     /* fall through */
   case CONGEST_CONTROL_CONGESTED_ON_M:
+    /* fall through */
+  case ORIGIN_OVERLOADED:
     handle_server_died(s);
 
     ink_assert(s->cache_info.action == CACHE_DO_NO_ACTION);
@@ -3498,6 +3526,19 @@ HttpTransact::handle_response_from_server(State* s)
     s->current.server->set_connect_fail(EUSERS); // too many users
     handle_server_connection_not_open(s);
     break;
+  case ORIGIN_OVERLOADED:
+    // Not a failure of the server, which must not be marked down for it
+    DebugTxn("http_trans", "[handle_response_from_server] Error. origin limit reached.");
+    SET_VIA_STRING(VIA_DETAIL_SERVER_CONNECT, VIA_DETAIL_SERVER_FAILURE);
+    SET_VIA_STRING(VIA_SERVER_RESULT, VIA_SERVER_ERROR);
+    if (s->cache_info.action == CACHE_DO_UPDATE && is_stale_cache_response_returnable(s)) {
+      DebugTxn("http_trans", "[handle_response_from_server] serving stale doc to client");
+      build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
+    } else {
+      handle_server_died(s);
+      s->next_action = PROXY_SEND_ERROR_CACHE_NOOP;
+    }
+    break;
   case OPEN_RAW_ERROR:
     /* fall through */
   case CONNECTION_ERROR:
@@ -4025,7 +4066,10 @@ HttpTransact::handle_cache_operation_on_forward_server_response(State* s)
           s->cache_info.action = CACHE_DO_UPDATE;
           s->next_action = SERVER_READ;
         } else {
-          if (s->hdr_info.client_request.presence(MIME_PRESENCE_RANGE)) {
+          if (s->range_segment >= 0) {
+            if (!handle_range_segment_response(s, s->cache_info.object_read->response_get()))
+              return;
+          } else if (s->hdr_info.client_request.presence(MIME_PRESENCE_RANGE)) {
             s->state_machine->do_range_setup_if_necessary();
             // Note that even if the Range request is not satisfiable, we
             // update and serve this cache. This will give a 200 response to
@@ -4362,6 +4406,9 @@ HttpTransact::handle_cache_operation_on_forward_server_response(State* s)
   }
   // all other responses (not 304, 412, 416) are handled here
   else {
+    if (s->next_action == SERVER_READ && s->range_segment >= 0 && server_response_code == HTTP_STATUS_PARTIAL_CONTENT &&
+        !handle_range_segment_response(s, &s->hdr_info.server_response))
+      return;
     if (((s->next_action == SERVE_FROM_CACHE) ||
          (s->next_action == SERVER_READ)) && s->state_machine->do_transform_open()) {
       set_header_for_transform(s, base_response);
@@ -4443,9 +4490,12 @@ HttpTransact::handle_no_cache_operation_on_forward_server_response(State* s)
     }
     return;
   case HTTP_STATUS_PARTIAL_CONTENT:
-    // If we get this back we should be just passing it through.
+    // If we get this back we should be just passing it through,
+    // unless it is a segment we asked for.
     ink_assert(s->cache_info.action == CACHE_DO_NO_ACTION);
     s->next_action = SERVER_READ;
+    if (s->range_segment >= 0 && !handle_range_segment_response(s, &s->hdr_info.server_response))
+      return;
     break;
   default:
     DebugTxn("http_trans", "[hncoofsr] server sent back something other than 100,304,200");
@@ -6038,8 +6088,15 @@ HttpTransact::is_response_cacheable(State* s, HTTPHdr* request, HTTPHdr* respons
       }
     }
   }
+  // a segment is cached only from the 206 response for exactly that segment
+  if (s->range_segment >= 0) {
+    if (!is_range_segment_response(s, response)) {
+      DebugTxn("http_trans", "[is_response_cacheable] " "not the requested segment - don't cache");
+      return false;
+    }
+  }
   // do not cache partial content - Range response
-  if (response_code == HTTP_STATUS_PARTIAL_CONTENT || response_code == HTTP_STATUS_RANGE_NOT_SATISFIABLE) {
+  else if (response_code == HTTP_STATUS_PARTIAL_CONTENT || response_code == HTTP_STATUS_RANGE_NOT_SATISFIABLE) {
     DebugTxn("http_trans", "[is_response_cacheable] " "response code %d - don't cache", response_code);
     return false;
   }
@@ -6145,6 +6202,193 @@ HttpTransact::is_response_cacheable(State* s, HTTPHdr* request, HTTPHdr* respons
 */
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+// Name       : range_segment_for_request()
+// Description: decide whether a Range: request is served from a segment
+//
+// Input      : State
+// Output     : the segment number, or -1
+//
+// Details    :
+//
+// Large objects which clients only ever fetch in pieces are cached as
+// segments of proxy.config.http.cache.range.segment_size bytes, each its
+// own object keyed off the URL, the segment number and the segment size,
+// which is noted in the State as it may be reconfigured meanwhile. A
+// single closed range which lies within one segment and misses as a whole
+// object is served from that segment. Anything else is looked up and
+// forwarded as usual: a response is served from one cache object, so a
+// range reaching into the next segment would have to be answered in part
+// from the origin, and an open ended range asks for all of the object
+// past its start, which the client would not get from a segment.
+//
+///////////////////////////////////////////////////////////////////////////////
+int64_t
+HttpTransact::range_segment_for_request(State* s)
+{
+  HTTPHdr *request = &s->hdr_info.client_request;
+  int64_t size = s->http_config_param->cache_range_segment_size;
+  int64_t start, end;
+
+  if (size <= 0 || s->method != HTTP_WKSIDX_GET || request->version_get() != HTTPVersion(1, 1) ||
+      !request->presence(MIME_PRESENCE_RANGE) || request->presence(MIME_PRESENCE_IF_RANGE))
+    return -1;
+  if (!parse_single_range(request, &start, &end))
+    return -1;
+  if (end < 0 || end / size != start / size)
+    return -1;
+  s->range_segment_size = size;
+  return start / size;
+}
+
+// The validator telling versions of a segmented object apart: its strong
+// ETag:, else its Last-Modified:.
+static bool
+range_segment_validator(HTTPHdr* response, INK_MD5* validator)
+{
+  int len;
+  const char *v = response->value_get(MIME_FIELD_ETAG, MIME_LEN_ETAG, &len);
+
+  if (!v || len < 2 || !strncmp(v, "W/", 2))
+    v = response->value_get(MIME_FIELD_LAST_MODIFIED, MIME_LEN_LAST_MODIFIED, &len);
+  if (!v || len <= 0)
+    return false;
+  validator->encodeBuffer(v, len);
+  return true;
+}
+
+// True if @a response is the 206 for exactly the segment we asked for,
+// with a validator to check the other segments of the object against.
+bool
+HttpTransact::is_range_segment_response(State* s, HTTPHdr* response)
+{
+  int64_t size = s->range_segment_size;
+  int64_t start, end, total;
+  INK_MD5 validator;
+
+  if (response->status_get() != HTTP_STATUS_PARTIAL_CONTENT || !parse_content_range(response, &start, &end, &total) ||
+      !range_segment_validator(response, &validator))
+    return false;
+  return start == s->range_segment * size && end == min(start + size, total) - 1;
+}
+
+// Sets up serving the client's range from the segment in @a response.  If
+// the range starts past the end of the object 416 is answered, if the
+// segment does not hold it for any other reason the request is sent to the
+// origin again as the client made it.  Returns false in both cases.
+bool
+HttpTransact::handle_range_segment_response(State* s, HTTPHdr* response)
+{
+  if (is_range_segment_response(s, response) && range_segment_validator_set(s, response))
+    HttpCacheSM::write_segment_head(s->cache_info.lookup_url, &s->range_segment_head);
+  if (s->state_machine->do_range_segment_setup(response))
+    return true;
+
+  s->cache_info.action = CACHE_DO_NO_ACTION;
+  if (s->range_setup == RANGE_NOT_SATISFIABLE) {
+    build_error_response(s, HTTP_STATUS_RANGE_NOT_SATISFIABLE, "Requested Range Not Satisfiable","","");
+    s->next_action = PROXY_SEND_ERROR_CACHE_NOOP;
+  } else {
+    DebugTxn("http_trans", "[handle_range_segment_response] segment does not hold the range, forwarding it");
+    s->range_segment = -1;
+    s->cache_info.object_read = NULL;
+    build_request(s, &s->hdr_info.client_request, &s->hdr_info.server_request, s->current.server->http_version);
+    s->next_action = how_to_open_connection(s);
+  }
+  return false;
+}
+
+// Takes the version of the object @a response, a segment, is of as the
+// current one.  Returns true if that is not the one in the segment head
+// read for the request, which is then to be rewritten.
+bool
+HttpTransact::range_segment_validator_set(State* s, HTTPHdr* response)
+{
+  INK_MD5 validator;
+
+  if (!range_segment_validator(response, &validator) ||
+      (s->range_segment_head_found && s->range_segment_head == validator))
+    return false;
+  s->range_segment_head = validator;
+  s->range_segment_head_found = true;
+  return true;
+}
+
+// True unless the segment head names another version of the object than
+// the one @a response, a cached segment, was taken from.
+bool
+HttpTransact::range_segment_validator_matches(State* s, HTTPHdr* response)
+{
+  INK_MD5 validator;
+
+  if (!range_segment_validator(response, &validator))
+    return false;
+  return !s->range_segment_head_found || s->range_segment_head == validator;
+}
+
+// Parses a Range: of a single "bytes=a-b" or "bytes=a-" range, in the
+// latter case @a end is set to -1.
+bool
+HttpTransact::parse_single_range(HTTPHdr* request, int64_t* start, int64_t* end)
+{
+  MIMEField *field = request->field_find(MIME_FIELD_RANGE, MIME_LEN_RANGE);
+  const char *s, *e;
+  int len;
+
+  if (!field || field->m_next_dup)
+    return false;
+  s = field->value_get(&len);
+  e = s + len;
+  if (len < 6 || strncasecmp(s, "bytes=", 6))
+    return false;
+  for (s += 6; s < e && ParseRules::is_ws(*s); ++s) ;
+  if (s >= e || !ParseRules::is_digit(*s))
+    return false;
+  for (*start = 0; s < e && ParseRules::is_digit(*s); ++s)
+    *start = *start * 10 + (*s - '0');
+  for (; s < e && ParseRules::is_ws(*s); ++s) ;
+  if (s >= e || *s++ != '-')
+    return false;
+  for (; s < e && ParseRules::is_ws(*s); ++s) ;
+  if (s < e && ParseRules::is_digit(*s)) {
+    for (*end = 0; s < e && ParseRules::is_digit(*s); ++s)
+      *end = *end * 10 + (*s - '0');
+    if (*end < *start)
+      return false;
+  } else {
+    *end = -1;
+  }
+  for (; s < e && ParseRules::is_ws(*s); ++s) ;
+  return s == e;
+}
+
+// Parses a "bytes a-b/total" Content-Range:, an unknown total is rejected.
+bool
+HttpTransact::parse_content_range(HTTPHdr* response, int64_t* start, int64_t* end, int64_t* total)
+{
+  int len;
+  const char *s = response->value_get(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE, &len);
+  const char *e = s + len;
+
+  if (!s || len < 6 || strncasecmp(s, "bytes ", 6))
+    return false;
+  s += 6;
+  int64_t *v[] = { start, end, total };
+  const char sep[] = { '-', '/', '\0' };
+  for (int i = 0; i < 3; i++) {
+    for (; s < e && ParseRules::is_ws(*s); ++s) ;
+    if (s >= e || !ParseRules::is_digit(*s))
+      return false;
+    for (*v[i] = 0; s < e && ParseRules::is_digit(*s); ++s)
+      *v[i] = *v[i] * 10 + (*s - '0');
+    for (; s < e && ParseRules::is_ws(*s); ++s) ;
+    if (sep[i] && (s >= e || *s++ != sep[i]))
+      return false;
+  }
+  return s == e && *start <= *end && *end < *total;
+}
+
 bool
 HttpTransact::is_request_valid(State* s, HTTPHdr* incoming_request)
 {
@@ -6294,7 +6538,8 @@ HttpTransact::is_response_valid(State* s, HTTPHdr* incoming_response)
                       (s->current.state == INACTIVE_TIMEOUT) ||
                       (s->current.state == ACTIVE_TIMEOUT) ||
                       (s->current.state == CONGEST_CONTROL_CONGESTED_ON_M) ||
-                      (s->current.state == CONGEST_CONTROL_CONGESTED_ON_F));
+                      (s->current.state == CONGEST_CONTROL_CONGESTED_ON_F) ||
+                      (s->current.state == ORIGIN_OVERLOADED));
 
     s->hdr_info.response_error = CONNECTION_OPEN_FAILED;
     return false;
@@ -7381,7 +7626,8 @@ HttpTransact::handle_server_died(State* s)
   //
   if (s->pCongestionEntry != NULL) {
     s->congestion_congested_or_failed = 1;
-    if (s->current.state != CONGEST_CONTROL_CONGESTED_ON_F && s->current.state != CONGEST_CONTROL_CONGESTED_ON_M) {
+    if (s->current.state != CONGEST_CONTROL_CONGESTED_ON_F && s->current.state != CONGEST_CONTROL_CONGESTED_ON_M &&
+        s->current.state != ORIGIN_OVERLOADED) {
       s->pCongestionEntry->failed_at(s->current.now);
     }
   }
@@ -7446,6 +7692,12 @@ HttpTransact::handle_server_died(State* s)
       body_type = "congestion#retryAfter";
     s->hdr_info.response_error = TOTAL_RESPONSE_ERROR_TYPES;
     break;
+  case ORIGIN_OVERLOADED:
+    status = HTTP_STATUS_SERVICE_UNAVAILABLE;
+    reason = "Origin Server Overloaded";
+    body_type = "congestion#retryAfter";
+    s->hdr_info.response_error = TOTAL_RESPONSE_ERROR_TYPES;
+    break;
   case STATE_UNDEFINED:
   case TRANSACTION_COMPLETE:
   default:                     /* unknown death */
@@ -7546,6 +7798,15 @@ HttpTransact::build_request(State* s, HTTPHdr* base_request, HTTPHdr* outgoing_r
   handle_request_keep_alive_headers(s, outgoing_version, outgoing_request);
   HttpTransactHeaders::handle_conditional_headers(&s->cache_info, outgoing_request);
 
+  // fetch the whole segment the client's range falls in, it is what gets cached
+  if (s->range_segment >= 0) {
+    char range[64];
+    int64_t size = s->range_segment_size;
+    int len = snprintf(range, sizeof(range), "bytes=%" PRId64 "-%" PRId64,
+                       s->range_segment * size, (s->range_segment + 1) * size - 1);
+    outgoing_request->value_set(MIME_FIELD_RANGE, MIME_LEN_RANGE, range, len);
+  }
+
   if (s->next_hop_scheme < 0)
     s->next_hop_scheme = URL_WKSIDX_HTTP;
   if (s->orig_scheme < 0)
@@ -8544,6 +8805,7 @@ HttpTransact::update_size_and_time_stats(State* s, ink_hrtime total_time, ink_hr
 
   // times
   HTTP_SUM_TRANS_STAT(http_total_transactions_time_stat, total_time);
+  RecRecordRawHistogram(http_rhb, NULL, (int) http_transaction_hist, ink_hrtime_to_usec(total_time));
 
   // sizes
   HTTP_SUM_TRANS_STAT(http_user_agent_request_header_total_size_stat, user_agent_request_header_size);
@@ -8689,7 +8951,14 @@ HttpTransact::change_response_header_because_of_range_request(State *s, HTTPHdr
     // Range: requests.
     header->set_content_length(s->range_output_cl);
   } else {
-    if (s->cache_info.object_read && s->cache_info.object_read->valid()) {
+    int64_t total = -1;
+
+    // a segment only knows the size of the whole object from its Content-Range:
+    if (s->range_segment >= 0)
+      total = s->range_segment_total;
+    else if (s->cache_info.object_read && s->cache_info.object_read->valid())
+      total = s->cache_info.object_read->object_size_get();
+    if (total >= 0) {
       // TODO: It's unclear under which conditions we need to update the Content-Range: header,
       // many times it's already set correctly before calling this. For now, always try do it
       // when we have the information for it available.
@@ -8698,7 +8967,7 @@ HttpTransact::change_response_header_because_of_range_request(State *s, HTTPHdr
       header->field_delete(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE);
       field = header->field_create(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE);
       snprintf(numbers, sizeof(numbers), "bytes %" PRId64"-%" PRId64"/%" PRId64, s->ranges[0]._start, s->ranges[0]._end,
-               s->cache_info.object_read->object_size_get());
+               total);
       field->value_set(header->m_heap, header->m_mime, numbers, strlen(numbers));
       header->field_attach(field);
     }
@@ -8706,3 +8975,168 @@ HttpTransact::change_response_header_because_of_range_request(State *s, HTTPHdr
     header->set_content_length(s->range_output_cl);
   }
 }
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+REGRESSION_TEST(HttpTransact_parse_single_range)(RegressionTest * t, int /* atype ATS_UNUSED */, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  static struct {
+    const char *range;
+    bool valid;
+    int64_t start, end;
+  } cases[] = {
+    { "bytes=0-499", true, 0, 499 },
+    { "bytes=500-", true, 500, -1 },
+    { "BYTES= 10 - 20 ", true, 10, 20 },
+    { "bytes=7-7", true, 7, 7 },
+    { "bytes=-500", false, 0, 0 },
+    { "bytes=20-10", false, 0, 0 },
+    { "bytes=0-1,5-9", false, 0, 0 },
+    { "bytes=1a-2", false, 0, 0 },
+    { "items=0-1", false, 0, 0 },
+    { "bytes=", false, 0, 0 }
+  };
+  HTTPHdr request;
+
+  box = REGRESSION_TEST_PASSED;
+  request.create(HTTP_TYPE_REQUEST);
+  for (unsigned i = 0; i < countof(cases); ++i) {
+    int64_t start = 0, end = 0;
+
+    request.value_set(MIME_FIELD_RANGE, MIME_LEN_RANGE, cases[i].range, strlen(cases[i].range));
+    bool valid = HttpTransact::parse_single_range(&request, &start, &end);
+    box.check(valid == cases[i].valid, "Range: %s parsed as %s", cases[i].range, valid ? "valid" : "invalid");
+    if (valid && cases[i].valid)
+      box.check(start == cases[i].start && end == cases[i].end, "Range: %s parsed as %" PRId64 "-%" PRId64,
+                cases[i].range, start, end);
+  }
+
+  // a single range in each of two Range: fields is more than one range
+  request.value_set(MIME_FIELD_RANGE, MIME_LEN_RANGE, "bytes=0-1", 9);
+  MIMEField *dup = request.field_create(MIME_FIELD_RANGE, MIME_LEN_RANGE);
+  request.field_value_set(dup, "bytes=5-9", 9);
+  request.field_attach(dup);
+  int64_t start, end;
+  box.check(!HttpTransact::parse_single_range(&request, &start, &end), "duplicate Range: fields parsed as valid");
+  request.destroy();
+}
+
+REGRESSION_TEST(HttpTransact_parse_content_range)(RegressionTest * t, int /* atype ATS_UNUSED */, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  static struct {
+    const char *range;
+    bool valid;
+    int64_t start, end, total;
+  } cases[] = {
+    { "bytes 0-499/1234", true, 0, 499, 1234 },
+    { "bytes 1000-1999/2000", true, 1000, 1999, 2000 },
+    { "bytes  5 - 9 / 10", true, 5, 9, 10 },
+    { "bytes 0-499/*", false, 0, 0, 0 },
+    { "bytes */1234", false, 0, 0, 0 },
+    { "bytes 500-499/1234", false, 0, 0, 0 },
+    { "bytes 0-1234/1234", false, 0, 0, 0 },
+    { "bytes=0-1/2", false, 0, 0, 0 },
+    { "bytes 0-1/2x", false, 0, 0, 0 }
+  };
+  HTTPHdr response;
+
+  box = REGRESSION_TEST_PASSED;
+  response.create(HTTP_TYPE_RESPONSE);
+  for (unsigned i = 0; i < countof(cases); ++i) {
+    int64_t start = 0, end = 0, total = 0;
+
+    response.value_set(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE, cases[i].range, strlen(cases[i].range));
+    bool valid = HttpTransact::parse_content_range(&response, &start, &end, &total);
+    box.check(valid == cases[i].valid, "Content-Range: %s parsed as %s", cases[i].range, valid ? "valid" : "invalid");
+    if (valid && cases[i].valid)
+      box.check(start == cases[i].start && end == cases[i].end && total == cases[i].total,
+                "Content-Range: %s parsed as %" PRId64 "-%" PRId64 "/%" PRId64, cases[i].range, start, end, total);
+  }
+  response.destroy();
+}
+
+// Picking the segment for a request, taking its 206 and checking the
+// validators of cached segments.
+REGRESSION_TEST(HttpTransact_range_segment)(RegressionTest * t, int /* atype ATS_UNUSED */, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  HttpConfigParams *params = NEW(new HttpConfigParams);
+  HttpTransact::State *s = NEW(new HttpTransact::State);
+  HTTPHdr *request = &s->hdr_info.client_request;
+  HTTPHdr response;
+
+  box = REGRESSION_TEST_PASSED;
+  params->cache_range_segment_size = 1000;
+  s->http_config_param = params;
+  s->method = HTTP_WKSIDX_GET;
+  request->create(HTTP_TYPE_REQUEST);
+  request->version_set(HTTPVersion(1, 1));
+
+  static struct {
+    const char *range;
+    int64_t segment;
+  } cases[] = {
+    { "bytes=1500-1600", 1 },
+    { "bytes=1000-1999", 1 },
+    { "bytes=2500-", -1 },
+    { "bytes=900-1100", -1 },
+    { "bytes=0-1,5-9", -1 }
+  };
+  for (unsigned i = 0; i < countof(cases); ++i) {
+    request->value_set(MIME_FIELD_RANGE, MIME_LEN_RANGE, cases[i].range, strlen(cases[i].range));
+    int64_t segment = HttpTransact::range_segment_for_request(s);
+    box.check(segment == cases[i].segment, "Range: %s served from segment %" PRId64 ", expected %" PRId64,
+              cases[i].range, segment, cases[i].segment);
+  }
+  box.check(s->range_segment_size == 1000, "segment size %" PRId64 " not noted", s->range_segment_size);
+
+  // conditional ranges and disabled segmenting go to the whole object
+  request->value_set(MIME_FIELD_RANGE, MIME_LEN_RANGE, "bytes=1500-1600", 15);
+  request->value_set(MIME_FIELD_IF_RANGE, MIME_LEN_IF_RANGE, "\"v1\"", 4);
+  box.check(HttpTransact::range_segment_for_request(s) == -1, "If-Range: request served from a segment");
+  request->field_delete(MIME_FIELD_IF_RANGE, MIME_LEN_IF_RANGE);
+  params->cache_range_segment_size = 0;
+  box.check(HttpTransact::range_segment_for_request(s) == -1, "segment used with segmenting disabled");
+
+  // only the 206 of the whole segment, with a validator, is cached; the
+  // segment size noted for the request counts, not the current one
+  s->range_segment = 1;
+  response.create(HTTP_TYPE_RESPONSE);
+  response.status_set(HTTP_STATUS_PARTIAL_CONTENT);
+  response.value_set(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE, "bytes 1000-1999/5000", 20);
+  box.check(!HttpTransact::is_range_segment_response(s, &response), "segment without a validator taken");
+  response.value_set(MIME_FIELD_ETAG, MIME_LEN_ETAG, "\"v1\"", 4);
+  box.check(HttpTransact::is_range_segment_response(s, &response), "segment 1000-1999/5000 not taken");
+  response.value_set(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE, "bytes 1000-1499/5000", 20);
+  box.check(!HttpTransact::is_range_segment_response(s, &response), "partial segment 1000-1499/5000 taken");
+  response.value_set(MIME_FIELD_CONTENT_RANGE, MIME_LEN_CONTENT_RANGE, "bytes 1000-1499/1500", 20);
+  box.check(HttpTransact::is_range_segment_response(s, &response), "last segment 1000-1499/1500 not taken");
+  response.value_set(MIME_FIELD_ETAG, MIME_LEN_ETAG, "W/\"v1\"", 6);
+  box.check(!HttpTransact::is_range_segment_response(s, &response), "segment with a weak ETag taken");
+  response.value_set(MIME_FIELD_LAST_MODIFIED, MIME_LEN_LAST_MODIFIED, "Sat, 01 Jan 2000 00:00:00 GMT", 29);
+  box.check(HttpTransact::is_range_segment_response(s, &response), "segment with a Last-Modified not taken");
+
+  // a cached segment of another version than the segment head's is not
+  // served, the head is rewritten only when the version changes
+  response.field_delete(MIME_FIELD_LAST_MODIFIED, MIME_LEN_LAST_MODIFIED);
+  response.value_set(MIME_FIELD_ETAG, MIME_LEN_ETAG, "\"v1\"", 4);
+  box.check(HttpTransact::range_segment_validator_matches(s, &response), "segment without a segment head does not match");
+  box.check(HttpTransact::range_segment_validator_set(s, &response), "missing segment head not written");
+  box.check(!HttpTransact::range_segment_validator_set(s, &response), "segment head of the same version rewritten");
+  box.check(HttpTransact::range_segment_validator_matches(s, &response), "segment of the same version does not match");
+  response.value_set(MIME_FIELD_ETAG, MIME_LEN_ETAG, "\"v2\"", 4);
+  box.check(!HttpTransact::range_segment_validator_matches(s, &response), "segment of another version matches");
+  box.check(HttpTransact::range_segment_validator_set(s, &response), "segment head of the old version not rewritten");
+  box.check(HttpTransact::range_segment_validator_matches(s, &response), "segment of the new version does not match");
+  response.value_set(MIME_FIELD_ETAG, MIME_LEN_ETAG, "\"v1\"", 4);
+  box.check(!HttpTransact::range_segment_validator_matches(s, &response), "segment of the old version matches");
+
+  response.destroy();
+  request->destroy();
+  delete s;
+  delete params;
+}
+#endif
@@ -409,7 +409,8 @@ public:
     PARSE_ERROR,
     TRANSACTION_COMPLETE,
     CONGEST_CONTROL_CONGESTED_ON_F,
-    CONGEST_CONTROL_CONGESTED_ON_M
+    CONGEST_CONTROL_CONGESTED_ON_M,
+    ORIGIN_OVERLOADED
   };
 
   enum CacheWriteStatus_t
@@ -997,6 +998,12 @@ public:
     int64_t num_range_fields;
     int64_t range_output_cl;
     RangeRecord *ranges;
+    bool range_in_cache;        // cache reads only the ranges, see do_io_pread_ranges
+    int64_t range_segment;      // cached segment serving the range, -1 if none
+    int64_t range_segment_size; // segment size the segment was chosen with
+    int64_t range_segment_total; // object size from the segment's Content-Range:
+    INK_MD5 range_segment_head;  // validator from the object's segment head
+    bool range_segment_head_found;
     
     OverridableHttpConfigParams *txn_conf;
     OverridableHttpConfigParams my_txn_conf; // Storage for plugins, to avoid malloc
@@ -1093,6 +1100,12 @@ public:
         num_range_fields(0),
         range_output_cl(0),
         ranges(NULL),
+        range_in_cache(false),
+        range_segment(-1),
+        range_segment_size(0),
+        range_segment_total(-1),
+        range_segment_head(),
+        range_segment_head_found(false),
         txn_conf(NULL),
         transparent_passthrough(false)
     {
@@ -1299,6 +1312,13 @@ public:
   static bool is_request_valid(State* s, HTTPHdr* incoming_request);
   static bool is_request_retryable(State* s);
   static bool is_response_cacheable(State* s, HTTPHdr* request, HTTPHdr* response);
+  static int64_t range_segment_for_request(State* s);
+  static bool is_range_segment_response(State* s, HTTPHdr* response);
+  static bool handle_range_segment_response(State* s, HTTPHdr* response);
+  static bool range_segment_validator_set(State* s, HTTPHdr* response);
+  static bool range_segment_validator_matches(State* s, HTTPHdr* response);
+  static bool parse_single_range(HTTPHdr* request, int64_t* start, int64_t* end);
+  static bool parse_content_range(HTTPHdr* response, int64_t* start, int64_t* end, int64_t* total);
   static bool is_response_valid(State* s, HTTPHdr* incoming_response);
 
   static void process_quick_http_filter(State* s, int method);
@@ -34,6 +34,7 @@
 #include "HttpConfig.h"
 #include "HttpTunnel.h"
 #include "HttpSM.h"
+#include "HttpServerSession.h"
 #include "HttpDebugNames.h"
 #include "ParseRules.h"
 
@@ -789,11 +790,19 @@ HttpTunnel::producer_run(HttpTunnelProducer * p)
   }
 
   int64_t read_start_pos = 0;
+  bool read_ranges = false;
   if (p->vc_type == HT_CACHE_READ && sm->t_state.range_setup == HttpTransact::RANGE_NOT_TRANSFORM_REQUESTED) {
     ink_assert(sm->t_state.num_range_fields == 1); // we current just support only one range entry
     read_start_pos = sm->t_state.ranges[0]._start;
     producer_n = (sm->t_state.ranges[0]._end - sm->t_state.ranges[0]._start)+1;
     consumer_n = (producer_n + sm->client_response_hdr_bytes);
+  } else if (p->vc_type == HT_CACHE_READ && sm->t_state.range_in_cache) {
+    // the range transform gets only the bytes of the ranges
+    read_ranges = true;
+    producer_n = 0;
+    for (int i = 0; i < sm->t_state.num_range_fields; i++)
+      producer_n += sm->t_state.ranges[i]._end - sm->t_state.ranges[i]._start + 1;
+    consumer_n = producer_n;
   } else if (p->nbytes >= 0) {
     consumer_n = p->nbytes;
     producer_n = p->ntodo;
@@ -935,11 +944,21 @@ HttpTunnel::producer_run(HttpTunnelProducer * p)
       Debug("http_tunnel", "[%" PRId64 "] [tunnel_run] producer already done", sm->sm_id);
       producer_handler(HTTP_TUNNEL_EVENT_PRECOMPLETE, p);
     } else {
-      if (read_start_pos > 0) {
+      if (read_ranges) {
+        int n = sm->t_state.num_range_fields;
+        int64_t *ranges = (int64_t *)ats_malloc(2 * n * sizeof(int64_t));
+        for (int i = 0; i < n; i++) {
+          ranges[2 * i] = sm->t_state.ranges[i]._start;
+          ranges[2 * i + 1] = sm->t_state.ranges[i]._end;
+        }
+        p->read_vio = ((CacheVC*)p->vc)->do_io_pread_ranges(this, p->read_buffer, n, ranges);
+        ats_free(ranges);
+      } else if (read_start_pos > 0) {
         p->read_vio = ((CacheVC*)p->vc)->do_io_pread(this, producer_n, p->read_buffer, read_start_pos);
       }
       else {
         p->read_vio = p->vc->do_io_read(this, producer_n, p->read_buffer);
+        producer_splice(p);
       }
     }
   }
@@ -950,6 +969,43 @@ HttpTunnel::producer_run(HttpTunnelProducer * p)
   p->buffer_start = NULL;
 }
 
+// Bodies shorter than this are not worth setting up a pipe for
+#define HTTP_TUNNEL_SPLICE_MIN_BYTES (32 * 1024)
+
+// Moves the data of the producer to its consumer in the kernel when both
+// are plain TCP connections and nothing in between needs to see the data.
+void
+HttpTunnel::producer_splice(HttpTunnelProducer * p)
+{
+  HttpTunnelConsumer *c = p->consumer_list.head;
+  HttpServerSession *server_session = sm->get_server_session();
+  NetVConnection *p_netvc, *c_netvc;
+
+  if (!sm->t_state.http_config_param->splice_tunnel || p->num_consumers != 1 || !c->alive || !c->write_vio)
+    return;
+  if (p->chunking_action != TCA_PASSTHRU_DECHUNKED_CONTENT || p->read_vio->nbytes < HTTP_TUNNEL_SPLICE_MIN_BYTES)
+    return;
+
+  if (!server_session || !sm->ua_session)
+    return;
+  if (p->vc == server_session && c->vc == sm->ua_session) {
+    p_netvc = server_session->get_netvc();
+    c_netvc = sm->ua_session->get_netvc();
+  } else if (p->vc == sm->ua_session && c->vc == server_session) {
+    // the POST body is copied out of the buffer for redirects
+    if (sm->t_state.method == HTTP_WKSIDX_POST && sm->enable_redirection)
+      return;
+    p_netvc = sm->ua_session->get_netvc();
+    c_netvc = server_session->get_netvc();
+  } else
+    return;
+
+  if (p_netvc && c_netvc && p_netvc->splice_to(c_netvc)) {
+    Debug("http_tunnel", "[%" PRId64 "] splicing %s to %s", sm->sm_id, p->name, c->name);
+    HTTP_INCREMENT_DYN_STAT(http_tunnel_splices_stat);
+  }
+}
+
 int
 HttpTunnel::producer_handler_dechunked(int event, HttpTunnelProducer * p)
 {
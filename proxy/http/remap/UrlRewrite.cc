@@ -573,6 +573,7 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping, RegexMap
 {
   bool retval;
   if (is_cur_mapping_regex) {
+    reg_map->prefilter_id = store.regex_prefilter.add(src_host);
     store.regex_list.enqueue(reg_map);
     retval = true;
   } else {
@@ -742,6 +743,12 @@ UrlRewrite::BuildTable(const char * path)
       forward_mappings_with_recv_port.hash_lookup);
   }
 
+  forward_mappings.regex_prefilter.compile();
+  reverse_mappings.regex_prefilter.compile();
+  permanent_redirects.regex_prefilter.compile();
+  temporary_redirects.regex_prefilter.compile();
+  forward_mappings_with_recv_port.regex_prefilter.compile();
+
   return 0;
 }
 
@@ -814,7 +821,7 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url,
     mapping_container.set(mapping);
     retval = true;
   }
-  if (_regexMappingLookup(mappings.regex_list, request_url, request_port, request_host_lower, request_host_len,
+  if (_regexMappingLookup(mappings.regex_list, mappings.regex_prefilter, request_url, request_port, request_host_lower, request_host_len,
                           rank_ceiling, mapping_container)) {
     Debug("url_rewrite", "Using regex mapping with rank %d", (mapping_container.getMapping())->getRank());
     retval = true;
@@ -872,9 +879,9 @@ UrlRewrite::_expandSubstitutions(int *matches_info, const RegexMapping *reg_map,
 }
 
 bool
-UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_url, int request_port,
-                                const char *request_host, int request_host_len, int rank_ceiling,
-                                UrlMappingContainer &mapping_container)
+UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, const RegexPrefilter &prefilter,
+                                URL *request_url, int request_port, const char *request_host,
+                                int request_host_len, int rank_ceiling, UrlMappingContainer &mapping_container)
 {
   bool retval = false;
 
@@ -892,6 +899,15 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
   int request_path_len, reg_map_path_len;
   const char *request_path = request_url->path_get(&request_path_len), *reg_map_path;
 
+  if (regex_mappings.empty()) {
+    return false;
+  }
+
+  // One pass over the host marks the regexes whose required literal it
+  // contains; only those are handed to pcre_exec() below.
+  unsigned char *candidates = (unsigned char *)alloca(prefilter.candidates_size());
+  prefilter.match(request_host, request_host_len, candidates);
+
   // Loop over the entire linked list, or until we're satisfied
   forl_LL(RegexMapping, list_iter, regex_mappings) {
     int reg_map_rank = list_iter->url_map->getRank();
@@ -923,6 +939,11 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
       continue;
     }
 
+    if (!RegexPrefilter::is_candidate(candidates, list_iter->prefilter_id)) {
+      Debug("url_rewrite_regex", "Skipping regex with rank %d as request host cannot match it", reg_map_rank);
+      continue;
+    }
+
     int matches_info[MAX_REGEX_SUBS * 3];
     int match_result = pcre_exec(list_iter->re, list_iter->re_extra, request_host, request_host_len,
                                  0, 0, matches_info, (sizeof(matches_info) / sizeof(int)));
@@ -86,6 +86,9 @@ public:
     int substitution_markers[MAX_REGEX_SUBS];
     int substitution_ids[MAX_REGEX_SUBS];
 
+    // id of the host regex in the store's prefilter
+    int prefilter_id;
+
     LINK(RegexMapping, link);
   };
 
@@ -95,6 +98,9 @@ public:
   {
     InkHashTable *hash_lookup;
     RegexMappingList regex_list;
+    // finds the regexes a host can possibly match in one pass, so that
+    // pcre_exec() only runs for those
+    RegexPrefilter regex_prefilter;
     bool empty() { return ((hash_lookup == NULL) && regex_list.empty()); }
   };
 
@@ -177,7 +183,7 @@ private:
                       int request_host_len, UrlMappingContainer &mapping_container);
   url_mapping *_tableLookup(InkHashTable * h_table, URL * request_url, int request_port, char *request_host,
                             int request_host_len);
-  bool _regexMappingLookup(RegexMappingList &regex_mappings, URL * request_url, int request_port, const char *request_host,
+  bool _regexMappingLookup(RegexMappingList &regex_mappings, const RegexPrefilter &prefilter, URL * request_url, int request_port, const char *request_host,
                            int request_host_len, int rank_ceiling,
                            UrlMappingContainer &mapping_container);
   int _expandSubstitutions(int *matches_info, const RegexMapping *reg_map, const char *matched_string, char *dest_buf,
@@ -0,0 +1,334 @@
+/** @file
+
+  Benchmark of the log formatting pipeline
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @section details Details
+
+  Replays the LogBuffers of binary log files through an ascii LogObject,
+  formatted by 1 to -t preproc threads and written by the flush thread
+  as in traffic_server, once for each of the -c compressions, and reports
+  the rate at which the buffers were written out.  The uncompressed
+  output of every thread count is compared with that of one thread, so
+  that buffers written out of order show up as a difference.
+ */
+
+#include "ink_config.h"
+#include "ink_file.h"
+#include "I_Layout.h"
+#include "I_Version.h"
+
+#define PROGRAM_NAME        "log_replay_bench"
+#define MAX_LOGBUFFER_SIZE  65536
+#define MAX_THREADS         64
+
+#include "LogStandalone.cc"
+
+#include "LogField.h"
+#include "LogFormat.h"
+#include "LogFile.h"
+#include "LogObject.h"
+#include "LogConfig.h"
+#include "LogBuffer.h"
+#include "LogCompress.h"
+#include "Log.h"
+
+static int version_flag = 0;
+static int help = 0;
+static int max_threads = 4;
+static int rounds = 10;
+static char compressions[256] = "none,gzip,zstd";
+static char output_dir[1024] = ".";
+
+static const ArgumentDescription argument_descriptions[] = {
+  {"threads", 't', "Maximum number of preproc threads", "I", &max_threads, NULL, NULL},
+  {"rounds", 'r', "Number of times the input is replayed", "I", &rounds, NULL, NULL},
+  {"compression", 'c', "Comma separated compressions to run", "S255", compressions, NULL, NULL},
+  {"output_dir", 'd', "Directory of the output files", "S1023", output_dir, NULL, NULL},
+  {"help", 'h', "Give this help", "T", &help, NULL, NULL},
+  {"debug_tags", 'T', "Colon-Separated Debug Tags", "S1023", error_tags, NULL, NULL},
+  {"version", 'V', "Print Version Id", "T", &version_flag, NULL, NULL}
+};
+
+static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-t threads] [-r rounds] [-c none,gzip,zstd] [-d dir] "
+  "binary-log-file ...";
+
+static LogBufferHeader **input;
+static int n_input;
+static int64_t input_bytes;
+
+// the object being replayed, and the number of its preproc threads
+static LogObject *volatile replay_object;
+static volatile int replay_threads;
+static EventNotify *notify;
+static volatile int active[MAX_THREADS];
+static int64_t queued[MAX_THREADS];
+static volatile int64_t formatted[MAX_THREADS];
+
+struct ReplayPreproc:public Continuation
+{
+  int idx;
+
+  ReplayPreproc(int i):Continuation(NULL), idx(i)
+  {
+    SET_HANDLER(&ReplayPreproc::mainEvent);
+  }
+
+  int mainEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    while (true) {
+      ink_atomic_swap(&active[idx], 1);
+      LogObject *obj = replay_object;
+
+      if (obj && idx < replay_threads)
+        formatted[idx] += obj->preproc_buffers(idx);
+      ink_atomic_swap(&active[idx], 0);
+      notify[idx].timedwait(1);
+    }
+    return 0;
+  }
+};
+
+struct ReplayFlush:public Continuation
+{
+  ReplayFlush():Continuation(NULL)
+  {
+    SET_HANDLER(&ReplayFlush::mainEvent);
+  }
+
+  int mainEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    Log::flush_thread_main(NULL);
+    return 0;
+  }
+};
+
+static int
+read_input(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    fprintf(stderr, "Error opening input file %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  while (true) {
+    LogBufferHeader header;
+    int nread = read(fd, &header, sizeof(header));
+
+    if (nread == 0)
+      break;
+    if (nread != (int) sizeof(header) || header.cookie != LOG_SEGMENT_COOKIE ||
+        header.byte_count < sizeof(header) || header.byte_count > MAX_LOGBUFFER_SIZE) {
+      fprintf(stderr, "Bad LogBuffer in %s\n", path);
+      close(fd);
+      return -1;
+    }
+
+    char *buffer = NEW(new char[header.byte_count]);
+    memcpy(buffer, &header, sizeof(header));
+    int body = header.byte_count - sizeof(header);
+    if (body > 0 && read(fd, buffer + sizeof(header), body) != body) {
+      fprintf(stderr, "Short LogBuffer in %s\n", path);
+      delete[] buffer;
+      close(fd);
+      return -1;
+    }
+
+    input = (LogBufferHeader **) ats_realloc(input, (n_input + 1) * sizeof(LogBufferHeader *));
+    input[n_input++] = (LogBufferHeader *) buffer;
+    input_bytes += header.byte_count;
+  }
+
+  close(fd);
+  return 0;
+}
+
+static bool
+all_formatted()
+{
+  for (int i = 0; i < replay_threads; i++) {
+    if (formatted[i] < queued[i])
+      return false;
+  }
+  return true;
+}
+
+static bool
+same_contents(const char *a, const char *b)
+{
+  FILE *fa = fopen(a, "r"), *fb = fopen(b, "r");
+  bool same = fa && fb;
+
+  while (same) {
+    int ca = getc(fa), cb = getc(fb);
+    if (ca != cb)
+      same = false;
+    else if (ca == EOF)
+      break;
+  }
+  if (fa)
+    fclose(fa);
+  if (fb)
+    fclose(fb);
+  return same;
+}
+
+// Replays the input through a new LogObject formatted by @a nthreads
+// threads, returning the name of its output file.
+static char *
+replay(LogFormat *format, LogFileCompression compression, int nthreads)
+{
+  char basename[64];
+
+  snprintf(basename, sizeof(basename), "replay-%s-%d", LogCompress::name(compression), nthreads);
+
+  LogObject *obj = NEW(new LogObject(format, output_dir, basename, LOG_FILE_ASCII, NULL, 0, nthreads,
+                                     0, 0, 0, false, compression));
+  char *path = ats_strdup(obj->get_full_filename());
+
+  unlink(path);
+  for (int i = 0; i < nthreads; i++)
+    queued[i] = formatted[i] = 0;
+  replay_threads = nthreads;
+  replay_object = obj;
+
+  // Buffers go to the threads in turn, so keeping each thread's backlog
+  // under its share of the LogFile reorder window means that the order
+  // is never given up on.
+  int64_t backlog = LOGFILE_FLUSH_WINDOW / (2 * nthreads);
+  ink_hrtime start = ink_get_hrtime_internal();
+
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < n_input; i++) {
+      char *copy = NEW(new char[input[i]->byte_count]);
+      memcpy(copy, input[i], input[i]->byte_count);
+
+      LogBuffer *lb = NEW(new LogBuffer(obj, (LogBufferHeader *) copy));
+      int idx = obj->add_to_flush_queue(lb);
+      queued[idx]++;
+      notify[idx].signal();
+      while (queued[idx] - formatted[idx] >= backlog)
+        sched_yield();
+    }
+  }
+
+  // everything is written out once the flush thread has let go of the
+  // LogFile
+  while (!all_formatted() || obj->m_logFile->refcount() > 1)
+    usleep(100);
+
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+  double secs = (double) elapsed / HRTIME_SECOND;
+  double in_mb = (double) input_bytes * rounds / (1024 * 1024);
+  double out_mb = (double) obj->m_logFile->m_bytes_written / (1024 * 1024);
+
+  printf("%-5s %2d threads: %8.1f MB in %7.3f sec, %8.1f MB/sec, %8.1f MB out\n",
+         LogCompress::name(compression), nthreads, in_mb, secs, in_mb / secs, out_mb);
+
+  // make sure no preproc thread still looks at the object
+  ink_atomic_swap(&replay_object, (LogObject *) NULL);
+  for (int i = 0; i < nthreads; i++) {
+    while (active[i])
+      sched_yield();
+  }
+  delete obj;
+
+  return path;
+}
+
+int
+main(int /* argc ATS_UNUSED */, char *argv[])
+{
+  appVersionInfo.setup(PACKAGE_NAME, PROGRAM_NAME, PACKAGE_VERSION, __DATE__,
+                       __TIME__, BUILD_MACHINE, BUILD_PERSON, "");
+
+  Layout::create();
+  process_args(argument_descriptions, countof(argument_descriptions), argv, USAGE_LINE);
+
+  if (version_flag) {
+    fprintf(stderr, "%s\n", appVersionInfo.FullVersionInfoStr);
+    _exit(0);
+  }
+  if (help || n_file_arguments == 0 || max_threads < 1 || max_threads > MAX_THREADS || rounds < 1) {
+    usage(argument_descriptions, countof(argument_descriptions), USAGE_LINE);
+  }
+
+  init_log_standalone_basic(PROGRAM_NAME);
+  RecProcessInit(RECM_STAND_ALONE, diags);
+  Log::init(Log::NO_REMOTE_MANAGEMENT | Log::LOGCAT);
+  log_rsb = RecAllocateRawStatBlock((int) log_stat_count);
+
+  ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
+  eventProcessor.start(1, 1048576); // Hardcoded stacksize at 1MB
+
+  for (unsigned i = 0; i < n_file_arguments; i++) {
+    if (read_input(file_arguments[i]) < 0)
+      _exit(1);
+  }
+  if (n_input == 0) {
+    fprintf(stderr, "No LogBuffers to replay\n");
+    _exit(1);
+  }
+  printf("replaying %d LogBuffers (%.1f MB) %d times\n", n_input, (double) input_bytes / (1024 * 1024), rounds);
+
+  // the formatting and flush threads of Log::create_threads()
+  notify = new EventNotify[max_threads];
+  for (int i = 0; i < max_threads; i++)
+    eventProcessor.spawn_thread(NEW(new ReplayPreproc(i)), "[LOG_PREPROC]", 1048576);
+  Log::flush_notify = new EventNotify;
+  Log::flush_data_list = new InkAtomicList;
+  ink_atomiclist_init(Log::flush_data_list, "Logging flush buffer list", 0);
+  eventProcessor.spawn_thread(NEW(new ReplayFlush), "[LOG_FLUSH]", 1048576);
+
+  // the output is formatted with the format stored in each buffer
+  LogFormat *format = NEW(new LogFormat("replay", "%<cqtq>"));
+  int failures = 0;
+  SimpleTokenizer tok(compressions, ',');
+  char *name;
+
+  while ((name = tok.getNext()) != NULL) {
+    LogFileCompression compression = LogCompress::from_name(name);
+    char *first = NULL;
+
+    if (compression == N_LOG_COMPRESSION_TYPES) {
+      printf("%-5s not supported\n", name);
+      continue;
+    }
+
+    for (int n = 1; n <= max_threads; n *= 2) {
+      char *path = replay(format, compression, n);
+
+      if (!first) {
+        first = path;
+        continue;
+      }
+      if (compression == LOG_COMPRESSION_NONE && !same_contents(first, path)) {
+        printf("FAILED: %s differs from %s\n", path, first);
+        failures++;
+      }
+      ats_free(path);
+    }
+    ats_free(first);
+  }
+
+  _exit(failures ? 1 : 0);
+}
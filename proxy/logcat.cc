@@ -41,6 +41,7 @@
 #include "LogObject.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogColumnar.h"
 #include "LogUtils.h"
 #include "LogSock.h"
 #include "LogPredefined.h"
@@ -57,8 +58,15 @@ static int elf2_flag = 0;
 static int auto_filenames = 0;
 static int overwrite_existing_file = 0;
 static char output_file[1024];
+static int64_t start_time = 0;
+static int64_t end_time = 0;
+static char filters[1024];
 int auto_clear_cache_flag = 0;
 
+// selects the entries, reading as little as it can
+static LogColumnQuery query;
+static bool query_set = false;
+
 static const ArgumentDescription argument_descriptions[] = {
 
   {"output_file", 'o', "Specify output file", "S1023", &output_file, NULL, NULL},
@@ -74,17 +82,36 @@ static const ArgumentDescription argument_descriptions[] = {
   {"overwrite_output", 'w', "Overwrite existing output file(s)", "T",
    &overwrite_existing_file, NULL, NULL},
   {"elf2", '2', "Convert to Extended2 Logging Format", "T", &elf2_flag, NULL,
-   NULL}
+   NULL},
+  {"start", 's', "Only entries at or after this time (seconds since the epoch)", "L", &start_time, NULL, NULL},
+  {"end", 'e', "Only entries before this time (seconds since the epoch)", "L", &end_time, NULL, NULL},
+  {"filter", 'F', "Only entries whose fields print as given (symbol=value,...)", "S1023", &filters, NULL, NULL}
 };
 
 static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-o output-file | -a] [-CEhS"
 #ifdef DEBUG
   "T"
 #endif
-  "Vw2] [input-file ...]";
+  "Vw2] [-s start] [-e end] [-F symbol=value,...] [input-file ...]";
 
 
 
+// the alternate format requested on the command line, if any
+static const char *
+alt_format()
+{
+  const char * alt_format = NULL;
+  if (squid_flag)
+    alt_format = PreDefinedFormatInfo::squid;
+  if (clf_flag)
+    alt_format = PreDefinedFormatInfo::common;
+  if (elf_flag)
+    alt_format = PreDefinedFormatInfo::extended;
+  if (elf2_flag)
+    alt_format = PreDefinedFormatInfo::extended2;
+  return alt_format;
+}
+
 static int
 process_file(int in_fd, int out_fd)
 {
@@ -111,7 +138,7 @@ process_file(int in_fd, int out_fd)
 
     // ensure that this is a valid logbuffer header
     //
-    if (header->cookie != LOG_SEGMENT_COOKIE) {
+    if (header->cookie != LOG_SEGMENT_COOKIE && header->cookie != LOG_COLUMN_COOKIE) {
       fprintf(stderr, "Bad LogBuffer!\n");
       return 1;
     }
@@ -127,6 +154,23 @@ process_file(int in_fd, int out_fd)
       fprintf(stderr, "Bad LogBufferHeader read!\n");
       return 1;
     }
+    // columnar blocks, and any blocks when selecting entries, are read
+    // only as far as they need to be
+    //
+    if (query_set || header->cookie == LOG_COLUMN_COOKIE) {
+      bool error;
+      LogBufferHeader *rows = query.read_block(in_fd, header, &error);
+
+      if (error) {
+        fprintf(stderr, "Bad LogBuffer read!\n");
+        return 1;
+      }
+      if (rows) {
+        bytes += LogFile::write_ascii_logbuffer(rows, out_fd, ".", alt_format());
+        ats_free(rows);
+      }
+      continue;
+    }
     // read the rest of the buffer
     //
     uint32_t byte_count = header->byte_count;
@@ -160,23 +204,10 @@ process_file(int in_fd, int out_fd)
       fprintf(stderr, "Read too many bytes!\n");
       return 1;
     }
-    // see if there is an alternate format request from the command
-    // line
-    //
-    const char * alt_format = NULL;
-    if (squid_flag)
-      alt_format = PreDefinedFormatInfo::squid;
-    if (clf_flag)
-      alt_format = PreDefinedFormatInfo::common;
-    if (elf_flag)
-      alt_format = PreDefinedFormatInfo::extended;
-    if (elf2_flag)
-      alt_format = PreDefinedFormatInfo::extended2;
-
     // convert the buffer to ascii entries and place onto stdout
     //
     if (header->fmt_fieldlist()) {
-      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format);
+      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format());
     } else {
       // TODO investigate why this buffer goes wonky
     }
@@ -265,6 +296,20 @@ main(int /* argc ATS_UNUSED */, char *argv[])
 
   Log::init(Log::NO_REMOTE_MANAGEMENT | Log::LOGCAT);
 
+  // set up the entry selection
+  //
+  if (start_time || end_time) {
+    query.set_time_range(start_time, end_time ? end_time : INT64_MAX);
+    query_set = true;
+  }
+  if (filters[0] != 0) {
+    if (!query.add_filters(filters)) {
+      fprintf(stderr, "Error: filters must be given as symbol=value,...\n");
+      _exit(CMD_LINE_OPTION_ERROR);
+    }
+    query_set = true;
+  }
+
   // setup output file
   //
   int out_fd = STDOUT_FILENO;
@@ -342,5 +387,6 @@ main(int /* argc ATS_UNUSED */, char *argv[])
     }
   }
 
+  Debug("logcat", "skipped reading %" PRId64 " bytes", query.m_bytes_skipped);
   _exit(error);
 }
@@ -1487,6 +1487,9 @@ Log::match_logobject(LogBufferHeader * header)
     if (fmt->valid()) {
       LogFileFormat file_format = header->log_object_flags & LogObject::BINARY ? LOG_FILE_BINARY :
         (header->log_object_flags & LogObject::WRITES_TO_PIPE ? LOG_FILE_PIPE : LOG_FILE_ASCII);
+      // as the client's object, so that the signatures match
+      LogFileCompression compression = header->log_object_flags & LogObject::GZIP_COMPRESSED ? LOG_COMPRESSION_GZIP :
+        (header->log_object_flags & LogObject::ZSTD_COMPRESSED ? LOG_COMPRESSION_ZSTD : LOG_COMPRESSION_NONE);
 
       obj = NEW(new LogObject(fmt, Log::config->logfile_dir,
                               header->log_filename(), file_format, NULL,
@@ -1494,7 +1497,8 @@ Log::match_logobject(LogBufferHeader * header)
                               Log::config->collation_preproc_threads,
                               Log::config->rolling_interval_sec,
                               Log::config->rolling_offset_hr,
-                              Log::config->rolling_size_mb, true));
+                              Log::config->rolling_size_mb, true,
+                              compression, header->log_object_flags & LogObject::COLUMNAR));
 
       obj->set_remote_flag();
 
@@ -128,7 +128,7 @@ LogBuffer::LogBuffer(LogObject * owner, size_t size, size_t buf_align, size_t wr
   m_size(size),
   m_buf_align(buf_align),
   m_write_align(write_align), m_owner(owner),
-  m_references(0)
+  m_references(0), m_flush_seq(-1)
 {
   size_t hdr_size;
 
@@ -158,13 +158,16 @@ LogBuffer::LogBuffer(LogObject * owner, LogBufferHeader * header):
   m_size(0),
   m_buf_align(LB_DEFAULT_ALIGN),
   m_write_align(INK_MIN_ALIGN), m_expiration_time(0), m_owner(owner), m_header(header),
-  m_references(0)
+  m_references(0), m_flush_seq(-1)
 {
   // This constructor does not allocate a buffer because it gets it as
   // an argument. We set m_unaligned_buffer to NULL, which means that
   // no checkout writes or checkin writes are allowed. This is enforced
   // by the asserts in checkout_write and checkin_write
 
+  // no writers, so that LogBufferManager::preproc_buffers() takes it
+  m_state.ival = 0;
+
   // update the buffer id (m_id gets the old value)
   //
   m_id = (uint32_t) ink_atomic_increment((pvint32) & M_ID, 1);
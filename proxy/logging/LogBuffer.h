@@ -217,6 +217,7 @@ private:
 public:
   volatile LB_State m_state;    // buffer state
   volatile int m_references;    // oustanding checkout_write references.
+  int64_t m_flush_seq;          // position in the LogFile write order, -1 for none
 private:
 
   // private functions
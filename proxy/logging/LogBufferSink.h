@@ -45,6 +45,16 @@ public:
   // return 0 if success, -1 on error.
   //
   virtual int preproc_and_try_delete(LogBuffer * buffer) = 0;
+
+  //
+  // Called instead of preproc_and_try_delete() for a buffer which is
+  // dropped, before it is deleted, so that the sink does not wait for
+  // it.
+  //
+  virtual void drop_buffer(LogBuffer * /* buffer ATS_UNUSED */)
+  {
+  };
+
   virtual ~ LogBufferSink()
   {
   };
@@ -0,0 +1,928 @@
+/** @file
+
+  Columnar layout of binary log buffers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+
+#include "Error.h"
+#include "LogAccess.h"
+#include "LogFormat.h"
+#include "LogColumnar.h"
+#include "ts/TestBox.h"
+
+// larger blocks than this are taken to be corrupt
+#define LOG_COLUMN_MAX_BLOCK (64 * 1024 * 1024)
+
+/*-------------------------------------------------------------------------
+  How the fields are marshalled
+  -------------------------------------------------------------------------*/
+
+enum FieldClass
+{
+  FIELD_INT,                    // an int64_t
+  FIELD_STRING,                 // a nul terminated string, padded
+  FIELD_RECORD,                 // a string of MARSHAL_RECORD_LENGTH bytes
+  FIELD_IP                      // a LogFieldIp
+};
+
+static FieldClass
+field_class(LogField * field)
+{
+  if (field->aggregate() != LogField::NO_AGGREGATE)
+    return FIELD_INT;
+
+  switch (field->container()) {
+  case LogField::NO_CONTAINER:
+    break;
+  case LogField::ICFG:
+    return FIELD_INT;
+  case LogField::RECORD:
+    return FIELD_RECORD;
+  default:
+    return FIELD_STRING;
+  }
+
+  switch (field->type()) {
+  case LogField::sINT:
+  case LogField::dINT:
+    return FIELD_INT;
+  case LogField::IP:
+    return FIELD_IP;
+  default:
+    return FIELD_STRING;
+  }
+}
+
+// Returns the number of bytes of the value at @a p, which may not
+// extend past @a end, or -1 if it does.
+static int
+field_len(FieldClass cls, const char *p, const char *end)
+{
+  int len;
+
+  switch (cls) {
+  case FIELD_INT:
+    len = INK_MIN_ALIGN;
+    break;
+  case FIELD_RECORD:
+    len = MARSHAL_RECORD_LENGTH;
+    break;
+  case FIELD_IP:
+    {
+      if (end - p < (int) sizeof(LogFieldIp))
+        return -1;
+      const LogFieldIp *ip = reinterpret_cast<const LogFieldIp *>(p);
+      len = sizeof(LogFieldIp);
+      if (AF_INET == ip->_family)
+        len = sizeof(LogFieldIp4);
+      else if (AF_INET6 == ip->_family)
+        len = sizeof(LogFieldIp6);
+      len = INK_ALIGN_DEFAULT(len);
+    }
+    break;
+  default:
+    {
+      const char *nul = (const char *) memchr(p, 0, end - p);
+      if (!nul)
+        return -1;
+      len = LogAccess::round_strlen(nul - p + 1);
+    }
+    break;
+  }
+  return (end - p < len) ? -1 : len;
+}
+
+// Copies the value at @a p of @a len bytes to @a dest with everything
+// which is not part of the value, such as padding, zeroed; so equal
+// values are equal bytes.
+static void
+normalize_value(FieldClass cls, const char *p, int len, char *dest)
+{
+  memset(dest, 0, len);
+  switch (cls) {
+  case FIELD_IP:
+    {
+      const LogFieldIp *ip = reinterpret_cast<const LogFieldIp *>(p);
+      if (AF_INET == ip->_family) {
+        LogFieldIp4 *ip4 = reinterpret_cast<LogFieldIp4 *>(dest);
+        ip4->_family = AF_INET;
+        ip4->_addr = static_cast<const LogFieldIp4 *>(ip)->_addr;
+      } else if (AF_INET6 == ip->_family) {
+        LogFieldIp6 *ip6 = reinterpret_cast<LogFieldIp6 *>(dest);
+        ip6->_family = AF_INET6;
+        ip6->_addr = static_cast<const LogFieldIp6 *>(ip)->_addr;
+      } else {
+        reinterpret_cast<LogFieldIp *>(dest)->_family = ip->_family;
+      }
+    }
+    break;
+  case FIELD_STRING:
+  case FIELD_RECORD:
+    memcpy(dest, p, strnlen(p, len));
+    break;
+  default:
+    memcpy(dest, p, len);
+    break;
+  }
+}
+
+static inline uint32_t
+hash_value(const char *p, int len)
+{
+  uint32_t h = 2166136261U;     // FNV-1a
+
+  for (int i = 0; i < len; i++)
+    h = (h ^ (unsigned char) p[i]) * 16777619U;
+  return h;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::transcode
+  -------------------------------------------------------------------------*/
+
+char *
+LogColumnar::transcode(LogBufferHeader * row)
+{
+  if (row->cookie != LOG_SEGMENT_COOKIE || row->version != LOG_SEGMENT_VERSION ||
+      row->data_offset < sizeof(LogBufferHeader) || row->data_offset > row->byte_count || row->entry_count == 0)
+    return NULL;
+
+  LogFieldList fieldlist;
+  bool agg;
+  int nfields = LogFormat::parse_symbol_string(row->fmt_fieldlist(), &fieldlist, &agg);
+
+  if (nfields <= 0)
+    return NULL;
+
+  unsigned n = row->entry_count;
+  unsigned ncols = LOG_COLUMN_FIRST_FIELD + nfields;
+  FieldClass *classes = (FieldClass *) ats_malloc(nfields * sizeof(FieldClass));
+  int64_t *field_bytes = (int64_t *) ats_malloc(nfields * sizeof(int64_t));
+  // where each value of each entry starts in the row buffer
+  uint32_t *pos = (uint32_t *) ats_malloc((size_t) n * nfields * sizeof(uint32_t));
+  int64_t *ts = (int64_t *) ats_malloc(n * sizeof(int64_t));
+  int64_t *ts_usec = (int64_t *) ats_malloc(n * sizeof(int64_t));
+  char *block = NULL;
+  uint32_t *table = NULL, *voff = NULL;
+
+  int f = 0;
+  for (LogField * field = fieldlist.first(); field; field = fieldlist.next(field), f++) {
+    classes[f] = field_class(field);
+    field_bytes[f] = 0;
+  }
+
+  // find the values of each entry
+  char *base = (char *) row;
+  char *end = base + row->byte_count;
+  char *p = base + row->data_offset;
+  uint32_t row_bytes = 0;
+
+  for (unsigned i = 0; i < n; i++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+
+    if (end - p < (int) sizeof(LogEntryHeader) || entry->entry_len < sizeof(LogEntryHeader) ||
+        entry->entry_len > (uint32_t) (end - p))
+      goto Lfail;
+
+    char *entry_end = p + entry->entry_len;
+    char *v = p + sizeof(LogEntryHeader);
+
+    ts[i] = entry->timestamp;
+    ts_usec[i] = entry->timestamp_usec;
+    row_bytes += sizeof(LogEntryHeader);
+    for (f = 0; f < nfields; f++) {
+      int len = field_len(classes[f], v, entry_end);
+      if (len < 0)
+        goto Lfail;
+      pos[i * nfields + f] = v - base;
+      field_bytes[f] += len;
+      row_bytes += len;
+      v += len;
+    }
+    p = entry_end;
+  }
+
+  {
+    // lay out the block, with room for every value to be distinct
+    uint32_t dir_offset = INK_ALIGN_DEFAULT(row->data_offset);
+    int64_t size = dir_offset + INK_ALIGN_DEFAULT(sizeof(LogColumnIndex) + ncols * sizeof(LogColumnHeader)) +
+      LOG_COLUMN_FIRST_FIELD * (int64_t) n * sizeof(int64_t);
+    for (f = 0; f < nfields; f++) {
+      if (classes[f] == FIELD_INT)
+        size += n * sizeof(int64_t);
+      else
+        size += INK_ALIGN_DEFAULT(n * sizeof(uint32_t)) + field_bytes[f] + INK_ALIGN_DEFAULT((n + 1) * sizeof(uint32_t));
+    }
+    if (size > LOG_COLUMN_MAX_BLOCK)
+      goto Lfail;
+
+    block = new char[size];
+    memcpy(block, row, row->data_offset);
+    memset(block + row->data_offset, 0, size - row->data_offset);
+
+    LogBufferHeader *header = (LogBufferHeader *) block;
+    LogColumnIndex *index = (LogColumnIndex *) (block + dir_offset);
+    LogColumnHeader *columns = (LogColumnHeader *) (index + 1);
+    uint32_t off = dir_offset + INK_ALIGN_DEFAULT(sizeof(LogColumnIndex) + ncols * sizeof(LogColumnHeader));
+
+    header->cookie = LOG_COLUMN_COOKIE;
+    header->data_offset = dir_offset;
+    index->column_count = ncols;
+    index->row_bytes = row_bytes;
+
+    // the entry timestamps
+    for (unsigned c = 0; c < LOG_COLUMN_FIRST_FIELD; c++) {
+      int64_t *src = (c == LOG_COLUMN_TIMESTAMP) ? ts : ts_usec;
+      LogColumnHeader *col = &columns[c];
+
+      col->kind = LOG_COLUMN_INT;
+      col->offset = off;
+      col->byte_count = n * sizeof(int64_t);
+      col->min_value = col->max_value = src[0];
+      memcpy(block + off, src, n * sizeof(int64_t));
+      for (unsigned i = 1; i < n; i++) {
+        col->min_value = MIN(col->min_value, src[i]);
+        col->max_value = MAX(col->max_value, src[i]);
+      }
+      off += col->byte_count;
+    }
+    header->low_timestamp = (uint32_t) columns[LOG_COLUMN_TIMESTAMP].min_value;
+    header->high_timestamp = (uint32_t) columns[LOG_COLUMN_TIMESTAMP].max_value;
+
+    // the fields
+    unsigned table_size = 16;
+    while (table_size < 2 * n)
+      table_size <<= 1;
+    table = (uint32_t *) ats_malloc(table_size * sizeof(uint32_t));
+    voff = (uint32_t *) ats_malloc((n + 1) * sizeof(uint32_t));
+
+    for (f = 0; f < nfields; f++) {
+      LogColumnHeader *col = &columns[LOG_COLUMN_FIRST_FIELD + f];
+
+      col->offset = off;
+      if (classes[f] == FIELD_INT) {
+        int64_t *ints = (int64_t *) (block + off);
+
+        col->kind = LOG_COLUMN_INT;
+        for (unsigned i = 0; i < n; i++) {
+          memcpy(&ints[i], base + pos[i * nfields + f], sizeof(int64_t));
+          col->min_value = i ? MIN(col->min_value, ints[i]) : ints[i];
+          col->max_value = i ? MAX(col->max_value, ints[i]) : ints[i];
+        }
+        off += n * sizeof(int64_t);
+      } else {
+        uint32_t *ids = (uint32_t *) (block + off);
+        char *values = block + off + INK_ALIGN_DEFAULT(n * sizeof(uint32_t));
+        char key[INK_ALIGN_DEFAULT(sizeof(LogFieldIpStorage))];
+        uint32_t d = 0;
+
+        col->kind = LOG_COLUMN_DICT;
+        col->dict_offset = values - block;
+        memset(table, 0, table_size * sizeof(uint32_t));
+        voff[0] = 0;
+
+        for (unsigned i = 0; i < n; i++) {
+          char *v = base + pos[i * nfields + f];
+          int len = field_len(classes[f], v, end);
+          const char *k = v;
+          int key_len = len;
+
+          if (classes[f] == FIELD_IP) {
+            normalize_value(FIELD_IP, v, len, key);
+            k = key;
+          } else if (classes[f] != FIELD_INT) {
+            key_len = strnlen(v, len);
+            key_len += (key_len < len);
+          }
+
+          uint32_t slot = hash_value(k, key_len) & (table_size - 1);
+          while (table[slot]) {
+            uint32_t id = table[slot] - 1;
+            if (voff[id + 1] - voff[id] == (uint32_t) len && memcmp(values + voff[id], k, key_len) == 0)
+              break;
+            slot = (slot + 1) & (table_size - 1);
+          }
+          if (!table[slot]) {
+            normalize_value(classes[f], k, len, values + voff[d]);
+            voff[d + 1] = voff[d] + len;
+            table[slot] = ++d;
+          }
+          ids[i] = table[slot] - 1;
+        }
+
+        col->dict_count = d;
+        col->dict_index_offset = col->dict_offset + INK_ALIGN_DEFAULT(voff[d]);
+        memcpy(block + col->dict_index_offset, voff, (d + 1) * sizeof(uint32_t));
+        off = col->dict_index_offset + INK_ALIGN_DEFAULT((d + 1) * sizeof(uint32_t));
+      }
+      col->byte_count = off - col->offset;
+    }
+
+    header->byte_count = off;
+  }
+
+  ats_free(voff);
+  ats_free(table);
+  ats_free(ts_usec);
+  ats_free(ts);
+  ats_free(pos);
+  ats_free(field_bytes);
+  ats_free(classes);
+  return block;
+
+Lfail:
+  Debug("log-columnar", "cannot transcode a malformed LogBuffer");
+  ats_free(ts_usec);
+  ats_free(ts);
+  ats_free(pos);
+  ats_free(field_bytes);
+  ats_free(classes);
+  return NULL;
+}
+
+/*-------------------------------------------------------------------------
+  Reading columnar blocks
+  -------------------------------------------------------------------------*/
+
+LogColumnIndex *
+LogColumnar::index(LogBufferHeader * block)
+{
+  return (LogColumnIndex *) ((char *) block + block->data_offset);
+}
+
+LogColumnHeader *
+LogColumnar::column(LogBufferHeader * block, unsigned i)
+{
+  return (LogColumnHeader *) (index(block) + 1) + i;
+}
+
+bool
+LogColumnar::valid_block(LogBufferHeader * block)
+{
+  if (block->cookie != LOG_COLUMN_COOKIE || block->version != LOG_SEGMENT_VERSION ||
+      block->data_offset < sizeof(LogBufferHeader) || block->data_offset % INK_MIN_ALIGN ||
+      (uint64_t) block->data_offset + sizeof(LogColumnIndex) > block->byte_count)
+    return false;
+
+  LogColumnIndex *idx = index(block);
+  if (idx->column_count < LOG_COLUMN_FIRST_FIELD ||
+      block->data_offset + sizeof(LogColumnIndex) + (uint64_t) idx->column_count * sizeof(LogColumnHeader) >
+      block->byte_count)
+    return false;
+
+  for (unsigned c = 0; c < idx->column_count; c++) {
+    LogColumnHeader *col = column(block, c);
+    if ((uint64_t) col->offset + col->byte_count > block->byte_count || col->offset % INK_MIN_ALIGN)
+      return false;
+  }
+  return true;
+}
+
+// Checks the contents of a column, once they have been read.
+static bool
+valid_column(LogBufferHeader * block, LogColumnHeader * col)
+{
+  uint64_t n = block->entry_count;
+  uint64_t col_end = (uint64_t) col->offset + col->byte_count;
+
+  if (col->kind == LOG_COLUMN_INT)
+    return col->byte_count >= n * sizeof(int64_t);
+  if (col->kind != LOG_COLUMN_DICT || col->offset + n * sizeof(uint32_t) > col->dict_offset ||
+      col->dict_offset > col->dict_index_offset ||
+      col->dict_index_offset + (col->dict_count + 1ULL) * sizeof(uint32_t) > col_end)
+    return false;
+
+  char *base = (char *) block;
+  uint32_t *ids = (uint32_t *) (base + col->offset);
+  uint32_t *voff = (uint32_t *) (base + col->dict_index_offset);
+
+  if (voff[0] != 0 || voff[col->dict_count] > col->dict_index_offset - col->dict_offset)
+    return false;
+  for (unsigned d = 0; d < col->dict_count; d++) {
+    if (voff[d + 1] < voff[d])
+      return false;
+  }
+  for (unsigned i = 0; i < n; i++) {
+    if (ids[i] >= col->dict_count)
+      return false;
+  }
+  return true;
+}
+
+LogBufferHeader *
+LogColumnar::to_rows(LogBufferHeader * block, const char *selected)
+{
+  unsigned n = block->entry_count;
+  unsigned ncols = index(block)->column_count;
+
+  for (unsigned c = 0; c < ncols; c++) {
+    if (!valid_column(block, column(block, c)))
+      return NULL;
+  }
+
+  char *base = (char *) block;
+  int64_t *ts = (int64_t *) (base + column(block, LOG_COLUMN_TIMESTAMP)->offset);
+  int64_t *ts_usec = (int64_t *) (base + column(block, LOG_COLUMN_TIMESTAMP_USEC)->offset);
+  uint64_t size = block->data_offset;
+  unsigned count = 0;
+
+  for (unsigned i = 0; i < n; i++) {
+    if (selected && !selected[i])
+      continue;
+    count++;
+    size += sizeof(LogEntryHeader);
+    for (unsigned c = LOG_COLUMN_FIRST_FIELD; c < ncols; c++) {
+      LogColumnHeader *col = column(block, c);
+      if (col->kind == LOG_COLUMN_INT) {
+        size += sizeof(int64_t);
+      } else {
+        uint32_t id = ((uint32_t *) (base + col->offset))[i];
+        uint32_t *voff = (uint32_t *) (base + col->dict_index_offset);
+        size += voff[id + 1] - voff[id];
+      }
+    }
+  }
+  if (count == 0 || size > LOG_COLUMN_MAX_BLOCK)
+    return NULL;
+
+  char *out = (char *) ats_malloc(size);
+  LogBufferHeader *header = (LogBufferHeader *) out;
+  char *p = out + block->data_offset;
+
+  memcpy(out, block, block->data_offset);
+  header->cookie = LOG_SEGMENT_COOKIE;
+  header->byte_count = size;
+  header->entry_count = count;
+  header->low_timestamp = 0xffffffff;
+  header->high_timestamp = 0;
+
+  for (unsigned i = 0; i < n; i++) {
+    if (selected && !selected[i])
+      continue;
+
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+    char *v = p + sizeof(LogEntryHeader);
+
+    entry->timestamp = ts[i];
+    entry->timestamp_usec = (int32_t) ts_usec[i];
+    header->low_timestamp = MIN(header->low_timestamp, (uint32_t) ts[i]);
+    header->high_timestamp = MAX(header->high_timestamp, (uint32_t) ts[i]);
+
+    for (unsigned c = LOG_COLUMN_FIRST_FIELD; c < ncols; c++) {
+      LogColumnHeader *col = column(block, c);
+      if (col->kind == LOG_COLUMN_INT) {
+        memcpy(v, base + col->offset + i * sizeof(int64_t), sizeof(int64_t));
+        v += sizeof(int64_t);
+      } else {
+        uint32_t id = ((uint32_t *) (base + col->offset))[i];
+        uint32_t *voff = (uint32_t *) (base + col->dict_index_offset);
+        uint32_t len = voff[id + 1] - voff[id];
+        memcpy(v, base + col->dict_offset + voff[id], len);
+        v += len;
+      }
+    }
+    entry->entry_len = v - p;
+    p = v;
+  }
+
+  return header;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnQuery
+  -------------------------------------------------------------------------*/
+
+LogColumnQuery::LogColumnQuery()
+  : m_bytes_skipped(0), m_start(0), m_end(INT64_MAX), m_filters(NULL), m_filter_count(0)
+{
+}
+
+LogColumnQuery::~LogColumnQuery()
+{
+  for (int i = 0; i < m_filter_count; i++) {
+    ats_free(m_filters[i].symbol);
+    ats_free(m_filters[i].value);
+  }
+  ats_free(m_filters);
+}
+
+void
+LogColumnQuery::set_time_range(int64_t start, int64_t end)
+{
+  m_start = start;
+  m_end = end;
+}
+
+bool
+LogColumnQuery::add_filters(const char *spec)
+{
+  SimpleTokenizer tok((char *) spec, ',');
+  char *filter;
+
+  while ((filter = tok.getNext()) != NULL) {
+    char *eq = strchr(filter, '=');
+
+    if (!eq || eq == filter)
+      return false;
+    m_filters = (Filter *) ats_realloc(m_filters, (m_filter_count + 1) * sizeof(Filter));
+    m_filters[m_filter_count].symbol = ats_strndup(filter, eq - filter);
+    m_filters[m_filter_count].value = ats_strdup(eq + 1);
+    m_filter_count++;
+  }
+  return true;
+}
+
+bool
+LogColumnQuery::block_in_range(const LogBufferHeader * header) const
+{
+  return (int64_t) header->high_timestamp >= m_start && (int64_t) header->low_timestamp < m_end;
+}
+
+// Whether @a field is the one a filter calls @a symbol.
+static bool
+field_named(LogField * field, const char *symbol)
+{
+  if (field->container() == LogField::NO_CONTAINER)
+    return strcmp(field->symbol(), symbol) == 0;
+
+  // {name}symbol
+  int name_len = strlen(field->name());
+  return symbol[0] == '{' && strncmp(symbol + 1, field->name(), name_len) == 0 && symbol[name_len + 1] == '}' &&
+    strcmp(symbol + name_len + 2, field->symbol()) == 0;
+}
+
+// Whether the value at @a p prints as @a value.
+static bool
+value_matches(LogField * field, char *p, const char *value, int value_len)
+{
+  char buf[LOG_MAX_FORMATTED_LINE];
+  int len = field->unmarshal(&p, buf, sizeof(buf));
+
+  return len == value_len && memcmp(buf, value, len) == 0;
+}
+
+bool
+LogColumnQuery::column_matches(LogBufferHeader * block, LogColumnHeader * col, LogField * field, const char *value,
+                               char *selected)
+{
+  char *base = (char *) block;
+  unsigned n = block->entry_count;
+  int value_len = strlen(value);
+  bool any = false;
+
+  if (!valid_column(block, col))
+    return false;
+
+  if (col->kind == LOG_COLUMN_INT) {
+    int64_t *ints = (int64_t *) (base + col->offset);
+    char *num_end;
+    int64_t num = strtoll(value, &num_end, 10);
+
+    if (value_len && *num_end == 0 && field->map() == NULL && field->aggregate() == LogField::NO_AGGREGATE) {
+      // compare the numbers, and not at all if the column has no such
+      if (num < col->min_value || num > col->max_value) {
+        memset(selected, 0, n);
+        return false;
+      }
+      for (unsigned i = 0; i < n; i++) {
+        selected[i] = selected[i] && ints[i] == num;
+        any = any || selected[i];
+      }
+    } else {
+      for (unsigned i = 0; i < n; i++) {
+        selected[i] = selected[i] && value_matches(field, (char *) &ints[i], value, value_len);
+        any = any || selected[i];
+      }
+    }
+    return any;
+  }
+
+  // each distinct value is printed once
+  uint32_t *ids = (uint32_t *) (base + col->offset);
+  uint32_t *voff = (uint32_t *) (base + col->dict_index_offset);
+  char *match = (char *) ats_malloc(col->dict_count);
+  bool any_value = false;
+
+  for (unsigned d = 0; d < col->dict_count; d++) {
+    match[d] = value_matches(field, base + col->dict_offset + voff[d], value, value_len);
+    any_value = any_value || match[d];
+  }
+  for (unsigned i = 0; i < n; i++) {
+    selected[i] = selected[i] && any_value && match[ids[i]];
+    any = any || selected[i];
+  }
+  ats_free(match);
+  return any;
+}
+
+// Sets @a selected for the entries of the columnar @a block which match;
+// only the timestamp column and those filtered on are looked at.
+bool
+LogColumnQuery::select_entries(LogBufferHeader * block, LogFieldList * fieldlist, char *selected)
+{
+  unsigned n = block->entry_count;
+  LogColumnHeader *ts_col = LogColumnar::column(block, LOG_COLUMN_TIMESTAMP);
+  bool any = false;
+
+  if (!valid_column(block, ts_col) || ts_col->kind != LOG_COLUMN_INT)
+    return false;
+
+  int64_t *ts = (int64_t *) ((char *) block + ts_col->offset);
+  for (unsigned i = 0; i < n; i++) {
+    selected[i] = ts[i] >= m_start && ts[i] < m_end;
+    any = any || selected[i];
+  }
+
+  for (int i = 0; i < m_filter_count && any; i++) {
+    LogField *field = fieldlist->first();
+    unsigned c = LOG_COLUMN_FIRST_FIELD;
+
+    while (field && !field_named(field, m_filters[i].symbol)) {
+      field = fieldlist->next(field);
+      c++;
+    }
+    // a block without the field has no entries with the value
+    if (!field || c >= LogColumnar::index(block)->column_count)
+      return false;
+    any = column_matches(block, LogColumnar::column(block, c), field, m_filters[i].value, selected);
+  }
+  return any;
+}
+
+LogBufferHeader *
+LogColumnQuery::select(LogBufferHeader * block)
+{
+  LogBufferHeader *rows = NULL;
+
+  if (!block_in_range(block))
+    return NULL;
+
+  if (block->cookie == LOG_SEGMENT_COOKIE) {
+    // entirely selected, as it stands
+    if (m_filter_count == 0 && (int64_t) block->low_timestamp >= m_start && (int64_t) block->high_timestamp < m_end) {
+      rows = (LogBufferHeader *) ats_malloc(block->byte_count);
+      memcpy(rows, block, block->byte_count);
+      return rows;
+    }
+    // otherwise the columns are as good a way of selecting as any
+    char *columns = LogColumnar::transcode(block);
+    if (columns) {
+      rows = select((LogBufferHeader *) columns);
+      delete[] columns;
+    }
+    return rows;
+  }
+
+  if (!LogColumnar::valid_block(block))
+    return NULL;
+
+  LogFieldList fieldlist;
+  bool agg;
+  char *selected = (char *) ats_malloc(block->entry_count + 1);
+
+  LogFormat::parse_symbol_string(block->fmt_fieldlist(), &fieldlist, &agg);
+  if (select_entries(block, &fieldlist, selected))
+    rows = LogColumnar::to_rows(block, selected);
+  ats_free(selected);
+  return rows;
+}
+
+static bool
+read_fully(int fd, char *buf, int64_t len, off_t offset)
+{
+  while (len > 0) {
+    ssize_t n = (offset >= 0) ? pread(fd, buf, len, offset) : read(fd, buf, len);
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR)
+        continue;
+      return false;
+    }
+    buf += n;
+    len -= n;
+    if (offset >= 0)
+      offset += n;
+  }
+  return true;
+}
+
+LogBufferHeader *
+LogColumnQuery::read_block(int fd, LogBufferHeader * header, bool * error)
+{
+  const int64_t header_size = sizeof(LogBufferHeader);
+  int64_t size = header->byte_count;
+  off_t start = lseek(fd, 0, SEEK_CUR);
+  LogBufferHeader *rows = NULL;
+
+  *error = false;
+  if (size < header_size || size > LOG_COLUMN_MAX_BLOCK) {
+    *error = true;
+    return NULL;
+  }
+  if (start >= 0)
+    start -= header_size;
+
+  if (start >= 0 && !block_in_range(header)) {
+    m_bytes_skipped += size;
+    if (lseek(fd, start + size, SEEK_SET) < 0)
+      *error = true;
+    return NULL;
+  }
+
+  char *block = (char *) ats_malloc(size);
+  LogBufferHeader *b = (LogBufferHeader *) block;
+
+  memcpy(block, header, header_size);
+
+  // a row block, or a pipe: read it all
+  if (start < 0 || header->cookie != LOG_COLUMN_COOKIE) {
+    if (read_fully(fd, block + header_size, size - header_size, -1))
+      rows = select(b);
+    else
+      *error = true;
+    ats_free(block);
+    return rows;
+  }
+
+  // the header strings and the index, then the column headers
+  int64_t have = b->data_offset + sizeof(LogColumnIndex);
+  if (have > size || !read_fully(fd, block + header_size, have - header_size, start + header_size)) {
+    *error = true;
+    goto Ldone;
+  }
+  {
+    int64_t dir_end = have + (int64_t) LogColumnar::index(b)->column_count * sizeof(LogColumnHeader);
+    if (dir_end > size || !read_fully(fd, block + have, dir_end - have, start + have) ||
+        !LogColumnar::valid_block(b)) {
+      *error = true;
+      goto Ldone;
+    }
+    have = dir_end;
+  }
+
+  {
+    LogFieldList fieldlist;
+    bool agg;
+    unsigned ncols = LogColumnar::index(b)->column_count;
+    char *selected = (char *) ats_malloc(b->entry_count + 1);
+    char *loaded = (char *) ats_malloc(ncols);
+    int64_t bytes_read = have;
+
+    memset(loaded, 0, ncols);
+    LogFormat::parse_symbol_string(b->fmt_fieldlist(), &fieldlist, &agg);
+
+    // the columns the entries are selected on
+    loaded[LOG_COLUMN_TIMESTAMP] = 1;
+    for (int i = 0; i < m_filter_count; i++) {
+      unsigned c = LOG_COLUMN_FIRST_FIELD;
+      for (LogField * field = fieldlist.first(); field; field = fieldlist.next(field), c++) {
+        if (field_named(field, m_filters[i].symbol) && c < ncols)
+          loaded[c] = 1;
+      }
+    }
+    for (unsigned c = 0; c < ncols && !*error; c++) {
+      LogColumnHeader *col = LogColumnar::column(b, c);
+      if (loaded[c]) {
+        *error = !read_fully(fd, block + col->offset, col->byte_count, start + col->offset);
+        bytes_read += col->byte_count;
+      }
+    }
+
+    if (!*error && select_entries(b, &fieldlist, selected)) {
+      // and the rest, only now that they are needed
+      for (unsigned c = 0; c < ncols && !*error; c++) {
+        LogColumnHeader *col = LogColumnar::column(b, c);
+        if (!loaded[c]) {
+          *error = !read_fully(fd, block + col->offset, col->byte_count, start + col->offset);
+          bytes_read += col->byte_count;
+        }
+      }
+      if (!*error)
+        rows = LogColumnar::to_rows(b, selected);
+    }
+    m_bytes_skipped += size - bytes_read;
+
+    ats_free(loaded);
+    ats_free(selected);
+  }
+
+Ldone:
+  if (lseek(fd, start + size, SEEK_SET) < 0)
+    *error = true;
+  ats_free(block);
+  return rows;
+}
+
+#if TS_HAS_TESTS
+
+REGRESSION_TEST(LogColumnar_RoundTrip)(RegressionTest * t, int /* atype ATS_UNUSED */, int * pstatus)
+{
+  TestBox box(t, pstatus);
+  char row_buf[8192];
+  LogBufferHeader *row = (LogBufferHeader *) row_buf;
+  const char *fieldlist = "chi,cqu,pssc";
+  const char *urls[] = { "http://a.example.com/", "http://b.example.com/index.html", "-" };
+  const unsigned n = 12;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // a row buffer with garbage in its padding, as marshalled values have
+  memset(row_buf, 0x5a, sizeof(row_buf));
+  memset(row, 0, sizeof(LogBufferHeader));
+  row->cookie = LOG_SEGMENT_COOKIE;
+  row->version = LOG_SEGMENT_VERSION;
+  row->entry_count = n;
+  row->fmt_fieldlist_offset = sizeof(LogBufferHeader);
+  strcpy(row_buf + row->fmt_fieldlist_offset, fieldlist);
+  row->data_offset = INK_ALIGN_DEFAULT(row->fmt_fieldlist_offset + strlen(fieldlist) + 1);
+
+  char *p = row_buf + row->data_offset;
+  for (unsigned i = 0; i < n; i++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+    char *v = p + sizeof(LogEntryHeader);
+    IpEndpoint ip;
+
+    entry->timestamp = 1000 + i;
+    entry->timestamp_usec = i;
+    ats_ip4_set(&ip, htonl(0x0a000000 | (i % 2)));
+    v += LogAccess::marshal_ip(v, &ip.sa);
+    int len = LogAccess::strlen(urls[i % 3]);
+    LogAccess::marshal_str(v, urls[i % 3], len);
+    v += len;
+    LogAccess::marshal_int(v, i % 4 ? 200 : 404);
+    v += INK_MIN_ALIGN;
+    entry->entry_len = v - p;
+    p = v;
+  }
+  row->byte_count = p - row_buf;
+  row->low_timestamp = 1000;
+  row->high_timestamp = 1000 + n - 1;
+
+  char *block = LogColumnar::transcode(row);
+  if (!box.check(block != NULL, "transcode failed"))
+    return;
+
+  LogBufferHeader *columns = (LogBufferHeader *) block;
+  box.check(columns->cookie == LOG_COLUMN_COOKIE && LogColumnar::valid_block(columns), "not a valid columnar block");
+  box.check(LogColumnar::column(columns, LOG_COLUMN_FIRST_FIELD)->dict_count == 2, "expected 2 distinct addresses, got %u",
+            LogColumnar::column(columns, LOG_COLUMN_FIRST_FIELD)->dict_count);
+  box.check(LogColumnar::column(columns, LOG_COLUMN_FIRST_FIELD + 1)->dict_count == 3, "expected 3 distinct urls, got %u",
+            LogColumnar::column(columns, LOG_COLUMN_FIRST_FIELD + 1)->dict_count);
+
+  // the entries come back as they went in, but for the padding
+  LogBufferHeader *rows = LogColumnar::to_rows(columns);
+  if (box.check(rows != NULL && rows->entry_count == n && rows->byte_count == row->byte_count,
+                "rows do not round trip")) {
+    LogBufferIterator a(row), b(rows);
+    LogEntryHeader *ea, *eb;
+    while ((ea = a.next()) && (eb = b.next())) {
+      char *va = (char *) ea + sizeof(LogEntryHeader), *vb = (char *) eb + sizeof(LogEntryHeader);
+      box.check(ea->timestamp == eb->timestamp && ea->timestamp_usec == eb->timestamp_usec &&
+                ea->entry_len == eb->entry_len, "entry headers differ");
+      box.check(memcmp(va + 4, vb + 4, 4) == 0, "addresses differ");
+      box.check(strcmp(va + 8, vb + 8) == 0, "urls differ");
+      box.check(memcmp((char *) ea + ea->entry_len - 8, (char *) eb + eb->entry_len - 8, 8) == 0, "status differs");
+    }
+  }
+  ats_free(rows);
+
+  // and are selected on their columns
+  LogColumnQuery q;
+  q.add_filters("pssc=404,cqu=http://a.example.com/");
+  rows = q.select(columns);
+  box.check(rows != NULL && rows->entry_count == 1, "expected 1 entry with pssc=404 and cqu=http://a.example.com/");
+  ats_free(rows);
+
+  LogColumnQuery q2;
+  q2.set_time_range(1004, 1008);
+  q2.add_filters("chi=10.0.0.1");
+  rows = q2.select(row);
+  box.check(rows != NULL && rows->entry_count == 2, "expected 2 entries with chi=10.0.0.1 in [1004, 1008)");
+  ats_free(rows);
+
+  LogColumnQuery q3;
+  q3.add_filters("pssc=500");
+  box.check(q3.select(columns) == NULL, "expected no entries with pssc=500");
+
+  delete[] block;
+}
+
+#endif
@@ -0,0 +1,161 @@
+/** @file
+
+  Columnar layout of binary log buffers
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef LOG_COLUMNAR_H
+#define LOG_COLUMNAR_H
+
+#include "libts.h"
+#include "LogBuffer.h"
+#include "LogField.h"
+
+/*-------------------------------------------------------------------------
+  Columnar blocks
+
+  A binary LogObject with Mode "columnar" writes each LogBuffer as a
+  columnar block.  The block starts with the LogBufferHeader and header
+  strings of the buffer, with the cookie set to LOG_COLUMN_COOKIE; so a
+  reader can tell the two kinds of blocks apart, skip a block on its
+  byte_count, and skip it on its low/high timestamps without reading
+  anything else.  At data_offset is a LogColumnIndex, followed by a
+  LogColumnHeader for each column: the seconds and microseconds of the
+  entry timestamps, then each field of the fieldlist.
+
+  An integer column is an int64_t for each entry.  Any other column is a
+  dictionary column: a uint32_t id for each entry, the distinct values
+  (as the field marshals them), and the offset of each value from the
+  first one, plus that of the end.  A reader needs only the columns it
+  filters on to find the matching entries, and the others only if there
+  are any.
+  -------------------------------------------------------------------------*/
+
+#define LOG_COLUMN_COOKIE 0xacec01a
+
+enum LogColumnKind
+{
+  LOG_COLUMN_INT = 0,
+  LOG_COLUMN_DICT
+};
+
+// the columns before those of the fields
+#define LOG_COLUMN_TIMESTAMP      0
+#define LOG_COLUMN_TIMESTAMP_USEC 1
+#define LOG_COLUMN_FIRST_FIELD    2
+
+struct LogColumnIndex
+{
+  uint32_t column_count;
+  uint32_t row_bytes;           // size of the entries in row layout
+};
+
+struct LogColumnHeader
+{
+  uint32_t kind;                // LogColumnKind
+  uint32_t offset;              // of the ints or ids, from the start of the block
+  uint32_t byte_count;          // of the whole column
+  uint32_t dict_count;          // number of distinct values
+  uint32_t dict_offset;         // of the first value
+  uint32_t dict_index_offset;   // of the dict_count + 1 value offsets
+  int64_t min_value;            // of an integer column
+  int64_t max_value;
+};
+
+/*-------------------------------------------------------------------------
+  LogColumnQuery
+
+  Selects the entries of a time range, whose fields have given values,
+  from the columnar or row blocks of a binary log.  A filter is written
+  as symbol=value, with container fields as {name}symbol (for example
+  {Host}cqh=www.example.com), and matches the entries whose field prints
+  as value in an ascii log.
+  -------------------------------------------------------------------------*/
+
+class LogColumnQuery
+{
+public:
+  LogColumnQuery();
+  ~LogColumnQuery();
+
+  // entries at or after @a start and before @a end (seconds)
+  void set_time_range(int64_t start, int64_t end);
+  // Adds the filters of @a spec, a comma separated list of
+  // symbol=value; returns false if one is malformed.
+  bool add_filters(const char *spec);
+  bool has_filters() const { return m_filter_count > 0; }
+
+  // Whether the block of @a header may hold any entries of the time
+  // range, which is all that is known of it before it is read.
+  bool block_in_range(const LogBufferHeader * header) const;
+
+  // Reads the block of @a header, already read from @a fd, reading only
+  // the parts needed.  Returns a row buffer (ats_malloc'ed) of the
+  // matching entries, or NULL if there are none or on error, in which
+  // case @a error is set.  @a fd is left at the next block.
+  LogBufferHeader *read_block(int fd, LogBufferHeader * header, bool * error);
+
+  // Returns a row buffer (ats_malloc'ed) of the matching entries of the
+  // block at @a block (row or columnar), or NULL if there are none.
+  LogBufferHeader *select(LogBufferHeader * block);
+
+  // bytes of the blocks not read, for the curious
+  int64_t m_bytes_skipped;
+
+private:
+  struct Filter
+  {
+    char *symbol;
+    char *value;
+  };
+
+  bool select_entries(LogBufferHeader * block, LogFieldList * fieldlist, char *selected);
+  bool column_matches(LogBufferHeader * block, LogColumnHeader * column, LogField * field, const char *value,
+                      char *selected);
+
+  int64_t m_start;
+  int64_t m_end;
+  Filter *m_filters;
+  int m_filter_count;
+
+  // -- member functions not allowed --
+  LogColumnQuery(const LogColumnQuery &);
+  LogColumnQuery & operator=(const LogColumnQuery &);
+};
+
+namespace LogColumnar
+{
+  // Returns the row buffer @a row as a columnar block allocated with
+  // new char[], or NULL if it cannot be, as when it is not well formed.
+  char *transcode(LogBufferHeader * row);
+
+  // Returns a row buffer (ats_malloc'ed) of the entries of the columnar
+  // block @a block for which @a selected is set (all if it is NULL), or
+  // NULL if there are none.
+  LogBufferHeader *to_rows(LogBufferHeader * block, const char *selected = NULL);
+
+  // Checks that the index and column headers of @a block fit in it.
+  bool valid_block(LogBufferHeader * block);
+
+  LogColumnIndex *index(LogBufferHeader * block);
+  LogColumnHeader *column(LogBufferHeader * block, unsigned i);
+};
+
+#endif
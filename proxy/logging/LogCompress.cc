@@ -0,0 +1,167 @@
+/** @file
+
+  Compression of ascii log file data
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+
+#if TS_HAS_LIBZ
+#include <zlib.h>
+#endif
+#if TS_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "Error.h"
+#include "LogCompress.h"
+
+#define LOG_COMPRESS_ZSTD_LEVEL 3
+
+static const char *compression_names[N_LOG_COMPRESSION_TYPES] = { "none", "gzip", "zstd" };
+static const char *compression_extensions[N_LOG_COMPRESSION_TYPES] = { "", ".gz", ".zst" };
+
+// The compression state is kept per thread and reset between blocks, so
+// that the preproc threads do not allocate it for every buffer.
+#if TS_HAS_LIBZ
+static __thread z_stream *thread_zstream = NULL;
+#endif
+#if TS_HAS_ZSTD
+static __thread ZSTD_CCtx *thread_zstd_cctx = NULL;
+#endif
+
+LogFileCompression
+LogCompress::from_name(const char *name)
+{
+  if (!name || strcasecmp(name, "none") == 0)
+    return LOG_COMPRESSION_NONE;
+#if TS_HAS_LIBZ
+  if (strcasecmp(name, "gzip") == 0)
+    return LOG_COMPRESSION_GZIP;
+#endif
+#if TS_HAS_ZSTD
+  if (strcasecmp(name, "zstd") == 0)
+    return LOG_COMPRESSION_ZSTD;
+#endif
+  return N_LOG_COMPRESSION_TYPES;
+}
+
+const char *
+LogCompress::name(LogFileCompression type)
+{
+  return (type >= 0 && type < N_LOG_COMPRESSION_TYPES) ? compression_names[type] : "unknown";
+}
+
+const char *
+LogCompress::extension(LogFileCompression type)
+{
+  return (type >= 0 && type < N_LOG_COMPRESSION_TYPES) ? compression_extensions[type] : "";
+}
+
+int
+LogCompress::strip_extension(LogFileCompression type, const char *path)
+{
+  int len = (int) strlen(path);
+  int ext_len = (int) strlen(extension(type));
+
+  if (ext_len && len > ext_len && strcmp(path + len - ext_len, extension(type)) == 0)
+    return len - ext_len;
+  return len;
+}
+
+#if TS_HAS_LIBZ
+static char *
+compress_gzip(const char *data, int len, int *out_len)
+{
+  z_stream *zs = thread_zstream;
+
+  if (zs == NULL) {
+    zs = (z_stream *) ats_malloc(sizeof(z_stream));
+    memset(zs, 0, sizeof(z_stream));
+    // 16 + the default window bits asks for a gzip header and trailer
+    if (deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      ats_free(zs);
+      return NULL;
+    }
+    thread_zstream = zs;
+  } else if (deflateReset(zs) != Z_OK) {
+    return NULL;
+  }
+
+  uLong bound = deflateBound(zs, len);
+  char *out = (char *) ats_malloc(bound);
+
+  zs->next_in = (Bytef *) data;
+  zs->avail_in = len;
+  zs->next_out = (Bytef *) out;
+  zs->avail_out = bound;
+  if (deflate(zs, Z_FINISH) != Z_STREAM_END) {
+    ats_free(out);
+    return NULL;
+  }
+  *out_len = (int) (bound - zs->avail_out);
+  return out;
+}
+#endif
+
+#if TS_HAS_ZSTD
+static char *
+compress_zstd(const char *data, int len, int *out_len)
+{
+  if (thread_zstd_cctx == NULL && (thread_zstd_cctx = ZSTD_createCCtx()) == NULL)
+    return NULL;
+
+  size_t bound = ZSTD_compressBound(len);
+  char *out = (char *) ats_malloc(bound);
+  size_t n = ZSTD_compressCCtx(thread_zstd_cctx, out, bound, data, len, LOG_COMPRESS_ZSTD_LEVEL);
+
+  if (ZSTD_isError(n)) {
+    ats_free(out);
+    return NULL;
+  }
+  *out_len = (int) n;
+  return out;
+}
+#endif
+
+char *
+LogCompress::compress(LogFileCompression type, const char *data, int len, int *out_len)
+{
+  char *out = NULL;
+
+  switch (type) {
+#if TS_HAS_LIBZ
+  case LOG_COMPRESSION_GZIP:
+    out = compress_gzip(data, len, out_len);
+    break;
+#endif
+#if TS_HAS_ZSTD
+  case LOG_COMPRESSION_ZSTD:
+    out = compress_zstd(data, len, out_len);
+    break;
+#endif
+  default:
+    break;
+  }
+
+  if (out == NULL)
+    Error("Failed to %s compress %d bytes of log data", name(type), len);
+  return out;
+}
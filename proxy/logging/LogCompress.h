@@ -0,0 +1,60 @@
+/** @file
+
+  Compression of ascii log file data
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef LOG_COMPRESS_H
+#define LOG_COMPRESS_H
+
+#include "libts.h"
+#include "LogFormat.h"
+
+/*-------------------------------------------------------------------------
+  LogCompress
+
+  Each block of log data is compressed on its own, into a complete gzip
+  member or zstd frame.  Both formats allow such blocks to be
+  concatenated, so a log file (or any part of it that starts at a block
+  boundary, such as a rolled file) reads as a single stream with zcat or
+  zstdcat, and the blocks can be compressed by the preproc threads in
+  parallel.
+  -------------------------------------------------------------------------*/
+
+namespace LogCompress
+{
+  // Returns the compression called @a name ("none", "gzip" or "zstd"),
+  // or N_LOG_COMPRESSION_TYPES if it is unknown or was not built in.
+  LogFileCompression from_name(const char *name);
+  const char *name(LogFileCompression type);
+
+  // Returns the file name extension for @a type (".gz" or ".zst"), or ""
+  // for LOG_COMPRESSION_NONE.
+  const char *extension(LogFileCompression type);
+
+  // Returns the length of @a path without its trailing @a type extension.
+  int strip_extension(LogFileCompression type, const char *path);
+
+  // Compresses the @a len bytes of @a data, returning an ats_malloc'ed
+  // block and its size in @a out_len, or NULL on failure.
+  char *compress(LogFileCompression type, const char *data, int len, int *out_len);
+};
+
+#endif
@@ -39,6 +39,7 @@
 #include "LogFilter.h"
 #include "LogFormat.h"
 #include "LogFile.h"
+#include "LogCompress.h"
 #include "LogBuffer.h"
 #include "LogHost.h"
 #include "LogObject.h"
@@ -1970,6 +1971,7 @@ LogConfig::read_xml_log_config(int from_memory)
       NameList rollingIntervalSec;
       NameList rollingOffsetHr;
       NameList rollingSizeMb;
+      NameList compression;
 
       for (xattr = xobj->first(); xattr; xattr = xobj->next(xattr)) {
         Debug("xml", "XmlAttr  : <%s,%s>", xattr->tag(), xattr->value());
@@ -1997,6 +1999,8 @@ LogConfig::read_xml_log_config(int from_memory)
           rollingOffsetHr.enqueue(xattr->value());
         } else if (strcasecmp(xattr->tag(), "RollingSizeMb") == 0) {
           rollingSizeMb.enqueue(xattr->value());
+        } else if (strcasecmp(xattr->tag(), "Compression") == 0) {
+          compression.enqueue(xattr->value());
         } else {
           Note("Unknown attribute %s for %s; ignoring", xattr->tag(), xobj->object_name());
         }
@@ -2049,6 +2053,9 @@ LogConfig::read_xml_log_config(int from_memory)
       if (rollingSizeMb.count() > 1) {
         Note("Multiple values for 'RollingSizeMb' attribute in %s; " "using the first one", xobj->object_name());
       }
+      if (compression.count() > 1) {
+        Note("Multiple values for 'Compression' attribute in %s; " "using the first one", xobj->object_name());
+      }
       // create new LogObject and start adding to it
       //
 
@@ -2061,9 +2068,12 @@ LogConfig::read_xml_log_config(int from_memory)
       // file format
       //
       LogFileFormat file_type = LOG_FILE_ASCII;      // default value
+      bool obj_columnar = false;
       if (mode.count()) {
         char *mode_str = mode.dequeue();
-        file_type = (strncasecmp(mode_str, "bin", 3) == 0 ||
+        // columnar files are binary files of columnar blocks
+        obj_columnar = (strcasecmp(mode_str, "columnar") == 0);
+        file_type = (strncasecmp(mode_str, "bin", 3) == 0 || obj_columnar ||
                      (mode_str[0] == 'b' && mode_str[1] == 0) ?
                      LOG_FILE_BINARY : (strcasecmp(mode_str, "ascii_pipe") == 0 ? LOG_FILE_PIPE : LOG_FILE_ASCII));
       }
@@ -2081,6 +2091,21 @@ LogConfig::read_xml_log_config(int from_memory)
       char *rollingSizeMb_str = rollingSizeMb.dequeue();
       int obj_rolling_size_mb = rollingSizeMb_str ? ink_atoui(rollingSizeMb_str) : rolling_size_mb;
 
+      // compression
+      //
+      LogFileCompression obj_compression = LOG_COMPRESSION_NONE;
+      char *compression_str = compression.dequeue();
+      if (compression_str) {
+        obj_compression = LogCompress::from_name(compression_str);
+        if (obj_compression == N_LOG_COMPRESSION_TYPES) {
+          Warning("Compression %s is not supported; " "not compressing this LogObject", compression_str);
+          obj_compression = LOG_COMPRESSION_NONE;
+        } else if (obj_compression != LOG_COMPRESSION_NONE && file_type != LOG_FILE_ASCII) {
+          Warning("Compression is only supported for ascii LogObjects; " "not compressing this LogObject");
+          obj_compression = LOG_COMPRESSION_NONE;
+        }
+      }
+
       // create the new object
       //
       LogObject *obj = NEW(new LogObject(fmt, logfile_dir,
@@ -2091,7 +2116,10 @@ LogConfig::read_xml_log_config(int from_memory)
                                          collation_preproc_threads,
                                          obj_rolling_interval_sec,
                                          obj_rolling_offset_hr,
-                                         obj_rolling_size_mb));
+                                         obj_rolling_size_mb,
+                                         false,
+                                         obj_compression,
+                                         obj_columnar));
 
       // filters
       //
@@ -147,6 +147,10 @@ public:
   {
     return m_type;
   }
+  Container container()
+  {
+    return m_container;
+  }
   Ptr<LogFieldAliasMap> map() {
     return m_alias_map;
   };
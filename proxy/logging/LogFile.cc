@@ -45,6 +45,8 @@
 #include "LogFormat.h"
 #include "LogBuffer.h"
 #include "LogFile.h"
+#include "LogCompress.h"
+#include "LogColumnar.h"
 #include "LogHost.h"
 #include "LogObject.h"
 #include "LogUtils.h"
@@ -86,13 +88,18 @@ static const int FILESIZE_SAFE_THRESHOLD_FACTOR = 10;
   -------------------------------------------------------------------------*/
 
 LogFile::LogFile(const char *name, const char *header, LogFileFormat format,
-                 uint64_t signature, size_t ascii_buffer_size, size_t max_line_size)
+                 uint64_t signature, size_t ascii_buffer_size, size_t max_line_size,
+                 LogFileCompression compression, bool columnar)
   : m_file_format(format),
+    m_compression(compression),
+    m_columnar(columnar),
     m_name(ats_strdup(name)),
     m_header(ats_strdup(header)),
     m_signature(signature),
     m_meta_info(NULL),
-    m_max_line_size(max_line_size)
+    m_max_line_size(max_line_size),
+    m_flush_seq(0),
+    m_flush_seq_next(0)
 {
   delete m_meta_info;
   m_meta_info = NULL;
@@ -103,6 +110,10 @@ LogFile::LogFile(const char *name, const char *header, LogFileFormat format,
   m_size_bytes = 0;
   m_ascii_buffer_size = (ascii_buffer_size < max_line_size ? max_line_size : ascii_buffer_size);
 
+  ink_mutex_init(&m_flush_mutex, "LogFile flush order");
+  memset(m_flush_pending, 0, sizeof(m_flush_pending));
+  memset(m_flush_ready, 0, sizeof(m_flush_ready));
+
   Debug("log-file", "exiting LogFile constructor, m_name=%s, this=%p", m_name, this);
 }
 
@@ -114,6 +125,8 @@ LogFile::LogFile(const char *name, const char *header, LogFileFormat format,
 
 LogFile::LogFile (const LogFile& copy)
   : m_file_format (copy.m_file_format),
+    m_compression (copy.m_compression),
+    m_columnar (copy.m_columnar),
     m_name  (ats_strdup (copy.m_name)),
     m_header  (ats_strdup (copy.m_header)),
     m_signature (copy.m_signature),
@@ -123,10 +136,16 @@ LogFile::LogFile (const LogFile& copy)
     m_fd (-1),
     m_start_time (0L),
     m_end_time (0L),
-    m_bytes_written (0)
+    m_bytes_written (0),
+    m_flush_seq (0),
+    m_flush_seq_next (0)
 {
     ink_release_assert(m_ascii_buffer_size >= m_max_line_size);
 
+    ink_mutex_init(&m_flush_mutex, "LogFile flush order");
+    memset(m_flush_pending, 0, sizeof(m_flush_pending));
+    memset(m_flush_ready, 0, sizeof(m_flush_ready));
+
     Debug("log-file", "exiting LogFile copy constructor, m_name=%s, this=%p",
           m_name, this);
 }
@@ -142,6 +161,7 @@ LogFile::~LogFile()
   ats_free(m_name);
   ats_free(m_header);
   delete m_meta_info;
+  ink_mutex_destroy(&m_flush_mutex);
   Debug("log-file", "exiting LogFile destructor, this=%p", this);
 }
 
@@ -270,7 +290,10 @@ LogFile::open_file()
   if (!file_exists) {
     if (m_file_format != LOG_FILE_BINARY && m_header != NULL) {
       Debug("log-file", "writing header to LogFile %s", m_name);
-      writeln(m_header, strlen(m_header), m_fd, m_name);
+      if (m_compression != LOG_COMPRESSION_NONE)
+        write_compressed(m_header, strlen(m_header));
+      else
+        writeln(m_header, strlen(m_header), m_fd, m_name);
     }
   }
 
@@ -303,7 +326,8 @@ LogFile::close_file()
   LogFile::rolled_logfile
 
   This function will return true if the given filename corresponds to a
-  rolled logfile.  We make this determination based on the file extension.
+  rolled logfile.  We make this determination based on the file extension,
+  which for a compressed logfile is followed by the compression extension.
   -------------------------------------------------------------------------*/
 
 bool LogFile::rolled_logfile(char *path)
@@ -312,10 +336,17 @@ bool LogFile::rolled_logfile(char *path)
     target_len = (int) strlen(LOGFILE_ROLLED_EXTENSION);
   int
     len = (int) strlen(path);
+  for (int i = LOG_COMPRESSION_NONE + 1; i < N_LOG_COMPRESSION_TYPES; i++) {
+    int stripped = LogCompress::strip_extension((LogFileCompression) i, path);
+    if (stripped < len) {
+      len = stripped;
+      break;
+    }
+  }
   if (len > target_len) {
     char *
       str = &path[len - target_len];
-    if (!strcmp(str, LOGFILE_ROLLED_EXTENSION)) {
+    if (!strncmp(str, LOGFILE_ROLLED_EXTENSION, target_len)) {
       return true;
     }
   }
@@ -373,6 +404,9 @@ LogFile::roll(long interval_start, long interval_end)
   //
   //    "squid.log.mymachine.19980712.12h00m00s-19980713.12h00m00s.old"
   //
+  // A compressed file keeps its compression extension at the end, as in
+  // "squid.log.mymachine.19980712.12h00m00s-19980713.12h00m00s.old.gz".
+  //
   char roll_name[MAXPATHLEN];
   char start_time_ext[64];
   char end_time_ext[64];
@@ -421,10 +455,13 @@ LogFile::roll(long interval_start, long interval_end)
   //
   LogUtils::timestamp_to_str((long) start, start_time_ext, 64);
   LogUtils::timestamp_to_str((long) end, end_time_ext, 64);
-  snprintf(roll_name, MAXPATHLEN, "%s%s%s.%s-%s%s",
-               m_name,
+  int name_len = LogCompress::strip_extension(m_compression, m_name);
+  const char *cext = LogCompress::extension(m_compression);
+
+  snprintf(roll_name, MAXPATHLEN, "%.*s%s%s.%s-%s%s%s",
+               name_len, m_name,
                LOGFILE_SEPARATOR_STRING,
-               Machine::instance()->hostname, start_time_ext, end_time_ext, LOGFILE_ROLLED_EXTENSION);
+               Machine::instance()->hostname, start_time_ext, end_time_ext, LOGFILE_ROLLED_EXTENSION, cext);
 
   //
   // It may be possible that the file we want to roll into already
@@ -436,10 +473,10 @@ LogFile::roll(long interval_start, long interval_end)
   while (LogFile::exists(roll_name)) {
     Note("The rolled file %s already exists; adding version "
          "tag %d to avoid clobbering the existing file.", roll_name, version);
-    snprintf(roll_name, MAXPATHLEN, "%s%s%s.%s-%s.%d%s",
-                 m_name,
+    snprintf(roll_name, MAXPATHLEN, "%.*s%s%s.%s-%s.%d%s%s",
+                 name_len, m_name,
                  LOGFILE_SEPARATOR_STRING,
-                 Machine::instance()->hostname, start_time_ext, end_time_ext, version, LOGFILE_ROLLED_EXTENSION);
+                 Machine::instance()->hostname, start_time_ext, end_time_ext, version, LOGFILE_ROLLED_EXTENSION, cext);
     version++;
   }
 
@@ -473,12 +510,14 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
 {
   int ret = -1;
   LogBufferHeader *buffer_header;
+  int64_t flush_seq;
 
   if (lb == NULL) {
     Note("Cannot write LogBuffer to LogFile %s; LogBuffer is NULL", m_name);
     return -1;
   }
 
+  flush_seq = lb->m_flush_seq;
   ink_atomic_increment(&lb->m_references, 1);
 
   if ((buffer_header = lb->header()) == NULL) {
@@ -510,6 +549,19 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
     // don't change between buffers), it's not worth trying to separate
     // out the buffer-dependent data from the buffer-independent data.
     //
+    // A columnar block takes the place of the buffer, in a LogBuffer
+    // of its own; if the buffer cannot be transcoded, it is written as
+    // it is, and readers take either.
+    if (m_columnar) {
+      char *block = LogColumnar::transcode(buffer_header);
+      if (block) {
+        LogBuffer *columns = NEW(new LogBuffer(lb->get_owner(), (LogBufferHeader *) block));
+        ink_atomic_increment(&columns->m_references, 1);
+        LogBuffer::destroy(lb);
+        lb = columns;
+      }
+    }
+
     LogFlushData *flush_data = new LogFlushData(this, lb);
 
     ProxyMutex *mutex = this_thread()->mutex;
@@ -520,9 +572,7 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
     RecIncrRawStat(log_rsb, mutex->thread_holding, log_stat_bytes_flush_to_disk_stat,
                    lb->header()->byte_count);
 
-    ink_atomiclist_push(Log::flush_data_list, flush_data);
-
-    Log::flush_notify->signal();
+    flush_in_order(flush_seq, flush_data);
 
     //
     // LogBuffer will be deleted in flush thread
@@ -530,8 +580,9 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
     return 0;
   }
   else if (m_file_format == LOG_FILE_ASCII || m_file_format == LOG_FILE_PIPE) {
-    write_ascii_logbuffer3(buffer_header);
-    ret = 0;
+    write_ascii_logbuffer3(buffer_header, flush_seq);
+    LogBuffer::destroy(lb);
+    return 0;
   }
   else {
     Note("Cannot write LogBuffer to LogFile %s; invalid file format: %d",
@@ -539,10 +590,112 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
   }
 
 done:
+  // nothing to write, but later buffers must not wait for this one
+  flush_in_order(flush_seq, NULL);
   LogBuffer::destroy(lb);
   return ret;
 }
 
+/*-------------------------------------------------------------------------
+  LogFile::drop_buffer
+  -------------------------------------------------------------------------*/
+
+void
+LogFile::drop_buffer(LogBuffer * lb)
+{
+  flush_in_order(lb->m_flush_seq, NULL);
+}
+
+/*-------------------------------------------------------------------------
+  LogFile::flush_in_order
+
+  Hand the flush data of buffer number @a seq (a list linked through
+  LogFlushData::link, possibly empty) to the flush thread once that of
+  every earlier buffer has been, along with that of any later buffers
+  which were waiting for it.  Buffers without a sequence number go
+  straight through.  If a buffer falls LOGFILE_FLUSH_WINDOW behind, we
+  stop waiting for it and it goes straight through when it comes.
+  -------------------------------------------------------------------------*/
+
+static int
+push_flush_data(LogFlushData * data)
+{
+  int n = 0;
+
+  while (data) {
+    // the flush list links through the same field
+    LogFlushData *next = data->link.next;
+    ink_atomiclist_push(Log::flush_data_list, data);
+    data = next;
+    n++;
+  }
+  return n;
+}
+
+void
+LogFile::flush_in_order(int64_t seq, LogFlushData * data)
+{
+  int pushed = 0;
+
+  if (seq < 0) {
+    pushed = push_flush_data(data);
+  } else {
+    ink_mutex_acquire(&m_flush_mutex);
+    if (seq < m_flush_seq) {
+      pushed = push_flush_data(data);
+    } else {
+      while (seq >= m_flush_seq + LOGFILE_FLUSH_WINDOW) {
+        int slot = m_flush_seq % LOGFILE_FLUSH_WINDOW;
+
+        Debug("log-file", "LogFile %s stopped waiting for buffer %" PRId64, m_name, m_flush_seq);
+        pushed += push_flush_data(m_flush_pending[slot]);
+        m_flush_pending[slot] = NULL;
+        m_flush_ready[slot] = false;
+        m_flush_seq++;
+      }
+
+      m_flush_pending[seq % LOGFILE_FLUSH_WINDOW] = data;
+      m_flush_ready[seq % LOGFILE_FLUSH_WINDOW] = true;
+
+      for (int slot = m_flush_seq % LOGFILE_FLUSH_WINDOW; m_flush_ready[slot];
+           slot = m_flush_seq % LOGFILE_FLUSH_WINDOW) {
+        pushed += push_flush_data(m_flush_pending[slot]);
+        m_flush_pending[slot] = NULL;
+        m_flush_ready[slot] = false;
+        m_flush_seq++;
+      }
+    }
+    ink_mutex_release(&m_flush_mutex);
+  }
+
+  if (pushed)
+    Log::flush_notify->signal();
+}
+
+/*-------------------------------------------------------------------------
+  LogFile::flush_pending
+  -------------------------------------------------------------------------*/
+
+void
+LogFile::flush_pending()
+{
+  int pushed = 0;
+
+  ink_mutex_acquire(&m_flush_mutex);
+  for (int i = 0; i < LOGFILE_FLUSH_WINDOW; i++) {
+    int slot = (m_flush_seq + i) % LOGFILE_FLUSH_WINDOW;
+
+    pushed += push_flush_data(m_flush_pending[slot]);
+    m_flush_pending[slot] = NULL;
+    m_flush_ready[slot] = false;
+  }
+  m_flush_seq = m_flush_seq_next;
+  ink_mutex_release(&m_flush_mutex);
+
+  if (pushed)
+    Log::flush_notify->signal();
+}
+
 /*-------------------------------------------------------------------------
   LogFile::write_ascii_logbuffer
 
@@ -618,7 +771,7 @@ LogFile::write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const ch
 }
 
 int
-LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt_format)
+LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, int64_t flush_seq, const char *alt_format)
 {
   Debug("log-file", "entering LogFile::write_ascii_logbuffer3 for %s " "(this=%p)", m_name, this);
   ink_assert(buffer_header != NULL);
@@ -634,6 +787,7 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt
   char *fieldlist_str;
   char *printf_str;
   char *ascii_buffer;
+  Queue<LogFlushData, LogFlushData::Link_link> flush_q;
 
   switch (buffer_header->version) {
   case LOG_SEGMENT_VERSION:
@@ -645,6 +799,7 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt
   default:
     Note("Invalid LogBuffer version %d in write_ascii_logbuffer; "
          "current version is %d", buffer_header->version, LOG_SEGMENT_VERSION);
+    flush_in_order(flush_seq, NULL);
     return 0;
   }
 
@@ -700,7 +855,29 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt
         break;
     } while ((entry_header = iter.next()));
 
-    // send the buffer to flush thread
+    // each buffer is compressed on its own, so that it can be written
+    // out between any two others
+    //
+    if (m_compression != LOG_COMPRESSION_NONE && fmt_buf_bytes > 0) {
+      int compressed_bytes;
+      char *compressed = LogCompress::compress(m_compression, ascii_buffer, fmt_buf_bytes, &compressed_bytes);
+
+      ats_free(ascii_buffer);
+      if (!compressed) {
+        RecIncrRawStat(log_rsb, mutex->thread_holding,
+                       log_stat_num_lost_before_flush_to_disk_stat,
+                       fmt_entry_count);
+
+        RecIncrRawStat(log_rsb, mutex->thread_holding,
+                       log_stat_bytes_lost_before_flush_to_disk_stat,
+                       fmt_buf_bytes);
+        continue;
+      }
+      ascii_buffer = compressed;
+      fmt_buf_bytes = compressed_bytes;
+    }
+
+    // queue the buffer for the flush thread
     //
     LogFlushData *flush_data = new LogFlushData(this, ascii_buffer, fmt_buf_bytes);
 
@@ -710,16 +887,47 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt
     RecIncrRawStat(log_rsb, mutex->thread_holding, log_stat_bytes_flush_to_disk_stat,
                    fmt_buf_bytes);
 
-    ink_atomiclist_push(Log::flush_data_list, flush_data);
-
-    Log::flush_notify->signal();
+    flush_q.enqueue(flush_data);
 
     total_bytes += fmt_buf_bytes;
   }
 
+  flush_in_order(flush_seq, flush_q.head);
+
   return total_bytes;
 }
 
+/*-------------------------------------------------------------------------
+  LogFile::write_compressed
+
+  Write @a data, followed by a newline, to the file as a block of its own.
+  -------------------------------------------------------------------------*/
+
+int
+LogFile::write_compressed(const char *data, int len)
+{
+  char *line = (char *)ats_malloc(len + 1);
+  int compressed_bytes, bytes_written = 0;
+
+  memcpy(line, data, len);
+  line[len] = '\n';
+  char *compressed = LogCompress::compress(m_compression, line, len + 1, &compressed_bytes);
+  ats_free(line);
+
+  if (compressed) {
+    while (bytes_written < compressed_bytes) {
+      int n = ::write(m_fd, compressed + bytes_written, compressed_bytes - bytes_written);
+      if (n < 0) {
+        Warning("An error was encountered in writing to %s: %s.", m_name, strerror(errno));
+        break;
+      }
+      bytes_written += n;
+    }
+    ats_free(compressed);
+  }
+  return bytes_written;
+}
+
 /*-------------------------------------------------------------------------
   LogFile::writeln
 
@@ -36,10 +36,15 @@ class LogSock;
 class LogBuffer;
 struct LogBufferHeader;
 class LogObject;
+class LogFlushData;
 
 #define LOGFILE_ROLLED_EXTENSION ".old"
 #define LOGFILE_SEPARATOR_STRING "_"
 
+// number of buffers which can be formatted ahead of the oldest one not
+// yet handed to the flush thread
+#define LOGFILE_FLUSH_WINDOW 1024
+
 /*-------------------------------------------------------------------------
   MetaInfo
 
@@ -126,7 +131,8 @@ class LogFile:public LogBufferSink, public RefCountObj
 {
 public:
   LogFile(const char *name, const char *header, LogFileFormat format, uint64_t signature,
-          size_t ascii_buffer_size = 4 * 9216, size_t max_line_size = 9216);
+          size_t ascii_buffer_size = 4 * 9216, size_t max_line_size = 9216,
+          LogFileCompression compression = LOG_COMPRESSION_NONE, bool columnar = false);
   LogFile(const LogFile &);
   ~LogFile();
 
@@ -141,6 +147,15 @@ public:
   };
 
   int preproc_and_try_delete(LogBuffer * lb);
+  void drop_buffer(LogBuffer * lb);
+
+  // The buffers of a file may be formatted by several preproc threads at
+  // once.  Each gets a sequence number when it is queued, and its flush
+  // data is held back until that of all the earlier buffers has been
+  // handed to the flush thread.
+  int64_t next_flush_seq() { return ink_atomic_increment(&m_flush_seq_next, (int64_t) 1); }
+  // hands over everything held back, regardless of order
+  void flush_pending();
 
   int roll(long interval_start, long interval_end);
 
@@ -150,12 +165,14 @@ public:
   void change_name(const char *new_name);
 
   LogFileFormat get_format() const { return m_file_format; }
+  LogFileCompression get_compression() const { return m_compression; }
+  bool is_columnar() const { return m_columnar; }
   const char *get_format_name() const {
     return (m_file_format == LOG_FILE_BINARY ? "binary" : (m_file_format == LOG_FILE_PIPE ? "ascii_pipe" : "ascii"));
   }
 
   static int write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, const char *alt_format = NULL);
-  int write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt_format = NULL);
+  int write_ascii_logbuffer3(LogBufferHeader * buffer_header, int64_t flush_seq, const char *alt_format = NULL);
   static bool rolled_logfile(char *file);
   static bool exists(const char *pathname);
 
@@ -175,6 +192,8 @@ public:
 
 public:
   LogFileFormat m_file_format;
+  LogFileCompression m_compression;
+  bool m_columnar;              // binary buffers are written as columnar blocks
 private:
   char *m_name;
 public:
@@ -195,6 +214,17 @@ public:
   Link<LogFile> link;
 
 private:
+  void flush_in_order(int64_t seq, LogFlushData * data);
+  int write_compressed(const char *data, int len);
+
+  ink_mutex m_flush_mutex;
+  int64_t m_flush_seq;          // next buffer to hand to the flush thread
+  volatile int64_t m_flush_seq_next;
+  // flush data of the buffers formatted ahead of their turn
+  LogFlushData *m_flush_pending[LOGFILE_FLUSH_WINDOW];
+  bool m_flush_ready[LOGFILE_FLUSH_WINDOW];
+
+
   // -- member functions not allowed --
   LogFile();
   LogFile & operator=(const LogFile &);
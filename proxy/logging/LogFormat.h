@@ -46,6 +46,14 @@ enum LogFileFormat
   N_LOGFILE_TYPES
 };
 
+enum LogFileCompression
+{
+  LOG_COMPRESSION_NONE,
+  LOG_COMPRESSION_GZIP,
+  LOG_COMPRESSION_ZSTD,
+  N_LOG_COMPRESSION_TYPES
+};
+
 /*-------------------------------------------------------------------------
   LogFormat
 
@@ -34,6 +34,7 @@
 #include "LogUtils.h"
 #include "LogField.h"
 #include "LogObject.h"
+#include "LogCompress.h"
 #include "LogConfig.h"
 #include "LogAccess.h"
 #include "Log.h"
@@ -53,6 +54,7 @@ LogBufferManager::preproc_buffers(LogBufferSink *sink) {
       RecIncrRawStat(log_rsb, this_thread()->mutex->thread_holding,
                      log_stat_bytes_lost_before_preproc_stat,
                      b->header()->byte_count);
+      sink->drop_buffer(b);
       delete b;
     } else {
       new_q.push(b);
@@ -80,7 +82,8 @@ LogObject::LogObject(const LogFormat *format, const char *log_dir,
                      const char *header, int rolling_enabled,
                      int flush_threads, int rolling_interval_sec,
                      int rolling_offset_hr, int rolling_size_mb,
-                     bool auto_created):
+                     bool auto_created, LogFileCompression compression,
+                     bool columnar):
       m_auto_created(auto_created),
       m_alt_filename (NULL),
       m_flags (0),
@@ -103,7 +106,24 @@ LogObject::LogObject(const LogFormat *format, const char *log_dir,
         m_flags |= WRITES_TO_PIPE;
     }
 
-    generate_filenames(log_dir, basename, file_format);
+    // only plain files are compressed
+    if (file_format != LOG_FILE_ASCII) {
+        compression = LOG_COMPRESSION_NONE;
+    }
+    if (compression == LOG_COMPRESSION_GZIP) {
+        m_flags |= GZIP_COMPRESSED;
+    } else if (compression == LOG_COMPRESSION_ZSTD) {
+        m_flags |= ZSTD_COMPRESSED;
+    }
+    // and only binary files are columnar
+    if (file_format != LOG_FILE_BINARY) {
+        columnar = false;
+    }
+    if (columnar) {
+        m_flags |= COLUMNAR;
+    }
+
+    generate_filenames(log_dir, basename, file_format, compression);
 
     // compute_signature is a static function
     m_signature = compute_signature(m_format, m_basename, m_flags);
@@ -114,7 +134,8 @@ LogObject::LogObject(const LogFormat *format, const char *log_dir,
     m_logFile = NEW(new LogFile (m_filename, header, file_format,
                                  m_signature,
                                  Log::config->ascii_buffer_size,
-                                 Log::config->max_line_size));
+                                 Log::config->max_line_size,
+                                 compression, columnar));
 
     LogBuffer *b = NEW (new LogBuffer (this, Log::config->log_buffer_size));
     ink_assert(b);
@@ -176,7 +197,12 @@ LogObject::~LogObject()
     Debug("log-config", "LogObject refcount = %d, waiting for zero", m_ref_count);
   }
 
-  preproc_buffers();
+  for (int i = 0; i < m_flush_threads; i++) {
+    preproc_buffers(i);
+  }
+  if (m_logFile) {
+    m_logFile->flush_pending();
+  }
 
   // here we need to free LogHost if it is remote logging.
   if (is_collation_client()) {
@@ -203,9 +229,12 @@ LogObject::~LogObject()
 // 3.- if there is a '.' at the end of the name, then do not add an extension
 //     and remove the '.'. To have a dot at the end of the filename, specify
 //     two ('..').
+// 4.- compressed logs then get .gz or .zst, unless the name already ends
+//     with it
 //
 void
-LogObject::generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format)
+LogObject::generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format,
+                              LogFileCompression compression)
 {
   ink_assert(log_dir && basename);
 
@@ -242,8 +271,14 @@ LogObject::generate_filenames(const char *log_dir, const char *basename, LogFile
     }
   }
 
+  const char *cext = LogCompress::extension(compression);
+  int cext_len = (int) strlen(cext);
+  if (LogCompress::strip_extension(compression, basename) < len) {
+    cext_len = 0;
+  }
+
   int dir_len = (int) strlen(log_dir);
-  int basename_len = len + ext_len + 1; // include null terminator
+  int basename_len = len + ext_len + cext_len + 1; // include null terminator
   int total_len = dir_len + 1 + basename_len;   // include '/'
 
   m_filename = (char *)ats_malloc(total_len);
@@ -258,6 +293,10 @@ LogObject::generate_filenames(const char *log_dir, const char *basename, LogFile
     memcpy(&m_filename[dir_len + len], ext, ext_len);
     memcpy(&m_basename[len], ext, ext_len);
   }
+  if (cext_len) {
+    memcpy(&m_filename[dir_len + len + ext_len], cext, cext_len);
+    memcpy(&m_basename[len + ext_len], cext, cext_len);
+  }
   m_filename[total_len - 1] = 0;
   m_basename[basename_len - 1] = 0;
 }
@@ -327,11 +366,14 @@ uint64_t LogObject::compute_signature(LogFormat * format, char *filename, unsign
   uint64_t signature = 0;
 
   if (fl && ps && filename) {
-    int buf_size = strlen(fl) + strlen(ps) + strlen(filename) + 2;
+    int buf_size = strlen(fl) + strlen(ps) + strlen(filename) + 3;
     char *buffer = (char *)ats_malloc(buf_size);
 
     ink_string_concatenate_strings(buffer, fl, ps, filename, flags & LogObject::BINARY ? "B" :
-                                   (flags & LogObject::WRITES_TO_PIPE ? "P" : "A"), NULL);
+                                   (flags & LogObject::WRITES_TO_PIPE ? "P" : "A"),
+                                   flags & LogObject::GZIP_COMPRESSED ? "G" :
+                                   (flags & LogObject::ZSTD_COMPRESSED ? "Z" :
+                                    (flags & LogObject::COLUMNAR ? "C" : "")), NULL);
 
     INK_MD5 md5s;
 
@@ -374,7 +416,12 @@ LogObject::displayAsXML(FILE * fd, bool extended)
           "<LogObject>\n"
           "  <Mode        = \"%s\"/>\n"
           "  <Format      = \"%s\"/>\n"
-          "  <Filename    = \"%s\"/>\n", (m_flags & BINARY ? "binary" : "ascii"), m_format->name(), m_filename);
+          "  <Filename    = \"%s\"/>\n", (m_flags & BINARY ? (m_flags & COLUMNAR ? "columnar" : "binary") : "ascii"),
+          m_format->name(), m_filename);
+
+  if (m_logFile && m_logFile->get_compression() != LOG_COMPRESSION_NONE) {
+    fprintf(fd, "  <Compression = \"%s\"/>\n", LogCompress::name(m_logFile->get_compression()));
+  }
 
   LogFilter *filter;
   for (filter = m_filter_list.first(); filter != NULL; filter = m_filter_list.next(filter)) {
@@ -452,9 +499,8 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
       if (FREELIST_POINTER(old_h) == FREELIST_POINTER(h)) {
         ink_atomic_increment(&buffer->m_references, FREELIST_VERSION(old_h) - 1);
 
-        int idx = m_buffer_manager_idx++ % m_flush_threads;
         Debug("log-logbuffer", "adding buffer %d to flush list after checkout", buffer->get_id());
-        m_buffer_manager[idx].add_to_flush_queue(buffer);
+        int idx = add_to_flush_queue(buffer);
         Log::preproc_notify[idx].signal();
 
       }
@@ -1137,8 +1183,13 @@ LogObjectManager::_solve_internal_filename_conflicts(LogObject *log_object, int
     if (fileNum < maxConflicts) {
       char new_name[MAXPATHLEN];
 
-      snprintf(new_name, sizeof(new_name), "%s%s%d",
-               log_object->get_original_filename(), LOGFILE_SEPARATOR_STRING, ++fileNum);
+      // keep the compression extension at the end of the name
+      LogFileCompression compression = log_object->get_compression();
+      const char *filename = log_object->get_original_filename();
+
+      snprintf(new_name, sizeof(new_name), "%.*s%s%d%s",
+               LogCompress::strip_extension(compression, filename), filename,
+               LOGFILE_SEPARATOR_STRING, ++fileNum, LogCompress::extension(compression));
       log_object->rename(new_name);
       retVal = _solve_internal_filename_conflicts(log_object, maxConflicts, fileNum);
     } else {
@@ -90,18 +90,25 @@ public:
     REMOTE_DATA = 2,
     WRITES_TO_PIPE = 4,
     LOG_OBJECT_FMT_TIMESTAMP = 8, // always format a timestamp into each log line (for raw text logs)
+    GZIP_COMPRESSED = 16,
+    ZSTD_COMPRESSED = 32,
+    COLUMNAR = 64
   };
 
   // BINARY: log is written in binary format (rather than ascii)
   // REMOTE_DATA: object receives data from remote collation clients, so
   //              it should not be destroyed during a reconfiguration
   // WRITES_TO_PIPE: object writes to a named pipe rather than to a file
+  // GZIP_COMPRESSED, ZSTD_COMPRESSED: the ascii file is compressed
+  // COLUMNAR: the binary file is written as columnar blocks
 
   LogObject(const LogFormat *format, const char *log_dir, const char *basename,
                  LogFileFormat file_format, const char *header,
                  int rolling_enabled, int flush_threads,
                  int rolling_interval_sec = 0, int rolling_offset_hr = 0,
-                 int rolling_size_mb = 0, bool auto_created = false)
+                 int rolling_size_mb = 0, bool auto_created = false,
+                 LogFileCompression compression = LOG_COMPRESSION_NONE,
+                 bool columnar = false)
     TS_NONNULL(2 /* format is required */);
   LogObject(LogObject &);
   virtual ~LogObject();
@@ -120,8 +127,12 @@ public:
 
   int add_to_flush_queue(LogBuffer * buffer)
   {
-    int idx = m_buffer_manager_idx++ % m_flush_threads;
+    int idx = ink_atomic_increment(&m_buffer_manager_idx, 1) % m_flush_threads;
 
+    // the preproc threads may finish the buffers out of order, the
+    // LogFile puts them back in this one
+    if (m_logFile)
+      buffer->m_flush_seq = m_logFile->next_flush_seq();
     m_buffer_manager[idx].add_to_flush_queue(buffer);
 
     return idx;
@@ -184,6 +195,11 @@ public:
   bool receives_remote_data() const { return m_flags & REMOTE_DATA ? true : false; }
   bool writes_to_pipe() const { return m_flags & WRITES_TO_PIPE ? true : false; }
   bool writes_to_disk() { return (m_logFile && !(m_flags & WRITES_TO_PIPE) ? true : false); }
+  LogFileCompression get_compression() const
+  {
+    return (m_flags & GZIP_COMPRESSED ? LOG_COMPRESSION_GZIP :
+            m_flags & ZSTD_COMPRESSED ? LOG_COMPRESSION_ZSTD : LOG_COMPRESSION_NONE);
+  }
 
   unsigned int get_flags() const { return m_flags; }
 
@@ -233,10 +249,11 @@ private:
   int m_ref_count;
 
   volatile head_p m_log_buffer;     // current work buffer
-  unsigned m_buffer_manager_idx;
+  volatile unsigned m_buffer_manager_idx;
   LogBufferManager *m_buffer_manager;
 
-  void generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format);
+  void generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format,
+                          LogFileCompression compression);
   void _setup_rolling(int rolling_enabled, int rolling_interval_sec, int rolling_offset_hr, int rolling_size_mb);
   int _roll_files(long interval_start, long interval_end);
 
@@ -32,6 +32,7 @@
 #include "LogStandalone.cc"
 
 #include "LogObject.h"
+#include "LogColumnar.h"
 #include "hdrs/HTTP.h"
 
 #include <math.h>
@@ -1701,7 +1702,7 @@ process_file(int in_fd, off_t offset, unsigned max_age)
           return 0;
         }
         // ensure that this is a valid logbuffer header
-        if (header->cookie && (LOG_SEGMENT_COOKIE == header->cookie)) {
+        if (header->cookie && (LOG_SEGMENT_COOKIE == header->cookie || LOG_COLUMN_COOKIE == header->cookie)) {
           offset = 0;
           break;
         }
@@ -1716,7 +1717,7 @@ process_file(int in_fd, off_t offset, unsigned max_age)
         return 0;
 
       // ensure that this is a valid logbuffer header
-      if (header->cookie != LOG_SEGMENT_COOKIE) {
+      if (header->cookie != LOG_SEGMENT_COOKIE && header->cookie != LOG_COLUMN_COOKIE) {
         Debug("logstats", "Invalid segment cookie (expected %d, got %d)", LOG_SEGMENT_COOKIE, header->cookie);
         return 1;
       }
@@ -1734,6 +1735,48 @@ process_file(int in_fd, off_t offset, unsigned max_age)
       return 1;
     }
 
+    // columnar blocks which are too old are skipped without reading
+    // them, the others are turned back into rows
+    if (LOG_COLUMN_COOKIE == header->cookie) {
+      int64_t block_bytes = (int64_t) header->byte_count - sizeof(LogBufferHeader);
+
+      if (block_bytes < 0) {
+        Debug("logstats", "Columnar block byte count [%d] is wrong.", header->byte_count);
+        return 1;
+      }
+      if (header->high_timestamp < max_age) {
+        Debug("logstats", "Skipping old columnar block (age=%d, max=%d)", header->high_timestamp, max_age);
+        if (lseek(in_fd, block_bytes, SEEK_CUR) < 0)
+          return 1;
+        continue;
+      }
+
+      char *block = (char *)ats_malloc(header->byte_count);
+      LogBufferHeader *rows = NULL;
+
+      memcpy(block, header, sizeof(LogBufferHeader));
+      for (nread = 0; nread < block_bytes; ) {
+        int rc = read(in_fd, block + sizeof(LogBufferHeader) + nread, block_bytes - nread);
+        if (rc <= 0)
+          break;
+        nread += rc;
+      }
+      if (nread == block_bytes && LogColumnar::valid_block((LogBufferHeader *)block))
+        rows = LogColumnar::to_rows((LogBufferHeader *)block);
+      ats_free(block);
+      if (!rows) {
+        Debug("logstats", "Failed to read columnar block [%d bytes]", header->byte_count);
+        return 1;
+      }
+      int rc = parse_log_buff(rows, cl.summary != 0);
+      ats_free(rows);
+      if (rc != 0) {
+        Debug("logstats", "Failed to parse log buffer.");
+        return 1;
+      }
+      continue;
+    }
+
     // read the rest of the buffer
     if (header->byte_count > sizeof(buffer)) {
       Debug("logstats", "Header byte count [%d] > expected [%zu]", header->byte_count, sizeof(buffer));